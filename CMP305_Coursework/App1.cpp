@@ -59,12 +59,14 @@ void App1::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeigh
 	light->setDirection(lightDir.x, lightDir.y, lightDir.z);
 
 	m_BiomeGenerator = new BiomeGenerator(renderer->getDevice(), 1);
-	m_HeightmapFilter = new HeightmapFilter(renderer->getDevice(), L"terrainNoise_cs.cso");
+	m_HeightmapFilter = new HeightmapFilter(renderer->getDevice(), L"terrainNoise_cs.cso",
+		L"terrainClassify_cs.cso", L"terrainPrefix_cs.cso", L"terrainScatter_cs.cso", L"terrainNoiseSorted_cs.cso");
 
 	if (m_LoadOnOpen)
 	{
 		loadSettings(std::string(m_SaveFilePath));
 		m_BiomeGenerator->GenerateBiomeMap(renderer->getDevice());
+		updateTerrainGOs();
 		regenerateAllHeightmaps();
 	}
 }
@@ -242,6 +244,21 @@ void App1::gui()
 	{
 		ImGui::Text("FPS: %.2f", timer->getFPS());
 		ImGui::Checkbox("Wireframe mode", &wireframeToggle);
+		bool sorted = m_HeightmapFilter->IsSorted();
+		if (ImGui::Checkbox("Sort texels by biome", &sorted))
+		{
+			m_HeightmapFilter->SetSorted(sorted);
+			regenerateTerrain = true;
+		}
+		// heightmaps read their blend map directly when it has the same resolution (1024)
+		if (ImGui::InputInt("Blend Map Resolution", &m_BlendMapResolution, 64, 256))
+		{
+			if (m_BlendMapResolution < 2) m_BlendMapResolution = 2;
+			if (m_BlendMapResolution > 1024) m_BlendMapResolution = 1024;
+			for (auto heightmap : m_Heightmaps)
+				heightmap.second->SetBlendMapResolution(renderer->getDevice(), m_BlendMapResolution);
+			regenerateTerrain = true;
+		}
 		ImGui::Separator();
 
 		if (ImGui::TreeNode("Camera"))
@@ -353,7 +370,11 @@ void App1::gui()
 	ImGui::Separator();
 
 	if (regenerateTerrain)
+	{
+		// switching between bounded and unbounded worlds changes which tiles exist
+		updateTerrainGOs();
 		regenerateAllHeightmaps();
+	}
 }
 
 void App1::regenerateAllHeightmaps()
@@ -365,6 +386,9 @@ void App1::regenerateAllHeightmaps()
 
 void App1::regenerateHeightmap(Heightmap* heightmap)
 {
+	// the blend map is baked from the biome map as it is now, and read by the heightmap filter and terrain shader
+	heightmap->GetBlendMap()->Bake(renderer->getDeviceContext(), m_BiomeGenerator, heightmap->GetOffset());
+
 	if (m_HeightmapFilter)
 		m_HeightmapFilter->Run(renderer->getDeviceContext(), heightmap, m_BiomeGenerator);
 }
@@ -387,10 +411,23 @@ void App1::updateTerrainGOs()
 		};
 
 		// make sure this tile is in bounds
-		if (tile.x >= 0 && tile.y >= 0)
+		// unbounded worlds have no bounds
+		bool unbounded = m_BiomeGenerator && m_BiomeGenerator->IsWorldUnbounded();
+		if (unbounded || (tile.x >= 0 && tile.y >= 0))
 			tilesInView.insert({ tile.x, tile.y });
 	}
 
+	if (m_BiomeGenerator)
+	{
+		// the biome map must cover all of the tiles in view before any heightmaps are generated
+		m_BiomeGenerator->SetViewRegion(
+			renderer->getDevice(),
+			{ worldTileInt.x - (m_ViewSize / 2), worldTileInt.y - (m_ViewSize / 2) },
+			{ worldTileInt.x - (m_ViewSize / 2) + m_ViewSize - 1, worldTileInt.y - (m_ViewSize / 2) + m_ViewSize - 1 }
+		);
+		m_BiomeGenerator->UpdateBuffers(renderer->getDeviceContext());
+	}
+
 	// identify any terrains that are out of view
 	std::queue<std::pair<int, int>> tilesToDelete;
 	for (auto& heightmap : m_Heightmaps)
@@ -422,7 +459,7 @@ void App1::updateTerrainGOs()
 			m_GameObjects.push_back(newGO);
 			m_Terrains.insert({ tile, m_GameObjects.back() });
 
-			Heightmap* newHeightmap = new Heightmap(renderer->getDevice(), 1024);
+			Heightmap* newHeightmap = new Heightmap(renderer->getDevice(), 1024, m_BlendMapResolution);
 			newHeightmap->SetOffset({
 				static_cast<float>(tile.first),
 				static_cast<float>(tile.second)
@@ -493,6 +530,7 @@ void App1::saveSettings(const std::string& file)
 	nlohmann::json serialized;
 
 	serialized["biomeGenerator"] = m_BiomeGenerator->Serialize();
+	serialized["biomePipeline"] = m_BiomeGenerator->SerializePipeline();
 
 	// serialize light settings
 	serialized["lightDir"] = SerializationHelper::SerializeFloat3(lightDir);
@@ -522,6 +560,8 @@ void App1::loadSettings(const std::string& file)
 	infile.close();
 
 	if (data.contains("biomeGenerator")) m_BiomeGenerator->LoadFromJson(data["biomeGenerator"]);
+	// settings saved before pipelines were configurable use the default pipeline
+	m_BiomeGenerator->LoadPipelineFromJson(data.contains("biomePipeline") ? data["biomePipeline"] : nlohmann::json());
 
 	if (data.contains("lightDir")) SerializationHelper::LoadFloat3FromJson(&lightDir, data["lightDir"]);
 	if (data.contains("lightDiffuse")) SerializationHelper::LoadFloat3FromJson(&lightDiffuse, data["lightDiffuse"]);
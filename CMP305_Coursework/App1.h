@@ -82,6 +82,8 @@ private:
 
 	BiomeGenerator* m_BiomeGenerator = nullptr;
 	HeightmapFilter* m_HeightmapFilter = nullptr;
+	// resolution of each tile's biome blend map
+	int m_BlendMapResolution = 1024;
 	
 	char m_SaveFilePath[128];
 	bool m_LoadOnOpen = true;
@@ -0,0 +1,96 @@
+#include "BiomeBlendMap.h"
+
+#include <cassert>
+#include <vector>
+
+#include "BiomeBlending.h"
+#include "BiomeGenerator.h"
+#include "Parallel.h"
+
+
+BiomeBlendMap::BiomeBlendMap(ID3D11Device* device, unsigned int resolution)
+	: m_Resolution(resolution)
+{
+	HRESULT hr;
+
+	D3D11_TEXTURE2D_DESC textureDesc;
+	ZeroMemory(&textureDesc, sizeof(textureDesc));
+	textureDesc.Width = m_Resolution;
+	textureDesc.Height = m_Resolution;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R32G32_UINT;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT; // updated from the CPU whenever the tile is baked
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.MiscFlags = 0;
+	hr = device->CreateTexture2D(&textureDesc, nullptr, &m_Texture);
+	assert(hr == S_OK);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC descSRV;
+	descSRV.Format = textureDesc.Format;
+	descSRV.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	descSRV.Texture2D.MostDetailedMip = 0;
+	descSRV.Texture2D.MipLevels = 1;
+	hr = device->CreateShaderResourceView(m_Texture, &descSRV, &m_SRV);
+	assert(hr == S_OK);
+}
+
+BiomeBlendMap::~BiomeBlendMap()
+{
+	if (m_SRV) m_SRV->Release();
+	if (m_Texture) m_Texture->Release();
+}
+
+void BiomeBlendMap::Bake(ID3D11DeviceContext* deviceContext, const BiomeGenerator* biomeGenerator, const XMFLOAT2& offset)
+{
+	// the blending only depends on the biome map and the offset, not on the noise settings that usually cause a rebake
+	const unsigned int version = biomeGenerator->GetBiomeMapVersion();
+	if (m_Baked && m_BakedVersion == version && m_BakedOffset.x == offset.x && m_BakedOffset.y == offset.y)
+		return;
+
+	const BiomeBlending::Mapping mapping = biomeGenerator->GetBiomeMapping();
+	const BiomeCell* map = biomeGenerator->GetBiomeMap();
+	const int size = static_cast<int>(biomeGenerator->GetBiomeMapSize());
+
+	// staging for the upload, shared by every blend map's bakes (which all happen on the render thread), so it isn't
+	// allocated again for each bake and no map keeps a copy of its texels
+	static std::vector<XMUINT2> texels;
+	const size_t texelCount = static_cast<size_t>(m_Resolution) * m_Resolution;
+	if (texels.size() < texelCount) texels.resize(texelCount);
+
+	// the same positions as the texels of a heightmap over the tile
+	const float texelScale = static_cast<float>(m_Resolution - 1);
+	Parallel::For(0, static_cast<int>(m_Resolution), biomeGenerator->GetThreadCount(), [&](int firstRow, int lastRow)
+	{
+		for (int row = firstRow; row < lastRow; row++)
+		{
+			const float posY = static_cast<float>(row) / texelScale + offset.y;
+			for (unsigned int column = 0; column < m_Resolution; column++)
+			{
+				const float posX = static_cast<float>(column) / texelScale + offset.x;
+				const BiomeBlending::Sample sample = BiomeBlending::GetSample(posX, posY, map, size, mapping);
+
+				XMUINT2& texel = texels[static_cast<size_t>(row) * m_Resolution + column];
+				texel.x = sample.biomes[0] | (sample.biomes[1] << 8) | (sample.biomes[2] << 16) | (sample.biomes[3] << 24);
+				texel.y = PackWeight(sample.blendX) | (PackWeight(sample.blendY) << 16);
+			}
+		}
+	});
+
+	deviceContext->UpdateSubresource(m_Texture, 0, nullptr, texels.data(), sizeof(XMUINT2) * m_Resolution, 0);
+
+	m_Baked = true;
+	m_BakedVersion = version;
+	m_BakedOffset = offset;
+}
+
+unsigned int BiomeBlendMap::PackWeight(float weight)
+{
+	const float magnitude = (weight < 0.0f ? -weight : weight) * 32767.0f;
+	int snorm = static_cast<int>(magnitude);
+	if (static_cast<float>(snorm) < magnitude && snorm < 32767) snorm++;
+	return static_cast<unsigned int>(weight < 0.0f ? -snorm : snorm) & 0xFFFF;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+class BiomeGenerator;
+
+
+// The biomes blended at each texel of a tile and their blend weights, baked on the CPU (see BiomeBlending) after the biome
+// map is generated, so terrainNoise_cs, the terrain shader and anything else drawing the tile read one result rather than
+// each finding the biome map cells and blend weights again
+// Each R32G32_UINT texel holds the four biome IDs in the bytes of x (as BiomeBlending::Sample), and the signed blend
+// weights along x and y as 16-bit snorms in the low and high halves of y; see LoadBiomeBlendSample in biomeHelper.hlsli
+// Texels lie on the same grid as a heightmap's, so a blend map with the heightmap's resolution matches it texel for texel
+class BiomeBlendMap
+{
+public:
+	BiomeBlendMap(ID3D11Device* device, unsigned int resolution);
+	~BiomeBlendMap();
+
+	// bakes the blending over the tile at offset (in tiles) from the biome generator's current biome map
+	// does nothing when the map was last baked at the same offset from the same version of the biome map
+	void Bake(ID3D11DeviceContext* deviceContext, const BiomeGenerator* biomeGenerator, const XMFLOAT2& offset);
+
+	ID3D11ShaderResourceView* GetSRV() const { return m_SRV; }
+	unsigned int GetResolution() const { return m_Resolution; }
+
+	// a signed blend weight in [-1, 1] as a 16-bit snorm, rounded away from zero so only a weight of 0 packs to 0
+	static unsigned int PackWeight(float weight);
+
+private:
+	unsigned int m_Resolution = 256;
+
+	ID3D11Texture2D* m_Texture = nullptr;
+	ID3D11ShaderResourceView* m_SRV = nullptr;
+
+	// what the texture was last baked from
+	bool m_Baked = false;
+	unsigned int m_BakedVersion = 0;
+	XMFLOAT2 m_BakedOffset{ 0.0f, 0.0f };
+};
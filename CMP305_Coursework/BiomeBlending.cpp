@@ -0,0 +1,64 @@
+#include "BiomeBlending.h"
+
+#include <cmath>
+
+
+// HLSL intrinsics, as used by biomeHelper.hlsli
+static inline float Step(float edge, float x)
+{
+	return x >= edge ? 1.0f : 0.0f;
+}
+
+static inline float SmoothStep01(float x)
+{
+	// saturate: NaN becomes 0
+	float t = x > 0.0f ? (x < 1.0f ? x : 1.0f) : 0.0f;
+	return t * t * (3.0f - 2.0f * t);
+}
+
+
+float BiomeBlending::Blend(float biomeUV, float blending)
+{
+	float blend = 0.0f;
+	blend += Step(biomeUV, 0.5f) * (SmoothStep01(biomeUV / blending + 0.5f) - 1.0f);
+	blend += Step(0.5f, biomeUV) * SmoothStep01((biomeUV * (1 + blending) - 1.0f) / (2.0f * blending));
+	return blend;
+}
+
+int BiomeBlending::GetCell(float pos, const Mapping& mapping, float& biomeUV)
+{
+	// GetBiomeMapUV, then scaled onto the cells as GetBiomeMapLocation and GetBiomeUV do
+	const float resolution = static_cast<float>(mapping.resolution);
+	const float cell = static_cast<float>(mapping.resolution - 1) * (pos * mapping.pxPerTile / resolution);
+	const float cellFloor = floorf(cell);
+	biomeUV = cell - cellFloor;
+	return static_cast<int>(cellFloor);
+}
+
+BiomeCell BiomeBlending::GetBiome(const BiomeCell* map, int size, const Mapping& mapping, int cellX, int cellY)
+{
+	const int x = cellX - mapping.originX;
+	const int y = cellY - mapping.originY;
+	if (!map || x < 0 || y < 0 || x >= size || y >= size)
+		return 0;
+	return map[static_cast<size_t>(y) * size + x];
+}
+
+BiomeBlending::Sample BiomeBlending::GetSample(float posX, float posY, const BiomeCell* map, int size, const Mapping& mapping)
+{
+	float uvX, uvY;
+	const int x = GetCell(posX, mapping, uvX);
+	const int y = GetCell(posY, mapping, uvY);
+
+	Sample sample;
+	sample.blendX = Blend(uvX, mapping.blending);
+	sample.blendY = Blend(uvY, mapping.blending);
+
+	const int dx = Sign(sample.blendX);
+	const int dy = Sign(sample.blendY);
+	sample.biomes[0] = GetBiome(map, size, mapping, x, y);
+	sample.biomes[1] = GetBiome(map, size, mapping, x + dx, y);
+	sample.biomes[2] = GetBiome(map, size, mapping, x, y + dy);
+	sample.biomes[3] = GetBiome(map, size, mapping, x + dx, y + dy);
+	return sample;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "BiomeMapBuffer.h"
+
+
+// CPU port of the biome blending in biomeHelper.hlsli: which biome map cells a world position blends between, and how much
+// Used to bake BiomeBlendMaps and by HeightmapBaker, so both see exactly the blending the shaders compute
+class BiomeBlending
+{
+public:
+	// pure static class
+	BiomeBlending() = delete;
+
+	// how world positions map onto the biome map, as BiomeMappingBuffer in biomeHelper.hlsli
+	struct Mapping
+	{
+		float pxPerTile = 8.0f;
+		int resolution = 0;
+		float blending = 0.5f;
+		// cell of the world that the biome map begins at
+		int originX = 0;
+		int originY = 0;
+	};
+
+	// the biomes blended at a position, and their signed blend weights, as terrainNoise_cs.hlsl finds them
+	// biomes are the biome at the position, then its neighbours along x, along y, and along both; where the position isn't
+	// blended along an axis its neighbours along that axis are the biome itself
+	struct Sample
+	{
+		BiomeCell biomes[4] = { 0, 0, 0, 0 };
+		float blendX = 0.0f;
+		float blendY = 0.0f;
+	};
+
+	// HLSL sign
+	static inline int Sign(float x) { return x > 0.0f ? 1 : (x < 0.0f ? -1 : 0); }
+
+	// GetBiomeBlend for one axis, from the position within a cell
+	static float Blend(float biomeUV, float blending);
+
+	// the world cell containing pos along one axis, and how far through the cell pos is, in [0, 1)
+	static int GetCell(float pos, const Mapping& mapping, float& biomeUV);
+
+	// map holds size x size cells from the mapping's origin; cells outside it are biome 0, as texture loads out of bounds return 0
+	static BiomeCell GetBiome(const BiomeCell* map, int size, const Mapping& mapping, int cellX, int cellY);
+	static Sample GetSample(float posX, float posY, const BiomeCell* map, int size, const Mapping& mapping);
+};
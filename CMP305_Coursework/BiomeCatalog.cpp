@@ -0,0 +1,83 @@
+#include "BiomeCatalog.h"
+
+#include <cstring>
+
+
+void BiomeCatalog::CreateBiomes(std::vector<Biome>& biomes, SpawnLists& spawnableLand, SpawnLists& spawnableOcean)
+{
+	// create biomes
+	biomes.clear();
+	biomes.push_back({ "Ocean",				BIOME_TYPE_OCEAN, BIOME_TEMP_TEMPERATE, 10 });
+	biomes.push_back({ "Plains",			BIOME_TYPE_LAND,  BIOME_TEMP_TEMPERATE, 2 });
+	biomes.push_back({ "Mountains",			BIOME_TYPE_LAND,  BIOME_TEMP_TEMPERATE, 1 });
+	biomes.push_back({ "Desert",			BIOME_TYPE_LAND,  BIOME_TEMP_WARM,		2 });
+	biomes.push_back({ "Desert Hills",		BIOME_TYPE_LAND,  BIOME_TEMP_WARM,		1 });
+	biomes.push_back({ "Tundra",			BIOME_TYPE_LAND,  BIOME_TEMP_COLD,		2 });
+	biomes.push_back({ "Snowy Mountains",	BIOME_TYPE_LAND,  BIOME_TEMP_COLD,		1 });
+	biomes.push_back({ "Shore",				BIOME_TYPE_LAND,  BIOME_TEMP_TEMPERATE,	1 });
+	biomes.push_back({ "Cold Shore",		BIOME_TYPE_LAND,  BIOME_TEMP_COLD,		1 });
+	biomes.push_back({ "Islands",			BIOME_TYPE_OCEAN, BIOME_TEMP_TEMPERATE,	1 });
+	biomes.push_back({ "Warm Ocean",		BIOME_TYPE_OCEAN, BIOME_TEMP_TEMPERATE,	1 });
+	biomes.push_back({ "Cold Ocean",		BIOME_TYPE_OCEAN, BIOME_TEMP_TEMPERATE,	1 });
+
+	// process biome list
+#define BID(x) FindBiome(biomes, x)
+
+	// set up spawnable biomes
+	spawnableLand.clear();
+	spawnableLand.insert(std::make_pair(BIOME_TEMP_COLD,
+		std::vector<int>({ BID("Tundra"), BID("Snowy Mountains") })));
+
+	spawnableLand.insert(std::make_pair(BIOME_TEMP_TEMPERATE,
+		std::vector<int>({ BID("Plains"), BID("Mountains") })));
+
+	spawnableLand.insert(std::make_pair(BIOME_TEMP_WARM,
+		std::vector<int>({ BID("Desert"), BID("Desert Hills") })));
+
+
+	spawnableOcean.clear();
+	spawnableOcean.insert(std::make_pair(BIOME_TEMP_COLD,
+		std::vector<int>({ BID("Cold Ocean") })));
+
+	spawnableOcean.insert(std::make_pair(BIOME_TEMP_TEMPERATE,
+		std::vector<int>({ BID("Ocean"), BID("Islands") })));
+
+	spawnableOcean.insert(std::make_pair(BIOME_TEMP_WARM,
+		std::vector<int>({ BID("Warm Ocean") })));
+
+#undef BID
+}
+
+int BiomeCatalog::FindBiome(const std::vector<Biome>& biomes, const char* name)
+{
+	int index = 0;
+	for (auto& biome : biomes)
+	{
+		if (strcmp(name, biome.name) == 0)
+			return index;
+		index++;
+	}
+	return -1;
+}
+
+void BiomeCatalog::FillRules(BiomeRules& rules, const std::vector<Biome>& biomes, const SpawnLists& spawnableLand, const SpawnLists& spawnableOcean)
+{
+	rules.biomeCount = static_cast<int>(biomes.size());
+	for (int i = 0; i < rules.biomeCount; i++)
+	{
+		rules.biomeTypes[i] = biomes[i].type;
+		rules.biomeTemps[i] = biomes[i].temperature;
+		rules.spawnWeights[i] = biomes[i].spawnWeight;
+	}
+
+	for (int temp = 0; temp < BIOME_TEMP_COUNT; temp++)
+	{
+		auto land = spawnableLand.find(static_cast<BIOME_TEMP>(temp));
+		rules.spawnableLandBiomes[temp] = land != spawnableLand.end() ? land->second : std::vector<int>();
+		auto ocean = spawnableOcean.find(static_cast<BIOME_TEMP>(temp));
+		rules.spawnableOceanBiomes[temp] = ocean != spawnableOcean.end() ? ocean->second : std::vector<int>();
+	}
+
+	rules.shoreBiome = FindBiome(biomes, "Shore");
+	rules.coldShoreBiome = FindBiome(biomes, "Cold Shore");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "BiomeRules.h"
+
+
+// The built-in biomes, and which of them can spawn at each temperature
+// Kept apart from BiomeGenerator so that tools without a D3D device build exactly the same BiomeRules
+class BiomeCatalog
+{
+public:
+	// pure static class
+	BiomeCatalog() = delete;
+
+	struct Biome
+	{
+		// debug
+		const char* name = nullptr;
+
+		// spawning properties
+		BIOME_TYPE type;
+		BIOME_TEMP temperature;
+		int spawnWeight;
+	};
+
+	// biome IDs that can spawn at each temperature
+	typedef std::map<BIOME_TEMP, std::vector<int>> SpawnLists;
+
+	// biome IDs are indices into biomes
+	static void CreateBiomes(std::vector<Biome>& biomes, SpawnLists& spawnableLand, SpawnLists& spawnableOcean);
+
+	// -1 if there is no biome with that name
+	static int FindBiome(const std::vector<Biome>& biomes, const char* name);
+
+	// fills in every per-biome property of the rules; the seed and chances are left as they are
+	static void FillRules(BiomeRules& rules, const std::vector<Biome>& biomes, const SpawnLists& spawnableLand, const SpawnLists& spawnableOcean);
+};
@@ -0,0 +1,148 @@
+#include "BiomeDistance.h"
+
+#include <cmath>
+#include <limits>
+
+#include "Parallel.h"
+
+
+const float BiomeDistanceField::Infinity = std::numeric_limits<float>::infinity();
+
+
+void BiomeDistanceField::Build(const BiomeCell* cells, int size, int originX, int originY, const BiomeCell* lut, unsigned int threadCount)
+{
+	m_Size = size;
+	m_OriginX = originX;
+	m_OriginY = originY;
+
+	const int cellCount = size * size;
+	m_Distances.assign(cellCount, Infinity);
+	m_Values.resize(cellCount);
+	m_ColumnDistances.resize(cellCount);
+
+	bool present[256] = {};
+	for (int cell = 0; cell < cellCount; cell++)
+	{
+		m_Values[cell] = lut ? lut[cells[cell]] : cells[cell];
+		present[m_Values[cell]] = true;
+	}
+
+	// the distance to a different value is the distance transform of every other value, so each value
+	// on the map gets its own transform; the number of values on a biome map is small, keeping this linear
+	int valueCount = 0;
+	for (int v = 0; v < 256; v++)
+		valueCount += present[v] ? 1 : 0;
+	if (valueCount < 2) return;
+
+	for (int v = 0; v < 256; v++)
+	{
+		if (present[v])
+			Transform(static_cast<BiomeCell>(v), threadCount);
+	}
+}
+
+float BiomeDistanceField::GetDistance(int x, int y) const
+{
+	if (m_Size == 0) return Infinity;
+
+	x -= m_OriginX;
+	y -= m_OriginY;
+	x = x < 0 ? 0 : (x >= m_Size ? m_Size - 1 : x);
+	y = y < 0 ? 0 : (y >= m_Size ? m_Size - 1 : y);
+	return m_Distances[y * m_Size + x];
+}
+
+void BiomeDistanceField::Transform(BiomeCell value, unsigned int threadCount)
+{
+	// separable exact transform (Meijster et al.): a pass down each column, then a lower envelope of parabolas along each row
+	const int size = m_Size;
+
+	// larger than any distance on the map, so columns without a feature never win against one with
+	const int far = 2 * size;
+
+	// COLUMN PASS
+	// features are the cells without this value
+	Parallel::For(0, size, threadCount, [&](int x0, int x1)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			int* g = m_ColumnDistances.data() + x;
+			const BiomeCell* values = m_Values.data() + x;
+
+			g[0] = values[0] != value ? 0 : far;
+			for (int y = 1; y < size; y++)
+				g[y * size] = values[y * size] != value ? 0 : g[(y - 1) * size] + 1;
+			for (int y = size - 2; y >= 0; y--)
+			{
+				if (g[(y + 1) * size] < g[y * size])
+					g[y * size] = g[(y + 1) * size] + 1;
+			}
+		}
+	}, 16);
+
+	// ROW PASS
+	const int workers = Parallel::WorkerCount(size, threadCount, 8);
+	if (m_Envelopes.size() < static_cast<size_t>(workers))
+		m_Envelopes.resize(workers);
+
+	Parallel::ForWorkers(0, size, threadCount, [&](int worker, int y0, int y1)
+	{
+		Envelope& envelope = m_Envelopes[worker];
+		envelope.sites.resize(size);
+		envelope.starts.resize(size);
+		int* s = envelope.sites.data();
+		int* t = envelope.starts.data();
+
+		for (int y = y0; y < y1; y++)
+		{
+			const int* g = m_ColumnDistances.data() + y * size;
+			const BiomeCell* values = m_Values.data() + y * size;
+			float* distances = m_Distances.data() + y * size;
+
+			// squared distance from x to the nearest feature in column i
+			auto f = [g](int64_t x, int64_t i) { return (x - i) * (x - i) + static_cast<int64_t>(g[i]) * g[i]; };
+			// first x at which column u's parabola is below column i's, for i < u
+			auto sep = [g](int64_t i, int64_t u)
+			{
+				int64_t n = u * u - i * i + static_cast<int64_t>(g[u]) * g[u] - static_cast<int64_t>(g[i]) * g[i];
+				int64_t d = 2 * (u - i);
+				return n >= 0 ? n / d : -((-n + d - 1) / d);
+			};
+
+			int q = 0;
+			s[0] = 0;
+			t[0] = 0;
+			for (int u = 1; u < size; u++)
+			{
+				while (q >= 0 && f(t[q], s[q]) > f(t[q], u))
+					q--;
+
+				if (q < 0)
+				{
+					q = 0;
+					s[0] = u;
+				}
+				else
+				{
+					int64_t w = 1 + sep(s[q], u);
+					if (w < size)
+					{
+						q++;
+						s[q] = u;
+						t[q] = static_cast<int>(w);
+					}
+				}
+			}
+
+			for (int u = size - 1; u >= 0; u--)
+			{
+				if (values[u] == value)
+				{
+					int64_t d = f(u, s[q]);
+					distances[u] = d >= static_cast<int64_t>(far) * far ? Infinity : sqrtf(static_cast<float>(d));
+				}
+				if (u == t[q]) q--;
+			}
+		}
+	}, 8);
+}
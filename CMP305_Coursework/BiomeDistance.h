@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BiomeMapBuffer.h"
+
+
+// Exact Euclidean distance from every cell of a biome map to the nearest cell with a different value
+// As with BiomeRegionIndex, values are the cells after a lookup table is applied,
+// so the same code gives distance to a biome border (no table) or distance to the coast (a biome -> type table)
+//
+// Distances are between cell centres, measured in cells: a cell next to a different value is 1 away
+// Cells whose value covers the whole map have no border to measure to, and are Infinity
+class BiomeDistanceField
+{
+public:
+	static const float Infinity;
+
+	BiomeDistanceField() = default;
+
+	// measures the size * size map cells, whose first cell is at (originX, originY) in the world
+	// lut maps each cell to the value borders are formed from; nullptr uses the cells themselves
+	void Build(const BiomeCell* cells, int size, int originX, int originY, const BiomeCell* lut, unsigned int threadCount);
+
+	// distance at a cell in world cells; cells outside the map use the nearest cell on the map
+	float GetDistance(int x, int y) const;
+
+	inline int GetSize() const { return m_Size; }
+	// size * size distances in row order, e.g. for uploading as a texture
+	inline const float* GetData() const { return m_Distances.data(); }
+
+private:
+	// squared distance transform of the cells that don't have this value, written to the cells that do
+	void Transform(BiomeCell value, unsigned int threadCount);
+
+private:
+	int m_Size = 0;
+	int m_OriginX = 0, m_OriginY = 0;
+
+	std::vector<float> m_Distances;
+
+	// the value of every cell after the lookup table
+	std::vector<BiomeCell> m_Values;
+	// vertical distance from each cell to the nearest feature in its column
+	std::vector<int> m_ColumnDistances;
+
+	// per-worker lower envelope of parabolas for the row pass
+	struct Envelope
+	{
+		std::vector<int> sites;
+		std::vector<int> starts;
+	};
+	std::vector<Envelope> m_Envelopes;
+};
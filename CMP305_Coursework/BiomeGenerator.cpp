@@ -5,8 +5,9 @@
 
 #include "imGUI/imgui.h"
 #include "SerializationHelper.h"
-
-
+#include "BiomeSettingsJson.h"
+#include "BiomeLayerStack.h"
+#include "BiomeStages.h"
 
 
 
@@ -97,60 +98,33 @@ void BiomeGenerator::BiomeTan::LoadFromJson(const nlohmann::json& data)
 
 
 BiomeGenerator::BiomeGenerator(ID3D11Device* device, unsigned int seed)
-	: m_Device(device), m_RNG(seed), m_Chance(1, 100)
+	: m_Device(device), m_Seed(seed)
 {
 	// create biomes
-	m_AllBiomes.clear();
-	m_AllBiomes.push_back({ "Ocean",			BIOME_TYPE_OCEAN, BIOME_TEMP_TEMPERATE, 10 });
-	m_AllBiomes.push_back({ "Plains",			BIOME_TYPE_LAND,  BIOME_TEMP_TEMPERATE, 2 });
-	m_AllBiomes.push_back({ "Mountains",		BIOME_TYPE_LAND,  BIOME_TEMP_TEMPERATE, 1 });
-	m_AllBiomes.push_back({ "Desert",			BIOME_TYPE_LAND,  BIOME_TEMP_WARM,		2 });
-	m_AllBiomes.push_back({ "Desert Hills",		BIOME_TYPE_LAND,  BIOME_TEMP_WARM,		1 });
-	m_AllBiomes.push_back({ "Tundra",			BIOME_TYPE_LAND,  BIOME_TEMP_COLD,		2 });
-	m_AllBiomes.push_back({ "Snowy Mountains",	BIOME_TYPE_LAND,  BIOME_TEMP_COLD,		1 });
-	m_AllBiomes.push_back({ "Shore",			BIOME_TYPE_LAND,  BIOME_TEMP_TEMPERATE,	1 });
-	m_AllBiomes.push_back({ "Cold Shore",		BIOME_TYPE_LAND,  BIOME_TEMP_COLD,		1 });
-	m_AllBiomes.push_back({ "Islands",			BIOME_TYPE_OCEAN, BIOME_TEMP_TEMPERATE,	1 });
-	m_AllBiomes.push_back({ "Warm Ocean",		BIOME_TYPE_OCEAN, BIOME_TEMP_TEMPERATE,	1 });
-	m_AllBiomes.push_back({ "Cold Ocean",		BIOME_TYPE_OCEAN, BIOME_TEMP_TEMPERATE,	1 });
-
-	// process biome list
-#define BID(x) GetBiomeIDByName(x)
-
-	// set up spawnable biomes
-	m_SpawnableLandBiomesByTemp.insert(std::make_pair(BIOME_TEMP_COLD,
-		std::vector<int>({ BID("Tundra"), BID("Snowy Mountains") })));
-
-	m_SpawnableLandBiomesByTemp.insert(std::make_pair( BIOME_TEMP_TEMPERATE,
-		std::vector<int>({ BID("Plains"), BID("Mountains") })));
-
-	m_SpawnableLandBiomesByTemp.insert(std::make_pair( BIOME_TEMP_WARM,
-		std::vector<int>({ BID("Desert"), BID("Desert Hills") })));
-
-
-	m_SpawnableOceanBiomesByTemp.insert(std::make_pair(BIOME_TEMP_COLD,
-		std::vector<int>({ BID("Cold Ocean") })));
-
-	m_SpawnableOceanBiomesByTemp.insert(std::make_pair(BIOME_TEMP_TEMPERATE,
-		std::vector<int>({ BID("Ocean"), BID("Islands") })));
-
-	m_SpawnableOceanBiomesByTemp.insert(std::make_pair(BIOME_TEMP_WARM,
-		std::vector<int>({ BID("Warm Ocean") })));
+	BiomeCatalog::CreateBiomes(m_AllBiomes, m_SpawnableLandBiomesByTemp, m_SpawnableOceanBiomesByTemp);
 
 	// create resources buffers
-	CreateBiomeMappingBuffer(device);
-	CreateGenerationSettingsBuffer(device);
-	CreateBiomeTanBuffer(device);
+	if (device)
+	{
+		CreateBiomeMappingBuffer(device);
+		CreateGenerationSettingsBuffer(device);
+		CreateLayerSourcesBuffer(device);
+		CreateBiomeTanBuffer(device);
+	}
 }
 
 BiomeGenerator::~BiomeGenerator()
 {
-	if (m_BiomeMap) delete m_BiomeMap;
 	if (m_BiomeMapSRV) m_BiomeMapSRV->Release();
+	if (m_DistanceFieldSRV) m_DistanceFieldSRV->Release();
+	if (m_LayerStack) delete m_LayerStack;
 
 	if (m_GenerationSettingsBuffer) m_GenerationSettingsBuffer->Release();
 	if (m_GenerationSettingsView) m_GenerationSettingsView->Release();
 
+	if (m_LayerSourcesBuffer) m_LayerSourcesBuffer->Release();
+	if (m_LayerSourcesView) m_LayerSourcesView->Release();
+
 	if (m_BiomeTanBuffer) m_BiomeTanBuffer->Release();
 	if (m_BiomeTanView) m_BiomeTanView->Release();
 
@@ -166,9 +140,24 @@ bool BiomeGenerator::SettingsGUI()
 		ImGui::Separator();
 
 		ImGui::Text("Biome map size: %d", m_BiomeMapSize);
+		ImGui::Text("Biome regions: %d", m_BiomeRegions.GetRegionCount());
+		const auto& land = m_Landmasses.GetRegionsWithValue(BIOME_TYPE_LAND);
+		ImGui::Text("Landmasses: %d (largest %d cells)", static_cast<int>(land.size()), land.empty() ? 0 : m_Landmasses.GetRegion(land.front()).area);
+		if (m_UnboundedWorld && m_LayerStack)
+			ImGui::Text("Cached layer chunks: %d", static_cast<int>(m_LayerStack->GetCachedChunkCount()));
 		ImGui::Text("Mapping:");
-		changed |= ImGui::DragFloat("Pixels Per Tile", &m_BiomeMapPxPerTile, 0.01f);
-		changed |= ImGui::SliderFloat("Blending", &m_BiomeBlending, 0.0f, 1.0f);
+		if (ImGui::DragFloat("Pixels Per Tile", &m_BiomeMapPxPerTile, 0.01f))
+		{
+			// the cells in view have changed
+			if (m_UnboundedWorld && m_LayerStack) UpdateBiomeMapWindow(m_Device, false);
+			m_BiomeMapVersion++;
+			changed = true;
+		}
+		if (ImGui::SliderFloat("Blending", &m_BiomeBlending, 0.0f, 1.0f))
+		{
+			m_BiomeMapVersion++;
+			changed = true;
+		}
 	
 		ImGui::Checkbox("Show Biome Map", &m_ShowBiomeMap);
 
@@ -182,6 +171,7 @@ bool BiomeGenerator::SettingsGUI()
 
 		// these values don't modify 'changed' as they don't affect world generation, only biome generation
 		ImGui::InputInt("Seed", (int*)(&m_Seed));
+		ImGui::Checkbox("Unbounded World", &m_UnboundedWorld);
 		ImGui::Text("Generation Probabilities:");
 		ImGui::SliderInt("Continent", &m_ContinentChance, 0, 100);
 		ImGui::SliderInt("Island Expand", &m_IslandExpandChance, 0, 100);
@@ -192,6 +182,18 @@ bool BiomeGenerator::SettingsGUI()
 		ImGui::DragInt("Temperate Biome", &m_TemperateBiomeChance, 0.1f);
 		ImGui::DragInt("Warm Biome", &m_WarmBiomeChance, 0.1f);
 
+		ImGui::Separator();
+		ImGui::SliderInt("Threads (0 = auto)", &m_ThreadCount, 0, 64);
+		ImGui::SliderInt("Stage Tile Size", &m_StageTileSize, 8, 512);
+
+		ImGui::Separator();
+
+		if (ImGui::TreeNode("Pipeline"))
+		{
+			PipelineGUI();
+			ImGui::TreePop();
+		}
+
 		ImGui::Separator();
 
 		if (ImGui::Button("Regenerate Biome Map"))
@@ -224,6 +226,12 @@ bool BiomeGenerator::SettingsGUI()
 		if (ImGui::TreeNode("Heightmap Generation"))
 		{
 			changed |= m_GenerationSettings[selectedBiome].SettingsGUI();
+
+			// layers evaluated once for this biome and the one named, where they blend
+			const TerrainNoiseLayers::Sources& sources = m_LayerSources[selectedBiome];
+			if (sources.continent != selectedBiome) ImGui::Text("Continent shared with %s", m_AllBiomes[sources.continent].name);
+			if (sources.mountains >= 0 && sources.mountains != selectedBiome) ImGui::Text("Mountains shared with %s", m_AllBiomes[sources.mountains].name);
+			if (sources.ridges >= 0 && sources.ridges != selectedBiome) ImGui::Text("Ridges shared with %s", m_AllBiomes[sources.ridges].name);
 			ImGui::TreePop();
 		}
 		if (ImGui::TreeNode("Tanning"))
@@ -238,6 +246,66 @@ bool BiomeGenerator::SettingsGUI()
 	return changed;
 }
 
+void BiomeGenerator::PipelineGUI()
+{
+	if (!m_PipelineError.empty())
+		ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Pipeline not loaded: %s", m_PipelineError.c_str());
+
+	ImGui::Text("Stages: %d, fused into %d chains", static_cast<int>(m_Pipeline.GetStages().size()), static_cast<int>(m_Plan.GetChainCount()));
+	ImGui::Text("Map memory: %.1f KB, stage outputs: %.1f KB, worker scratch: %.1f KB",
+		m_Plan.GetArenaBytes() / 1024.0f, m_Plan.GetSnapshotBytes() / 1024.0f, m_StageExecutor.GetWorkerMemory() / 1024.0f);
+	ImGui::Text("Last generation: %.3f ms, %d stages rerun", m_Plan.GetLastMilliseconds(), m_Plan.GetLastStagesRun());
+
+	// timings are CPU time summed over all threads
+	ImGui::Columns(5, "PipelineStats");
+	ImGui::Text("Stage"); ImGui::NextColumn();
+	ImGui::Text("Map"); ImGui::NextColumn();
+	ImGui::Text("Chain"); ImGui::NextColumn();
+	ImGui::Text("Size"); ImGui::NextColumn();
+	ImGui::Text("CPU ms"); ImGui::NextColumn();
+	ImGui::Separator();
+	for (auto& stats : m_Plan.GetStageStats())
+	{
+		ImGui::Text("%s", stats.name); ImGui::NextColumn();
+		ImGui::Text("%s", m_Plan.GetMapNames()[stats.map].c_str()); ImGui::NextColumn();
+		ImGui::Text("%d", stats.chain); ImGui::NextColumn();
+		ImGui::Text("%d -> %d (%.1f KB)", stats.inputSize, stats.outputSize, stats.outputBytes / 1024.0f); ImGui::NextColumn();
+		if (stats.reused)
+			ImGui::Text("reused");
+		else
+			ImGui::Text("%.3f", stats.milliseconds);
+		ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+
+	if (ImGui::Button("Reset To Default Pipeline"))
+	{
+		m_Pipeline = BiomePipeline::Default();
+		m_PipelineError.clear();
+		m_PlanDirty = true;
+	}
+}
+
+nlohmann::json BiomeGenerator::SerializePipeline() const
+{
+	return m_Pipeline.Serialize();
+}
+
+void BiomeGenerator::LoadPipelineFromJson(const nlohmann::json& data)
+{
+	m_PipelineError.clear();
+	m_PlanDirty = true;
+
+	if (data.is_null())
+	{
+		m_Pipeline = BiomePipeline::Default();
+		return;
+	}
+
+	// an invalid pipeline leaves the current one in place
+	m_Pipeline.LoadFromJson(data, m_PipelineError);
+}
+
 nlohmann::json BiomeGenerator::Serialize() const
 {
 	nlohmann::json serialized;
@@ -246,6 +314,7 @@ nlohmann::json BiomeGenerator::Serialize() const
 	serialized["biomeBlending"] = m_BiomeBlending;
 
 	serialized["seed"] = m_Seed;
+	serialized["unboundedWorld"] = m_UnboundedWorld;
 	serialized["continentChance"] = m_ContinentChance;
 	serialized["islandExpandChance"] = m_IslandExpandChance;
 	serialized["islandErodeChance"] = m_IslandErodeChance;
@@ -262,7 +331,11 @@ nlohmann::json BiomeGenerator::Serialize() const
 
 	serialized["generationSettings"] = nlohmann::json::array();
 	for (int i = 0; i < m_AllBiomes.size(); i++)
+	{
 		serialized["generationSettings"].push_back(m_GenerationSettings[i].Serialize());
+		if (!m_NoiseGraphs[i].is_null())
+			serialized["generationSettings"].back()["noiseGraph"] = m_NoiseGraphs[i];
+	}
 	
 	serialized["biomeTans"] = nlohmann::json::array();
 	for (int i = 0; i < m_AllBiomes.size(); i++)
@@ -277,20 +350,28 @@ nlohmann::json BiomeGenerator::Serialize() const
 
 void BiomeGenerator::LoadFromJson(const nlohmann::json& data)
 {
-	if (data.contains("biomeMapPxPerTile")) m_BiomeMapPxPerTile = data["biomeMapPxPerTile"];
-	if (data.contains("biomeBlending")) m_BiomeBlending = data["biomeBlending"];
-
-	if (data.contains("seed")) m_Seed = data["seed"];
-	if (data.contains("continentChance")) m_ContinentChance = data["continentChance"];
-	if (data.contains("islandExpandChance")) m_IslandExpandChance = data["islandExpandChance"];
-	if (data.contains("islandErodeChance")) m_IslandErodeChance = data["islandErodeChance"];
-	if (data.contains("removeOceanChance")) m_SmallIslandsChance = data["removeOceanChance"];
-	if (data.contains("zoomingPerturbationChance")) m_ZoomSamplePerturbation = data["zoomingPerturbationChance"];
-
-	if (data.contains("temperateChance")) m_TemperateBiomeChance = data["temperateChance"];
-	if (data.contains("coldChance")) m_ColdBiomeChance = data["coldChance"];
-	if (data.contains("warmChance")) m_WarmBiomeChance = data["warmChance"];
-
+	// the settings shared with HeightmapBaker, over the current ones
+	BiomeRules rules = GetRules();
+	BiomeSettingsJson::World world{ m_BiomeMapPxPerTile, m_BiomeBlending, m_UnboundedWorld };
+	BiomeSettingsJson::Load(data, rules, world, m_GenerationSettings, m_NoiseGraphs, m_AllBiomes);
+
+	m_BiomeMapPxPerTile = world.biomeMapPxPerTile;
+	m_BiomeBlending = world.biomeBlending;
+	m_UnboundedWorld = world.unboundedWorld;
+	m_BiomeMapVersion++;
+
+	m_Seed = rules.seed;
+	m_ContinentChance = rules.continentChance;
+	m_IslandExpandChance = rules.islandExpandChance;
+	m_IslandErodeChance = rules.islandErodeChance;
+	m_SmallIslandsChance = rules.smallIslandsChance;
+	m_ZoomSamplePerturbation = rules.zoomSamplePerturbation;
+
+	m_TemperateBiomeChance = rules.temperateBiomeChance;
+	m_ColdBiomeChance = rules.coldBiomeChance;
+	m_WarmBiomeChance = rules.warmBiomeChance;
+
+	// display settings only the app has
 	if (data.contains("biomeMinimapColours"))
 	{
 		int index = 0;
@@ -301,16 +382,6 @@ void BiomeGenerator::LoadFromJson(const nlohmann::json& data)
 		}
 	}
 
-	if (data.contains("generationSettings"))
-	{
-		int index = 0;
-		for (auto& biome : data["generationSettings"])
-		{
-			m_GenerationSettings[index].LoadFromJson(biome);
-			index++;
-		}
-	}
-
 	if (data.contains("biomeTans"))
 	{
 		int index = 0;
@@ -320,387 +391,198 @@ void BiomeGenerator::LoadFromJson(const nlohmann::json& data)
 			index++;
 		}
 	}
-
-	if (data.contains("spawnWeights"))
-	{
-		auto& spawnWeights = data["spawnWeights"];
-		for (auto& biome : m_AllBiomes)
-		{
-			if (spawnWeights.contains(biome.name))
-				biome.spawnWeight = spawnWeights[biome.name];
-		}
-	}
 }
 
 void BiomeGenerator::GenerateBiomeMap(ID3D11Device* device)
 {
-	// clear out old biome map	
-	if (m_BiomeMap) delete m_BiomeMap;
-	if (m_BiomeMapSRV) m_BiomeMapSRV->Release();
-
-
-	// reset world seed
-	m_RNG.seed(m_Seed);
-
-	// start with a really small biome map; 4x4
-	m_BiomeMapSize = 4;
-	m_BiomeMap = new int[m_BiomeMapSize * m_BiomeMapSize];
-
-	// work out what will be land and what will be ocean
-	IslandsCA(&m_BiomeMap, m_BiomeMapSize);
-	Zoom2x(&m_BiomeMap, &m_BiomeMapSize);
-	AddIslandsCA(&m_BiomeMap, m_BiomeMapSize);
-	Zoom2x(&m_BiomeMap, &m_BiomeMapSize);
-	AddIslandsCA(&m_BiomeMap, m_BiomeMapSize);
-	AddIslandsCA(&m_BiomeMap, m_BiomeMapSize);
-	AddIslandsCA(&m_BiomeMap, m_BiomeMapSize);
-	RemoveTooMuchOcean(&m_BiomeMap, m_BiomeMapSize);
-	
-	// decide on biome temperatures
-	size_t tempMapSize = m_BiomeMapSize;
-	int* tempMap = new int[tempMapSize * tempMapSize];
-	CreateTemperatures(&tempMap, m_BiomeMap, tempMapSize);
-	
-	Zoom2x(&m_BiomeMap, &m_BiomeMapSize);
-	Zoom2x(&tempMap, &tempMapSize);
-	
-	TransitionTemperatures(&tempMap, tempMapSize);
-	
-	// now select biomes based off of the temperatures
-	SelectBiomes(&m_BiomeMap, tempMap, m_BiomeMapSize);
-	// temp map is no longer needed (temperatures have been assigned into biomes)
-	delete[] tempMap;
-	
-	Zoom2x(&m_BiomeMap, &m_BiomeMapSize);
-	
-	AddShores(&m_BiomeMap, m_BiomeMapSize);
-
-	CreateBiomeMapTexture(device);
-}
-
-
-void BiomeGenerator::IslandsCA(int** biomeMapPtr, size_t mapSize)
-{
-	int* biomeMap = *biomeMapPtr;
-	int* newBiomeMap = new int[mapSize * mapSize];
-
-	for (int i = 0; i < mapSize * mapSize; i++)
+	if (m_UnboundedWorld)
 	{
-		if (Chance(m_ContinentChance))
-			newBiomeMap[i] = BIOME_TYPE_LAND;
-		else
-			newBiomeMap[i] = BIOME_TYPE_OCEAN;
-	}
-
-	delete[] biomeMap;
-	*biomeMapPtr = newBiomeMap;
-}
-
-void BiomeGenerator::AddIslandsCA(int** biomeMapPtr, size_t mapSize)
-{
-	int* biomeMap = *biomeMapPtr;
-	int* newBiomeMap = new int[mapSize * mapSize];
+		// nothing is generated up front; layers are evaluated on demand for the region in view
+		if (m_LayerStack) delete m_LayerStack;
+		m_LayerStack = new BiomeLayerStack(GetRules(), m_Pipeline);
+		m_BiomeMapResolution = m_LayerStack->GetNominalMapSize();
 
-	for (int y = 0; y < mapSize; y++)
-	{
-		for (int x = 0; x < mapSize; x++)
-		{
-			int sample = biomeMap[y * mapSize + x];
-			
-			if (sample == BIOME_TYPE_OCEAN)
-			{
-				// process oceans
-
-				// if ocean is next to at least 1 land tile, then theres a chance it will also become land
-				if (CountNeighboursEqual(x, y, BIOME_TYPE_LAND, biomeMap, mapSize) > 0)
-				{
-					if (Chance(m_IslandExpandChance))
-						sample = BIOME_TYPE_LAND;
-				}
-			}
-			else if (sample == BIOME_TYPE_LAND)
-			{
-				// process land
-				// if land is next to more than 1 ocean tile, then theres a chance it will become ocean
-				if (CountNeighboursEqual(x, y, BIOME_TYPE_OCEAN, biomeMap, mapSize) > 1)
-				{
-					if (Chance(m_IslandErodeChance))
-						sample = BIOME_TYPE_OCEAN;
-				}
-			}
-
-			newBiomeMap[y * mapSize + x] = sample;
-		}
+		UpdateBiomeMapWindow(device, true);
+		return;
 	}
 
-	delete[] biomeMap;
-	*biomeMapPtr = newBiomeMap;
-}
-
-void BiomeGenerator::RemoveTooMuchOcean(int** biomeMapPtr, size_t mapSize)
-{
-	int* biomeMap = *biomeMapPtr;
-	int* newBiomeMap = new int[mapSize * mapSize];
+	// clear out old biome map	
+	if (m_BiomeMapSRV) m_BiomeMapSRV->Release();
+	m_BiomeMapSRV = nullptr;
+	if (m_DistanceFieldSRV) m_DistanceFieldSRV->Release();
+	m_DistanceFieldSRV = nullptr;
 
-	for (int y = 0; y < mapSize; y++)
-	{
-		for (int x = 0; x < mapSize; x++)
-		{
-			int sample = biomeMap[y * mapSize + x];
 
-			if (CountNeighboursEqual(x, y, BIOME_TYPE_OCEAN, biomeMap, mapSize) == 8)
-			{
-				if (Chance(m_SmallIslandsChance))
-					sample = BIOME_TYPE_LAND;
-			}
+	// every stage that makes random decisions gets its own stage index
+	// randomness is keyed by (seed, stage, x, y) rather than drawn in scan order
+	const BiomeRules rules = GetRules();
+	m_StageExecutor.SetTileSize(m_StageTileSize);
 
-			newBiomeMap[y * mapSize + x] = sample;
-		}
+	// the pipeline is only recompiled when its description changes
+	// otherwise the plan reruns only the stages affected by settings that have changed since the last generation
+	if (m_PlanDirty)
+	{
+		m_Plan.Compile(m_Pipeline);
+		m_PlanDirty = false;
 	}
 
-	delete[] biomeMap;
-	*biomeMapPtr = newBiomeMap;
-}
-
-void BiomeGenerator::CreateTemperatures(int** tempMapPtr, int* biomeMap, size_t mapSize)
-{
-	int* tempMap = *tempMapPtr;
-	int* newTempMap = new int[mapSize * mapSize];
+	size_t size = 0;
+	m_BiomeMap = m_Plan.Execute(rules, m_BiomeArena, m_StageExecutor, m_ThreadCount, size);
 
-	int t = m_TemperateBiomeChance + m_WarmBiomeChance + m_ColdBiomeChance;
-	std::uniform_int_distribution<int> temperatureDist(1, t);
+	// the finished map is owned by the plan, and stays valid until the next generation
+	m_BiomeMapSize = size;
+	m_BiomeMapResolution = m_BiomeMapSize;
+	m_BiomeMapOrigin = { 0, 0 };
+	m_BiomeMapVersion++;
 
-	for (int y = 0; y < mapSize; y++)
-	{
-		for (int x = 0; x < mapSize; x++)
-		{
-			int biome = biomeMap[y * mapSize + x];
-			int temperature = BIOME_TEMP_TEMPERATE;
-
-			int r = temperatureDist(m_RNG);
-			if (r <= m_TemperateBiomeChance)
-				temperature = BIOME_TEMP_TEMPERATE;
-			else if (r <= m_TemperateBiomeChance + m_ColdBiomeChance)
-				temperature = BIOME_TEMP_COLD;
-			else
-				temperature = BIOME_TEMP_WARM;
-
-			newTempMap[y * mapSize + x] = temperature;
-		}
-	}
-
-	delete[] tempMap;
-	*tempMapPtr = newTempMap;
+	UpdateRegions();
+	CreateBiomeMapTexture(device);
+	CreateDistanceFieldTexture(device);
 }
 
-void BiomeGenerator::TransitionTemperatures(int** tempMapPtr, size_t mapSize)
+BiomeRules BiomeGenerator::GetRules() const
 {
-	int* tempMap = *tempMapPtr;
-	int* newTempMap = new int[mapSize * mapSize];
+	BiomeRules rules;
 
-	for (int y = 0; y < mapSize; y++)
-	{
-		for (int x = 0; x < mapSize; x++)
-		{
-			int temp = tempMap[y * mapSize + x];
-
-			if (temp == BIOME_TEMP_COLD)
-			{
-				if (CountNeighboursEqual(x, y, BIOME_TEMP_WARM, tempMap, mapSize) > 3)
-				{
-					temp = BIOME_TEMP_TEMPERATE;
-				}
-			} 
-			else if(temp == BIOME_TEMP_WARM)
-			{
-				if (CountNeighboursEqual(x, y, BIOME_TEMP_COLD, tempMap, mapSize) > 3)
-				{
-					temp = BIOME_TEMP_TEMPERATE;
-				}
-			}
-
-			newTempMap[y * mapSize + x] = temp;
-		}
-	}
+	rules.seed = m_Seed;
+	rules.continentChance = m_ContinentChance;
+	rules.islandExpandChance = m_IslandExpandChance;
+	rules.islandErodeChance = m_IslandErodeChance;
+	rules.smallIslandsChance = m_SmallIslandsChance;
+	rules.zoomSamplePerturbation = m_ZoomSamplePerturbation;
 
-	delete[] tempMap;
-	*tempMapPtr = newTempMap;
-}
-
-void BiomeGenerator::SelectBiomes(int** biomeMapPtr, int* tempMap, size_t mapSize)
-{
-	int* biomeMap = *biomeMapPtr;
-	int* newBiomeMap = new int[mapSize * mapSize];
+	rules.temperateBiomeChance = m_TemperateBiomeChance;
+	rules.warmBiomeChance = m_WarmBiomeChance;
+	rules.coldBiomeChance = m_ColdBiomeChance;
 
-	for (int y = 0; y < mapSize; y++)
-	{
-		for (int x = 0; x < mapSize; x++)
-		{
-			BIOME_TYPE biomeType = static_cast<BIOME_TYPE>(biomeMap[y * mapSize + x]);
-			BIOME_TEMP biomeTemp = static_cast<BIOME_TEMP>(tempMap[y * mapSize + x]);
-			int biome;
-
-			// select biomes
-			const std::vector<int>& candidates = biomeType == BIOME_TYPE_OCEAN ? 
-				m_SpawnableOceanBiomesByTemp[biomeTemp] :
-				m_SpawnableLandBiomesByTemp[biomeTemp];
-			float totalOdds = 0.0f;
-			for (auto index : candidates)
-				totalOdds += m_AllBiomes[index].spawnWeight;
-
-			int chance = m_Chance(m_RNG);
-			int p = 0;
-			for (auto index : candidates)
-			{
-				int scaledOdds = static_cast<int>(ceil(100.0f * m_AllBiomes[index].spawnWeight / totalOdds));
-				p += scaledOdds;
-				if (chance <= p)
-				{
-					biome = index;
-					break;
-				}
-			}
-
-			newBiomeMap[y * mapSize + x] = biome;
-		}
-	}
+	BiomeCatalog::FillRules(rules, m_AllBiomes, m_SpawnableLandBiomesByTemp, m_SpawnableOceanBiomesByTemp);
 
-	delete[] biomeMap;
-	*biomeMapPtr = newBiomeMap;
+	return rules;
 }
 
-void BiomeGenerator::AddShores(int** biomeMapPtr, size_t mapSize)
+void BiomeGenerator::SetViewRegion(ID3D11Device* device, const XMINT2& minTile, const XMINT2& maxTile)
 {
-	int* biomeMap = *biomeMapPtr;
-	int* newBiomeMap = new int[mapSize * mapSize];
-
-	for (int y = 0; y < mapSize; y++)
-	{
-		for (int x = 0; x < mapSize; x++)
-		{
-			int biome = biomeMap[y * mapSize + x];
-
-			// select biomes
-			if (m_AllBiomes[biome].type == BIOME_TYPE_LAND)
-			{
-				if (CountNeighboursEqual(x, y, [this](int biome) { return m_AllBiomes[biome].type == BIOME_TYPE_OCEAN; }, biomeMap, mapSize) > 0)
-				{
-					if (m_AllBiomes[biome].temperature == BIOME_TEMP_COLD)
-						biome = GetBiomeIDByName("Cold Shore");
-					else
-						biome = GetBiomeIDByName("Shore");
-				}
-			}
-
-			newBiomeMap[y * mapSize + x] = biome;
-		}
-	}
+	m_ViewMinTile = minTile;
+	m_ViewMaxTile = maxTile;
 
-	delete[] biomeMap;
-	*biomeMapPtr = newBiomeMap;
+	if (m_UnboundedWorld && m_LayerStack)
+		UpdateBiomeMapWindow(device, false);
 }
 
-void BiomeGenerator::Zoom2x(int** mapPtr, size_t* mapSize)
+void BiomeGenerator::UpdateBiomeMapWindow(ID3D11Device* device, bool force)
 {
-	int* map = *mapPtr;
-	size_t oldSize = (*mapSize);
+	// same mapping from world position to biome map cell as GetBiomeMapLocation in biomeHelper.hlsli
+	float cellsPerTile = m_BiomeMapPxPerTile * static_cast<float>(m_BiomeMapResolution - 1) / static_cast<float>(m_BiomeMapResolution);
 
-	size_t newSize = 2 * oldSize;
-	int* newMap = new int[newSize * newSize];
+	// one extra cell on each side, for blending with neighbouring biomes
+	int x0 = static_cast<int>(floor(m_ViewMinTile.x * cellsPerTile)) - 1;
+	int y0 = static_cast<int>(floor(m_ViewMinTile.y * cellsPerTile)) - 1;
+	int x1 = static_cast<int>(floor((m_ViewMaxTile.x + 1) * cellsPerTile)) + 2;
+	int y1 = static_cast<int>(floor((m_ViewMaxTile.y + 1) * cellsPerTile)) + 2;
+	size_t windowSize = static_cast<size_t>(max(x1 - x0, y1 - y0));
 
-	for (int y = 0; y < newSize; y++)
-	{
-		for (int x = 0; x < newSize; x++)
-		{
-			int sampleX = x / 2;
-			int sampleY = y / 2;
-
-			if (Chance(m_ZoomSamplePerturbation))
-			{
-				if (Chance(50))
-					sampleX += Chance(50) ? 1 : -1;
-				else
-					sampleY += Chance(50) ? 1 : -1;
-			}
-			sampleX = max(0, sampleX);
-			sampleX = min(static_cast<int>(oldSize - 1), sampleX);
-			sampleY = max(0, sampleY);
-			sampleY = min(static_cast<int>(oldSize - 1), sampleY);
-
-			int sample = map[sampleY * oldSize + sampleX];
-
-			newMap[y * newSize + x] = sample;
-		}
-	}
+	if (!force && m_BiomeMap && m_BiomeMapOrigin.x == x0 && m_BiomeMapOrigin.y == y0 && m_BiomeMapSize == windowSize)
+		return;
 
-	delete[] map;
-	*mapPtr = newMap;
-	*mapSize = newSize;
+	if (m_BiomeMapSRV) m_BiomeMapSRV->Release();
+	m_BiomeMapSRV = nullptr;
+	if (m_DistanceFieldSRV) m_DistanceFieldSRV->Release();
+	m_DistanceFieldSRV = nullptr;
+
+	m_BiomeMapSize = windowSize;
+	m_BiomeMapOrigin = { x0, y0 };
+	m_BiomeArena.Reset(BiomeArena::RequiredBytes<BiomeCell>(m_BiomeMapSize * m_BiomeMapSize));
+	m_BiomeMap = m_BiomeArena.Allocate<BiomeCell>(m_BiomeMapSize * m_BiomeMapSize);
+	m_LayerStack->GetBiomes(x0, y0, static_cast<int>(m_BiomeMapSize), static_cast<int>(m_BiomeMapSize), m_BiomeMap);
+	m_BiomeMapVersion++;
+
+	UpdateRegions();
+	CreateBiomeMapTexture(device);
+	CreateDistanceFieldTexture(device);
 }
 
 
-int BiomeGenerator::GetBiomeIDByName(const char* name) const
+void BiomeGenerator::UpdateRegions()
 {
-	int index = 0;
-	for (auto& biome : m_AllBiomes)
-	{
-		if (strcmp(name, biome.name) == 0)
-			return index;
-		index++;
-	}
-	assert(false && "No biome found with that name");
-	return -1;
+	// regions of a single biome
+	const int size = static_cast<int>(m_BiomeMapSize);
+	m_BiomeRegions.Build(m_BiomeMap, size, m_BiomeMapOrigin.x, m_BiomeMapOrigin.y, nullptr, m_ThreadCount);
+
+	// land and ocean, regardless of biome
+	BiomeCell typeLUT[256] = {};
+	for (size_t i = 0; i < m_AllBiomes.size(); i++)
+		typeLUT[i] = static_cast<BiomeCell>(m_AllBiomes[i].type);
+	m_Landmasses.Build(m_BiomeMap, size, m_BiomeMapOrigin.x, m_BiomeMapOrigin.y, typeLUT, m_ThreadCount);
+
+	// the coast is wherever the type changes, so it uses the same table
+	m_CoastDistance.Build(m_BiomeMap, size, m_BiomeMapOrigin.x, m_BiomeMapOrigin.y, typeLUT, m_ThreadCount);
+	m_BorderDistance.Build(m_BiomeMap, size, m_BiomeMapOrigin.x, m_BiomeMapOrigin.y, nullptr, m_ThreadCount);
 }
 
-int BiomeGenerator::CountNeighboursEqual(int x, int y, int v, int* biomeMap, size_t mapSize)
+int BiomeGenerator::GetBiomeIDByName(const char* name) const
 {
-	return CountNeighboursEqual(x, y, [v](int biome) { return biome == v; }, biomeMap, mapSize);
+	int index = BiomeCatalog::FindBiome(m_AllBiomes, name);
+	assert(index >= 0 && "No biome found with that name");
+	return index;
 }
 
-int BiomeGenerator::CountNeighboursEqual(int x, int y, std::function<bool(int biome)> condition, int* biomeMap, size_t mapSize)
+void BiomeGenerator::CreateBiomeMapTexture(ID3D11Device* device)
 {
-	int count = 0;
-
-	if (x > 0)
-	{
-		count += condition(biomeMap[y		* mapSize + (x - 1)]) ? 1 : 0;
+	if (!m_BiomeMap) return;
 
-		if (y > 0)
-			count += condition(biomeMap[(y - 1) * mapSize + (x - 1)]) ? 1 : 0;
-		if (y < mapSize - 1)
-			count += condition(biomeMap[(y + 1) * mapSize + (x - 1)]) ? 1 : 0;
-	}
+	D3D11_TEXTURE2D_DESC desc;
+	desc.Width = static_cast<unsigned int>(m_BiomeMapSize);
+	desc.Height = static_cast<unsigned int>(m_BiomeMapSize);
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8_UINT;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
 
-	if (y > 0)
-		count += condition(biomeMap[(y - 1) * mapSize + x	   ]) ? 1 : 0;
-	if (y < mapSize - 1)
-		count += condition(biomeMap[(y + 1) * mapSize + x	   ]) ? 1 : 0;
+	D3D11_SUBRESOURCE_DATA initialData;
+	initialData.pSysMem = m_BiomeMap;
+	initialData.SysMemPitch = static_cast<unsigned int>(sizeof(BiomeCell) * m_BiomeMapSize);
+	initialData.SysMemSlicePitch = 0;
 
+	ID3D11Texture2D* tex = nullptr;
+	HRESULT hr = device->CreateTexture2D(&desc, &initialData, &tex);
+	assert(hr == S_OK);
 
-	if (x < mapSize - 1)
-	{
-		count += condition(biomeMap[y * mapSize + (x + 1)]) ? 1 : 0;
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	srvDesc.Format = DXGI_FORMAT_R8_UINT;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = 1;
+	srvDesc.Texture2D.MostDetailedMip = 0;
 
-		if (y > 0)
-			count += condition(biomeMap[(y - 1) * mapSize + (x + 1)]) ? 1 : 0;
-		if (y < mapSize - 1)
-			count += condition(biomeMap[(y + 1) * mapSize + (x + 1)]) ? 1 : 0;
-	}
+	hr = device->CreateShaderResourceView(tex, &srvDesc, &m_BiomeMapSRV);
+	assert(hr == S_OK);
 
-	return count;
+	// the SRV keeps its own reference to the texture
+	tex->Release();
 }
 
-
-void BiomeGenerator::CreateBiomeMapTexture(ID3D11Device* device)
+void BiomeGenerator::CreateDistanceFieldTexture(ID3D11Device* device)
 {
 	if (!m_BiomeMap) return;
 
+	// interleave the two fields so a single load gets both
+	const size_t cellCount = m_BiomeMapSize * m_BiomeMapSize;
+	m_DistanceFieldTexels.resize(cellCount);
+	const float* coast = m_CoastDistance.GetData();
+	const float* border = m_BorderDistance.GetData();
+	for (size_t i = 0; i < cellCount; i++)
+		m_DistanceFieldTexels[i] = { coast[i], border[i] };
+
 	D3D11_TEXTURE2D_DESC desc;
 	desc.Width = static_cast<unsigned int>(m_BiomeMapSize);
 	desc.Height = static_cast<unsigned int>(m_BiomeMapSize);
 	desc.MipLevels = 1;
 	desc.ArraySize = 1;
-	desc.Format = DXGI_FORMAT_R32_SINT;
+	desc.Format = DXGI_FORMAT_R32G32_FLOAT;
 	desc.SampleDesc.Count = 1;
 	desc.SampleDesc.Quality = 0;
 	desc.Usage = D3D11_USAGE_DEFAULT;
@@ -709,8 +591,8 @@ void BiomeGenerator::CreateBiomeMapTexture(ID3D11Device* device)
 	desc.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA initialData;
-	initialData.pSysMem = m_BiomeMap;
-	initialData.SysMemPitch = static_cast<unsigned int>(sizeof(int) * m_BiomeMapSize);
+	initialData.pSysMem = m_DistanceFieldTexels.data();
+	initialData.SysMemPitch = static_cast<unsigned int>(sizeof(XMFLOAT2) * m_BiomeMapSize);
 	initialData.SysMemSlicePitch = 0;
 
 	ID3D11Texture2D* tex = nullptr;
@@ -718,13 +600,16 @@ void BiomeGenerator::CreateBiomeMapTexture(ID3D11Device* device)
 	assert(hr == S_OK);
 
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-	srvDesc.Format = DXGI_FORMAT_R32_SINT;
+	srvDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Texture2D.MipLevels = 1;
 	srvDesc.Texture2D.MostDetailedMip = 0;
 
-	hr = device->CreateShaderResourceView(tex, &srvDesc, &m_BiomeMapSRV);
+	hr = device->CreateShaderResourceView(tex, &srvDesc, &m_DistanceFieldSRV);
 	assert(hr == S_OK);
+
+	// the SRV keeps its own reference to the texture
+	tex->Release();
 }
 
 void BiomeGenerator::CreateBiomeMappingBuffer(ID3D11Device* device)
@@ -739,9 +624,11 @@ void BiomeGenerator::CreateBiomeMappingBuffer(ID3D11Device* device)
 
 	BiomeMappingBufferType bmbt{ 
 		m_BiomeMapPxPerTile, 
-		static_cast<unsigned int>(m_BiomeMapSize),
+		static_cast<unsigned int>(m_BiomeMapResolution),
 		m_BiomeBlending,
-		0.0f
+		0.0f,
+		m_BiomeMapOrigin,
+		{ 0.0f, 0.0f }
 	};
 	D3D11_SUBRESOURCE_DATA initialData;
 	initialData.pSysMem = &bmbt;
@@ -779,6 +666,36 @@ void BiomeGenerator::CreateGenerationSettingsBuffer(ID3D11Device* device)
 	assert(hr == S_OK);
 }
 
+void BiomeGenerator::CreateLayerSourcesBuffer(ID3D11Device* device)
+{
+	TerrainNoiseLayers::FindSources(m_GenerationSettings, MAX_BIOMES, m_LayerSources);
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.ByteWidth = sizeof(TerrainNoiseLayers::Sources) * MAX_BIOMES;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = sizeof(TerrainNoiseLayers::Sources);
+
+	D3D11_SUBRESOURCE_DATA initialData;
+	initialData.pSysMem = &m_LayerSources;
+	initialData.SysMemPitch = 0;
+	initialData.SysMemSlicePitch = 0;
+
+	HRESULT hr = device->CreateBuffer(&bufferDesc, &initialData, &m_LayerSourcesBuffer);
+	assert(hr == S_OK);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = MAX_BIOMES;
+
+	hr = device->CreateShaderResourceView(m_LayerSourcesBuffer, &srvDesc, &m_LayerSourcesView);
+	assert(hr == S_OK);
+}
+
 void BiomeGenerator::CreateBiomeTanBuffer(ID3D11Device* device)
 {
 	// create biome data buffer
@@ -818,6 +735,12 @@ void BiomeGenerator::UpdateBuffers(ID3D11DeviceContext* deviceContext)
 	memcpy(mappedResource.pData, &m_GenerationSettings, sizeof(TerrainNoiseSettings) * MAX_BIOMES);
 	deviceContext->Unmap(m_GenerationSettingsBuffer, 0);
 
+	TerrainNoiseLayers::FindSources(m_GenerationSettings, MAX_BIOMES, m_LayerSources);
+	hr = deviceContext->Map(m_LayerSourcesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	assert(hr == S_OK);
+	memcpy(mappedResource.pData, &m_LayerSources, sizeof(TerrainNoiseLayers::Sources) * MAX_BIOMES);
+	deviceContext->Unmap(m_LayerSourcesBuffer, 0);
+
 	hr = deviceContext->Map(m_BiomeTanBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
 	assert(hr == S_OK);
 	memcpy(mappedResource.pData, &m_BiomeTans, sizeof(BiomeTan) * MAX_BIOMES);
@@ -827,18 +750,31 @@ void BiomeGenerator::UpdateBuffers(ID3D11DeviceContext* deviceContext)
 	assert(hr == S_OK);
 	BiomeMappingBufferType* dataPtr = reinterpret_cast<BiomeMappingBufferType*>(mappedResource.pData);
 	dataPtr->pxPerTile = m_BiomeMapPxPerTile;
-	dataPtr->resolution = static_cast<unsigned int>(m_BiomeMapSize);
+	dataPtr->resolution = static_cast<unsigned int>(m_BiomeMapResolution);
 	dataPtr->blending = m_BiomeBlending;
+	dataPtr->origin = m_BiomeMapOrigin;
 	deviceContext->Unmap(m_BiomeMappingBuffer, 0);
 }
 
+BiomeBlending::Mapping BiomeGenerator::GetBiomeMapping() const
+{
+	// as uploaded to the biome mapping buffer
+	BiomeBlending::Mapping mapping;
+	mapping.pxPerTile = m_BiomeMapPxPerTile;
+	mapping.resolution = static_cast<int>(m_BiomeMapResolution);
+	mapping.blending = m_BiomeBlending;
+	mapping.originX = m_BiomeMapOrigin.x;
+	mapping.originY = m_BiomeMapOrigin.y;
+	return mapping;
+}
+
 
 const char* BiomeGenerator::StrFromBiomeType(BIOME_TYPE type)
 {
 	switch (type)
 	{
-	case BiomeGenerator::BIOME_TYPE_OCEAN:	return "Ocean";
-	case BiomeGenerator::BIOME_TYPE_LAND:	return "Land";
+	case BIOME_TYPE_OCEAN:	return "Ocean";
+	case BIOME_TYPE_LAND:	return "Land";
 	default:				return "Unknown";
 	}
 }
@@ -846,9 +782,9 @@ const char* BiomeGenerator::StrFromBiomeTemp(BIOME_TEMP temp)
 {
 	switch (temp)
 	{
-	case BiomeGenerator::BIOME_TEMP_TEMPERATE:	return "Temperate";
-	case BiomeGenerator::BIOME_TEMP_COLD:		return "Cold";
-	case BiomeGenerator::BIOME_TEMP_WARM:		return "Warm";
+	case BIOME_TEMP_TEMPERATE:	return "Temperate";
+	case BIOME_TEMP_COLD:		return "Cold";
+	case BIOME_TEMP_WARM:		return "Warm";
 	default:					return "Unknown";
 	}
 }
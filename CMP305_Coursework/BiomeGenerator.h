@@ -2,45 +2,30 @@
 
 #include <d3d11.h>
 #include <DirectXMath.h>
-#include <random>
 #include <map>
-#include <functional>
 
 #include "NoiseSettings.h"
+#include "BiomeRules.h"
+#include "BiomeCatalog.h"
+#include "BiomeBlending.h"
+#include "BiomeMapBuffer.h"
+#include "BiomeStages.h"
+#include "BiomePipeline.h"
+#include "BiomeRegions.h"
+#include "BiomeDistance.h"
+#include "TerrainNoiseLayers.h"
 
 using namespace DirectX;
 
-#define MAX_BIOMES 32
-
 
+class BiomeLayerStack;
 
 
 class BiomeGenerator 
 {
 public:
 
-	enum BIOME_TYPE : int
-	{
-		BIOME_TYPE_OCEAN = 0,
-		BIOME_TYPE_LAND = 1
-	};
-	enum BIOME_TEMP : int
-	{
-		BIOME_TEMP_COLD = 0,
-		BIOME_TEMP_TEMPERATE = 1,
-		BIOME_TEMP_WARM = 2
-	};
-
-	struct Biome
-	{
-		// debug
-		const char* name = nullptr;
-
-		// spawning properties
-		BIOME_TYPE type;
-		BIOME_TEMP temperature;
-		int spawnWeight;
-	};
+	typedef BiomeCatalog::Biome Biome;
 
 	struct BiomeTan
 	{
@@ -76,8 +61,12 @@ public:
 		unsigned int resolution;
 		float blending;
 		float padding;
+		// cell of the world that the biome map texture begins at
+		XMINT2 origin;
+		XMFLOAT2 padding1;
 	};
 
+	// device may be nullptr for headless use (e.g. surveying seeds), in which case no GPU resources are created
 	BiomeGenerator(ID3D11Device* device, unsigned int seed);
 	~BiomeGenerator();
 
@@ -85,16 +74,52 @@ public:
 	nlohmann::json Serialize() const;
 	void LoadFromJson(const nlohmann::json& data);
 
+	// the stages of the biome pipeline are stored separately from the rest of the settings
+	nlohmann::json SerializePipeline() const;
+	void LoadPipelineFromJson(const nlohmann::json& data);
+	inline const BiomePipeline& GetPipeline() const { return m_Pipeline; }
+	// why the last pipeline failed to load, or empty
+	inline const std::string& GetPipelineError() const { return m_PipelineError; }
+
 	void GenerateBiomeMap(ID3D11Device* device);
 
+	// snapshot of the settings that drive biome map generation
+	BiomeRules GetRules() const;
+
+	// for unbounded worlds the biome map texture only covers the tiles in view (plus a border for blending)
+	// this should be called whenever the tiles in view change
+	void SetViewRegion(ID3D11Device* device, const XMINT2& minTile, const XMINT2& maxTile);
+	inline bool IsWorldUnbounded() const { return m_UnboundedWorld; }
+
 	inline size_t GetBiomeCount() const { return m_AllBiomes.size(); }
+	inline const char* GetBiomeName(size_t biome) const { return m_AllBiomes[biome].name; }
+
+	// connected regions of the biome map, in biome map cells; for unbounded worlds these only cover the cells in view
+	// biome regions hold cells of one biome, landmasses hold cells of one BIOME_TYPE
+	inline const BiomeRegionIndex& GetBiomeRegions() const { return m_BiomeRegions; }
+	inline const BiomeRegionIndex& GetLandmasses() const { return m_Landmasses; }
+
+	// distance from each biome map cell to the coast, and to the edge of its biome, covering the same cells as the regions
+	inline const BiomeDistanceField& GetCoastDistance() const { return m_CoastDistance; }
+	inline const BiomeDistanceField& GetBorderDistance() const { return m_BorderDistance; }
+	// both distance fields as one R32G32_FLOAT texture (coast, border) over the biome map texture's cells
+	inline ID3D11ShaderResourceView* GetDistanceFieldSRV() const { return m_DistanceFieldSRV; }
 
 	inline ID3D11ShaderResourceView* GetBiomeMapSRV() const { return m_BiomeMapSRV; }
-	inline size_t GetBiomeMapResolution() const { return m_BiomeMapSize; }
+	inline size_t GetBiomeMapResolution() const { return m_BiomeMapResolution; }
+	// the finished biome map on the CPU, GetBiomeMapSize() cells square, and how it maps onto the world (see BiomeBlendMap)
+	inline const BiomeCell* GetBiomeMap() const { return m_BiomeMap; }
+	inline size_t GetBiomeMapSize() const { return m_BiomeMapSize; }
+	BiomeBlending::Mapping GetBiomeMapping() const;
+	// changes whenever the biome map or its mapping does, so anything baked from them knows when to bake again
+	inline unsigned int GetBiomeMapVersion() const { return m_BiomeMapVersion; }
+	// threads to use for work over the biome map (0 uses all hardware threads)
+	inline unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_ThreadCount); }
 	
 	inline ID3D11Buffer* GetBiomeMappingBuffer() const { return m_BiomeMappingBuffer; }
 	
 	inline ID3D11ShaderResourceView* GetGenerationSettingsSRV() const { return m_GenerationSettingsView; }
+	inline ID3D11ShaderResourceView* GetLayerSourcesSRV() const { return m_LayerSourcesView; }
 	inline ID3D11ShaderResourceView* GetBiomeTanningSRV() const { return m_BiomeTanView; }
 	inline const XMFLOAT4* GetBiomeMinimapColours() const { return m_BiomeMinimapColours; }
 
@@ -103,46 +128,43 @@ public:
 	inline bool ShowBiomeMap() const { return m_ShowBiomeMap; }
 
 private:
-	// land/ocean balance
-	void IslandsCA(int** biomeMapPtr, size_t mapSize);
-	void AddIslandsCA(int** biomeMapPtr, size_t mapSize);
-	void RemoveTooMuchOcean(int** biomeMapPtr, size_t mapSize);
-
-	// biome temperatures
-	void CreateTemperatures(int** tempMapPtr, int* biomeMap, size_t mapSize);
-	void TransitionTemperatures(int** tempMapPtr, size_t mapSize);
-
-	void SelectBiomes(int** biomeMapPtr, int* tempMap, size_t mapSize);
-	void AddShores(int** biomeMapPtr, size_t mapSize);
+	int GetBiomeIDByName(const char* name) const;
 
-	// zoom
-	void Zoom2x(int** mapPtr, size_t* mapSize);
+	void PipelineGUI();
 
-	// utility
-	int CountNeighboursEqual(int x, int y, int v, int* biomeMap, size_t mapSize);
-	int CountNeighboursEqual(int x, int y, std::function<bool(int biome)> condition, int* biomeMap, size_t mapSize);
-	int GetBiomeIDByName(const char* name) const;
+	void UpdateBiomeMapWindow(ID3D11Device* device, bool force);
+	// labels the connected regions of the finished biome map and measures its distance fields
+	void UpdateRegions();
 
 	void CreateBiomeMapTexture(ID3D11Device* device);
+	void CreateDistanceFieldTexture(ID3D11Device* device);
 	void CreateBiomeMappingBuffer(ID3D11Device* device);
 	void CreateGenerationSettingsBuffer(ID3D11Device* device);
+	void CreateLayerSourcesBuffer(ID3D11Device* device);
 	void CreateBiomeTanBuffer(ID3D11Device* device);
 
-	inline bool Chance(int percent) { return m_Chance(m_RNG) <= percent; }
-
 	const char* StrFromBiomeType(BIOME_TYPE type);
 	const char* StrFromBiomeTemp(BIOME_TEMP temp);
 
 private:
 	ID3D11Device* m_Device = nullptr;
 
-	std::mt19937 m_RNG;
 	unsigned int m_Seed;
-	std::uniform_int_distribution<int> m_Chance;
+	// 0 uses all hardware threads
+	int m_ThreadCount = 0;
+	// biome stages are fused and run in tiles of this size
+	int m_StageTileSize = 64;
+	BiomeStageExecutor m_StageExecutor;
+
+	// the sequence of biome stages, and the plan it compiles to
+	BiomePipeline m_Pipeline = BiomePipeline::Default();
+	BiomePlan m_Plan;
+	bool m_PlanDirty = true;
+	std::string m_PipelineError;
 
 	std::vector<Biome> m_AllBiomes;
-	std::map<BIOME_TEMP, std::vector<int>> m_SpawnableLandBiomesByTemp;
-	std::map<BIOME_TEMP, std::vector<int>> m_SpawnableOceanBiomesByTemp;
+	BiomeCatalog::SpawnLists m_SpawnableLandBiomesByTemp;
+	BiomeCatalog::SpawnLists m_SpawnableOceanBiomesByTemp;
 
 	// biome generation constants (all are integers [0,100] for how likely something is to occur)
 	int m_ContinentChance = 15;
@@ -155,14 +177,43 @@ private:
 	int m_WarmBiomeChance = 17;
 	int m_ColdBiomeChance = 17;
 
-	int* m_BiomeMap = nullptr;
+	// storage for the biome pipeline and the finished map
+	BiomeArena m_BiomeArena;
+	BiomeCell* m_BiomeMap = nullptr;
 	size_t m_BiomeMapSize = -1;
 	ID3D11ShaderResourceView* m_BiomeMapSRV = nullptr;
 
+	// the resolution used to map world positions onto biome map cells
+	// for bounded worlds this is the size of the biome map
+	size_t m_BiomeMapResolution = -1;
+	XMINT2 m_BiomeMapOrigin{ 0, 0 };
+	unsigned int m_BiomeMapVersion = 0;
+
+	BiomeRegionIndex m_BiomeRegions;
+	BiomeRegionIndex m_Landmasses;
+
+	BiomeDistanceField m_CoastDistance;
+	BiomeDistanceField m_BorderDistance;
+	ID3D11ShaderResourceView* m_DistanceFieldSRV = nullptr;
+	std::vector<XMFLOAT2> m_DistanceFieldTexels;
+
+	// unbounded worlds evaluate the biome pipeline lazily around the viewer
+	bool m_UnboundedWorld = false;
+	BiomeLayerStack* m_LayerStack = nullptr;
+	XMINT2 m_ViewMinTile{ 0, 0 };
+	XMINT2 m_ViewMaxTile{ 0, 0 };
+
 	TerrainNoiseSettings m_GenerationSettings[MAX_BIOMES];
+	// noise graphs are only evaluated when baking heightmaps (see NoiseGraph), but are kept so they are saved again
+	nlohmann::json m_NoiseGraphs[MAX_BIOMES];
 	ID3D11Buffer* m_GenerationSettingsBuffer = nullptr;
 	ID3D11ShaderResourceView* m_GenerationSettingsView = nullptr;
 
+	// which biome each biome's noise layers are evaluated from, found again whenever the buffers are updated
+	TerrainNoiseLayers::Sources m_LayerSources[MAX_BIOMES];
+	ID3D11Buffer* m_LayerSourcesBuffer = nullptr;
+	ID3D11ShaderResourceView* m_LayerSourcesView = nullptr;
+
 	BiomeTan m_BiomeTans[MAX_BIOMES];
 	ID3D11Buffer* m_BiomeTanBuffer = nullptr;
 	ID3D11ShaderResourceView* m_BiomeTanView = nullptr;
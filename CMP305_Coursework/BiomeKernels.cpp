@@ -0,0 +1,172 @@
+#include "BiomeKernels.h"
+
+#include "CPUFeatures.h"
+
+
+// count for a single cell, with full bounds checks; used for cells the vector loops can't reach
+static inline int CountEqualCell(const BiomeCell* above, const BiomeCell* row, const BiomeCell* below, int width, BiomeCell value, int x)
+{
+	int count = 0;
+	int x0 = x > 0 ? x - 1 : 0;
+	int x1 = x < width - 1 ? x + 1 : width - 1;
+
+	for (int i = x0; i <= x1; i++)
+	{
+		if (above) count += above[i] == value ? 1 : 0;
+		if (below) count += below[i] == value ? 1 : 0;
+		if (i != x) count += row[i] == value ? 1 : 0;
+	}
+	return count;
+}
+
+
+void BiomeKernels::CountEqualRow(const BiomeCell* above, const BiomeCell* row, const BiomeCell* below, int width, BiomeCell value, uint8_t* counts)
+{
+	if (CPUFeatures::HasAVX2())
+		CountEqualRowAVX2(above, row, below, width, value, counts);
+	else
+		CountEqualRowScalar(above, row, below, width, value, counts);
+}
+
+void BiomeKernels::LookupRow(const BiomeCell* row, int width, const BiomeCell* lut, BiomeCell* out)
+{
+	for (int x = 0; x < width; x++)
+		out[x] = lut[row[x]];
+}
+
+void BiomeKernels::CountEqualRowScalar(const BiomeCell* above, const BiomeCell* row, const BiomeCell* below, int width, BiomeCell value, uint8_t* counts)
+{
+	if (width <= 0) return;
+	if (width < 3)
+	{
+		for (int x = 0; x < width; x++)
+			counts[x] = static_cast<uint8_t>(CountEqualCell(above, row, below, width, value, x));
+		return;
+	}
+
+	// sliding window over the column sums of the 3 rows
+	auto column = [&](int x)
+	{
+		return (above && above[x] == value ? 1 : 0) + (row[x] == value ? 1 : 0) + (below && below[x] == value ? 1 : 0);
+	};
+
+	int left = 0;
+	int centre = column(0);
+	for (int x = 0; x < width; x++)
+	{
+		int right = x < width - 1 ? column(x + 1) : 0;
+		// the cell itself is not a neighbour
+		counts[x] = static_cast<uint8_t>(left + centre + right - (row[x] == value ? 1 : 0));
+		left = centre;
+		centre = right;
+	}
+}
+
+#if CPU_X86
+// adds the number of cells in [p - 1, p + 32] that equal v to each lane; centre selects whether p itself is included
+// comparisons give -1 for equal, so subtracting them accumulates the count
+CPU_TARGET_AVX2
+static inline __m256i AccumulateEqual(__m256i acc, const BiomeCell* p, __m256i v, bool centre)
+{
+	acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p - 1)), v));
+	if (centre)
+		acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), v));
+	acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1)), v));
+	return acc;
+}
+
+CPU_TARGET_AVX2
+static inline void CountEqualBlockAVX2(const BiomeCell* above, const BiomeCell* row, const BiomeCell* below, int x, __m256i v, uint8_t* counts)
+{
+	__m256i acc = _mm256_setzero_si256();
+	if (above) acc = AccumulateEqual(acc, above + x, v, true);
+	if (below) acc = AccumulateEqual(acc, below + x, v, true);
+	acc = AccumulateEqual(acc, row + x, v, false);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(counts + x), acc);
+}
+#endif
+
+CPU_TARGET_AVX2
+void BiomeKernels::CountEqualRowAVX2(const BiomeCell* above, const BiomeCell* row, const BiomeCell* below, int width, BiomeCell value, uint8_t* counts)
+{
+#if CPU_X86
+	// blocks of 32 cells that can read one cell either side without leaving the row
+	const int block = 32;
+	if (width < block + 2)
+	{
+		CountEqualRowScalar(above, row, below, width, value, counts);
+		return;
+	}
+
+	const __m256i v = _mm256_set1_epi8(static_cast<char>(value));
+
+	int x = 1;
+	for (; x + block < width; x += block)
+		CountEqualBlockAVX2(above, row, below, x, v, counts);
+	// the final block overlaps the previous one, which is harmless as every cell is independent
+	if (x < width - 1)
+		CountEqualBlockAVX2(above, row, below, width - 1 - block, v, counts);
+
+	counts[0] = static_cast<uint8_t>(CountEqualCell(above, row, below, width, value, 0));
+	counts[width - 1] = static_cast<uint8_t>(CountEqualCell(above, row, below, width, value, width - 1));
+#else
+	CountEqualRowScalar(above, row, below, width, value, counts);
+#endif
+}
+
+
+void BiomeKernels::PackRow(const BiomeCell* row, int width, BiomeCell value, uint64_t* bits)
+{
+	int words = WordsPerRow(width);
+	for (int w = 0; w < words; w++)
+	{
+		int x0 = w * 64;
+		int x1 = x0 + 64 < width ? x0 + 64 : width;
+
+		uint64_t word = 0;
+		for (int x = x0; x < x1; x++)
+			word |= static_cast<uint64_t>(row[x] == value ? 1 : 0) << (x - x0);
+		bits[w] = word;
+	}
+}
+
+void BiomeKernels::NeighbourBitsRow(const uint64_t* above, const uint64_t* row, const uint64_t* below, int words,
+	uint64_t* any, uint64_t* atLeastTwo, uint64_t* all)
+{
+	for (int w = 0; w < words; w++)
+	{
+		// the 8 neighbours of every cell in this word, each shifted so that it lines up with the cell
+		uint64_t n[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		int count = 0;
+
+		auto addRow = [&](const uint64_t* bits, bool includeCentre)
+		{
+			uint64_t centre = bits[w];
+			uint64_t prev = w > 0 ? bits[w - 1] : 0;
+			uint64_t next = w < words - 1 ? bits[w + 1] : 0;
+
+			// cell x - 1 into bit x, and cell x + 1 into bit x
+			n[count++] = (centre << 1) | (prev >> 63);
+			n[count++] = (centre >> 1) | (next << 63);
+			if (includeCentre) n[count++] = centre;
+		};
+
+		// missing rows contribute nothing, exactly like neighbours off the edge of the map
+		if (above) addRow(above, true);
+		addRow(row, false);
+		if (below) addRow(below, true);
+
+		uint64_t ones = 0, twos = 0;
+		uint64_t everything = count == 8 ? ~0ull : 0ull;
+		for (int i = 0; i < count; i++)
+		{
+			twos |= ones & n[i];
+			ones |= n[i];
+			everything &= n[i];
+		}
+
+		if (any) any[w] = ones;
+		if (atLeastTwo) atLeastTwo[w] = twos;
+		if (all) all[w] = everything;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "BiomeMapBuffer.h"
+
+
+// Row kernels for the neighbourhood tests made by the cellular automaton stages of the biome pipeline
+// Every kernel matches the edge semantics of the original per-cell count:
+// neighbours that fall outside the map never count, for any value
+// Rows outside the map are passed as nullptr
+class BiomeKernels
+{
+public:
+	// pure static class
+	BiomeKernels() = delete;
+
+	// BYTE KERNELS
+	// one BiomeCell per cell
+
+	// counts[x] = the number of the 8 neighbours of cell x in row that are equal to value
+	static void CountEqualRow(const BiomeCell* above, const BiomeCell* row, const BiomeCell* below, int width, BiomeCell value, uint8_t* counts);
+
+	// out[x] = lut[row[x]]; used to test a property of a biome (e.g. its type) rather than its ID
+	static void LookupRow(const BiomeCell* row, int width, const BiomeCell* lut, BiomeCell* out);
+
+	// implementations, selected between by the functions above
+	static void CountEqualRowScalar(const BiomeCell* above, const BiomeCell* row, const BiomeCell* below, int width, BiomeCell value, uint8_t* counts);
+	static void CountEqualRowAVX2(const BiomeCell* above, const BiomeCell* row, const BiomeCell* below, int width, BiomeCell value, uint8_t* counts);
+
+
+	// BIT-PACKED KERNELS
+	// for maps that only hold 2 values (land and ocean), with cell x of a row in bit (x % 64) of word (x / 64)
+
+	static inline int WordsPerRow(int width) { return (width + 63) / 64; }
+
+	// bits[x] = row[x] == value; bits beyond width are cleared
+	static void PackRow(const BiomeCell* row, int width, BiomeCell value, uint64_t* bits);
+
+	// tests on the 8 neighbours of each cell; any output may be nullptr if it is not needed
+	// any: at least 1 neighbour is set, atLeastTwo: at least 2 neighbours are set, all: all 8 neighbours are set
+	static void NeighbourBitsRow(const uint64_t* above, const uint64_t* row, const uint64_t* below, int words,
+		uint64_t* any, uint64_t* atLeastTwo, uint64_t* all);
+
+	static inline bool TestBit(const uint64_t* bits, int x) { return ((bits[x >> 6] >> (x & 63)) & 1) != 0; }
+};
@@ -0,0 +1,464 @@
+#include "BiomeLayerStack.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+#include "BiomeRNG.h"
+
+
+// division that rounds towards negative infinity, so negative coordinates map to the correct parent cell
+static inline int FloorDiv(int a, int b)
+{
+	return (a >= 0 ? a : a - b + 1) / b;
+}
+
+
+BiomeLayer::BiomeLayer(size_t cacheCapacity)
+	: m_CacheCapacity(cacheCapacity > 0 ? cacheCapacity : 1)
+{
+}
+
+void BiomeLayer::GetRegion(int x, int y, int w, int h, BiomeCell* out)
+{
+	int cx0 = FloorDiv(x, ChunkSize);
+	int cy0 = FloorDiv(y, ChunkSize);
+	int cx1 = FloorDiv(x + w - 1, ChunkSize);
+	int cy1 = FloorDiv(y + h - 1, ChunkSize);
+
+	for (int cy = cy0; cy <= cy1; cy++)
+	{
+		for (int cx = cx0; cx <= cx1; cx++)
+		{
+			const BiomeCell* chunk = GetChunk(cx, cy);
+
+			// intersection of the chunk with the requested region
+			int chunkX = cx * ChunkSize;
+			int chunkY = cy * ChunkSize;
+			int ix0 = (chunkX > x) ? chunkX : x;
+			int iy0 = (chunkY > y) ? chunkY : y;
+			int ix1 = (chunkX + ChunkSize < x + w) ? chunkX + ChunkSize : x + w;
+			int iy1 = (chunkY + ChunkSize < y + h) ? chunkY + ChunkSize : y + h;
+
+			for (int j = iy0; j < iy1; j++)
+			{
+				const BiomeCell* src = chunk + (j - chunkY) * ChunkSize + (ix0 - chunkX);
+				BiomeCell* dst = out + (j - y) * w + (ix0 - x);
+				std::copy(src, src + (ix1 - ix0), dst);
+			}
+		}
+	}
+}
+
+void BiomeLayer::ClearCache()
+{
+	m_Chunks.clear();
+	m_ChunkLookup.clear();
+}
+
+const BiomeCell* BiomeLayer::GetChunk(int cx, int cy)
+{
+	auto key = std::make_pair(cx, cy);
+
+	auto it = m_ChunkLookup.find(key);
+	if (it != m_ChunkLookup.end())
+	{
+		// mark as most recently used
+		m_Chunks.splice(m_Chunks.begin(), m_Chunks, it->second);
+		return it->second->cells.data();
+	}
+
+	// evict the least recently used chunk, reusing its storage
+	if (m_Chunks.size() >= m_CacheCapacity)
+	{
+		m_ChunkLookup.erase(m_Chunks.back().coord);
+		m_Chunks.splice(m_Chunks.begin(), m_Chunks, std::prev(m_Chunks.end()));
+	}
+	else
+	{
+		m_Chunks.emplace_front();
+		m_Chunks.front().cells.resize(ChunkSize * ChunkSize);
+	}
+
+	Chunk& chunk = m_Chunks.front();
+	chunk.coord = key;
+	m_ChunkLookup.insert({ key, m_Chunks.begin() });
+
+	Generate(cx * ChunkSize, cy * ChunkSize, ChunkSize, ChunkSize, chunk.cells.data());
+
+	return chunk.cells.data();
+}
+
+
+
+// LAYER DEFINITIONS
+// these mirror the stages in BiomeGenerator, but have no map edges
+
+namespace
+{
+	// layers that read a 1 cell border around each cell of their parent
+	class NeighbourhoodLayer : public BiomeLayer
+	{
+	public:
+		NeighbourhoodLayer(BiomeLayer* parent, size_t cacheCapacity)
+			: BiomeLayer(cacheCapacity), m_Parent(parent) {}
+
+	protected:
+		virtual void Generate(int x, int y, int w, int h, BiomeCell* out) override
+		{
+			int pitch = w + 2;
+			m_Input.resize(pitch * (h + 2));
+			m_Parent->GetRegion(x - 1, y - 1, w + 2, h + 2, m_Input.data());
+
+			for (int j = 0; j < h; j++)
+			{
+				for (int i = 0; i < w; i++)
+				{
+					const BiomeCell* centre = m_Input.data() + (j + 1) * pitch + (i + 1);
+					out[j * w + i] = static_cast<BiomeCell>(Apply(x + i, y + j, centre, pitch));
+				}
+			}
+		}
+
+		// centre points at the parent cell; neighbours are at centre[dy * pitch + dx]
+		virtual int Apply(int x, int y, const BiomeCell* centre, int pitch) const = 0;
+
+		template<typename Pred>
+		static int CountNeighbours(const BiomeCell* centre, int pitch, Pred pred)
+		{
+			int count = 0;
+			for (int dy = -1; dy <= 1; dy++)
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				if (dx == 0 && dy == 0) continue;
+				count += pred(centre[dy * pitch + dx]) ? 1 : 0;
+			}
+			return count;
+		}
+
+	private:
+		BiomeLayer* m_Parent;
+		std::vector<BiomeCell> m_Input;
+	};
+
+
+	class IslandsLayer : public BiomeLayer
+	{
+	public:
+		IslandsLayer(const BiomeRules& rules, unsigned int stage, int continentChance, size_t cacheCapacity)
+			: BiomeLayer(cacheCapacity), m_Rules(rules), m_Stage(stage), m_ContinentChance(continentChance) {}
+
+	protected:
+		virtual void Generate(int x, int y, int w, int h, BiomeCell* out) override
+		{
+			for (int j = 0; j < h; j++)
+			for (int i = 0; i < w; i++)
+			{
+				out[j * w + i] = static_cast<BiomeCell>(BiomeRNG::Chance(m_ContinentChance, m_Rules.seed, m_Stage, x + i, y + j) ?
+					BIOME_TYPE_LAND : BIOME_TYPE_OCEAN);
+			}
+		}
+
+	private:
+		const BiomeRules& m_Rules;
+		unsigned int m_Stage;
+		int m_ContinentChance;
+	};
+
+
+	class AddIslandsLayer : public NeighbourhoodLayer
+	{
+	public:
+		AddIslandsLayer(BiomeLayer* parent, const BiomeRules& rules, unsigned int stage, int expandChance, int erodeChance, size_t cacheCapacity)
+			: NeighbourhoodLayer(parent, cacheCapacity), m_Rules(rules), m_Stage(stage), m_ExpandChance(expandChance), m_ErodeChance(erodeChance) {}
+
+	protected:
+		virtual int Apply(int x, int y, const BiomeCell* centre, int pitch) const override
+		{
+			int sample = *centre;
+			if (sample == BIOME_TYPE_OCEAN)
+			{
+				if (CountNeighbours(centre, pitch, [](int v) { return v == BIOME_TYPE_LAND; }) > 0)
+				{
+					if (BiomeRNG::Chance(m_ExpandChance, m_Rules.seed, m_Stage, x, y))
+						sample = BIOME_TYPE_LAND;
+				}
+			}
+			else if (sample == BIOME_TYPE_LAND)
+			{
+				if (CountNeighbours(centre, pitch, [](int v) { return v == BIOME_TYPE_OCEAN; }) > 1)
+				{
+					if (BiomeRNG::Chance(m_ErodeChance, m_Rules.seed, m_Stage, x, y))
+						sample = BIOME_TYPE_OCEAN;
+				}
+			}
+			return sample;
+		}
+
+	private:
+		const BiomeRules& m_Rules;
+		unsigned int m_Stage;
+		int m_ExpandChance;
+		int m_ErodeChance;
+	};
+
+
+	class RemoveTooMuchOceanLayer : public NeighbourhoodLayer
+	{
+	public:
+		RemoveTooMuchOceanLayer(BiomeLayer* parent, const BiomeRules& rules, unsigned int stage, int smallIslandsChance, size_t cacheCapacity)
+			: NeighbourhoodLayer(parent, cacheCapacity), m_Rules(rules), m_Stage(stage), m_SmallIslandsChance(smallIslandsChance) {}
+
+	protected:
+		virtual int Apply(int x, int y, const BiomeCell* centre, int pitch) const override
+		{
+			int sample = *centre;
+			if (CountNeighbours(centre, pitch, [](int v) { return v == BIOME_TYPE_OCEAN; }) == 8)
+			{
+				if (BiomeRNG::Chance(m_SmallIslandsChance, m_Rules.seed, m_Stage, x, y))
+					sample = BIOME_TYPE_LAND;
+			}
+			return sample;
+		}
+
+	private:
+		const BiomeRules& m_Rules;
+		unsigned int m_Stage;
+		int m_SmallIslandsChance;
+	};
+
+
+	class TemperatureLayer : public BiomeLayer
+	{
+	public:
+		TemperatureLayer(const BiomeRules& rules, unsigned int stage, size_t cacheCapacity)
+			: BiomeLayer(cacheCapacity), m_Rules(rules), m_Stage(stage) {}
+
+	protected:
+		virtual void Generate(int x, int y, int w, int h, BiomeCell* out) override
+		{
+			int t = m_Rules.temperateBiomeChance + m_Rules.warmBiomeChance + m_Rules.coldBiomeChance;
+
+			for (int j = 0; j < h; j++)
+			for (int i = 0; i < w; i++)
+			{
+				int r = BiomeRNG::Range(BiomeRNG::Hash(m_Rules.seed, m_Stage, x + i, y + j), t);
+				int temperature;
+				if (r <= m_Rules.temperateBiomeChance)
+					temperature = BIOME_TEMP_TEMPERATE;
+				else if (r <= m_Rules.temperateBiomeChance + m_Rules.coldBiomeChance)
+					temperature = BIOME_TEMP_COLD;
+				else
+					temperature = BIOME_TEMP_WARM;
+
+				out[j * w + i] = static_cast<BiomeCell>(temperature);
+			}
+		}
+
+	private:
+		const BiomeRules& m_Rules;
+		unsigned int m_Stage;
+	};
+
+
+	class TransitionTemperaturesLayer : public NeighbourhoodLayer
+	{
+	public:
+		TransitionTemperaturesLayer(BiomeLayer* parent, size_t cacheCapacity)
+			: NeighbourhoodLayer(parent, cacheCapacity) {}
+
+	protected:
+		virtual int Apply(int /*x*/, int /*y*/, const BiomeCell* centre, int pitch) const override
+		{
+			int temp = *centre;
+			if (temp == BIOME_TEMP_COLD)
+			{
+				if (CountNeighbours(centre, pitch, [](int v) { return v == BIOME_TEMP_WARM; }) > 3)
+					temp = BIOME_TEMP_TEMPERATE;
+			}
+			else if (temp == BIOME_TEMP_WARM)
+			{
+				if (CountNeighbours(centre, pitch, [](int v) { return v == BIOME_TEMP_COLD; }) > 3)
+					temp = BIOME_TEMP_TEMPERATE;
+			}
+			return temp;
+		}
+	};
+
+
+	class SelectBiomesLayer : public BiomeLayer
+	{
+	public:
+		SelectBiomesLayer(BiomeLayer* typeParent, BiomeLayer* tempParent, const BiomeRules& rules, unsigned int stage, size_t cacheCapacity)
+			: BiomeLayer(cacheCapacity), m_TypeParent(typeParent), m_TempParent(tempParent), m_Rules(rules), m_Stage(stage) {}
+
+	protected:
+		virtual void Generate(int x, int y, int w, int h, BiomeCell* out) override
+		{
+			m_Temps.resize(w * h);
+			m_TypeParent->GetRegion(x, y, w, h, out);
+			m_TempParent->GetRegion(x, y, w, h, m_Temps.data());
+
+			for (int j = 0; j < h; j++)
+			for (int i = 0; i < w; i++)
+			{
+				int chance = BiomeRNG::Range(BiomeRNG::Hash(m_Rules.seed, m_Stage, x + i, y + j), 100);
+				out[j * w + i] = static_cast<BiomeCell>(m_Rules.SelectBiome(static_cast<BIOME_TYPE>(out[j * w + i]), static_cast<BIOME_TEMP>(m_Temps[j * w + i]), chance));
+			}
+		}
+
+	private:
+		BiomeLayer* m_TypeParent;
+		BiomeLayer* m_TempParent;
+		const BiomeRules& m_Rules;
+		unsigned int m_Stage;
+
+		std::vector<BiomeCell> m_Temps;
+	};
+
+
+	class AddShoresLayer : public NeighbourhoodLayer
+	{
+	public:
+		AddShoresLayer(BiomeLayer* parent, const BiomeRules& rules, size_t cacheCapacity)
+			: NeighbourhoodLayer(parent, cacheCapacity), m_Rules(rules) {}
+
+	protected:
+		virtual int Apply(int /*x*/, int /*y*/, const BiomeCell* centre, int pitch) const override
+		{
+			int biome = *centre;
+			if (m_Rules.biomeTypes[biome] == BIOME_TYPE_LAND)
+			{
+				if (CountNeighbours(centre, pitch, [this](int v) { return m_Rules.biomeTypes[v] == BIOME_TYPE_OCEAN; }) > 0)
+				{
+					if (m_Rules.biomeTemps[biome] == BIOME_TEMP_COLD)
+						biome = m_Rules.coldShoreBiome;
+					else
+						biome = m_Rules.shoreBiome;
+				}
+			}
+			return biome;
+		}
+
+	private:
+		const BiomeRules& m_Rules;
+	};
+
+
+	class ZoomLayer : public BiomeLayer
+	{
+	public:
+		ZoomLayer(BiomeLayer* parent, const BiomeRules& rules, unsigned int stage, int perturbation, size_t cacheCapacity)
+			: BiomeLayer(cacheCapacity), m_Parent(parent), m_Rules(rules), m_Stage(stage), m_Perturbation(perturbation) {}
+
+	protected:
+		virtual void Generate(int x, int y, int w, int h, BiomeCell* out) override
+		{
+			// parent cells that can be sampled, including perturbation
+			int px = FloorDiv(x, 2) - 1;
+			int py = FloorDiv(y, 2) - 1;
+			int pw = FloorDiv(x + w - 1, 2) + 1 - px + 1;
+			int ph = FloorDiv(y + h - 1, 2) + 1 - py + 1;
+
+			m_Input.resize(pw * ph);
+			m_Parent->GetRegion(px, py, pw, ph, m_Input.data());
+
+			for (int j = 0; j < h; j++)
+			for (int i = 0; i < w; i++)
+			{
+				int cellX = x + i;
+				int cellY = y + j;
+
+				int sampleX = FloorDiv(cellX, 2);
+				int sampleY = FloorDiv(cellY, 2);
+
+				if (BiomeRNG::Chance(m_Perturbation, m_Rules.seed, m_Stage, cellX, cellY, 0))
+				{
+					if (BiomeRNG::Chance(50, m_Rules.seed, m_Stage, cellX, cellY, 1))
+						sampleX += BiomeRNG::Chance(50, m_Rules.seed, m_Stage, cellX, cellY, 2) ? 1 : -1;
+					else
+						sampleY += BiomeRNG::Chance(50, m_Rules.seed, m_Stage, cellX, cellY, 2) ? 1 : -1;
+				}
+
+				out[j * w + i] = m_Input[(sampleY - py) * pw + (sampleX - px)];
+			}
+		}
+
+	private:
+		BiomeLayer* m_Parent;
+		const BiomeRules& m_Rules;
+		unsigned int m_Stage;
+		int m_Perturbation;
+
+		std::vector<BiomeCell> m_Input;
+	};
+}
+
+
+
+BiomeLayerStack::BiomeLayerStack(const BiomeRules& rules, const BiomePipeline& pipeline, size_t cacheCapacityPerLayer)
+	: m_Rules(rules)
+{
+	assert(m_Rules.shoreBiome >= 0 && m_Rules.coldShoreBiome >= 0 && "Shore biomes must be set");
+
+	size_t cap = cacheCapacityPerLayer;
+	auto add = [this](BiomeLayer* layer) { m_Layers.emplace_back(layer); return layer; };
+
+	// the top layer of each of the pipeline's maps
+	std::vector<BiomeLayer*> maps(pipeline.GetMapNames().size(), nullptr);
+
+	// stage indices match those used by BiomeGenerator::GenerateBiomeMap
+	const auto& stages = pipeline.GetStages();
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		const BiomePipelineStage& desc = stages[i];
+		const unsigned int stage = pipeline.GetStageIndex(i);
+		auto param = [&desc](int index, int fallback) { return desc.params[index] >= 0 ? desc.params[index] : fallback; };
+
+		BiomeLayer* parent = maps[desc.map];
+		BiomeLayer* layer = nullptr;
+
+		switch (desc.type)
+		{
+		case BIOME_STAGE_ISLANDS:
+			layer = new IslandsLayer(m_Rules, stage, param(0, m_Rules.continentChance), cap); break;
+		case BIOME_STAGE_ADD_ISLANDS:
+			layer = new AddIslandsLayer(parent, m_Rules, stage, param(0, m_Rules.islandExpandChance), param(1, m_Rules.islandErodeChance), cap); break;
+		case BIOME_STAGE_REMOVE_TOO_MUCH_OCEAN:
+			layer = new RemoveTooMuchOceanLayer(parent, m_Rules, stage, param(0, m_Rules.smallIslandsChance), cap); break;
+		case BIOME_STAGE_CREATE_TEMPERATURES:
+			layer = new TemperatureLayer(m_Rules, stage, cap); break;
+		case BIOME_STAGE_TRANSITION_TEMPERATURES:
+			layer = new TransitionTemperaturesLayer(parent, cap); break;
+		case BIOME_STAGE_SELECT_BIOMES:
+			layer = new SelectBiomesLayer(parent, maps[desc.secondary], m_Rules, stage, cap); break;
+		case BIOME_STAGE_ADD_SHORES:
+			layer = new AddShoresLayer(parent, m_Rules, cap); break;
+		case BIOME_STAGE_ZOOM_2X:
+			layer = new ZoomLayer(parent, m_Rules, stage, param(0, m_Rules.zoomSamplePerturbation), cap); break;
+		default:
+			assert(false && "Unknown biome stage type");
+		}
+
+		maps[desc.map] = add(layer);
+	}
+
+	m_Output = maps[pipeline.GetOutputMap()];
+	m_NominalMapSize = pipeline.GetFinalSize();
+}
+
+BiomeLayerStack::~BiomeLayerStack() = default;
+
+void BiomeLayerStack::GetBiomes(int x, int y, int w, int h, BiomeCell* out)
+{
+	if (w <= 0 || h <= 0) return;
+	m_Output->GetRegion(x, y, w, h, out);
+}
+
+size_t BiomeLayerStack::GetCachedChunkCount() const
+{
+	size_t count = 0;
+	for (auto& layer : m_Layers)
+		count += layer->GetCachedChunkCount();
+	return count;
+}
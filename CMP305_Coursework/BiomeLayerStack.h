@@ -0,0 +1,79 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "BiomeRules.h"
+#include "BiomeMapBuffer.h"
+#include "BiomePipeline.h"
+
+
+// A single layer of the biome pipeline, defined over the entire (unbounded) integer plane
+// Layers are evaluated lazily in fixed size chunks, and recently used chunks are kept in an LRU cache
+class BiomeLayer
+{
+public:
+	static const int ChunkSize = 32;
+
+	BiomeLayer(size_t cacheCapacity);
+	virtual ~BiomeLayer() = default;
+
+	// writes the cells [x, x + w) * [y, y + h) into out, row-major with a pitch of w
+	void GetRegion(int x, int y, int w, int h, BiomeCell* out);
+
+	void ClearCache();
+	inline size_t GetCachedChunkCount() const { return m_Chunks.size(); }
+
+protected:
+	// generate the cells [x, x + w) * [y, y + h) of this layer
+	virtual void Generate(int x, int y, int w, int h, BiomeCell* out) = 0;
+
+private:
+	const BiomeCell* GetChunk(int cx, int cy);
+
+private:
+	struct Chunk
+	{
+		std::pair<int, int> coord;
+		std::vector<BiomeCell> cells;
+	};
+
+	size_t m_CacheCapacity;
+
+	// most recently used chunk is at the front
+	std::list<Chunk> m_Chunks;
+	std::map<std::pair<int, int>, std::list<Chunk>::iterator> m_ChunkLookup;
+};
+
+
+// A biome pipeline (by default islands -> zoom -> temperatures -> biomes -> shores) as a stack of unbounded layers
+// Any region of the world can be queried, at a cost proportional to the area queried
+// Random decisions use the same keys as BiomeGenerator::GenerateBiomeMap, so both produce the same style of world
+class BiomeLayerStack
+{
+public:
+	// each chunk pulls a few chunks from the layer beneath it, so very small caches will regenerate parent chunks repeatedly
+	BiomeLayerStack(const BiomeRules& rules, const BiomePipeline& pipeline, size_t cacheCapacityPerLayer = 256);
+	~BiomeLayerStack();
+
+	// layers hold references to the stack's rules
+	BiomeLayerStack(const BiomeLayerStack&) = delete;
+	BiomeLayerStack& operator=(const BiomeLayerStack&) = delete;
+
+	// writes the biome IDs of cells [x, x + w) * [y, y + h) into out, row-major with a pitch of w
+	void GetBiomes(int x, int y, int w, int h, BiomeCell* out);
+
+	// size that the fixed-size biome map pipeline would produce; the scale at which the stack is sampled
+	inline size_t GetNominalMapSize() const { return m_NominalMapSize; }
+
+	size_t GetCachedChunkCount() const;
+
+private:
+	BiomeRules m_Rules;
+	size_t m_NominalMapSize = 0;
+
+	std::vector<std::unique_ptr<BiomeLayer>> m_Layers;
+	BiomeLayer* m_Output = nullptr;
+};
@@ -0,0 +1,55 @@
+#include "BiomeMapBuffer.h"
+
+#include <cassert>
+
+
+BiomeArena::~BiomeArena()
+{
+	if (m_Memory) delete[] m_Memory;
+}
+
+void BiomeArena::Reset(size_t capacity)
+{
+	m_Used = 0;
+
+	if (capacity <= m_Capacity) return;
+
+	// only ever grow, so the arena settles at the size of the largest pipeline
+	if (m_Memory) delete[] m_Memory;
+	m_Memory = new uint8_t[capacity];
+	m_Capacity = capacity;
+}
+
+void* BiomeArena::AllocateBytes(size_t bytes)
+{
+	// align relative to the real address, as new[] only guarantees fundamental alignment
+	uintptr_t base = reinterpret_cast<uintptr_t>(m_Memory);
+	uintptr_t aligned = (base + m_Used + Alignment - 1) & ~(static_cast<uintptr_t>(Alignment) - 1);
+	size_t offset = static_cast<size_t>(aligned - base);
+
+	assert(offset + bytes <= m_Capacity && "Biome arena is too small; Reset it with a larger capacity");
+
+	m_Used = offset + bytes;
+	return m_Memory + offset;
+}
+
+
+BiomeMapBuffer::BiomeMapBuffer(BiomeArena& arena, size_t maxSize)
+	: m_MaxSize(maxSize)
+{
+	m_Front = arena.Allocate<BiomeCell>(maxSize * maxSize);
+	m_Back = arena.Allocate<BiomeCell>(maxSize * maxSize);
+}
+
+void BiomeMapBuffer::Swap()
+{
+	BiomeCell* temp = m_Front;
+	m_Front = m_Back;
+	m_Back = temp;
+}
+
+void BiomeMapBuffer::SetSize(size_t size)
+{
+	assert(size <= m_MaxSize && "Biome map buffer is too small");
+	m_Size = size;
+}
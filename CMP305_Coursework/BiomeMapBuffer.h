@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+// biome IDs, temperatures and land/ocean flags all fit comfortably in a byte (MAX_BIOMES is 32)
+typedef uint8_t BiomeCell;
+
+
+// Linear allocator that keeps its memory between biome map generations
+// Once it has grown to fit the largest pipeline, generating a biome map performs no heap allocations
+class BiomeArena
+{
+public:
+	BiomeArena() = default;
+	~BiomeArena();
+
+	BiomeArena(const BiomeArena&) = delete;
+	BiomeArena& operator=(const BiomeArena&) = delete;
+
+	// frees every allocation at once and makes sure at least capacity bytes are available
+	// any pointers previously handed out by the arena are invalidated
+	void Reset(size_t capacity);
+
+	template<typename T>
+	T* Allocate(size_t count)
+	{
+		return static_cast<T*>(AllocateBytes(count * sizeof(T)));
+	}
+
+	inline size_t GetCapacity() const { return m_Capacity; }
+	inline size_t GetUsed() const { return m_Used; }
+
+	// frees everything allocated since GetUsed() returned used; for temporary data within a stage
+	inline void Rewind(size_t used) { if (used < m_Used) m_Used = used; }
+
+	// bytes required for an allocation of count objects of type T, accounting for worst-case alignment
+	template<typename T>
+	static size_t RequiredBytes(size_t count) { return count * sizeof(T) + Alignment; }
+
+private:
+	void* AllocateBytes(size_t bytes);
+
+private:
+	// every allocation starts on its own cache line
+	static const size_t Alignment = 64;
+
+	uint8_t* m_Memory = nullptr;
+	size_t m_Capacity = 0;
+	size_t m_Used = 0;
+};
+
+
+// A square biome map with a front (read) and back (write) buffer
+// Each pipeline stage reads the front buffer, writes the back buffer, then swaps them
+// Both buffers are sized for the largest map the pipeline will produce, so stages that grow the map (zooms) need no reallocation
+class BiomeMapBuffer
+{
+public:
+	BiomeMapBuffer(BiomeArena& arena, size_t maxSize);
+
+	inline const BiomeCell* Read() const { return m_Front; }
+	inline BiomeCell* Read() { return m_Front; }
+	inline BiomeCell* Write() { return m_Back; }
+
+	// the back buffer becomes the front buffer
+	void Swap();
+
+	inline size_t GetSize() const { return m_Size; }
+	inline size_t GetMaxSize() const { return m_MaxSize; }
+	void SetSize(size_t size);
+
+	// arena bytes needed for a buffer of this size
+	static size_t RequiredBytes(size_t maxSize) { return 2 * BiomeArena::RequiredBytes<BiomeCell>(maxSize * maxSize); }
+
+private:
+	BiomeCell* m_Front = nullptr;
+	BiomeCell* m_Back = nullptr;
+
+	size_t m_Size = 0;
+	size_t m_MaxSize = 0;
+};
@@ -0,0 +1,490 @@
+#include "BiomePipeline.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+
+// largest map a pipeline may produce; the biome map texture is this size squared
+static const int MaxPipelineMapSize = 4096;
+
+
+BiomePipeline BiomePipeline::Default()
+{
+	BiomePipeline pipeline;
+	pipeline.m_MapNames = { "biomes", "temperatures" };
+	const int biomes = 0, temps = 1;
+
+	auto add = [&pipeline](BIOME_STAGE_TYPE type, int map)
+	{
+		BiomePipelineStage stage;
+		stage.type = type;
+		stage.map = map;
+		pipeline.m_Stages.push_back(stage);
+		return &pipeline.m_Stages.back();
+	};
+
+	// start with a really small biome map; 4x4
+	// work out what will be land and what will be ocean
+	add(BIOME_STAGE_ISLANDS, biomes)->size = 4;
+	add(BIOME_STAGE_ZOOM_2X, biomes);
+	add(BIOME_STAGE_ADD_ISLANDS, biomes);
+	add(BIOME_STAGE_ZOOM_2X, biomes);
+	add(BIOME_STAGE_ADD_ISLANDS, biomes);
+	add(BIOME_STAGE_ADD_ISLANDS, biomes);
+	add(BIOME_STAGE_ADD_ISLANDS, biomes);
+	add(BIOME_STAGE_REMOVE_TOO_MUCH_OCEAN, biomes);
+
+	// decide on biome temperatures
+	add(BIOME_STAGE_CREATE_TEMPERATURES, temps)->sizeOf = biomes;
+
+	add(BIOME_STAGE_ZOOM_2X, biomes);
+	add(BIOME_STAGE_ZOOM_2X, temps);
+
+	add(BIOME_STAGE_TRANSITION_TEMPERATURES, temps);
+
+	// now select biomes based off of the temperatures, then zoom to the final size and add shores
+	add(BIOME_STAGE_SELECT_BIOMES, biomes)->secondary = temps;
+	add(BIOME_STAGE_ZOOM_2X, biomes);
+	add(BIOME_STAGE_ADD_SHORES, biomes);
+
+	pipeline.m_OutputMap = biomes;
+
+	std::string error;
+	bool valid = pipeline.Validate(error);
+	assert(valid && "Default biome pipeline is invalid");
+
+	return pipeline;
+}
+
+bool BiomePipeline::LoadFromJson(const nlohmann::json& data, std::string& error)
+{
+	BiomePipeline pipeline;
+
+	// maps are declared by being used
+	auto mapIndex = [&pipeline](const std::string& name)
+	{
+		int index = pipeline.FindMap(name);
+		if (index < 0)
+		{
+			index = static_cast<int>(pipeline.m_MapNames.size());
+			pipeline.m_MapNames.push_back(name);
+		}
+		return index;
+	};
+
+	try
+	{
+		if (!data.contains("stages") || !data["stages"].is_array())
+		{
+			error = "Pipeline has no stages array";
+			return false;
+		}
+
+		for (auto& desc : data["stages"])
+		{
+			BiomePipelineStage stage;
+
+			std::string typeName = desc.value("type", "");
+			if (!BiomeStage::TypeFromName(typeName.c_str(), stage.type))
+			{
+				error = "Unknown stage type '" + typeName + "'";
+				return false;
+			}
+			const BiomeStageInfo& info = BiomeStage::GetInfo(stage.type);
+
+			if (!desc.contains("map"))
+			{
+				error = std::string(info.name) + " stage has no map";
+				return false;
+			}
+			stage.map = mapIndex(desc["map"].get<std::string>());
+
+			if (info.secondary)
+			{
+				if (!desc.contains(info.secondary))
+				{
+					error = std::string(info.name) + " stage has no " + info.secondary + " map";
+					return false;
+				}
+				stage.secondary = mapIndex(desc[info.secondary].get<std::string>());
+			}
+
+			if (info.generator)
+			{
+				if (desc.contains("size")) stage.size = desc["size"];
+				if (desc.contains("sizeOf")) stage.sizeOf = mapIndex(desc["sizeOf"].get<std::string>());
+			}
+
+			for (int i = 0; i < BIOME_STAGE_MAX_PARAMS; i++)
+			{
+				if (info.params[i] && desc.contains(info.params[i]))
+					stage.params[i] = desc[info.params[i]];
+			}
+
+			if (desc.contains("stage")) stage.stage = desc["stage"];
+
+			pipeline.m_Stages.push_back(stage);
+		}
+
+		if (data.contains("output"))
+		{
+			pipeline.m_OutputMap = pipeline.FindMap(data["output"].get<std::string>());
+			if (pipeline.m_OutputMap < 0)
+			{
+				error = "Output map is never created";
+				return false;
+			}
+		}
+		else if (!pipeline.m_Stages.empty())
+		{
+			// default to whatever the last stage wrote
+			pipeline.m_OutputMap = pipeline.m_Stages.back().map;
+		}
+	}
+	catch (const nlohmann::json::exception& e)
+	{
+		error = e.what();
+		return false;
+	}
+
+	if (!pipeline.Validate(error))
+		return false;
+
+	*this = pipeline;
+	return true;
+}
+
+nlohmann::json BiomePipeline::Serialize() const
+{
+	nlohmann::json serialized;
+
+	serialized["output"] = m_MapNames[m_OutputMap];
+	serialized["stages"] = nlohmann::json::array();
+
+	for (auto& stage : m_Stages)
+	{
+		const BiomeStageInfo& info = BiomeStage::GetInfo(stage.type);
+
+		nlohmann::json desc;
+		desc["type"] = info.name;
+		desc["map"] = m_MapNames[stage.map];
+		if (info.secondary) desc[info.secondary] = m_MapNames[stage.secondary];
+		if (stage.size > 0) desc["size"] = stage.size;
+		if (stage.sizeOf >= 0) desc["sizeOf"] = m_MapNames[stage.sizeOf];
+
+		for (int i = 0; i < BIOME_STAGE_MAX_PARAMS; i++)
+		{
+			if (info.params[i] && stage.params[i] >= 0)
+				desc[info.params[i]] = stage.params[i];
+		}
+
+		if (stage.stage >= 0) desc["stage"] = stage.stage;
+
+		serialized["stages"].push_back(desc);
+	}
+
+	return serialized;
+}
+
+bool BiomePipeline::Validate(std::string& error)
+{
+	if (m_Stages.empty())
+	{
+		error = "Pipeline has no stages";
+		return false;
+	}
+
+	const size_t stageCount = m_Stages.size();
+	m_StageIndices.assign(stageCount, 0);
+	m_InputSizes.assign(stageCount, 0);
+	m_OutputSizes.assign(stageCount, 0);
+
+	// a size of 0 means the map hasn't been created yet
+	std::vector<int> sizes(m_MapNames.size(), 0);
+	m_MaxMapSizes.assign(m_MapNames.size(), 0);
+
+	unsigned int nextStage = 0;
+	for (size_t i = 0; i < stageCount; i++)
+	{
+		const BiomePipelineStage& stage = m_Stages[i];
+		const BiomeStageInfo& info = BiomeStage::GetInfo(stage.type);
+		const std::string& mapName = m_MapNames[stage.map];
+
+		// random stages each get their own index, unless they are given one
+		if (info.random)
+		{
+			m_StageIndices[i] = stage.stage >= 0 ? static_cast<unsigned int>(stage.stage) : nextStage;
+			nextStage = m_StageIndices[i] + 1;
+		}
+
+		if (info.generator)
+		{
+			int size = stage.size;
+			if (size <= 0 && stage.sizeOf >= 0)
+				size = sizes[stage.sizeOf];
+			if (size <= 0)
+			{
+				error = std::string(info.name) + " stage creating '" + mapName + "' needs a size, or the name of an existing map in sizeOf";
+				return false;
+			}
+			sizes[stage.map] = size;
+		}
+		else if (sizes[stage.map] == 0)
+		{
+			error = std::string(info.name) + " stage uses '" + mapName + "' before it is created";
+			return false;
+		}
+
+		m_InputSizes[i] = sizes[stage.map];
+		m_OutputSizes[i] = info.generator ? sizes[stage.map] : sizes[stage.map] * info.scale;
+
+		if (stage.secondary >= 0)
+		{
+			if (stage.secondary == stage.map)
+			{
+				error = std::string(info.name) + " stage cannot read the map it writes";
+				return false;
+			}
+			if (sizes[stage.secondary] != m_InputSizes[i])
+			{
+				error = std::string(info.name) + " stage needs '" + m_MapNames[stage.secondary] + "' to be the same size as '" + mapName + "'";
+				return false;
+			}
+		}
+
+		if (m_OutputSizes[i] > MaxPipelineMapSize)
+		{
+			error = "Map '" + mapName + "' grows larger than " + std::to_string(MaxPipelineMapSize);
+			return false;
+		}
+
+		sizes[stage.map] = m_OutputSizes[i];
+		if (sizes[stage.map] > m_MaxMapSizes[stage.map])
+			m_MaxMapSizes[stage.map] = sizes[stage.map];
+	}
+
+	if (m_OutputMap < 0 || sizes[m_OutputMap] == 0)
+	{
+		error = "Pipeline has no output map";
+		return false;
+	}
+	m_FinalSize = sizes[m_OutputMap];
+
+	return true;
+}
+
+int BiomePipeline::FindMap(const std::string& name) const
+{
+	for (size_t i = 0; i < m_MapNames.size(); i++)
+	{
+		if (m_MapNames[i] == name)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+
+
+void BiomePlan::Compile(const BiomePipeline& pipeline)
+{
+	const auto& stages = pipeline.GetStages();
+	const int mapCount = static_cast<int>(pipeline.GetMapNames().size());
+
+	// any previous outputs are discarded along with the chains
+	m_Chains.clear();
+	m_Stats.clear();
+	m_MapNames = pipeline.GetMapNames();
+
+	m_MaxMapSizes.resize(mapCount);
+	m_ArenaBytes = 0;
+	for (int m = 0; m < mapCount; m++)
+	{
+		m_MaxMapSizes[m] = pipeline.GetMaxMapSize(m);
+		m_ArenaBytes += BiomeMapBuffer::RequiredBytes(m_MaxMapSizes[m]);
+	}
+
+	// each map has at most one chain being built at a time
+	// a chain is emitted once something else needs its result, or a later stage would change a map it reads
+	std::vector<Chain> open(mapCount);
+	// the last chain emitted for each map
+	std::vector<int> last(mapCount, -1);
+	// cells written by the stages of each open chain, a measure of what rerunning it costs
+	std::vector<size_t> openCells(mapCount, 0);
+
+	auto emit = [&](int map)
+	{
+		Chain& chain = open[map];
+		if (chain.stages.empty()) return;
+
+		for (int stat : chain.statIndices)
+			m_Stats[stat].chain = static_cast<int>(m_Chains.size());
+
+		last[map] = static_cast<int>(m_Chains.size());
+		m_Chains.push_back(chain);
+		chain.stages.clear();
+		chain.secondaryChains.clear();
+		chain.statIndices.clear();
+		openCells[map] = 0;
+	};
+
+	// settings read by any earlier stage
+	unsigned int rulesRead = 0;
+
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		const BiomePipelineStage& desc = stages[i];
+		const BiomeStageInfo& info = BiomeStage::GetInfo(desc.type);
+
+		BiomeStage stage = BiomeStage::Create(desc.type, pipeline.GetStageIndex(i));
+		for (int p = 0; p < BIOME_STAGE_MAX_PARAMS; p++)
+			stage.params[p] = desc.params[p];
+
+		// the map this stage reads must be complete
+		if (desc.secondary >= 0)
+			emit(desc.secondary);
+
+		// chains that read this map must run before it changes
+		for (int m = 0; m < mapCount; m++)
+		{
+			if (m == desc.map) continue;
+			for (int secondary : open[m].secondaryChains)
+			{
+				if (secondary >= 0 && m_Chains[secondary].map == desc.map)
+				{
+					emit(m);
+					break;
+				}
+			}
+		}
+
+		// a stage that reads a setting for the first time only starts a new chain when that saves work: the chain's
+		// output so far is written out in full, and copied back whenever the new chain reruns, so it is only worth
+		// keeping when rerunning the chain so far would cost more
+		// otherwise the stage stays fused, and changing the setting reruns the chain (whose key includes it) from its input
+		const unsigned int rules = stage.GetRuleDependencies();
+		const size_t inputCells = static_cast<size_t>(pipeline.GetInputSize(i)) * pipeline.GetInputSize(i);
+		const bool keepInput = (rules & ~rulesRead) && openCells[desc.map] > 2 * inputCells;
+		rulesRead |= rules;
+
+		// generators always start a new chain, and chains are limited in length
+		if (info.generator || keepInput || static_cast<int>(open[desc.map].stages.size()) >= BiomeStageExecutor::MaxChainLength)
+			emit(desc.map);
+
+		Chain& chain = open[desc.map];
+		if (chain.stages.empty())
+		{
+			chain.map = desc.map;
+			chain.startSize = info.generator ? pipeline.GetOutputSize(i) : 0;
+			chain.previous = info.generator ? -1 : last[desc.map];
+			chain.key = 0;
+			chain.snapshotSize = 0;
+			chain.snapshotKey = 0;
+			chain.snapshotValid = false;
+		}
+
+		chain.stages.push_back(stage);
+		openCells[desc.map] += static_cast<size_t>(pipeline.GetOutputSize(i)) * pipeline.GetOutputSize(i);
+		chain.secondaryChains.push_back(desc.secondary >= 0 ? last[desc.secondary] : -1);
+		chain.statIndices.push_back(static_cast<int>(m_Stats.size()));
+
+		StageStats stats;
+		stats.name = info.name;
+		stats.map = desc.map;
+		stats.stage = stage.stage;
+		stats.inputSize = pipeline.GetInputSize(i);
+		stats.outputSize = pipeline.GetOutputSize(i);
+		stats.outputBytes = static_cast<size_t>(stats.outputSize) * stats.outputSize * sizeof(BiomeCell);
+		stats.milliseconds = 0.0;
+		stats.chain = -1;
+		stats.reused = false;
+		m_Stats.push_back(stats);
+	}
+
+	// whatever is left doesn't depend on anything else
+	for (int m = 0; m < mapCount; m++)
+		emit(m);
+
+	m_OutputChain = last[pipeline.GetOutputMap()];
+}
+
+BiomeCell* BiomePlan::Execute(const BiomeRules& rules, BiomeArena& arena, BiomeStageExecutor& executor, unsigned int threadCount, size_t& outputSize)
+{
+	assert(!m_Chains.empty() && "Biome plan has not been compiled");
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	arena.Reset(m_ArenaBytes);
+	m_Maps.clear();
+	for (int size : m_MaxMapSizes)
+		m_Maps.emplace_back(arena, size);
+
+	for (auto& stats : m_Stats)
+	{
+		stats.milliseconds = 0.0;
+		stats.reused = true;
+	}
+	m_LastStagesRun = 0;
+
+	for (Chain& chain : m_Chains)
+	{
+		// a chain's output is determined by its input, its stages, the settings they read, and any maps they read
+		chain.key = chain.previous >= 0 ? m_Chains[chain.previous].key : BiomeRules::HashCombine(0, chain.startSize);
+		for (size_t i = 0; i < chain.stages.size(); i++)
+		{
+			chain.key = BiomeRules::HashCombine(chain.key, chain.stages[i].Key(rules));
+			if (chain.secondaryChains[i] >= 0)
+				chain.key = BiomeRules::HashCombine(chain.key, m_Chains[chain.secondaryChains[i]].key);
+		}
+
+		if (chain.snapshotValid && chain.snapshotKey == chain.key)
+			continue;
+
+		// earlier chains are always up to date by now
+		BiomeMapBuffer& map = m_Maps[chain.map];
+		if (chain.previous >= 0)
+		{
+			const Chain& previous = m_Chains[chain.previous];
+			map.SetSize(previous.snapshotSize);
+			std::copy(previous.snapshot.begin(), previous.snapshot.end(), map.Read());
+		}
+		else
+		{
+			map.SetSize(chain.startSize);
+		}
+
+		for (size_t i = 0; i < chain.stages.size(); i++)
+			chain.stages[i].secondary = chain.secondaryChains[i] >= 0 ? m_Chains[chain.secondaryChains[i]].snapshot.data() : nullptr;
+
+		m_ChainSeconds.assign(chain.stages.size(), 0.0);
+		executor.Run(rules, chain.stages.data(), static_cast<int>(chain.stages.size()), map, threadCount, m_ChainSeconds.data());
+
+		for (size_t i = 0; i < chain.stages.size(); i++)
+		{
+			StageStats& stats = m_Stats[chain.statIndices[i]];
+			stats.milliseconds = 1000.0 * m_ChainSeconds[i];
+			stats.reused = false;
+		}
+		m_LastStagesRun += static_cast<int>(chain.stages.size());
+
+		// keep the output for next time; the snapshot's storage is reused once it has grown
+		chain.snapshotSize = map.GetSize();
+		chain.snapshot.assign(map.Read(), map.Read() + chain.snapshotSize * chain.snapshotSize);
+		chain.snapshotKey = chain.key;
+		chain.snapshotValid = true;
+	}
+
+	m_LastMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	Chain& output = m_Chains[m_OutputChain];
+	outputSize = output.snapshotSize;
+	return output.snapshot.data();
+}
+
+size_t BiomePlan::GetSnapshotBytes() const
+{
+	size_t bytes = 0;
+	for (auto& chain : m_Chains)
+		bytes += chain.snapshot.capacity() * sizeof(BiomeCell);
+	return bytes;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "BiomeRules.h"
+#include "BiomeMapBuffer.h"
+#include "BiomeStages.h"
+
+
+// One stage of a data-driven biome pipeline
+struct BiomePipelineStage
+{
+	BIOME_STAGE_TYPE type = BIOME_STAGE_ISLANDS;
+
+	// index of the map the stage transforms
+	int map = -1;
+	// index of the second map the stage reads (e.g. temperatures for SelectBiomes), or -1
+	int secondary = -1;
+
+	// generators only: the size of the map they create, either given directly or copied from another map
+	int size = 0;
+	int sizeOf = -1;
+
+	// overrides for the rules, as named by BiomeStageInfo::params; -1 uses the rules
+	int params[BIOME_STAGE_MAX_PARAMS] = { -1, -1 };
+
+	// key for the stage's random decisions; -1 follows on from the previous random stage
+	int stage = -1;
+};
+
+
+// The sequence of biome stages, and the named maps they operate on, as declared in the settings JSON
+// Maps are created by generator stages, and every other stage transforms one map in place
+class BiomePipeline
+{
+public:
+	// the islands -> temperatures -> biomes -> shores pipeline, which produces a 64x64 map
+	static BiomePipeline Default();
+
+	// replaces the pipeline only if the description is valid; otherwise error describes the problem
+	bool LoadFromJson(const nlohmann::json& data, std::string& error);
+	nlohmann::json Serialize() const;
+
+	inline const std::vector<std::string>& GetMapNames() const { return m_MapNames; }
+	inline const std::vector<BiomePipelineStage>& GetStages() const { return m_Stages; }
+	inline int GetOutputMap() const { return m_OutputMap; }
+
+	// resolved stage indices, map sizes before and after each stage, and the largest size of each map
+	inline unsigned int GetStageIndex(size_t i) const { return m_StageIndices[i]; }
+	inline int GetInputSize(size_t i) const { return m_InputSizes[i]; }
+	inline int GetOutputSize(size_t i) const { return m_OutputSizes[i]; }
+	inline int GetMaxMapSize(int map) const { return m_MaxMapSizes[map]; }
+	inline int GetFinalSize() const { return m_FinalSize; }
+
+private:
+	// checks the stages make sense together and works out every map size
+	bool Validate(std::string& error);
+
+	int FindMap(const std::string& name) const;
+
+private:
+	std::vector<std::string> m_MapNames;
+	std::vector<BiomePipelineStage> m_Stages;
+	int m_OutputMap = -1;
+
+	std::vector<unsigned int> m_StageIndices;
+	std::vector<int> m_InputSizes;
+	std::vector<int> m_OutputSizes;
+	std::vector<int> m_MaxMapSizes;
+	int m_FinalSize = 0;
+};
+
+
+// A biome pipeline compiled for execution
+// Stages are grouped into chains that can be fused, and every map's storage is sized up front,
+// so running the plan is just a handful of BiomeStageExecutor::Run calls
+//
+// The output of every chain is kept, keyed by a hash of everything that went into it
+// Executing the plan again only reruns the chains whose key has changed, and those after them
+// Chains are split before a stage that reads a setting no earlier stage does, so that changing that setting restarts
+// the pipeline right at that stage, but only where keeping the output up to that stage costs less than redoing it;
+// e.g. AddShores stays fused after SelectBiomes and Zoom2x, which are cheap to rerun when biome properties change
+class BiomePlan
+{
+public:
+	struct StageStats
+	{
+		const char* name;
+		// index of the map the stage transforms; see GetMapNames
+		int map;
+		unsigned int stage;
+		int inputSize;
+		int outputSize;
+		// bytes the stage's output would occupy as a whole map; fused stages only ever hold a tile of it
+		size_t outputBytes;
+		// time spent in the stage, summed over all threads
+		double milliseconds;
+		// which chain the stage was fused into
+		int chain;
+		// whether the stage's output was reused from the previous execution rather than rerun
+		bool reused;
+	};
+
+	void Compile(const BiomePipeline& pipeline);
+
+	// runs every chain whose output is out of date and returns the output map, which is owned by the plan
+	// arena provides working storage, and is reset
+	BiomeCell* Execute(const BiomeRules& rules, BiomeArena& arena, BiomeStageExecutor& executor, unsigned int threadCount, size_t& outputSize);
+
+	// arena bytes needed for working storage, and bytes held by the chain outputs
+	inline size_t GetArenaBytes() const { return m_ArenaBytes; }
+	size_t GetSnapshotBytes() const;
+	inline size_t GetChainCount() const { return m_Chains.size(); }
+	inline const std::vector<std::string>& GetMapNames() const { return m_MapNames; }
+
+	// results of the last execution
+	inline const std::vector<StageStats>& GetStageStats() const { return m_Stats; }
+	inline double GetLastMilliseconds() const { return m_LastMilliseconds; }
+	inline int GetLastStagesRun() const { return m_LastStagesRun; }
+
+private:
+	struct Chain
+	{
+		int map;
+		// size of the map created by a chain beginning with a generator
+		int startSize;
+		// chain whose output is this chain's input, or -1 for chains that begin with a generator
+		int previous;
+
+		std::vector<BiomeStage> stages;
+		// chain whose output each stage reads as its secondary input, or -1
+		std::vector<int> secondaryChains;
+		// stats entry of each stage
+		std::vector<int> statIndices;
+
+		// key of the chain's output on the current execution
+		uint64_t key;
+
+		// output of the chain, and the key it was generated with
+		std::vector<BiomeCell> snapshot;
+		size_t snapshotSize;
+		uint64_t snapshotKey;
+		bool snapshotValid;
+	};
+
+	std::vector<Chain> m_Chains;
+	std::vector<int> m_MaxMapSizes;
+	int m_OutputChain = -1;
+	size_t m_ArenaBytes = 0;
+
+	std::vector<std::string> m_MapNames;
+	std::vector<StageStats> m_Stats;
+	double m_LastMilliseconds = 0.0;
+	int m_LastStagesRun = 0;
+
+	// working storage for the maps while chains run
+	std::vector<BiomeMapBuffer> m_Maps;
+	std::vector<double> m_ChainSeconds;
+};
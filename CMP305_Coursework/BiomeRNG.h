@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+
+// Stateless, counter-based random number generator used by biome generation
+// Every random decision is a pure hash of (seed, stage, x, y, draw), so cells can be evaluated
+// in any order and on any number of threads while always producing the same biome map
+class BiomeRNG
+{
+public:
+	// pure static class
+	BiomeRNG() = delete;
+
+	static inline uint32_t Hash(uint32_t seed, uint32_t stage, int x, int y, uint32_t draw = 0)
+	{
+		uint32_t h = Mix(seed + 0x9E3779B9u);
+		h = Mix(h ^ (stage * 0x85EBCA6Bu));
+		h = Mix(h ^ (static_cast<uint32_t>(x) * 0xC2B2AE35u));
+		h = Mix(h ^ (static_cast<uint32_t>(y) * 0x27D4EB2Fu));
+		h = Mix(h ^ (draw * 0x165667B1u));
+		return h;
+	}
+
+	// maps a hash to a uniformly distributed integer in [1, n]
+	static inline int Range(uint32_t hash, int n)
+	{
+		return static_cast<int>((static_cast<uint64_t>(hash) * static_cast<uint64_t>(n)) >> 32) + 1;
+	}
+
+	// percent is an integer [0,100] for how likely this is to return true
+	static inline bool Chance(int percent, uint32_t seed, uint32_t stage, int x, int y, uint32_t draw = 0)
+	{
+		return Range(Hash(seed, stage, x, y, draw), 100) <= percent;
+	}
+
+private:
+	// murmur3 finalizer
+	static inline uint32_t Mix(uint32_t h)
+	{
+		h ^= h >> 16;
+		h *= 0x85EBCA6Bu;
+		h ^= h >> 13;
+		h *= 0xC2B2AE35u;
+		h ^= h >> 16;
+		return h;
+	}
+};
@@ -0,0 +1,261 @@
+#include "BiomeRegions.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "Parallel.h"
+
+
+void BiomeRegionIndex::Build(const BiomeCell* cells, int size, int originX, int originY, const BiomeCell* lut, unsigned int threadCount)
+{
+	m_Size = size;
+	m_OriginX = originX;
+	m_OriginY = originY;
+
+	const int cellCount = size * size;
+	m_Labels.resize(cellCount);
+	m_Parent.resize(cellCount);
+
+	auto value = [cells, lut](int cell) { return lut ? lut[cells[cell]] : cells[cell]; };
+
+	// LABELLING
+	// each worker labels a band of rows, with every union staying inside the band
+	// a component's root is always its first cell in scan order, so labels don't depend on the number of threads
+	const int bands = Parallel::WorkerCount(size, threadCount, 8);
+	m_BandStarts.resize(bands);
+	Parallel::ForWorkers(0, size, threadCount, [&](int band, int y0, int y1)
+	{
+		m_BandStarts[band] = y0;
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				int cell = y * size + x;
+				m_Parent[cell] = cell;
+
+				BiomeCell v = value(cell);
+				if (x > 0 && value(cell - 1) == v) Union(cell, cell - 1);
+				if (y > y0 && value(cell - size) == v) Union(cell, cell - size);
+			}
+		}
+	}, 8);
+
+	// stitch the bands together along the rows where they meet
+	for (int band = 1; band < bands; band++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			int cell = m_BandStarts[band] * size + x;
+			if (value(cell) == value(cell - size)) Union(cell, cell - size);
+		}
+	}
+
+	// roots are only read from here on, so every cell can find its root in parallel
+	Parallel::For(0, cellCount, threadCount, [&](int begin, int end)
+	{
+		for (int cell = begin; cell < end; cell++)
+			m_Labels[cell] = Find(cell);
+	}, 4096);
+
+	// number the roots in scan order, reusing the forest to map roots to region IDs
+	int regionCount = 0;
+	for (int cell = 0; cell < cellCount; cell++)
+	{
+		if (m_Labels[cell] == cell)
+			m_Parent[cell] = regionCount++;
+	}
+
+	Parallel::For(0, cellCount, threadCount, [&](int begin, int end)
+	{
+		for (int cell = begin; cell < end; cell++)
+			m_Labels[cell] = m_Parent[m_Labels[cell]];
+	}, 4096);
+
+
+	// REGION STATISTICS
+	// accumulated per band of rows, then combined
+	const int workers = Parallel::WorkerCount(size, threadCount, 8);
+	if (m_WorkerSums.size() < static_cast<size_t>(workers))
+		m_WorkerSums.resize(workers);
+
+	Parallel::ForWorkers(0, size, threadCount, [&](int worker, int y0, int y1)
+	{
+		std::vector<RegionSums>& sums = m_WorkerSums[worker];
+		sums.assign(regionCount, RegionSums{ 0, 0, size, size, -1, -1, 0, 0 });
+
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				RegionSums& s = sums[m_Labels[y * size + x]];
+				s.value = value(y * size + x);
+				s.area++;
+				s.minX = x < s.minX ? x : s.minX;
+				s.minY = y < s.minY ? y : s.minY;
+				s.maxX = x > s.maxX ? x : s.maxX;
+				s.maxY = y > s.maxY ? y : s.maxY;
+				s.sumX += x;
+				s.sumY += y;
+			}
+		}
+	}, 8);
+
+	m_Regions.assign(regionCount, Region());
+	for (int r = 0; r < regionCount; r++)
+	{
+		RegionSums total{ 0, 0, size, size, -1, -1, 0, 0 };
+		for (int w = 0; w < workers; w++)
+		{
+			const RegionSums& s = m_WorkerSums[w][r];
+			if (s.area > 0) total.value = s.value;
+			total.area += s.area;
+			total.minX = s.minX < total.minX ? s.minX : total.minX;
+			total.minY = s.minY < total.minY ? s.minY : total.minY;
+			total.maxX = s.maxX > total.maxX ? s.maxX : total.maxX;
+			total.maxY = s.maxY > total.maxY ? s.maxY : total.maxY;
+			total.sumX += s.sumX;
+			total.sumY += s.sumY;
+		}
+
+		Region& region = m_Regions[r];
+		region.value = total.value;
+		region.area = total.area;
+		region.minX = total.minX + originX;
+		region.minY = total.minY + originY;
+		region.maxX = total.maxX + originX;
+		region.maxY = total.maxY + originY;
+		region.centroidX = static_cast<float>(total.sumX) / total.area + originX;
+		region.centroidY = static_cast<float>(total.sumY) / total.area + originY;
+	}
+
+
+	// SPATIAL INDEX
+	m_ValueCount = 0;
+	for (int cell = 0; cell < cellCount; cell++)
+		m_ValueCount = value(cell) >= m_ValueCount ? value(cell) + 1 : m_ValueCount;
+
+	m_RegionsByValue.resize(256);
+	for (auto& regions : m_RegionsByValue)
+		regions.clear();
+	for (int r = 0; r < regionCount; r++)
+		m_RegionsByValue[m_Regions[r].value].push_back(r);
+	for (auto& regions : m_RegionsByValue)
+	{
+		std::stable_sort(regions.begin(), regions.end(), [this](int a, int b) { return m_Regions[a].area > m_Regions[b].area; });
+	}
+
+	m_BlocksAcross = (size + BlockSize - 1) / BlockSize;
+	const int blockCount = m_BlocksAcross * m_BlocksAcross;
+	m_BlockMasks.assign(static_cast<size_t>(m_ValueCount) * blockCount, 0);
+
+	// each worker fills whole rows of blocks
+	Parallel::For(0, m_BlocksAcross, threadCount, [&](int by0, int by1)
+	{
+		for (int y = by0 * BlockSize; y < by1 * BlockSize && y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				int block = (y / BlockSize) * m_BlocksAcross + x / BlockSize;
+				int bit = (y % BlockSize) * BlockSize + x % BlockSize;
+				m_BlockMasks[static_cast<size_t>(value(y * size + x)) * blockCount + block] |= 1ull << bit;
+			}
+		}
+	}, 1);
+}
+
+int BiomeRegionIndex::RegionAt(int x, int y) const
+{
+	x -= m_OriginX;
+	y -= m_OriginY;
+	if (x < 0 || y < 0 || x >= m_Size || y >= m_Size) return NoRegion;
+	return m_Labels[y * m_Size + x];
+}
+
+const std::vector<int>& BiomeRegionIndex::GetRegionsWithValue(BiomeCell value) const
+{
+	static const std::vector<int> none;
+	return value < m_RegionsByValue.size() ? m_RegionsByValue[value] : none;
+}
+
+int BiomeRegionIndex::FindNearest(int x, int y, BiomeCell value, int minArea, int& nearestX, int& nearestY) const
+{
+	if (value >= m_ValueCount || m_Size == 0) return NoRegion;
+
+	// work in map cells; points outside the map search outwards from the closest cell on the map
+	const int px = x - m_OriginX;
+	const int py = y - m_OriginY;
+	const int cx = px < 0 ? 0 : (px >= m_Size ? m_Size - 1 : px);
+	const int cy = py < 0 ? 0 : (py >= m_Size ? m_Size - 1 : py);
+	const int bx = cx / BlockSize;
+	const int by = cy / BlockSize;
+
+	const int blockCount = m_BlocksAcross * m_BlocksAcross;
+	const uint64_t* masks = m_BlockMasks.data() + static_cast<size_t>(value) * blockCount;
+
+	int64_t bestDistance = INT64_MAX;
+	int best = NoRegion;
+
+	// search rings of blocks outwards from the point's block
+	// every cell in ring r is at least (r - 1) * BlockSize + 1 cells from the clamped point along one axis,
+	// and no closer to the original point than that
+	for (int r = 0; r < m_BlocksAcross; r++)
+	{
+		int64_t ringDistance = r > 0 ? static_cast<int64_t>(r - 1) * BlockSize + 1 : 0;
+		if (ringDistance * ringDistance >= bestDistance)
+			break;
+
+		for (int j = by - r; j <= by + r; j++)
+		{
+			if (j < 0 || j >= m_BlocksAcross) continue;
+
+			// only the ends of the middle rows are on the ring
+			int step = (j == by - r || j == by + r) ? 1 : 2 * r;
+			for (int i = bx - r; i <= bx + r; i += step)
+			{
+				if (i < 0 || i >= m_BlocksAcross) continue;
+
+				uint64_t mask = masks[j * m_BlocksAcross + i];
+				for (int bit = 0; bit < 64 && (mask >> bit); bit++)
+				{
+					if (!((mask >> bit) & 1)) continue;
+
+					int cellX = i * BlockSize + bit % BlockSize;
+					int cellY = j * BlockSize + bit / BlockSize;
+					int region = m_Labels[cellY * m_Size + cellX];
+					if (m_Regions[region].area < minArea) continue;
+
+					int64_t dx = cellX - px;
+					int64_t dy = cellY - py;
+					int64_t distance = dx * dx + dy * dy;
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = region;
+						nearestX = cellX + m_OriginX;
+						nearestY = cellY + m_OriginY;
+					}
+				}
+			}
+		}
+	}
+
+	return best;
+}
+
+int BiomeRegionIndex::Find(int cell) const
+{
+	while (m_Parent[cell] != cell)
+		cell = m_Parent[cell];
+	return cell;
+}
+
+void BiomeRegionIndex::Union(int a, int b)
+{
+	// path halving keeps the trees shallow
+	while (m_Parent[a] != a) { m_Parent[a] = m_Parent[m_Parent[a]]; a = m_Parent[a]; }
+	while (m_Parent[b] != b) { m_Parent[b] = m_Parent[m_Parent[b]]; b = m_Parent[b]; }
+
+	// the smaller index becomes the root, so a component's root is its first cell
+	if (a < b) m_Parent[b] = a;
+	else if (b < a) m_Parent[a] = b;
+}
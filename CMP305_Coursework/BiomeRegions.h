@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BiomeMapBuffer.h"
+
+
+// The connected regions of a biome map, and an index for answering spatial queries about them
+// Cells belong to the same region when they are 4-connected and have the same value after a lookup table is applied,
+// so the same code finds regions of one biome (no table) or whole landmasses and oceans (a biome -> type table)
+// All coordinates are in world cells, so queries work the same for bounded maps and unbounded windows
+class BiomeRegionIndex
+{
+public:
+	static const int NoRegion = -1;
+
+	struct Region
+	{
+		// the value shared by every cell of the region
+		BiomeCell value = 0;
+		int area = 0;
+
+		// inclusive bounding box
+		int minX = 0, minY = 0;
+		int maxX = 0, maxY = 0;
+
+		float centroidX = 0.0f, centroidY = 0.0f;
+	};
+
+	BiomeRegionIndex() = default;
+
+	// labels the size * size map cells, whose first cell is at (originX, originY) in the world
+	// lut maps each cell to the value regions are formed from; nullptr uses the cells themselves
+	void Build(const BiomeCell* cells, int size, int originX, int originY, const BiomeCell* lut, unsigned int threadCount);
+
+	inline int GetRegionCount() const { return static_cast<int>(m_Regions.size()); }
+	inline const Region& GetRegion(int region) const { return m_Regions[region]; }
+	inline const std::vector<Region>& GetRegions() const { return m_Regions; }
+
+	// region containing the cell, or NoRegion if it is outside the map
+	int RegionAt(int x, int y) const;
+
+	// regions with this value, largest first
+	const std::vector<int>& GetRegionsWithValue(BiomeCell value) const;
+
+	// finds the closest cell to (x, y) with this value, in a region of at least minArea cells
+	// returns its region, or NoRegion if there is none; (x, y) may be outside the map
+	int FindNearest(int x, int y, BiomeCell value, int minArea, int& nearestX, int& nearestY) const;
+
+private:
+	int Find(int cell) const;
+	void Union(int a, int b);
+
+private:
+	// cells are indexed into blocks of BlockSize x BlockSize for nearest queries
+	static const int BlockSize = 8;
+
+	int m_Size = 0;
+	int m_OriginX = 0, m_OriginY = 0;
+
+	// region of every cell
+	std::vector<int> m_Labels;
+	// union-find forest over cells while labelling, and the first row of each band of rows labelled in parallel
+	std::vector<int> m_Parent;
+	std::vector<int> m_BandStarts;
+
+	std::vector<Region> m_Regions;
+	std::vector<std::vector<int>> m_RegionsByValue;
+
+	// bit (y % 8) * 8 + (x % 8) of m_BlockMasks[value * blockCount + block] is set when that cell has that value
+	int m_BlocksAcross = 0;
+	int m_ValueCount = 0;
+	std::vector<uint64_t> m_BlockMasks;
+
+	// per-worker partial region statistics
+	struct RegionSums
+	{
+		BiomeCell value;
+		int area;
+		int minX, minY, maxX, maxY;
+		int64_t sumX, sumY;
+	};
+	std::vector<std::vector<RegionSums>> m_WorkerSums;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#define MAX_BIOMES 32
+
+
+enum BIOME_TYPE : int
+{
+	BIOME_TYPE_OCEAN = 0,
+	BIOME_TYPE_LAND = 1
+};
+enum BIOME_TEMP : int
+{
+	BIOME_TEMP_COLD = 0,
+	BIOME_TEMP_TEMPERATE = 1,
+	BIOME_TEMP_WARM = 2,
+
+	BIOME_TEMP_COUNT
+};
+
+
+// The settings in BiomeRules, so that stages can declare which ones they read
+// A stage's output can only change when its input or one of these settings changes
+enum BIOME_RULE : unsigned int
+{
+	BIOME_RULE_SEED					= 1 << 0,
+	BIOME_RULE_CONTINENT_CHANCE		= 1 << 1,
+	BIOME_RULE_ISLAND_EXPAND_CHANCE	= 1 << 2,
+	BIOME_RULE_ISLAND_ERODE_CHANCE	= 1 << 3,
+	BIOME_RULE_SMALL_ISLANDS_CHANCE	= 1 << 4,
+	BIOME_RULE_ZOOM_PERTURBATION	= 1 << 5,
+	BIOME_RULE_TEMPERATURE_CHANCES	= 1 << 6,
+	// spawn weights and the spawnable biome lists
+	BIOME_RULE_BIOME_SPAWNING		= 1 << 7,
+	// biome types and temperatures, and the shore biomes
+	BIOME_RULE_BIOME_PROPERTIES		= 1 << 8
+};
+
+
+// A plain snapshot of everything the biome layer pipeline needs to make its decisions
+// Pipelines work from this rather than from the BiomeGenerator, so they don't require a D3D device
+struct BiomeRules
+{
+	unsigned int seed = 0;
+
+	// biome generation constants (all are integers [0,100] for how likely something is to occur)
+	int continentChance = 15;
+	int islandExpandChance = 30;
+	int islandErodeChance = 15;
+	int smallIslandsChance = 45;
+	int zoomSamplePerturbation = 15;
+
+	int temperateBiomeChance = 66;
+	int warmBiomeChance = 17;
+	int coldBiomeChance = 17;
+
+	// per-biome properties, indexed by biome ID
+	int biomeCount = 0;
+	BIOME_TYPE biomeTypes[MAX_BIOMES];
+	BIOME_TEMP biomeTemps[MAX_BIOMES];
+	int spawnWeights[MAX_BIOMES];
+
+	// biome IDs that can be selected for each temperature
+	std::vector<int> spawnableLandBiomes[BIOME_TEMP_COUNT];
+	std::vector<int> spawnableOceanBiomes[BIOME_TEMP_COUNT];
+
+	int shoreBiome = -1;
+	int coldShoreBiome = -1;
+
+
+	// picks one of the spawnable biomes for this type and temperature, weighted by spawn weight
+	// chance is an integer [1,100]
+	inline int SelectBiome(BIOME_TYPE type, BIOME_TEMP temp, int chance) const
+	{
+		const std::vector<int>& candidates = type == BIOME_TYPE_OCEAN ? spawnableOceanBiomes[temp] : spawnableLandBiomes[temp];
+		if (candidates.empty()) return 0;
+
+		float totalOdds = 0.0f;
+		for (auto index : candidates)
+			totalOdds += spawnWeights[index];
+
+		int p = 0;
+		for (auto index : candidates)
+		{
+			int scaledOdds = static_cast<int>(ceil(100.0f * spawnWeights[index] / totalOdds));
+			p += scaledOdds;
+			if (chance <= p)
+				return index;
+		}
+		return candidates.back();
+	}
+
+	// hash of the settings selected by rules (a combination of BIOME_RULE flags)
+	uint64_t Hash(unsigned int rules) const
+	{
+		uint64_t h = HashCombine(0, rules);
+
+		if (rules & BIOME_RULE_SEED) h = HashCombine(h, seed);
+		if (rules & BIOME_RULE_CONTINENT_CHANCE) h = HashCombine(h, continentChance);
+		if (rules & BIOME_RULE_ISLAND_EXPAND_CHANCE) h = HashCombine(h, islandExpandChance);
+		if (rules & BIOME_RULE_ISLAND_ERODE_CHANCE) h = HashCombine(h, islandErodeChance);
+		if (rules & BIOME_RULE_SMALL_ISLANDS_CHANCE) h = HashCombine(h, smallIslandsChance);
+		if (rules & BIOME_RULE_ZOOM_PERTURBATION) h = HashCombine(h, zoomSamplePerturbation);
+		if (rules & BIOME_RULE_TEMPERATURE_CHANCES)
+		{
+			h = HashCombine(h, temperateBiomeChance);
+			h = HashCombine(h, warmBiomeChance);
+			h = HashCombine(h, coldBiomeChance);
+		}
+		if (rules & BIOME_RULE_BIOME_SPAWNING)
+		{
+			for (int i = 0; i < biomeCount; i++)
+				h = HashCombine(h, spawnWeights[i]);
+			for (int temp = 0; temp < BIOME_TEMP_COUNT; temp++)
+			{
+				// list lengths keep [a][b, c] distinct from [a, b][c]
+				h = HashCombine(h, spawnableLandBiomes[temp].size());
+				for (int biome : spawnableLandBiomes[temp]) h = HashCombine(h, biome);
+				h = HashCombine(h, spawnableOceanBiomes[temp].size());
+				for (int biome : spawnableOceanBiomes[temp]) h = HashCombine(h, biome);
+			}
+		}
+		if (rules & BIOME_RULE_BIOME_PROPERTIES)
+		{
+			h = HashCombine(h, biomeCount);
+			for (int i = 0; i < biomeCount; i++)
+			{
+				h = HashCombine(h, biomeTypes[i]);
+				h = HashCombine(h, biomeTemps[i]);
+			}
+			h = HashCombine(h, shoreBiome);
+			h = HashCombine(h, coldShoreBiome);
+		}
+
+		return h;
+	}
+
+	// order-dependent mixing of a value into a hash
+	static inline uint64_t HashCombine(uint64_t h, uint64_t value)
+	{
+		// splitmix64 finalizer
+		uint64_t z = h ^ (value + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2));
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+};
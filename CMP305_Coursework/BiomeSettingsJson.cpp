@@ -0,0 +1,44 @@
+#include "BiomeSettingsJson.h"
+
+
+void BiomeSettingsJson::Load(const nlohmann::json& data, BiomeRules& rules, World& world, TerrainNoiseSettings* generationSettings,
+	nlohmann::json* noiseGraphs, std::vector<BiomeCatalog::Biome>& biomes)
+{
+	if (data.contains("biomeMapPxPerTile")) world.biomeMapPxPerTile = data["biomeMapPxPerTile"];
+	if (data.contains("biomeBlending")) world.biomeBlending = data["biomeBlending"];
+	if (data.contains("unboundedWorld")) world.unboundedWorld = data["unboundedWorld"];
+
+	if (data.contains("seed")) rules.seed = data["seed"];
+	if (data.contains("continentChance")) rules.continentChance = data["continentChance"];
+	if (data.contains("islandExpandChance")) rules.islandExpandChance = data["islandExpandChance"];
+	if (data.contains("islandErodeChance")) rules.islandErodeChance = data["islandErodeChance"];
+	if (data.contains("removeOceanChance")) rules.smallIslandsChance = data["removeOceanChance"];
+	if (data.contains("zoomingPerturbationChance")) rules.zoomSamplePerturbation = data["zoomingPerturbationChance"];
+
+	if (data.contains("temperateChance")) rules.temperateBiomeChance = data["temperateChance"];
+	if (data.contains("coldChance")) rules.coldBiomeChance = data["coldChance"];
+	if (data.contains("warmChance")) rules.warmBiomeChance = data["warmChance"];
+
+	if (data.contains("generationSettings"))
+	{
+		int index = 0;
+		for (auto& biome : data["generationSettings"])
+		{
+			if (index >= MAX_BIOMES) break;
+
+			generationSettings[index].LoadFromJson(biome);
+			noiseGraphs[index] = biome.contains("noiseGraph") ? biome["noiseGraph"] : nlohmann::json();
+			index++;
+		}
+	}
+
+	if (data.contains("spawnWeights"))
+	{
+		auto& spawnWeights = data["spawnWeights"];
+		for (auto& biome : biomes)
+		{
+			if (spawnWeights.contains(biome.name))
+				biome.spawnWeight = spawnWeights[biome.name];
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "BiomeCatalog.h"
+#include "BiomeRules.h"
+#include "NoiseSettings.h"
+
+
+// Reads the "biomeGenerator" object of a settings file, as saved by BiomeGenerator::Serialize
+// BiomeGenerator and HeightmapBaker both load through this, so they always agree on what a settings file means
+class BiomeSettingsJson
+{
+public:
+	// pure static class
+	BiomeSettingsJson() = delete;
+
+	// how the biome map is laid over the world
+	struct World
+	{
+		float biomeMapPxPerTile = 8.0f;
+		float biomeBlending = 0.5f;
+		bool unboundedWorld = false;
+	};
+
+	// anything missing from data keeps its current value
+	// loads the seed and chances of rules (not the per-biome properties, see BiomeCatalog::FillRules), the generation
+	// settings of each of MAX_BIOMES biomes, their noise graphs (null where a biome has none), and the biomes' spawn weights
+	static void Load(const nlohmann::json& data, BiomeRules& rules, World& world, TerrainNoiseSettings* generationSettings,
+		nlohmann::json* noiseGraphs, std::vector<BiomeCatalog::Biome>& biomes);
+};
@@ -0,0 +1,554 @@
+#include "BiomeStages.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+#include "BiomeRNG.h"
+#include "BiomeKernels.h"
+#include "Parallel.h"
+
+
+// STAGE KERNELS
+// each mirrors the whole-map stage it replaced, but only fills the cells of its output tile
+
+namespace
+{
+	inline bool Chance(const BiomeStageArgs& args, int percent, int x, int y, unsigned int draw = 0)
+	{
+		return BiomeRNG::Chance(percent, args.rules->seed, args.stage, x, y, draw);
+	}
+
+	// a stage's own parameters override the rules when they are set
+	inline int Param(const BiomeStageArgs& args, int index, int fallback)
+	{
+		return args.params[index] >= 0 ? args.params[index] : fallback;
+	}
+
+	// rows either side of row y of the input, or nullptr where they are off the edge of the map
+	// the input tile always contains them when they are on the map
+	template<typename T>
+	inline void NeighbourRows(const T* rows, size_t pitch, int j, int y, int inputSize, const T*& above, const T*& below)
+	{
+		above = y > 0 ? rows + (j - 1) * pitch : nullptr;
+		below = y < inputSize - 1 ? rows + (j + 1) * pitch : nullptr;
+	}
+
+
+	void IslandsKernel(const BiomeStageArgs& args, const BiomeTile& /*in*/, const BiomeTile& out, BiomeArena& /*scratch*/)
+	{
+		const int continentChance = Param(args, 0, args.rules->continentChance);
+
+		for (int y = out.y0; y < out.y0 + out.height; y++)
+		{
+			BiomeCell* row = out.Row(y);
+			for (int x = out.x0; x < out.x0 + out.width; x++)
+				row[x - out.x0] = Chance(args, continentChance, x, y) ? BIOME_TYPE_LAND : BIOME_TYPE_OCEAN;
+		}
+	}
+
+	void AddIslandsKernel(const BiomeStageArgs& args, const BiomeTile& in, const BiomeTile& out, BiomeArena& scratch)
+	{
+		const int expandChance = Param(args, 0, args.rules->islandExpandChance);
+		const int erodeChance = Param(args, 1, args.rules->islandErodeChance);
+
+		// land and ocean are tested 64 cells at a time using bit-packed rows
+		const int words = BiomeKernels::WordsPerRow(in.width);
+		uint64_t* land = scratch.Allocate<uint64_t>(in.height * words);
+		uint64_t* ocean = scratch.Allocate<uint64_t>(in.height * words);
+		uint64_t* nextToLand = scratch.Allocate<uint64_t>(words);
+		uint64_t* nextToTwoOcean = scratch.Allocate<uint64_t>(words);
+
+		for (int j = 0; j < in.height; j++)
+		{
+			BiomeKernels::PackRow(in.Row(in.y0 + j), in.width, BIOME_TYPE_LAND, land + j * words);
+			BiomeKernels::PackRow(in.Row(in.y0 + j), in.width, BIOME_TYPE_OCEAN, ocean + j * words);
+		}
+
+		for (int y = out.y0; y < out.y0 + out.height; y++)
+		{
+			int j = y - in.y0;
+			const uint64_t *above, *below;
+
+			NeighbourRows<uint64_t>(land, words, j, y, args.inputSize, above, below);
+			BiomeKernels::NeighbourBitsRow(above, land + j * words, below, words, nextToLand, nullptr, nullptr);
+			NeighbourRows<uint64_t>(ocean, words, j, y, args.inputSize, above, below);
+			BiomeKernels::NeighbourBitsRow(above, ocean + j * words, below, words, nullptr, nextToTwoOcean, nullptr);
+
+			const BiomeCell* inRow = in.Row(y);
+			BiomeCell* outRow = out.Row(y);
+			for (int x = out.x0; x < out.x0 + out.width; x++)
+			{
+				int sample = inRow[x - in.x0];
+
+				if (sample == BIOME_TYPE_OCEAN)
+				{
+					// if ocean is next to at least 1 land tile, then theres a chance it will also become land
+					if (BiomeKernels::TestBit(nextToLand, x - in.x0) && Chance(args, expandChance, x, y))
+						sample = BIOME_TYPE_LAND;
+				}
+				else if (sample == BIOME_TYPE_LAND)
+				{
+					// if land is next to more than 1 ocean tile, then theres a chance it will become ocean
+					if (BiomeKernels::TestBit(nextToTwoOcean, x - in.x0) && Chance(args, erodeChance, x, y))
+						sample = BIOME_TYPE_OCEAN;
+				}
+
+				outRow[x - out.x0] = static_cast<BiomeCell>(sample);
+			}
+		}
+	}
+
+	void RemoveTooMuchOceanKernel(const BiomeStageArgs& args, const BiomeTile& in, const BiomeTile& out, BiomeArena& scratch)
+	{
+		const int smallIslandsChance = Param(args, 0, args.rules->smallIslandsChance);
+
+		const int words = BiomeKernels::WordsPerRow(in.width);
+		uint64_t* ocean = scratch.Allocate<uint64_t>(in.height * words);
+		uint64_t* surrounded = scratch.Allocate<uint64_t>(words);
+
+		for (int j = 0; j < in.height; j++)
+			BiomeKernels::PackRow(in.Row(in.y0 + j), in.width, BIOME_TYPE_OCEAN, ocean + j * words);
+
+		for (int y = out.y0; y < out.y0 + out.height; y++)
+		{
+			int j = y - in.y0;
+			const uint64_t *above, *below;
+			NeighbourRows<uint64_t>(ocean, words, j, y, args.inputSize, above, below);
+			BiomeKernels::NeighbourBitsRow(above, ocean + j * words, below, words, nullptr, nullptr, surrounded);
+
+			const BiomeCell* inRow = in.Row(y);
+			BiomeCell* outRow = out.Row(y);
+			for (int x = out.x0; x < out.x0 + out.width; x++)
+			{
+				int sample = inRow[x - in.x0];
+
+				// completely surrounded by ocean
+				if (BiomeKernels::TestBit(surrounded, x - in.x0) && Chance(args, smallIslandsChance, x, y))
+					sample = BIOME_TYPE_LAND;
+
+				outRow[x - out.x0] = static_cast<BiomeCell>(sample);
+			}
+		}
+	}
+
+	void CreateTemperaturesKernel(const BiomeStageArgs& args, const BiomeTile& /*in*/, const BiomeTile& out, BiomeArena& /*scratch*/)
+	{
+		const BiomeRules& rules = *args.rules;
+		int t = rules.temperateBiomeChance + rules.warmBiomeChance + rules.coldBiomeChance;
+
+		for (int y = out.y0; y < out.y0 + out.height; y++)
+		{
+			BiomeCell* row = out.Row(y);
+			for (int x = out.x0; x < out.x0 + out.width; x++)
+			{
+				int temperature = BIOME_TEMP_TEMPERATE;
+
+				int r = BiomeRNG::Range(BiomeRNG::Hash(rules.seed, args.stage, x, y), t);
+				if (r <= rules.temperateBiomeChance)
+					temperature = BIOME_TEMP_TEMPERATE;
+				else if (r <= rules.temperateBiomeChance + rules.coldBiomeChance)
+					temperature = BIOME_TEMP_COLD;
+				else
+					temperature = BIOME_TEMP_WARM;
+
+				row[x - out.x0] = static_cast<BiomeCell>(temperature);
+			}
+		}
+	}
+
+	void TransitionTemperaturesKernel(const BiomeStageArgs& args, const BiomeTile& in, const BiomeTile& out, BiomeArena& scratch)
+	{
+		uint8_t* warm = scratch.Allocate<uint8_t>(in.width);
+		uint8_t* cold = scratch.Allocate<uint8_t>(in.width);
+
+		for (int y = out.y0; y < out.y0 + out.height; y++)
+		{
+			const BiomeCell *above, *below;
+			NeighbourRows<BiomeCell>(in.cells, in.pitch, y - in.y0, y, args.inputSize, above, below);
+
+			const BiomeCell* inRow = in.Row(y);
+			BiomeKernels::CountEqualRow(above, inRow, below, in.width, BIOME_TEMP_WARM, warm);
+			BiomeKernels::CountEqualRow(above, inRow, below, in.width, BIOME_TEMP_COLD, cold);
+
+			BiomeCell* outRow = out.Row(y);
+			for (int x = out.x0; x < out.x0 + out.width; x++)
+			{
+				int temp = inRow[x - in.x0];
+
+				// extreme temperatures cannot border each other
+				if (temp == BIOME_TEMP_COLD && warm[x - in.x0] > 3)
+					temp = BIOME_TEMP_TEMPERATE;
+				else if (temp == BIOME_TEMP_WARM && cold[x - in.x0] > 3)
+					temp = BIOME_TEMP_TEMPERATE;
+
+				outRow[x - out.x0] = static_cast<BiomeCell>(temp);
+			}
+		}
+	}
+
+	void SelectBiomesKernel(const BiomeStageArgs& args, const BiomeTile& in, const BiomeTile& out, BiomeArena& /*scratch*/)
+	{
+		for (int y = out.y0; y < out.y0 + out.height; y++)
+		{
+			const BiomeCell* inRow = in.Row(y);
+			const BiomeCell* tempRow = args.secondary + y * args.inputSize;
+			BiomeCell* outRow = out.Row(y);
+
+			for (int x = out.x0; x < out.x0 + out.width; x++)
+			{
+				BIOME_TYPE biomeType = static_cast<BIOME_TYPE>(inRow[x - in.x0]);
+				BIOME_TEMP biomeTemp = static_cast<BIOME_TEMP>(tempRow[x]);
+
+				int chance = BiomeRNG::Range(BiomeRNG::Hash(args.rules->seed, args.stage, x, y), 100);
+				outRow[x - out.x0] = static_cast<BiomeCell>(args.rules->SelectBiome(biomeType, biomeTemp, chance));
+			}
+		}
+	}
+
+	void AddShoresKernel(const BiomeStageArgs& args, const BiomeTile& in, const BiomeTile& out, BiomeArena& scratch)
+	{
+		const BiomeRules& rules = *args.rules;
+
+		// shores depend on the type of neighbouring biomes rather than their ID
+		BiomeCell typeLUT[256];
+		for (int i = 0; i < 256; i++)
+			typeLUT[i] = i < rules.biomeCount ? static_cast<BiomeCell>(rules.biomeTypes[i]) : 0xFF;
+
+		BiomeCell* types = scratch.Allocate<BiomeCell>(in.width * in.height);
+		uint8_t* oceans = scratch.Allocate<uint8_t>(in.width);
+
+		for (int j = 0; j < in.height; j++)
+			BiomeKernels::LookupRow(in.Row(in.y0 + j), in.width, typeLUT, types + j * in.width);
+
+		for (int y = out.y0; y < out.y0 + out.height; y++)
+		{
+			int j = y - in.y0;
+			const BiomeCell *above, *below;
+			NeighbourRows<BiomeCell>(types, in.width, j, y, args.inputSize, above, below);
+			BiomeKernels::CountEqualRow(above, types + j * in.width, below, in.width, BIOME_TYPE_OCEAN, oceans);
+
+			const BiomeCell* inRow = in.Row(y);
+			BiomeCell* outRow = out.Row(y);
+			for (int x = out.x0; x < out.x0 + out.width; x++)
+			{
+				int biome = inRow[x - in.x0];
+
+				if (rules.biomeTypes[biome] == BIOME_TYPE_LAND && oceans[x - in.x0] > 0)
+				{
+					if (rules.biomeTemps[biome] == BIOME_TEMP_COLD)
+						biome = rules.coldShoreBiome;
+					else
+						biome = rules.shoreBiome;
+				}
+
+				outRow[x - out.x0] = static_cast<BiomeCell>(biome);
+			}
+		}
+	}
+
+	void Zoom2xKernel(const BiomeStageArgs& args, const BiomeTile& in, const BiomeTile& out, BiomeArena& /*scratch*/)
+	{
+		const int maxSample = args.inputSize - 1;
+		const int perturbation = Param(args, 0, args.rules->zoomSamplePerturbation);
+
+		for (int y = out.y0; y < out.y0 + out.height; y++)
+		{
+			BiomeCell* outRow = out.Row(y);
+			for (int x = out.x0; x < out.x0 + out.width; x++)
+			{
+				int sampleX = x / 2;
+				int sampleY = y / 2;
+
+				if (Chance(args, perturbation, x, y, 0))
+				{
+					if (Chance(args, 50, x, y, 1))
+						sampleX += Chance(args, 50, x, y, 2) ? 1 : -1;
+					else
+						sampleY += Chance(args, 50, x, y, 2) ? 1 : -1;
+				}
+				sampleX = sampleX < 0 ? 0 : (sampleX > maxSample ? maxSample : sampleX);
+				sampleY = sampleY < 0 ? 0 : (sampleY > maxSample ? maxSample : sampleY);
+
+				outRow[x - out.x0] = in.At(sampleX, sampleY);
+			}
+		}
+	}
+
+
+	// one entry per BIOME_STAGE_TYPE, in the same order
+	const BiomeStageInfo StageInfos[BIOME_STAGE_COUNT] = {
+		// name, kernel, scale, halo, generator, random, secondary map, parameters, settings read, settings overridden by parameters
+		{ "Islands", IslandsKernel, 1, 0, true, true, nullptr, { "chance", nullptr },
+			BIOME_RULE_SEED | BIOME_RULE_CONTINENT_CHANCE, { BIOME_RULE_CONTINENT_CHANCE, 0 } },
+		{ "AddIslands", AddIslandsKernel, 1, 1, false, true, nullptr, { "expandChance", "erodeChance" },
+			BIOME_RULE_SEED | BIOME_RULE_ISLAND_EXPAND_CHANCE | BIOME_RULE_ISLAND_ERODE_CHANCE, { BIOME_RULE_ISLAND_EXPAND_CHANCE, BIOME_RULE_ISLAND_ERODE_CHANCE } },
+		{ "RemoveTooMuchOcean", RemoveTooMuchOceanKernel, 1, 1, false, true, nullptr, { "chance", nullptr },
+			BIOME_RULE_SEED | BIOME_RULE_SMALL_ISLANDS_CHANCE, { BIOME_RULE_SMALL_ISLANDS_CHANCE, 0 } },
+		{ "CreateTemperatures", CreateTemperaturesKernel, 1, 0, true, true, nullptr, { nullptr, nullptr },
+			BIOME_RULE_SEED | BIOME_RULE_TEMPERATURE_CHANCES, { 0, 0 } },
+		{ "TransitionTemperatures", TransitionTemperaturesKernel, 1, 1, false, false, nullptr, { nullptr, nullptr },
+			0, { 0, 0 } },
+		{ "SelectBiomes", SelectBiomesKernel, 1, 0, false, true, "temperatures", { nullptr, nullptr },
+			BIOME_RULE_SEED | BIOME_RULE_BIOME_SPAWNING, { 0, 0 } },
+		{ "AddShores", AddShoresKernel, 1, 1, false, false, nullptr, { nullptr, nullptr },
+			BIOME_RULE_BIOME_PROPERTIES, { 0, 0 } },
+		{ "Zoom2x", Zoom2xKernel, 2, 1, false, true, nullptr, { "perturbation", nullptr },
+			BIOME_RULE_SEED | BIOME_RULE_ZOOM_PERTURBATION, { BIOME_RULE_ZOOM_PERTURBATION, 0 } }
+	};
+}
+
+
+void BiomeStage::RequiredInput(int outX0, int outX1, int inputSize, int& x0, int& x1) const
+{
+	if (generator)
+	{
+		x0 = x1 = 0;
+		return;
+	}
+
+	// output coordinates are never negative, so integer division rounds down
+	x0 = outX0 / scale - halo;
+	x1 = (outX1 - 1) / scale + 1 + halo;
+
+	x0 = x0 < 0 ? 0 : x0;
+	x1 = x1 > inputSize ? inputSize : x1;
+}
+
+unsigned int BiomeStage::GetRuleDependencies() const
+{
+	const BiomeStageInfo& info = GetInfo(type);
+
+	unsigned int rules = info.rules;
+	for (int i = 0; i < BIOME_STAGE_MAX_PARAMS; i++)
+	{
+		if (params[i] >= 0)
+			rules &= ~info.paramRules[i];
+	}
+	return rules;
+}
+
+uint64_t BiomeStage::Key(const BiomeRules& rules) const
+{
+	uint64_t h = BiomeRules::HashCombine(type, stage);
+	for (int i = 0; i < BIOME_STAGE_MAX_PARAMS; i++)
+		h = BiomeRules::HashCombine(h, static_cast<uint64_t>(params[i]));
+	return BiomeRules::HashCombine(h, rules.Hash(GetRuleDependencies()));
+}
+
+const BiomeStageInfo& BiomeStage::GetInfo(BIOME_STAGE_TYPE type)
+{
+	assert(type >= 0 && type < BIOME_STAGE_COUNT && "Invalid biome stage type");
+	return StageInfos[type];
+}
+
+bool BiomeStage::TypeFromName(const char* name, BIOME_STAGE_TYPE& type)
+{
+	for (int i = 0; i < BIOME_STAGE_COUNT; i++)
+	{
+		if (strcmp(StageInfos[i].name, name) == 0)
+		{
+			type = static_cast<BIOME_STAGE_TYPE>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+BiomeStage BiomeStage::Create(BIOME_STAGE_TYPE type, unsigned int stage, const BiomeCell* secondary)
+{
+	const BiomeStageInfo& info = GetInfo(type);
+
+	BiomeStage s;
+	s.type = type;
+	s.name = info.name;
+	s.func = info.func;
+	s.scale = info.scale;
+	s.halo = info.halo;
+	s.generator = info.generator;
+	s.stage = info.random ? stage : 0;
+	s.secondary = secondary;
+	return s;
+}
+
+BiomeStage BiomeStage::Islands(unsigned int stage)				{ return Create(BIOME_STAGE_ISLANDS, stage); }
+BiomeStage BiomeStage::AddIslands(unsigned int stage)			{ return Create(BIOME_STAGE_ADD_ISLANDS, stage); }
+BiomeStage BiomeStage::RemoveTooMuchOcean(unsigned int stage)	{ return Create(BIOME_STAGE_REMOVE_TOO_MUCH_OCEAN, stage); }
+BiomeStage BiomeStage::CreateTemperatures(unsigned int stage)	{ return Create(BIOME_STAGE_CREATE_TEMPERATURES, stage); }
+BiomeStage BiomeStage::TransitionTemperatures()					{ return Create(BIOME_STAGE_TRANSITION_TEMPERATURES, 0); }
+BiomeStage BiomeStage::SelectBiomes(unsigned int stage, const BiomeCell* temps) { return Create(BIOME_STAGE_SELECT_BIOMES, stage, temps); }
+BiomeStage BiomeStage::AddShores()								{ return Create(BIOME_STAGE_ADD_SHORES, 0); }
+BiomeStage BiomeStage::Zoom2x(unsigned int stage)				{ return Create(BIOME_STAGE_ZOOM_2X, stage); }
+
+
+
+void BiomeStageExecutor::Run(const BiomeRules& rules, std::initializer_list<BiomeStage> chain, BiomeMapBuffer& map, unsigned int threadCount)
+{
+	Run(rules, chain.begin(), static_cast<int>(chain.size()), map, threadCount);
+}
+
+void BiomeStageExecutor::Run(const BiomeRules& rules, const BiomeStage* chain, int stageCount, BiomeMapBuffer& map, unsigned int threadCount, double* stageSeconds)
+{
+	assert(stageCount > 0 && stageCount <= MaxChainLength && "Invalid biome stage chain length");
+	for (int i = 1; i < stageCount; i++)
+		assert(!chain[i].generator && "Generator stages can only begin a chain");
+
+	// map size at the input of each stage, and the largest region of it a tile can depend on
+	int sizes[MaxChainLength + 1];
+	int extents[MaxChainLength + 1];
+
+	sizes[0] = static_cast<int>(map.GetSize());
+	for (int i = 0; i < stageCount; i++)
+		sizes[i + 1] = sizes[i] * chain[i].scale;
+	const int outputSize = sizes[stageCount];
+	assert(static_cast<size_t>(outputSize) <= map.GetMaxSize() && "Biome map buffer is too small for this chain");
+
+	// keep splitting tiles until every thread has some to work on
+	const int threads = static_cast<int>(Parallel::ResolveThreadCount(threadCount));
+	int tileSize = m_TileSize < outputSize ? m_TileSize : outputSize;
+	auto tilesAcross = [&](int size) { return (outputSize + size - 1) / size; };
+	while (tileSize > 16 && tilesAcross(tileSize) * tilesAcross(tileSize) < threads)
+		tileSize /= 2;
+	const int tilesX = tilesAcross(tileSize);
+	const int tileCount = tilesX * tilesX;
+
+	// extent of the regions that a tile depends on, working back from the output
+	// zooming halves a region but may straddle one extra parent cell
+	extents[stageCount] = tileSize;
+	for (int i = stageCount - 1; i >= 0; i--)
+	{
+		const BiomeStage& s = chain[i];
+		int extent = (extents[i + 1] + s.scale - 1) / s.scale + (s.scale > 1 ? 1 : 0) + 2 * s.halo;
+		extents[i] = extent < sizes[i] ? extent : sizes[i];
+	}
+
+	size_t maxIntermediateArea = 0;
+	int maxInputExtent = 0;
+	for (int i = 0; i < stageCount; i++)
+	{
+		size_t area = static_cast<size_t>(extents[i + 1]) * extents[i + 1];
+		if (i < stageCount - 1 && area > maxIntermediateArea) maxIntermediateArea = area;
+		if (extents[i] > maxInputExtent) maxInputExtent = extents[i];
+	}
+
+	// prepare a scratch arena for every worker before going wide
+	const int workerCount = Parallel::WorkerCount(tileCount, threadCount, 1);
+	while (m_WorkerArenas.size() < static_cast<size_t>(workerCount))
+		m_WorkerArenas.emplace_back(new BiomeArena());
+
+	const size_t workerBytes = 2 * BiomeArena::RequiredBytes<BiomeCell>(maxIntermediateArea) + StageScratchBytes(maxInputExtent, maxInputExtent);
+	for (int w = 0; w < workerCount; w++)
+		m_WorkerArenas[w]->Reset(workerBytes);
+
+	const BiomeCell* input = map.Read();
+	BiomeCell* output = map.Write();
+
+	std::mutex timingMutex;
+
+	Parallel::ForWorkers(0, tileCount, threadCount, [&](int worker, int tileBegin, int tileEnd)
+	{
+		BiomeArena& arena = *m_WorkerArenas[worker];
+		arena.Rewind(0);
+
+		// intermediate results ping-pong between two buffers
+		BiomeCell* buffers[2] = {
+			arena.Allocate<BiomeCell>(maxIntermediateArea),
+			arena.Allocate<BiomeCell>(maxIntermediateArea)
+		};
+		const size_t scratchMark = arena.GetUsed();
+
+		// time spent in each stage by this worker
+		double seconds[MaxChainLength] = {};
+
+		for (int t = tileBegin; t < tileEnd; t++)
+		{
+			// regions of each stage's input (and the final output) that this tile depends on
+			int x0[MaxChainLength + 1], x1[MaxChainLength + 1];
+			int y0[MaxChainLength + 1], y1[MaxChainLength + 1];
+
+			x0[stageCount] = (t % tilesX) * tileSize;
+			y0[stageCount] = (t / tilesX) * tileSize;
+			x1[stageCount] = x0[stageCount] + tileSize < outputSize ? x0[stageCount] + tileSize : outputSize;
+			y1[stageCount] = y0[stageCount] + tileSize < outputSize ? y0[stageCount] + tileSize : outputSize;
+
+			for (int i = stageCount - 1; i >= 0; i--)
+			{
+				chain[i].RequiredInput(x0[i + 1], x1[i + 1], sizes[i], x0[i], x1[i]);
+				chain[i].RequiredInput(y0[i + 1], y1[i + 1], sizes[i], y0[i], y1[i]);
+			}
+
+			// the first stage reads straight from the input map
+			BiomeTile in;
+			in.cells = const_cast<BiomeCell*>(input) + y0[0] * sizes[0] + x0[0];
+			in.x0 = x0[0];
+			in.y0 = y0[0];
+			in.width = x1[0] - x0[0];
+			in.height = y1[0] - y0[0];
+			in.pitch = sizes[0];
+
+			for (int i = 0; i < stageCount; i++)
+			{
+				BiomeTile out;
+				out.x0 = x0[i + 1];
+				out.y0 = y0[i + 1];
+				out.width = x1[i + 1] - x0[i + 1];
+				out.height = y1[i + 1] - y0[i + 1];
+
+				if (i == stageCount - 1)
+				{
+					// the last stage writes straight into the output map
+					out.pitch = outputSize;
+					out.cells = output + out.y0 * out.pitch + out.x0;
+				}
+				else
+				{
+					out.pitch = out.width;
+					out.cells = buffers[i % 2];
+				}
+
+				BiomeStageArgs args{ &rules, chain[i].stage, sizes[i], sizes[i + 1], chain[i].secondary, chain[i].params };
+				if (stageSeconds)
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					chain[i].func(args, in, out, arena);
+					seconds[i] += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+				}
+				else
+				{
+					chain[i].func(args, in, out, arena);
+				}
+				arena.Rewind(scratchMark);
+
+				in = out;
+			}
+		}
+
+		if (stageSeconds)
+		{
+			std::lock_guard<std::mutex> lock(timingMutex);
+			for (int i = 0; i < stageCount; i++)
+				stageSeconds[i] += seconds[i];
+		}
+	}, 1);
+
+	map.SetSize(outputSize);
+	map.Swap();
+}
+
+size_t BiomeStageExecutor::GetWorkerMemory() const
+{
+	size_t bytes = 0;
+	for (auto& arena : m_WorkerArenas)
+		bytes += arena->GetCapacity();
+	return bytes;
+}
+
+size_t BiomeStageExecutor::StageScratchBytes(int width, int height)
+{
+	// bit-packed stages use 2 bit planes and 2 rows of results, byte stages use a byte map and 2 rows of counts
+	size_t words = static_cast<size_t>(BiomeKernels::WordsPerRow(width));
+	size_t bitScratch = 2 * BiomeArena::RequiredBytes<uint64_t>(height * words) + 2 * BiomeArena::RequiredBytes<uint64_t>(words);
+	size_t byteScratch = BiomeArena::RequiredBytes<BiomeCell>(static_cast<size_t>(width) * height) + 2 * BiomeArena::RequiredBytes<uint8_t>(width);
+	return bitScratch > byteScratch ? bitScratch : byteScratch;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "BiomeRules.h"
+#include "BiomeMapBuffer.h"
+
+
+// A rectangular window onto a biome map
+// Cell (x, y) of the map is stored at cells[(y - y0) * pitch + (x - x0)]
+struct BiomeTile
+{
+	BiomeCell* cells = nullptr;
+	int x0 = 0, y0 = 0;
+	int width = 0, height = 0;
+	size_t pitch = 0;
+
+	// first cell of the tile in row y of the map
+	inline BiomeCell* Row(int y) const { return cells + (y - y0) * pitch; }
+	inline BiomeCell& At(int x, int y) const { return cells[(y - y0) * pitch + (x - x0)]; }
+};
+
+
+struct BiomeStageArgs
+{
+	const BiomeRules* rules;
+	unsigned int stage;
+
+	// sizes of the whole input and output maps, which define where the map edges are
+	int inputSize;
+	int outputSize;
+
+	// a whole map at the input resolution, for stages that read a second map
+	const BiomeCell* secondary;
+
+	// the stage's parameters (see BiomeStageInfo); negative values use the rules instead
+	const int* params;
+};
+
+// Generates the cells of out from the cells of in
+// in covers every cell of the input map that out depends on (see BiomeStage::RequiredInput)
+// scratch is private to the calling thread
+typedef void(*BiomeStageFunc)(const BiomeStageArgs& args, const BiomeTile& in, const BiomeTile& out, BiomeArena& scratch);
+
+
+enum BIOME_STAGE_TYPE : int
+{
+	BIOME_STAGE_ISLANDS = 0,
+	BIOME_STAGE_ADD_ISLANDS,
+	BIOME_STAGE_REMOVE_TOO_MUCH_OCEAN,
+	BIOME_STAGE_CREATE_TEMPERATURES,
+	BIOME_STAGE_TRANSITION_TEMPERATURES,
+	BIOME_STAGE_SELECT_BIOMES,
+	BIOME_STAGE_ADD_SHORES,
+	BIOME_STAGE_ZOOM_2X,
+
+	BIOME_STAGE_COUNT
+};
+
+#define BIOME_STAGE_MAX_PARAMS 2
+
+// Static description of each type of stage, used to build stages from data
+struct BiomeStageInfo
+{
+	const char* name;
+	BiomeStageFunc func;
+	int scale;
+	int halo;
+	bool generator;
+	// whether the stage makes random decisions, and so needs its own stage index
+	bool random;
+	// name of the second map the stage reads, or nullptr
+	const char* secondary;
+	// names of the parameters that can override the rules, or nullptr for unused slots
+	const char* params[BIOME_STAGE_MAX_PARAMS];
+
+	// BIOME_RULE flags for the settings the stage reads, and the setting each parameter overrides
+	unsigned int rules;
+	unsigned int paramRules[BIOME_STAGE_MAX_PARAMS];
+};
+
+
+// One step of the biome pipeline
+// Stages are described by how far their output depends on their input, so that chains of them can be run in tiles
+struct BiomeStage
+{
+	BIOME_STAGE_TYPE type = BIOME_STAGE_ISLANDS;
+	const char* name = nullptr;
+	BiomeStageFunc func = nullptr;
+
+	// output map size = input map size * scale
+	int scale = 1;
+	// how many input cells either side of an output cell (after scaling) the stage reads
+	int halo = 0;
+	// generator stages ignore their input, and can only begin a chain
+	bool generator = false;
+
+	// keys the stage's random decisions
+	unsigned int stage = 0;
+	const BiomeCell* secondary = nullptr;
+	int params[BIOME_STAGE_MAX_PARAMS] = { -1, -1 };
+
+	// the region of the input map [x0, x1) that output cells [outX0, outX1) depend on, clipped to the map
+	void RequiredInput(int outX0, int outX1, int inputSize, int& x0, int& x1) const;
+
+	// BIOME_RULE flags for the settings this stage reads, excluding those its parameters override
+	unsigned int GetRuleDependencies() const;
+	// hash of everything apart from its input maps that affects the stage's output
+	uint64_t Key(const BiomeRules& rules) const;
+
+
+	static const BiomeStageInfo& GetInfo(BIOME_STAGE_TYPE type);
+	static bool TypeFromName(const char* name, BIOME_STAGE_TYPE& type);
+
+	static BiomeStage Create(BIOME_STAGE_TYPE type, unsigned int stage, const BiomeCell* secondary = nullptr);
+
+	// land/ocean balance
+	static BiomeStage Islands(unsigned int stage);
+	static BiomeStage AddIslands(unsigned int stage);
+	static BiomeStage RemoveTooMuchOcean(unsigned int stage);
+
+	// biome temperatures
+	static BiomeStage CreateTemperatures(unsigned int stage);
+	static BiomeStage TransitionTemperatures();
+
+	// temps is the temperature map, at the same resolution as this stage's input
+	static BiomeStage SelectBiomes(unsigned int stage, const BiomeCell* temps);
+	static BiomeStage AddShores();
+
+	static BiomeStage Zoom2x(unsigned int stage);
+};
+
+
+// Runs chains of biome stages, fused together
+// The output map is split into tiles, and for each tile every stage of the chain is run over just the region that tile depends on
+// Intermediate maps are never materialised in full, and a tile's working set stays in cache
+// As every stage is a pure function of its input region, the result is identical to running the stages one at a time over the whole map
+class BiomeStageExecutor
+{
+public:
+	static const int MaxChainLength = 32;
+
+	BiomeStageExecutor() = default;
+	~BiomeStageExecutor() = default;
+
+	BiomeStageExecutor(const BiomeStageExecutor&) = delete;
+	BiomeStageExecutor& operator=(const BiomeStageExecutor&) = delete;
+
+	// runs the chain over the front buffer of map, leaving the result in the front buffer
+	void Run(const BiomeRules& rules, std::initializer_list<BiomeStage> chain, BiomeMapBuffer& map, unsigned int threadCount);
+	// if stageSeconds is given, the time spent in each stage (summed over all threads) is added to it
+	void Run(const BiomeRules& rules, const BiomeStage* chain, int stageCount, BiomeMapBuffer& map, unsigned int threadCount, double* stageSeconds = nullptr);
+
+	// size of output tiles; smaller tiles are used when there would not be enough to occupy every thread
+	inline void SetTileSize(int tileSize) { m_TileSize = tileSize > 1 ? tileSize : 1; }
+	inline int GetTileSize() const { return m_TileSize; }
+
+	// total size of the worker threads' scratch arenas
+	size_t GetWorkerMemory() const;
+
+	// scratch memory a stage may need for an input region of this size
+	static size_t StageScratchBytes(int width, int height);
+
+private:
+	int m_TileSize = 64;
+
+	// one scratch arena per worker thread, which keep their memory between runs
+	std::vector<std::unique_ptr<BiomeArena>> m_WorkerArenas;
+};
@@ -0,0 +1,159 @@
+#include "BiomeSurvey.h"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#include "BiomeMapBuffer.h"
+#include "BiomeStages.h"
+#include "BiomeRegions.h"
+#include "Parallel.h"
+
+
+BiomeSurvey::BiomeSurvey(const BiomeRules& rules, const BiomePipeline& pipeline)
+	: m_Rules(rules), m_Pipeline(pipeline)
+{
+}
+
+void BiomeSurvey::Run(unsigned int firstSeed, int count, unsigned int threadCount, const std::function<void(const SeedStats&)>& onSeed)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// seeds are handed out one at a time, as some take longer than others
+	std::atomic<int> nextSeed{ 0 };
+
+	// results that finished ahead of an earlier seed wait here until they can be passed on in order
+	std::mutex resultsMutex;
+	std::map<int, SeedStats> pending;
+	int nextResult = 0;
+
+	BiomeCell typeLUT[256] = {};
+	for (int i = 0; i < m_Rules.biomeCount; i++)
+		typeLUT[i] = static_cast<BiomeCell>(m_Rules.biomeTypes[i]);
+
+	const int workers = Parallel::WorkerCount(count, threadCount, 1);
+	Parallel::ForWorkers(0, workers, workers, [&](int, int, int)
+	{
+		// each worker keeps its own plan, so chain outputs and working memory are reused from seed to seed
+		BiomePlan plan;
+		plan.Compile(m_Pipeline);
+		BiomeArena arena;
+		BiomeStageExecutor executor;
+		BiomeRegionIndex landmasses;
+		BiomeRules rules = m_Rules;
+
+		for (int i = nextSeed++; i < count; i = nextSeed++)
+		{
+			auto seedStart = std::chrono::high_resolution_clock::now();
+
+			rules.seed = firstSeed + static_cast<unsigned int>(i);
+			size_t size = 0;
+			const BiomeCell* map = plan.Execute(rules, arena, executor, 1, size);
+			const int mapSize = static_cast<int>(size);
+
+			SeedStats stats;
+			stats.seed = rules.seed;
+			stats.mapSize = mapSize;
+			stats.biomeCells.assign(rules.biomeCount, 0);
+
+			int landCells = 0;
+			for (int cell = 0; cell < mapSize * mapSize; cell++)
+			{
+				if (map[cell] < rules.biomeCount) stats.biomeCells[map[cell]]++;
+				landCells += typeLUT[map[cell]] == BIOME_TYPE_LAND ? 1 : 0;
+			}
+			stats.landFraction = mapSize > 0 ? static_cast<float>(landCells) / (mapSize * mapSize) : 0.0f;
+
+			landmasses.Build(map, mapSize, 0, 0, typeLUT, 1);
+			const auto& land = landmasses.GetRegionsWithValue(BIOME_TYPE_LAND);
+			stats.landmassCount = static_cast<int>(land.size());
+			stats.oceanCount = static_cast<int>(landmasses.GetRegionsWithValue(BIOME_TYPE_OCEAN).size());
+			stats.largestLandmass = land.empty() ? 0 : landmasses.GetRegion(land.front()).area;
+
+			stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - seedStart).count();
+
+			std::lock_guard<std::mutex> lock(resultsMutex);
+			pending.emplace(i, std::move(stats));
+			for (auto it = pending.begin(); it != pending.end() && it->first == nextResult; it = pending.erase(it))
+			{
+				onSeed(it->second);
+				nextResult++;
+			}
+		}
+	}, 1);
+
+	m_LastCount = count;
+	m_LastSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+
+BiomeSurveyWriter::BiomeSurveyWriter(std::ostream& out, FORMAT format, const std::vector<std::string>& biomeNames)
+	: m_Out(out), m_Format(format), m_BiomeNames(biomeNames)
+{
+	if (m_Format == FORMAT_CSV)
+	{
+		m_Out << "seed,mapSize,landFraction,landmasses,oceans,largestLandmass,milliseconds";
+		for (auto& name : m_BiomeNames)
+			m_Out << "," << name;
+		m_Out << "\n";
+	}
+	else
+	{
+		m_Out << "[";
+	}
+}
+
+BiomeSurveyWriter::~BiomeSurveyWriter()
+{
+	Finish();
+}
+
+void BiomeSurveyWriter::Write(const BiomeSurvey::SeedStats& stats)
+{
+	if (m_Format == FORMAT_CSV)
+	{
+		m_Out << stats.seed << "," << stats.mapSize << "," << stats.landFraction << ","
+			<< stats.landmassCount << "," << stats.oceanCount << "," << stats.largestLandmass << "," << stats.milliseconds;
+		for (size_t i = 0; i < m_BiomeNames.size(); i++)
+			m_Out << "," << (i < stats.biomeCells.size() ? stats.biomeCells[i] : 0);
+		m_Out << "\n";
+	}
+	else
+	{
+		nlohmann::json serialized;
+		serialized["seed"] = stats.seed;
+		serialized["mapSize"] = stats.mapSize;
+		serialized["landFraction"] = stats.landFraction;
+		serialized["landmasses"] = stats.landmassCount;
+		serialized["oceans"] = stats.oceanCount;
+		serialized["largestLandmass"] = stats.largestLandmass;
+		serialized["milliseconds"] = stats.milliseconds;
+
+		serialized["biomeCells"] = nlohmann::json::object();
+		for (size_t i = 0; i < m_BiomeNames.size(); i++)
+			serialized["biomeCells"][m_BiomeNames[i]] = i < stats.biomeCells.size() ? stats.biomeCells[i] : 0;
+
+		m_Out << (m_Written > 0 ? ",\n" : "\n") << serialized.dump();
+	}
+
+	m_Written++;
+}
+
+void BiomeSurveyWriter::Finish()
+{
+	if (m_Finished) return;
+	m_Finished = true;
+
+	if (m_Format == FORMAT_JSON)
+		m_Out << "\n]\n";
+	m_Out.flush();
+}
+
+BiomeSurveyWriter::FORMAT BiomeSurveyWriter::FormatFromPath(const std::string& path)
+{
+	const std::string extension = ".json";
+	if (path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0)
+		return FORMAT_JSON;
+	return FORMAT_CSV;
+}
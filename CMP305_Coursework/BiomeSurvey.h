@@ -0,0 +1,83 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "BiomeRules.h"
+#include "BiomePipeline.h"
+
+
+// Generates the biome maps for a range of seeds and collects statistics about each, for choosing seeds
+// Runs without a D3D device: every worker thread runs its own compiled plan over whole seeds
+class BiomeSurvey
+{
+public:
+	struct SeedStats
+	{
+		unsigned int seed;
+		int mapSize;
+
+		// fraction of cells that are land
+		float landFraction;
+		// number of separate landmasses and oceans, and the area of the largest landmass in cells
+		int landmassCount;
+		int oceanCount;
+		int largestLandmass;
+
+		// number of cells of each biome
+		std::vector<int> biomeCells;
+
+		double milliseconds;
+	};
+
+	// rules supply every setting except the seed
+	BiomeSurvey(const BiomeRules& rules, const BiomePipeline& pipeline);
+
+	// surveys seeds [firstSeed, firstSeed + count), calling onSeed for every seed in order
+	// onSeed is called from the worker threads, but never from two at once
+	void Run(unsigned int firstSeed, int count, unsigned int threadCount, const std::function<void(const SeedStats&)>& onSeed);
+
+	// throughput of the last run
+	inline double GetLastSeconds() const { return m_LastSeconds; }
+	inline double GetSeedsPerSecond() const { return m_LastSeconds > 0.0 ? m_LastCount / m_LastSeconds : 0.0; }
+
+private:
+	BiomeRules m_Rules;
+	BiomePipeline m_Pipeline;
+
+	double m_LastSeconds = 0.0;
+	int m_LastCount = 0;
+};
+
+
+// Streams survey statistics to CSV (one row per seed) or JSON (an array of one object per seed)
+class BiomeSurveyWriter
+{
+public:
+	enum FORMAT
+	{
+		FORMAT_CSV,
+		FORMAT_JSON
+	};
+
+	// biomeNames label the biome histogram columns
+	BiomeSurveyWriter(std::ostream& out, FORMAT format, const std::vector<std::string>& biomeNames);
+	~BiomeSurveyWriter();
+
+	void Write(const BiomeSurvey::SeedStats& stats);
+	// completes the output; called by the destructor if it hasn't been
+	void Finish();
+
+	// json for files ending in .json, otherwise csv
+	static FORMAT FormatFromPath(const std::string& path);
+
+private:
+	std::ostream& m_Out;
+	FORMAT m_Format;
+	std::vector<std::string> m_BiomeNames;
+
+	int m_Written = 0;
+	bool m_Finished = false;
+};
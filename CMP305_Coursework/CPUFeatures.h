@@ -0,0 +1,102 @@
+#pragma once
+
+// Runtime detection of the SIMD instruction sets available on this CPU
+// Kernels that use them are compiled with the matching CPU_TARGET_ attribute, and selected at runtime,
+// so the program still runs on machines without them
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#else
+#define CPU_X86 0
+#endif
+
+#if CPU_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows any intrinsic in any function; GCC and Clang need to be told per function
+#if CPU_X86 && !defined(_MSC_VER)
+#define CPU_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define CPU_TARGET_AVX512 __attribute__((target("avx512f,avx512dq,avx2,fma")))
+#else
+#define CPU_TARGET_AVX2
+#define CPU_TARGET_AVX512
+#endif
+
+
+class CPUFeatures
+{
+public:
+	// pure static class
+	CPUFeatures() = delete;
+
+	static inline bool HasAVX2()
+	{
+		static const bool avx2 = DetectAVX2();
+		return avx2;
+	}
+
+	static inline bool HasAVX512()
+	{
+		static const bool avx512 = DetectAVX512();
+		return avx512;
+	}
+
+private:
+#if CPU_X86 && defined(_MSC_VER)
+	// the OS must also save the wider registers on context switches
+	static inline bool OSSavesState(unsigned long long mask)
+	{
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		return osxsave && (_xgetbv(0) & mask) == mask;
+	}
+#endif
+
+	static inline bool DetectAVX2()
+	{
+#if CPU_X86 && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+
+		// XMM and YMM state
+		return fma && avx2 && OSSavesState(0x6);
+#elif CPU_X86
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return false;
+#endif
+	}
+
+	static inline bool DetectAVX512()
+	{
+#if CPU_X86 && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		__cpuidex(info, 7, 0);
+		bool f = (info[1] & (1 << 16)) != 0;
+		bool dq = (info[1] & (1 << 17)) != 0;
+
+		// XMM, YMM, opmask and ZMM state
+		return f && dq && DetectAVX2() && OSSavesState(0xE6);
+#elif CPU_X86
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") && DetectAVX2();
+#else
+		return false;
+#endif
+	}
+};
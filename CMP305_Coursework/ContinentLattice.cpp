@@ -0,0 +1,126 @@
+#include "ContinentLattice.h"
+
+#include <cmath>
+
+#include "TerrainNoiseCPU.h"
+
+
+const float ContinentLattice::ErrorScale = 24.0f;
+const float ContinentLattice::MaxCycles = 0.25f;
+
+
+// Catmull-Rom weights of the four samples around t in [0, 1]
+static inline void CatmullRom(float t, float* w)
+{
+	w[0] = t * (-0.5f + t * (1.0f - 0.5f * t));
+	w[1] = 1.0f + t * t * (-2.5f + 1.5f * t);
+	w[2] = t * (0.5f + t * (2.0f - 1.5f * t));
+	w[3] = t * t * (-0.5f + 0.5f * t);
+}
+
+
+float ContinentLattice::ReconstructionError(const SimpleNoiseSettings& settings, int octaves, float latticeSpacing, float sampleSpacing)
+{
+	float error = 0.0f;
+	float f = settings.Frequency;
+	float a = 1.0f;
+
+	for (int octave = 0; octave < octaves && octave < settings.Octaves; octave++)
+	{
+		// octaves that aren't evaluated at this sample spacing have nothing to reconstruct
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		if (weight <= 0.0f && settings.Lacunarity >= 1.0f) break;
+
+		float cycles = fabsf(f) * latticeSpacing;
+		if (cycles > MaxCycles) return INFINITY;
+		error += ErrorScale * cycles * cycles * cycles * fabsf(a * weight);
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence;
+	}
+
+	return error * fabsf(settings.Elevation);
+}
+
+int ContinentLattice::LatticeOctaves(const TerrainNoiseSettings& settings, float latticeSpacing, float maxError, float sampleSpacing)
+{
+	// smooth max never steepens the continent, but the ocean depth multiplier scales it below sea level
+	float depthScale = fabsf(1.0f + settings.OceanDepthMultiplier);
+	maxError /= depthScale > 1.0f ? depthScale : 1.0f;
+
+	int octaves = 0;
+	while (octaves < settings.ContinentSettings.Octaves &&
+		ReconstructionError(settings.ContinentSettings, octaves + 1, latticeSpacing, sampleSpacing) <= maxError)
+	{
+		octaves++;
+	}
+	return octaves;
+}
+
+
+// the cell of the lattice a texel lies in, and the Catmull-Rom weights of the samples around it
+static inline int LatticeCell(int texel, int step, int cells, float* w)
+{
+	// texels on the far edge belong to the last cell
+	int cell = texel / step;
+	cell = cell < cells - 1 ? cell : cells - 1;
+	CatmullRom(static_cast<float>(texel - cell * step) / static_cast<float>(step), w);
+	return cell;
+}
+
+void ContinentLattice::Build(const SimpleNoiseSettings& settings, int octaves, float originX, float originY, int resolution, int step,
+	float sampleSpacing)
+{
+	m_Octaves = octaves;
+	m_Resolution = resolution;
+
+	const float texelScale = static_cast<float>(resolution - 1);
+	const int cells = (resolution - 1 + step - 1) / step;
+	const int width = cells + 3;
+
+	// sample the lattice, at the positions the texels on it have
+	m_X.resize(width * width);
+	m_Y.resize(width * width);
+	m_Samples.resize(width * width);
+	for (int j = 0; j < width; j++)
+	{
+		for (int i = 0; i < width; i++)
+		{
+			m_X[j * width + i] = static_cast<float>((i - 1) * step) / texelScale + originX;
+			m_Y[j * width + i] = static_cast<float>((j - 1) * step) / texelScale + originY;
+		}
+	}
+	TerrainNoiseCPU::ContinentOctaves(m_X.data(), m_Y.data(), width * width, settings, 0, octaves, m_Samples.data(), sampleSpacing);
+
+	// the cell and weights of each row of the tile, which are also those of each column
+	m_TexelCell.resize(resolution);
+	m_TexelWeights.resize(4 * resolution);
+	for (int texel = 0; texel < resolution; texel++)
+		m_TexelCell[texel] = LatticeCell(texel, step, cells, m_TexelWeights.data() + 4 * texel);
+
+	// interpolate every row of the lattice along x
+	m_Rows.resize(width * resolution);
+	for (int j = 0; j < width; j++)
+	{
+		const float* samples = m_Samples.data() + j * width;
+		float* row = m_Rows.data() + j * resolution;
+		for (int column = 0; column < resolution; column++)
+		{
+			const float* w = m_TexelWeights.data() + 4 * column;
+			const float* s = samples + m_TexelCell[column];
+			row[column] = w[0] * s[0] + w[1] * s[1] + w[2] * s[2] + w[3] * s[3];
+		}
+	}
+}
+
+void ContinentLattice::Sample(const int* columns, const int* rows, int count, float* sums) const
+{
+	// interpolate the lattice's rows along y
+	const int stride = m_Resolution;
+	for (int p = 0; p < count; p++)
+	{
+		const float* w = m_TexelWeights.data() + 4 * rows[p];
+		const float* s = m_Rows.data() + m_TexelCell[rows[p]] * stride + columns[p];
+		sums[p] = w[0] * s[0] + w[1] * s[stride] + w[2] * s[2 * stride] + w[3] * s[3 * stride];
+	}
+}
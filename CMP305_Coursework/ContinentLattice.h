@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include "NoiseSettings.h"
+
+
+// The first octaves of a continent layer over a heightmap tile, sampled on a coarse lattice and reconstructed at the tile's
+// texels with Catmull-Rom (bicubic) interpolation
+// Continent octaves start out far coarser than a heightmap's texels, so most of their samples can be interpolated
+// rather than evaluated; the finer octaves are still evaluated at every texel (see TerrainNoiseCPU::TerrainNoise)
+//
+// Error:
+// reconstructing a single octave of simplex noise, of unit amplitude, from a lattice with c cycles per lattice spacing
+// is out by at most 19.3 * c^3 (measured, for c up to 0.25); ErrorScale leaves a margin above that
+class ContinentLattice
+{
+public:
+	ContinentLattice() = default;
+	~ContinentLattice() = default;
+
+	static const float ErrorScale;
+	// octaves with more cycles per lattice spacing than this are never reconstructed
+	static const float MaxCycles;
+
+	// bound on the reconstruction error of the first octaves of a layer at a lattice spacing, in units of height
+	static float ReconstructionError(const SimpleNoiseSettings& settings, int octaves, float latticeSpacing, float sampleSpacing = 0.0f);
+	// most leading octaves of the continent layer whose reconstruction moves TerrainNoise by no more than maxError
+	static int LatticeOctaves(const TerrainNoiseSettings& settings, float latticeSpacing, float maxError, float sampleSpacing = 0.0f);
+
+	// samples the first octaves of a layer every step texels over a tile of resolution * resolution texels,
+	// whose texels are 1 / (resolution - 1) apart starting from (originX, originY), as a heightmap's are
+	void Build(const SimpleNoiseSettings& settings, int octaves, float originX, float originY, int resolution, int step,
+		float sampleSpacing = 0.0f);
+
+	// the reconstructed sum of the octaves (before elevation and vertical shift) at texels of the tile
+	void Sample(const int* columns, const int* rows, int count, float* sums) const;
+
+	// a lattice without octaves reconstructs nothing
+	inline void Clear() { m_Octaves = 0; }
+	inline int GetOctaves() const { return m_Octaves; }
+
+private:
+	int m_Octaves = 0;
+	int m_Resolution = 0;
+
+	// the lattice interpolated along x to every column of the tile, for each row of the lattice
+	// the lattice has a ring of one sample beyond the tile, so that every cell has its 4x4 neighbourhood
+	std::vector<float> m_Rows;
+	// for each row (or column) of the tile, the first of the four lattice rows (or columns) around it and their weights
+	std::vector<int> m_TexelCell;
+	std::vector<float> m_TexelWeights;
+
+	// lattice sample positions and values, kept between builds
+	std::vector<float> m_X;
+	std::vector<float> m_Y;
+	std::vector<float> m_Samples;
+};
@@ -2,7 +2,7 @@
 
 #include <cassert>
 
-Heightmap::Heightmap(ID3D11Device* device, unsigned int resolution)
+Heightmap::Heightmap(ID3D11Device* device, unsigned int resolution, unsigned int blendMapResolution)
 	: m_Resolution(resolution)
 {
 	// create heightmap texture
@@ -43,10 +43,20 @@ Heightmap::Heightmap(ID3D11Device* device, unsigned int resolution)
 	descSRV.Texture2D.MipLevels = 1;
 	hr = device->CreateShaderResourceView(tex, &descSRV, &m_SRV);
 	assert(hr == S_OK);
+
+	m_BlendMap = new BiomeBlendMap(device, blendMapResolution);
 }
 
 Heightmap::~Heightmap()
 {
 	if (m_UAV) m_UAV->Release();
 	if (m_SRV) m_SRV->Release();
+
+	if (m_BlendMap) delete m_BlendMap;
+}
+
+void Heightmap::SetBlendMapResolution(ID3D11Device* device, unsigned int blendMapResolution)
+{
+	if (m_BlendMap) delete m_BlendMap;
+	m_BlendMap = new BiomeBlendMap(device, blendMapResolution);
 }
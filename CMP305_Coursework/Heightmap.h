@@ -3,19 +3,28 @@
 #include <d3d11.h>
 #include <DirectXMath.h>
 
+#include "BiomeBlendMap.h"
+
 using namespace DirectX;
 
 
+// Heightmap texture generated by terrainNoise_cs
+// r holds the height, g and b its gradient with respect to the world position (in tiles)
+// Each heightmap keeps the biome blend map of its tile, baked before the heightmap is generated
 class Heightmap
 {
 public:
-	Heightmap(ID3D11Device* device, unsigned int resolution);
+	Heightmap(ID3D11Device* device, unsigned int resolution, unsigned int blendMapResolution);
 	~Heightmap();
 
 	ID3D11UnorderedAccessView* GetUAV() const { return m_UAV; }
 	ID3D11ShaderResourceView* GetSRV() const { return m_SRV; }
 	unsigned int GetResolution() const { return m_Resolution; }
 
+	BiomeBlendMap* GetBlendMap() const { return m_BlendMap; }
+	// recreates the blend map, which must then be baked again
+	void SetBlendMapResolution(ID3D11Device* device, unsigned int blendMapResolution);
+
 	inline const XMFLOAT2& GetOffset() const { return m_Offset; }
 	inline void SetOffset(const XMFLOAT2& o) { m_Offset = o; }
 
@@ -25,5 +34,7 @@ private:
 	ID3D11ShaderResourceView* m_SRV = nullptr;
 	ID3D11UnorderedAccessView* m_UAV = nullptr;
 
+	BiomeBlendMap* m_BlendMap = nullptr;
+
 	XMFLOAT2 m_Offset = { 0.0f, 0.0f };
 };
\ No newline at end of file
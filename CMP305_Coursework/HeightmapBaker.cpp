@@ -0,0 +1,745 @@
+#include "HeightmapBaker.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "BiomeBlending.h"
+#include "BiomeSettingsJson.h"
+#include "BiomeStages.h"
+#include "BiomeLayerStack.h"
+#include "TerrainNoiseCPU.h"
+#include "Parallel.h"
+
+
+// tiles are generated a band of rows at a time, so that the working memory stays small
+static const int BandRows = 32;
+// and the rows of a band are classified in blocks of BlockSize x BlockSize pixels (see ClassifyBlock)
+static const int BlockSize = 16;
+
+// spacings (in texels) the continent lattice chooses between
+static const int LatticeSteps[] = { 4, 8, 16, 32, 64 };
+
+
+static inline float Lerp(float a, float b, float t)
+{
+	return a + t * (b - a);
+}
+
+
+HeightmapBaker::HeightmapBaker()
+{
+	BiomeCatalog::CreateBiomes(m_AllBiomes, m_SpawnableLandBiomesByTemp, m_SpawnableOceanBiomesByTemp);
+
+	// the seed App1 creates its biome generator with
+	m_Rules.seed = 1;
+	BiomeCatalog::FillRules(m_Rules, m_AllBiomes, m_SpawnableLandBiomesByTemp, m_SpawnableOceanBiomesByTemp);
+
+	UpdateKernels();
+}
+
+bool HeightmapBaker::LoadFromJson(const nlohmann::json& data, std::string& error)
+{
+	// the same settings as BiomeGenerator::LoadFromJson
+	if (data.contains("biomeGenerator"))
+	{
+		BiomeSettingsJson::World world{ m_BiomeMapPxPerTile, m_BiomeBlending, m_UnboundedWorld };
+		nlohmann::json noiseGraphs[MAX_BIOMES];
+		BiomeSettingsJson::Load(data["biomeGenerator"], m_Rules, world, m_GenerationSettings, noiseGraphs, m_AllBiomes);
+
+		m_BiomeMapPxPerTile = world.biomeMapPxPerTile;
+		m_BiomeBlending = world.biomeBlending;
+		m_UnboundedWorld = world.unboundedWorld;
+
+		for (int biome = 0; biome < MAX_BIOMES; biome++)
+		{
+			m_Graphs[biome].Clear();
+			if (!noiseGraphs[biome].is_null() && !m_Graphs[biome].LoadFromJson(noiseGraphs[biome], error))
+			{
+				error = "Noise graph of biome " + std::to_string(biome) + ": " + error;
+				UpdateKernels();
+				return false;
+			}
+		}
+	}
+	BiomeCatalog::FillRules(m_Rules, m_AllBiomes, m_SpawnableLandBiomesByTemp, m_SpawnableOceanBiomesByTemp);
+	UpdateKernels();
+
+	// settings saved before pipelines were configurable use the default pipeline
+	error.clear();
+	if (!data.contains("biomePipeline"))
+	{
+		m_Pipeline = BiomePipeline::Default();
+		return true;
+	}
+	return m_Pipeline.LoadFromJson(data["biomePipeline"], error);
+}
+
+void HeightmapBaker::SetResolution(int resolution)
+{
+	m_Resolution = resolution > 2 ? resolution : 2;
+	UpdateKernels();
+}
+
+void HeightmapBaker::SetBandLimited(bool bandLimited)
+{
+	m_BandLimited = bandLimited;
+	UpdateKernels();
+}
+
+void HeightmapBaker::SetFixedPoint(bool fixedPoint)
+{
+	m_FixedPoint = fixedPoint;
+	UpdateKernels();
+}
+
+void HeightmapBaker::UpdateKernels()
+{
+	// the sample spacing decides which octaves each kernel evaluates
+	m_Kernels.clear();
+	m_Kernels.reserve(MAX_BIOMES);
+	m_FixedKernels.clear();
+	m_FixedKernels.reserve(m_FixedPoint ? MAX_BIOMES : 0);
+	m_Programs.resize(MAX_BIOMES);
+	TerrainNoiseLayers::FindSources(m_GenerationSettings, MAX_BIOMES, m_LayerSources);
+	for (int biome = 0; biome < MAX_BIOMES; biome++)
+	{
+		m_Kernels.emplace_back(m_GenerationSettings[biome], GetSampleSpacing());
+		if (m_FixedPoint) m_FixedKernels.emplace_back(m_GenerationSettings[biome], GetSampleSpacing());
+		m_Programs[biome].Compile(m_Graphs[biome], m_GenerationSettings[biome], GetSampleSpacing());
+	}
+}
+
+void HeightmapBaker::BuildBiomeMap(int minTileX, int minTileY, int maxTileX, int maxTileY, unsigned int threadCount)
+{
+	if (!m_UnboundedWorld)
+	{
+		BiomePlan plan;
+		plan.Compile(m_Pipeline);
+		BiomeArena arena;
+		BiomeStageExecutor executor;
+
+		size_t size = 0;
+		const BiomeCell* map = plan.Execute(m_Rules, arena, executor, threadCount, size);
+
+		m_BiomeMap.assign(map, map + size * size);
+		m_BiomeMapWidth = m_BiomeMapHeight = m_BiomeMapResolution = static_cast<int>(size);
+		m_BiomeMapOriginX = m_BiomeMapOriginY = 0;
+		return;
+	}
+
+	BiomeLayerStack layerStack(m_Rules, m_Pipeline);
+	m_BiomeMapResolution = static_cast<int>(layerStack.GetNominalMapSize());
+
+	// the window BiomeGenerator::UpdateBiomeMapWindow would choose with these tiles in view
+	float cellsPerTile = m_BiomeMapPxPerTile * static_cast<float>(m_BiomeMapResolution - 1) / static_cast<float>(m_BiomeMapResolution);
+	int x0 = static_cast<int>(floor(minTileX * cellsPerTile)) - 1;
+	int y0 = static_cast<int>(floor(minTileY * cellsPerTile)) - 1;
+	int x1 = static_cast<int>(floor((maxTileX + 1) * cellsPerTile)) + 2;
+	int y1 = static_cast<int>(floor((maxTileY + 1) * cellsPerTile)) + 2;
+
+	m_BiomeMapOriginX = x0;
+	m_BiomeMapOriginY = y0;
+	m_BiomeMapWidth = x1 - x0;
+	m_BiomeMapHeight = y1 - y0;
+	m_BiomeMap.resize(static_cast<size_t>(m_BiomeMapWidth) * m_BiomeMapHeight);
+	layerStack.GetBiomes(x0, y0, m_BiomeMapWidth, m_BiomeMapHeight, m_BiomeMap.data());
+}
+
+void HeightmapBaker::GenerateTile(int tileX, int tileY, float* heights, Scratch& scratch) const
+{
+	const int resolution = m_Resolution;
+	const float texelScale = static_cast<float>(resolution - 1);
+	BiomeBlending::Mapping mapping;
+	mapping.pxPerTile = m_BiomeMapPxPerTile;
+	mapping.resolution = m_BiomeMapResolution;
+	mapping.blending = m_BiomeBlending;
+
+	const int bandPixels = BandRows * resolution;
+	scratch.biomes.resize(4 * bandPixels);
+	scratch.weights.resize(2 * bandPixels);
+	scratch.points.resize(4 * bandPixels);
+	scratch.x.resize(4 * bandPixels);
+	scratch.y.resize(4 * bandPixels);
+	scratch.heights.resize(4 * bandPixels);
+	scratch.biomeStart.resize(MAX_BIOMES + 1);
+	scratch.continentBase.resize(4 * bandPixels);
+	scratch.columns.resize(4 * bandPixels);
+	scratch.rows.resize(4 * bandPixels);
+	scratch.lattices.resize(MAX_BIOMES);
+	scratch.latticeBuilt.assign(MAX_BIOMES, 0);
+
+	int* biomes = scratch.biomes.data();
+	float* weights = scratch.weights.data();
+	int* points = scratch.points.data();
+	int* biomeStart = scratch.biomeStart.data();
+
+	// the biome map cell and blend of each column are the same on every row, and of each row on every column
+	scratch.columnCells.resize(resolution);
+	scratch.columnBlends.resize(resolution);
+	scratch.rowCells.resize(BandRows);
+	scratch.rowBlends.resize(BandRows);
+	int* columnCells = scratch.columnCells.data();
+	float* columnBlends = scratch.columnBlends.data();
+	int* rowCells = scratch.rowCells.data();
+	float* rowBlends = scratch.rowBlends.data();
+
+	for (int column = 0; column < resolution; column++)
+	{
+		const float posX = static_cast<float>(column) / texelScale + static_cast<float>(tileX);
+		float uvX;
+		columnCells[column] = BiomeBlending::GetCell(posX, mapping, uvX);
+		columnBlends[column] = m_FixedPoint ? TerrainNoiseFixed::BiomeBlend(uvX, m_BiomeBlending) : BiomeBlending::Blend(uvX, m_BiomeBlending);
+	}
+
+	for (int firstRow = 0; firstRow < resolution; firstRow += BandRows)
+	{
+		const int rows = resolution - firstRow < BandRows ? resolution - firstRow : BandRows;
+		const int pixels = rows * resolution;
+
+		// find the biomes at each pixel, exactly as terrainNoise_cs.hlsl does
+		for (int i = 0; i < MAX_BIOMES + 1; i++)
+			biomeStart[i] = 0;
+		for (int row = 0; row < rows; row++)
+		{
+			const float posY = static_cast<float>(firstRow + row) / texelScale + static_cast<float>(tileY);
+			float uvY;
+			rowCells[row] = BiomeBlending::GetCell(posY, mapping, uvY);
+			rowBlends[row] = m_FixedPoint ? TerrainNoiseFixed::BiomeBlend(uvY, m_BiomeBlending) : BiomeBlending::Blend(uvY, m_BiomeBlending);
+		}
+
+		for (int blockRow = 0; blockRow < rows; blockRow += BlockSize)
+		{
+			const int blockRows = rows - blockRow < BlockSize ? rows - blockRow : BlockSize;
+			for (int blockColumn = 0; blockColumn < resolution; blockColumn += BlockSize)
+			{
+				const int blockColumns = resolution - blockColumn < BlockSize ? resolution - blockColumn : BlockSize;
+				const BlockBlend blend = ClassifyBlock(columnCells + blockColumn, columnBlends + blockColumn, blockColumns,
+					rowCells + blockRow, rowBlends + blockRow, blockRows);
+
+				if (blend == BlockBlend::Single)
+				{
+					// one biome, so no blend maths or biome lookups per pixel
+					const int biome = GetBiome(columnCells[blockColumn], rowCells[blockRow]);
+					for (int row = blockRow; row < blockRow + blockRows; row++)
+					{
+						for (int column = blockColumn; column < blockColumn + blockColumns; column++)
+						{
+							const int pixel = row * resolution + column;
+							int* b = biomes + 4 * pixel;
+							b[0] = biome;
+							b[1] = b[2] = b[3] = -1;
+							weights[2 * pixel + 0] = 0.0f;
+							weights[2 * pixel + 1] = 0.0f;
+						}
+					}
+					biomeStart[biome + 1] += blockRows * blockColumns;
+
+					TerrainNoiseLayers::Evaluations evaluations;
+					TerrainNoiseLayers::CountEvaluations(m_GenerationSettings, m_LayerSources, &biome, 1, evaluations);
+					scratch.evaluations.unshared += evaluations.unshared * blockRows * blockColumns;
+					scratch.evaluations.shared += evaluations.shared * blockRows * blockColumns;
+					continue;
+				}
+
+				for (int row = blockRow; row < blockRow + blockRows; row++)
+				{
+					const int y = rowCells[row];
+					const float blendY = rowBlends[row];
+					for (int column = blockColumn; column < blockColumn + blockColumns; column++)
+					{
+						const int pixel = row * resolution + column;
+						const int x = columnCells[column];
+						const float blendX = columnBlends[column];
+
+						int* b = biomes + 4 * pixel;
+						weights[2 * pixel + 0] = fabsf(blendX);
+						weights[2 * pixel + 1] = fabsf(blendY);
+
+						b[0] = GetBiome(x, y);
+						if (sqrtf(blendX * blendX + blendY * blendY) == 0.0f)
+						{
+							b[1] = b[2] = b[3] = -1;
+						}
+						else if (blend == BlockBlend::BlendX)
+						{
+							// no blending along y, so the biomes below are the same as those at the pixel's row
+							b[1] = GetBiome(x + BiomeBlending::Sign(blendX), y);
+							b[2] = b[0];
+							b[3] = b[1];
+						}
+						else if (blend == BlockBlend::BlendY)
+						{
+							b[1] = b[0];
+							b[2] = GetBiome(x, y + BiomeBlending::Sign(blendY));
+							b[3] = b[2];
+						}
+						else
+						{
+							b[1] = GetBiome(x + BiomeBlending::Sign(blendX), y);
+							b[2] = GetBiome(x, y + BiomeBlending::Sign(blendY));
+							b[3] = GetBiome(x + BiomeBlending::Sign(blendX), y + BiomeBlending::Sign(blendY));
+						}
+						TerrainNoiseLayers::CountEvaluations(m_GenerationSettings, m_LayerSources, b, b[1] < 0 ? 1 : 4, scratch.evaluations);
+
+						// biomes appearing more than once at a pixel are only evaluated once
+						for (int k = 0; k < 4 && b[k] >= 0; k++)
+						{
+							bool repeated = false;
+							for (int j = 0; j < k; j++)
+								repeated |= b[j] == b[k];
+							if (!repeated) biomeStart[b[k] + 1]++;
+						}
+					}
+				}
+			}
+		}
+
+		// group the points by biome
+		for (int i = 0; i < MAX_BIOMES; i++)
+			biomeStart[i + 1] += biomeStart[i];
+
+		int next[MAX_BIOMES];
+		for (int i = 0; i < MAX_BIOMES; i++)
+			next[i] = biomeStart[i];
+
+		float* x = scratch.x.data();
+		float* y = scratch.y.data();
+		for (int pixel = 0; pixel < pixels; pixel++)
+		{
+			const int* b = biomes + 4 * pixel;
+			const float posX = static_cast<float>(pixel % resolution) / texelScale + static_cast<float>(tileX);
+			const float posY = static_cast<float>(firstRow + pixel / resolution) / texelScale + static_cast<float>(tileY);
+
+			for (int k = 0; k < 4 && b[k] >= 0; k++)
+			{
+				int j = 0;
+				while (j < k && b[j] != b[k]) j++;
+				if (j < k)
+				{
+					points[4 * pixel + k] = points[4 * pixel + j];
+					continue;
+				}
+
+				const int point = next[b[k]]++;
+				x[point] = posX;
+				y[point] = posY;
+				scratch.columns[point] = pixel % resolution;
+				scratch.rows[point] = firstRow + pixel / resolution;
+				points[4 * pixel + k] = point;
+			}
+		}
+
+		// one batch per biome
+		float* biomeHeights = scratch.heights.data();
+		for (int biome = 0; biome < MAX_BIOMES; biome++)
+		{
+			const int start = biomeStart[biome];
+			const int count = biomeStart[biome + 1] - start;
+			if (count == 0) continue;
+
+			// biomes with a noise graph evaluate it in place of their fixed layers
+			if (!m_Programs[biome].IsEmpty())
+			{
+				TerrainNoiseCPU::GraphNoise(m_Programs[biome], x + start, y + start, count, biomeHeights + start);
+				continue;
+			}
+
+			if (m_FixedPoint)
+			{
+				m_FixedKernels[biome].TerrainNoise(x + start, y + start, count, biomeHeights + start);
+				continue;
+			}
+
+			const float* continentBase = nullptr;
+			int baseOctaves = 0;
+			if (m_ContinentError > 0.0f)
+			{
+				ContinentLattice& lattice = scratch.lattices[biome];
+				if (!scratch.latticeBuilt[biome])
+				{
+					BuildContinentLattice(tileX, tileY, m_GenerationSettings[biome], lattice);
+					scratch.latticeBuilt[biome] = 1;
+				}
+
+				if (lattice.GetOctaves() > 0)
+				{
+					lattice.Sample(scratch.columns.data() + start, scratch.rows.data() + start, count, scratch.continentBase.data() + start);
+					continentBase = scratch.continentBase.data() + start;
+					baseOctaves = lattice.GetOctaves();
+				}
+			}
+
+			// a biome's points are its pixels of the band in row order, so neighbours share simplex cells
+			m_Kernels[biome].TerrainNoise(x + start, y + start, count, biomeHeights + start, continentBase, baseOctaves, 1.0f / texelScale);
+		}
+
+		// blend between the biomes
+		float* out = heights + firstRow * resolution;
+		for (int pixel = 0; pixel < pixels; pixel++)
+		{
+			const int* p = points + 4 * pixel;
+			if (biomes[4 * pixel + 1] < 0)
+			{
+				out[pixel] = biomeHeights[p[0]];
+				continue;
+			}
+
+			const float wx = weights[2 * pixel + 0];
+			const float wy = weights[2 * pixel + 1];
+			if (m_FixedPoint)
+			{
+				out[pixel] = TerrainNoiseFixed::Lerp(
+					TerrainNoiseFixed::Lerp(biomeHeights[p[0]], biomeHeights[p[2]], wy),
+					TerrainNoiseFixed::Lerp(biomeHeights[p[1]], biomeHeights[p[3]], wy),
+					wx
+				);
+				continue;
+			}
+			out[pixel] = Lerp(
+				Lerp(biomeHeights[p[0]], biomeHeights[p[2]], wy),
+				Lerp(biomeHeights[p[1]], biomeHeights[p[3]], wy),
+				wx
+			);
+		}
+	}
+}
+
+HeightmapBaker::BlockBlend HeightmapBaker::ClassifyBlock(const int* columnCells, const float* columnBlends, int columns,
+	const int* rowCells, const float* rowBlends, int rows)
+{
+	// an axis is still when all of the block lies in one cell along it, and none of it blends into the neighbouring cells
+	auto still = [](const int* cells, const float* blends, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (cells[i] != cells[0] || blends[i] != 0.0f)
+				return false;
+		}
+		return true;
+	};
+
+	const bool stillX = still(columnCells, columnBlends, columns);
+	const bool stillY = still(rowCells, rowBlends, rows);
+	if (stillX && stillY) return BlockBlend::Single;
+	if (stillY) return BlockBlend::BlendX;
+	if (stillX) return BlockBlend::BlendY;
+	return BlockBlend::FourWay;
+}
+
+int HeightmapBaker::ChooseLatticeStep(const TerrainNoiseSettings& settings, int& octaves) const
+{
+	const float texelScale = static_cast<float>(m_Resolution - 1);
+	const float pixels = static_cast<float>(m_Resolution) * static_cast<float>(m_Resolution);
+
+	// each octave taken from the lattice saves a sample per pixel, but costs one per lattice node;
+	// interpolating each row of the lattice along x costs about as much as a sample per column
+	int bestStep = 0;
+	float bestSaving = 0.0f;
+	octaves = 0;
+	for (int step : LatticeSteps)
+	{
+		const int width = (m_Resolution - 1 + step - 1) / step + 3;
+		const float nodes = static_cast<float>(width * width);
+		const int stepOctaves = ContinentLattice::LatticeOctaves(settings, static_cast<float>(step) / texelScale, m_ContinentError, GetSampleSpacing());
+
+		const float saving = static_cast<float>(stepOctaves) * (pixels - nodes) - static_cast<float>(width * m_Resolution);
+		if (stepOctaves > 0 && saving > bestSaving)
+		{
+			bestStep = step;
+			bestSaving = saving;
+			octaves = stepOctaves;
+		}
+	}
+	return bestStep;
+}
+
+void HeightmapBaker::BuildContinentLattice(int tileX, int tileY, const TerrainNoiseSettings& settings, ContinentLattice& lattice) const
+{
+	int octaves;
+	const int step = ChooseLatticeStep(settings, octaves);
+	if (octaves == 0)
+	{
+		lattice.Clear();
+		return;
+	}
+
+	lattice.Build(settings.ContinentSettings, octaves, static_cast<float>(tileX), static_cast<float>(tileY), m_Resolution, step, GetSampleSpacing());
+}
+
+TerrainNoiseBounds::Interval HeightmapBaker::GetTileBounds(int tileX, int tileY) const
+{
+	// same mapping from world position to biome map cell as GenerateTile
+	auto cell = [this](int pos)
+	{
+		float uv = static_cast<float>(pos) * m_BiomeMapPxPerTile / static_cast<float>(m_BiomeMapResolution);
+		return static_cast<int>(floorf(static_cast<float>(m_BiomeMapResolution - 1) * uv));
+	};
+
+	// every biome the tile's pixels could blend between
+	bool present[MAX_BIOMES] = {};
+	for (int y = cell(tileY) - 1; y <= cell(tileY + 1) + 1; y++)
+	{
+		for (int x = cell(tileX) - 1; x <= cell(tileX + 1) + 1; x++)
+			present[GetBiome(x, y)] = true;
+	}
+
+	// blending never leaves the range of the heights being blended
+	TerrainNoiseBounds::Interval bounds{ INFINITY, -INFINITY };
+	for (int biome = 0; biome < MAX_BIOMES; biome++)
+	{
+		if (!present[biome]) continue;
+
+		// noise graphs aren't bounded
+		if (!m_Graphs[biome].IsEmpty())
+			return { -INFINITY, INFINITY };
+
+		auto biomeBounds = TerrainNoiseBounds::TerrainNoise(static_cast<float>(tileX), static_cast<float>(tileY),
+			static_cast<float>(tileX + 1), static_cast<float>(tileY + 1), m_GenerationSettings[biome], GetSampleSpacing(),
+			m_FixedPoint ? TerrainNoiseFixed::FloatTolerance : TerrainNoiseCPU::NoiseTolerance);
+		bounds.min = biomeBounds.min < bounds.min ? biomeBounds.min : bounds.min;
+		bounds.max = biomeBounds.max > bounds.max ? biomeBounds.max : bounds.max;
+	}
+
+	// continents reconstructed from a lattice may be out by up to the error allowed
+	const float continentError = m_FixedPoint ? 0.0f : m_ContinentError;
+	bounds.min -= continentError;
+	bounds.max += continentError;
+	return bounds;
+}
+
+bool HeightmapBaker::Bake(int minTileX, int minTileY, int maxTileX, int maxTileY, const std::string& directory, unsigned int threadCount,
+	const std::function<void(const Progress&)>& onProgress, std::string& error)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const int width = maxTileX - minTileX + 1;
+	const int height = maxTileY - minTileY + 1;
+	if (width <= 0 || height <= 0)
+	{
+		error = "no tiles in range";
+		return false;
+	}
+	const int tileCount = width * height;
+
+	BuildBiomeMap(minTileX, minTileY, maxTileX, maxTileY, threadCount);
+
+	// tiles in blended areas cost up to four times as much as the rest, so idle workers steal tiles from busy ones
+	const int workers = Parallel::WorkerCount(tileCount, threadCount, 1);
+	std::vector<Scratch> scratch(workers);
+	std::vector<std::vector<float>> tiles(workers);
+
+	std::mutex progressMutex;
+	Progress progress;
+	progress.tileCount = tileCount;
+	std::atomic<bool> failed{ false };
+	error.clear();
+
+	Parallel::ForEachStealing(0, tileCount, threadCount, [&](int worker, int tile)
+	{
+		if (failed) return;
+
+		const int tileX = minTileX + tile % width;
+		const int tileY = minTileY + tile / width;
+		std::vector<float>& heights = tiles[worker];
+		heights.resize(static_cast<size_t>(m_Resolution) * m_Resolution);
+		GenerateTile(tileX, tileY, heights.data(), scratch[worker]);
+
+		std::string path = directory + "/tile_" + std::to_string(tileX) + "_" + std::to_string(tileY) + ".r32";
+		std::ofstream outfile(path, std::ios::binary);
+		outfile.write(reinterpret_cast<const char*>(heights.data()), heights.size() * sizeof(float));
+		outfile.close();
+
+		std::lock_guard<std::mutex> lock(progressMutex);
+		if (!outfile)
+		{
+			if (!failed) error = "could not write " + path;
+			failed = true;
+			return;
+		}
+
+		progress.tilesDone++;
+		progress.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		if (onProgress) onProgress(progress);
+	});
+
+	m_LastTileCount = progress.tilesDone;
+	m_LastEvaluations = {};
+	for (const Scratch& s : scratch)
+	{
+		m_LastEvaluations.unshared += s.evaluations.unshared;
+		m_LastEvaluations.shared += s.evaluations.shared;
+	}
+	m_LastSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return !failed;
+}
+
+BiomeCell HeightmapBaker::GetBiome(int x, int y) const
+{
+	x -= m_BiomeMapOriginX;
+	y -= m_BiomeMapOriginY;
+	if (x < 0 || y < 0 || x >= m_BiomeMapWidth || y >= m_BiomeMapHeight)
+		return 0;
+	return m_BiomeMap[static_cast<size_t>(y) * m_BiomeMapWidth + x];
+}
+
+
+int HeightmapBaker::RunCommandLine(const std::vector<std::string>& args)
+{
+	const char* usage = "usage: <settings.json> <output directory> <min tile x> <min tile y> <max tile x> <max tile y> [threads] [resolution]"
+		" [--band-limit] [--continent-error <height>] [--fixed-point]\n";
+
+	std::vector<std::string> positional;
+	bool bandLimited = false;
+	bool fixedPoint = false;
+	float continentError = 0.0f;
+	bool valid = true;
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		if (args[i] == "--band-limit") bandLimited = true;
+		else if (args[i] == "--fixed-point") fixedPoint = true;
+		else if (args[i] == "--continent-error")
+		{
+			std::istringstream value(i + 1 < args.size() ? args[++i] : "");
+			valid &= static_cast<bool>(value >> continentError) && continentError >= 0.0f;
+		}
+		else positional.push_back(args[i]);
+	}
+
+	int tileRange[4] = {};
+	unsigned int threadCount = 0;
+	int resolution = 1024;
+
+	std::istringstream numbers;
+	valid &= positional.size() >= 6;
+	for (size_t i = 2; valid && i < positional.size(); i++)
+	{
+		numbers.clear();
+		numbers.str(positional[i]);
+		if (i < 6) valid = static_cast<bool>(numbers >> tileRange[i - 2]);
+		else if (i == 6) valid = static_cast<bool>(numbers >> threadCount);
+		else if (i == 7) valid = static_cast<bool>(numbers >> resolution) && resolution > 1;
+	}
+	if (!valid)
+	{
+		fprintf(stderr, "%s", usage);
+		return 1;
+	}
+
+	std::ifstream infile(positional[0]);
+	if (!infile)
+	{
+		fprintf(stderr, "could not open %s\n", positional[0].c_str());
+		return 1;
+	}
+	nlohmann::json data;
+	try
+	{
+		infile >> data;
+	}
+	catch (const nlohmann::json::exception& e)
+	{
+		fprintf(stderr, "could not parse %s: %s\n", positional[0].c_str(), e.what());
+		return 1;
+	}
+	infile.close();
+
+	HeightmapBaker baker;
+	std::string error;
+	if (!baker.LoadFromJson(data, error))
+	{
+		fprintf(stderr, "invalid settings: %s\n", error.c_str());
+		return 1;
+	}
+	baker.SetResolution(resolution);
+	baker.SetBandLimited(bandLimited);
+	baker.SetContinentError(continentError);
+	baker.SetFixedPoint(fixedPoint);
+
+	for (int biome = 0; biome < baker.m_Rules.biomeCount; biome++)
+	{
+		const NoiseProgram& program = baker.m_Programs[biome];
+		if (program.IsEmpty()) continue;
+		printf("%-16s noise graph of %zu instructions in %d registers (%d of %d nodes shared)\n", baker.m_AllBiomes[biome].name,
+			program.GetInstructions().size(), program.GetRegisterCount(), program.GetSharedCount(), program.GetNodeCount());
+	}
+
+	// layers the GPU evaluates once for several biomes
+	for (int biome = 0; biome < baker.m_Rules.biomeCount; biome++)
+	{
+		const TerrainNoiseLayers::Sources& sources = baker.m_LayerSources[biome];
+		const char* names[3] = { "continent", "mountains", "ridges" };
+		const int layers[3] = { sources.continent, sources.mountains, sources.ridges };
+		for (int layer = 0; layer < 3; layer++)
+		{
+			if (layers[layer] >= 0 && layers[layer] != biome)
+				printf("%-16s %s shared with %s\n", baker.m_AllBiomes[biome].name, names[layer], baker.m_AllBiomes[layers[layer]].name);
+		}
+
+		const TerrainNoiseKernel& kernel = baker.m_Kernels[biome];
+		if (kernel.GetSharedOctaveCount() > 0)
+		{
+			printf("%-16s %d of %d ridge octaves shared with the mountains\n", baker.m_AllBiomes[biome].name,
+				kernel.GetSharedOctaveCount(), kernel.GetRidges().octaves);
+		}
+	}
+
+	if (bandLimited)
+	{
+		// how much of each biome's noise is left out at this resolution, and in total for these settings
+		int evaluated = 0, octaves = 0;
+		for (int biome = 0; biome < baker.m_Rules.biomeCount; biome++)
+		{
+			const TerrainNoiseSettings& settings = baker.m_GenerationSettings[biome];
+			const int biomeEvaluated = TerrainNoiseCPU::OctaveCount(settings, baker.GetSampleSpacing());
+			const int biomeOctaves = TerrainNoiseCPU::OctaveCount(settings, 0.0f);
+			printf("%-16s %2d of %2d octaves\n", baker.m_AllBiomes[biome].name, biomeEvaluated, biomeOctaves);
+			evaluated += biomeEvaluated;
+			octaves += biomeOctaves;
+		}
+		printf("%s: %d of %d octaves at %d pixels per tile (%.0f%% fewer)\n", positional[0].c_str(), evaluated, octaves, resolution,
+			octaves > 0 ? 100.0 * (octaves - evaluated) / octaves : 0.0);
+	}
+
+	if (continentError > 0.0f && !fixedPoint)
+	{
+		for (int biome = 0; biome < baker.m_Rules.biomeCount; biome++)
+		{
+			int octaves;
+			const int step = baker.ChooseLatticeStep(baker.m_GenerationSettings[biome], octaves);
+			printf("%-16s %2d of %2d continent octaves from a lattice every %d texels\n", baker.m_AllBiomes[biome].name,
+				octaves, baker.m_GenerationSettings[biome].ContinentSettings.Octaves, step);
+		}
+	}
+
+	// report at most twice a second
+	double lastReport = 0.0;
+	bool baked = baker.Bake(tileRange[0], tileRange[1], tileRange[2], tileRange[3], positional[1], threadCount, [&](const Progress& progress)
+	{
+		if (progress.tilesDone < progress.tileCount && progress.seconds - lastReport < 0.5) return;
+		lastReport = progress.seconds;
+		printf("%d / %d tiles (%.2f tiles per second)\n", progress.tilesDone, progress.tileCount, progress.tilesDone / progress.seconds);
+		fflush(stdout);
+	}, error);
+
+	if (!baked)
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	printf("baked %d tiles of %dx%d in %.2fs (%.2f tiles per second)\n",
+		baker.m_LastTileCount, baker.GetResolution(), baker.GetResolution(), baker.GetLastSeconds(), baker.GetTilesPerSecond());
+
+	const TerrainNoiseLayers::Evaluations& evaluations = baker.GetLastLayerEvaluations();
+	if (evaluations.unshared > 0)
+	{
+		printf("GPU layer evaluations: %lld, %lld without sharing layers between biomes (%.1f%% saved)\n", evaluations.shared, evaluations.unshared,
+			100.0 * (evaluations.unshared - evaluations.shared) / evaluations.unshared);
+	}
+	return 0;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "BiomeRules.h"
+#include "BiomeCatalog.h"
+#include "BiomeMapBuffer.h"
+#include "BiomePipeline.h"
+#include "ContinentLattice.h"
+#include "NoiseGraph.h"
+#include "NoiseSettings.h"
+#include "TerrainNoiseBounds.h"
+#include "TerrainNoiseCPU.h"
+#include "TerrainNoiseFixed.h"
+#include "TerrainNoiseLayers.h"
+
+
+// Generates heightmap tiles on the CPU, without a window or D3D device, and writes them to disk
+// Loads the same settings files as App1, and produces the same heights that terrainNoise_cs.hlsl would
+// for a tile (to within TerrainNoiseCPU::NoiseTolerance)
+//
+// Tiles are written as raw 32-bit floats, row-major, resolution * resolution heights per tile,
+// to <directory>/tile_<x>_<y>.r32
+class HeightmapBaker
+{
+public:
+	struct Progress
+	{
+		int tilesDone = 0;
+		int tileCount = 0;
+		double seconds = 0.0;
+	};
+
+	HeightmapBaker();
+	~HeightmapBaker() = default;
+
+	// settings are loaded from a whole settings file, as saved by App1
+	// returns false if the file describes an invalid biome pipeline or noise graph
+	bool LoadFromJson(const nlohmann::json& data, std::string& error);
+
+	// generates the biome map covering the tiles [minTile, maxTile]; must be called before generating those tiles
+	void BuildBiomeMap(int minTileX, int minTileY, int maxTileX, int maxTileY, unsigned int threadCount);
+
+	// working memory for generating a tile
+	// workers generating tiles concurrently must each use their own
+	struct Scratch
+	{
+		// the biomes blended at each pixel, and their blend weights
+		std::vector<int> biomes;
+		std::vector<float> weights;
+		// the biome map cell and blend weight of each column of the tile, and each row of a band
+		std::vector<int> columnCells;
+		std::vector<float> columnBlends;
+		std::vector<int> rowCells;
+		std::vector<float> rowBlends;
+
+		// points grouped by biome so that each biome's noise is evaluated in one batch
+		std::vector<int> biomeStart;
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> heights;
+		// which point holds the height of each of a pixel's biomes
+		std::vector<int> points;
+
+		// each biome's coarse continent octaves over the tile, built when the biome is first needed, and their value at each point
+		std::vector<ContinentLattice> lattices;
+		std::vector<char> latticeBuilt;
+		std::vector<float> continentBase;
+		// the texel of each point
+		std::vector<int> columns;
+		std::vector<int> rows;
+
+		// layer evaluations terrainNoise_cs.hlsl makes for the tiles generated, with and without sharing layers between biomes
+		TerrainNoiseLayers::Evaluations evaluations;
+	};
+
+	// heights must have room for resolution * resolution floats
+	void GenerateTile(int tileX, int tileY, float* heights, Scratch& scratch) const;
+
+	// conservative bounds on the heights of a tile, without generating it; e.g. a tile entirely under water has a max below 0
+	// the biome map must cover the tile
+	TerrainNoiseBounds::Interval GetTileBounds(int tileX, int tileY) const;
+
+	// generates every tile in [minTile, maxTile] and writes them into directory, which must already exist
+	// onProgress is called from one thread at a time after each tile is written
+	bool Bake(int minTileX, int minTileY, int maxTileX, int maxTileY, const std::string& directory, unsigned int threadCount,
+		const std::function<void(const Progress&)>& onProgress, std::string& error);
+
+	void SetResolution(int resolution);
+	inline int GetResolution() const { return m_Resolution; }
+
+	// band limited tiles leave out octaves too fine for the tile's resolution (see TerrainNoiseCPU::OctaveWeight)
+	// they are cheaper to generate, most of all at low resolutions, but no longer match the GPU
+	void SetBandLimited(bool bandLimited);
+	inline bool IsBandLimited() const { return m_BandLimited; }
+	// world distance between the pixels of a tile if band limited, otherwise 0
+	inline float GetSampleSpacing() const { return m_BandLimited ? 1.0f / static_cast<float>(m_Resolution - 1) : 0.0f; }
+
+	// coarse continent octaves are reconstructed from a lattice over each tile (see ContinentLattice) rather than evaluated at
+	// every pixel, as far as that moves no height by more than maxError; 0 evaluates every octave at every pixel
+	inline void SetContinentError(float maxError) { m_ContinentError = maxError > 0.0f ? maxError : 0.0f; }
+	inline float GetContinentError() const { return m_ContinentError; }
+
+	// fixed point tiles are generated with TerrainNoiseFixed, and blended in fixed point, so every machine and build bakes
+	// the same bits; they differ from the GPU's by up to TerrainNoiseFixed::FloatTolerance
+	// biomes with a noise graph are still evaluated in float, and the continent lattice isn't used
+	void SetFixedPoint(bool fixedPoint);
+	inline bool IsFixedPoint() const { return m_FixedPoint; }
+
+	inline const BiomeRules& GetRules() const { return m_Rules; }
+	inline double GetLastSeconds() const { return m_LastSeconds; }
+	inline double GetTilesPerSecond() const { return m_LastSeconds > 0.0 ? m_LastTileCount / m_LastSeconds : 0.0; }
+	// layer evaluations the GPU makes for the last tiles baked (see TerrainNoiseLayers)
+	inline const TerrainNoiseLayers::Evaluations& GetLastLayerEvaluations() const { return m_LastEvaluations; }
+
+	// entry point for the command line tools:
+	//	<settings.json> <output directory> <min tile x> <min tile y> <max tile x> <max tile y> [threads] [resolution]
+	//	[--band-limit] [--continent-error <height>] [--fixed-point]
+	static int RunCommandLine(const std::vector<std::string>& args);
+
+private:
+	// biome at a cell of the world; cells outside the biome map are biome 0, as texture loads out of bounds return 0
+	BiomeCell GetBiome(int x, int y) const;
+
+	// which biomes a block of pixels blends between: only the one biome of the cell it lies in (most blocks, away from
+	// biome borders), the biomes either side along one axis, or all four around a corner
+	enum class BlockBlend
+	{
+		Single,
+		BlendX,
+		BlendY,
+		FourWay
+	};
+	// classifies the block of pixels spanning the given columns and rows, from the cell and blend weight of each
+	static BlockBlend ClassifyBlock(const int* columnCells, const float* columnBlends, int columns,
+		const int* rowCells, const float* rowBlends, int rows);
+
+	// prepares each biome's noise kernel and graph for its settings and the sample spacing; called whenever either changes
+	void UpdateKernels();
+
+	// lattice spacing (in texels) that saves the most work for a biome's continent, and how many octaves it reconstructs
+	int ChooseLatticeStep(const TerrainNoiseSettings& settings, int& octaves) const;
+	// builds the lattice a biome's continent octaves are reconstructed from over a tile
+	void BuildContinentLattice(int tileX, int tileY, const TerrainNoiseSettings& settings, ContinentLattice& lattice) const;
+
+private:
+	std::vector<BiomeCatalog::Biome> m_AllBiomes;
+	BiomeCatalog::SpawnLists m_SpawnableLandBiomesByTemp;
+	BiomeCatalog::SpawnLists m_SpawnableOceanBiomesByTemp;
+
+	BiomeRules m_Rules;
+	BiomePipeline m_Pipeline = BiomePipeline::Default();
+	TerrainNoiseSettings m_GenerationSettings[MAX_BIOMES];
+	// a kernel for each biome's settings
+	std::vector<TerrainNoiseKernel> m_Kernels;
+	std::vector<TerrainNoiseFixed> m_FixedKernels;
+	// biomes with a noise graph evaluate it in place of their fixed layers
+	NoiseGraph m_Graphs[MAX_BIOMES];
+	std::vector<NoiseProgram> m_Programs;
+	TerrainNoiseLayers::Sources m_LayerSources[MAX_BIOMES];
+
+	bool m_UnboundedWorld = false;
+	float m_BiomeMapPxPerTile = 8.0f;
+	float m_BiomeBlending = 0.5f;
+
+	// the biome map, as BiomeGenerator would upload it
+	std::vector<BiomeCell> m_BiomeMap;
+	int m_BiomeMapWidth = 0;
+	int m_BiomeMapHeight = 0;
+	int m_BiomeMapOriginX = 0;
+	int m_BiomeMapOriginY = 0;
+	int m_BiomeMapResolution = 0;
+
+	// size of the heightmaps in App1
+	int m_Resolution = 1024;
+	bool m_BandLimited = false;
+	float m_ContinentError = 0.0f;
+	bool m_FixedPoint = false;
+
+	int m_LastTileCount = 0;
+	double m_LastSeconds = 0.0;
+	TerrainNoiseLayers::Evaluations m_LastEvaluations;
+};
@@ -1,21 +1,16 @@
 #include "HeightmapFilter.h"
 
 
-HeightmapFilter::HeightmapFilter(ID3D11Device* device, const wchar_t* cs)
+HeightmapFilter::HeightmapFilter(ID3D11Device* device, const wchar_t* cs, const wchar_t* classifyCS, const wchar_t* prefixCS, const wchar_t* scatterCS,
+	const wchar_t* sortedCS)
 {
 	HRESULT hr;
 
-	// load compute shader from file
-	ID3D10Blob* computeShaderBuffer;
-
-	// Reads compiled shader into buffer (bytecode).
-	hr = D3DReadFileToBlob(cs, &computeShaderBuffer);
-	assert(hr == S_OK && "Failed to load shader");
-
-	// Create the compute shader from the buffer.
-	hr = device->CreateComputeShader(computeShaderBuffer->GetBufferPointer(), computeShaderBuffer->GetBufferSize(), NULL, &m_ComputeShader);
-	assert(hr == S_OK);
-	computeShaderBuffer->Release();
+	m_ComputeShader = LoadComputeShader(device, cs);
+	m_ClassifyShader = LoadComputeShader(device, classifyCS);
+	m_PrefixShader = LoadComputeShader(device, prefixCS);
+	m_ScatterShader = LoadComputeShader(device, scatterCS);
+	m_SortedShader = LoadComputeShader(device, sortedCS);
 
 	// Setup description of heightmap settings constant buffer
 	D3D11_BUFFER_DESC bufferDesc;
@@ -33,14 +28,115 @@ HeightmapFilter::~HeightmapFilter()
 {
 	if (m_ComputeShader) m_ComputeShader->Release();
 	if (m_WorldBuffer) m_WorldBuffer->Release();
+
+	if (m_ClassifyShader) m_ClassifyShader->Release();
+	if (m_PrefixShader) m_PrefixShader->Release();
+	if (m_ScatterShader) m_ScatterShader->Release();
+	if (m_SortedShader) m_SortedShader->Release();
+
+	ReleaseSortBuffers();
+}
+
+ID3D11ComputeShader* HeightmapFilter::LoadComputeShader(ID3D11Device* device, const wchar_t* cs)
+{
+	HRESULT hr;
+
+	// load compute shader from file
+	ID3D10Blob* computeShaderBuffer;
+
+	// Reads compiled shader into buffer (bytecode).
+	hr = D3DReadFileToBlob(cs, &computeShaderBuffer);
+	assert(hr == S_OK && "Failed to load shader");
+
+	// Create the compute shader from the buffer.
+	ID3D11ComputeShader* computeShader = nullptr;
+	hr = device->CreateComputeShader(computeShaderBuffer->GetBufferPointer(), computeShaderBuffer->GetBufferSize(), NULL, &computeShader);
+	assert(hr == S_OK);
+	computeShaderBuffer->Release();
+
+	return computeShader;
+}
+
+void HeightmapFilter::CreateSortBuffers(ID3D11Device* device, unsigned int resolution)
+{
+	ReleaseSortBuffers();
+	m_SortResolution = resolution;
+	const unsigned int texelCount = resolution * resolution;
+
+	HRESULT hr;
+
+	// counts are accessed as raw bytes so they can be incremented atomically
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.ByteWidth = sizeof(UINT) * SignatureCount;
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	bufferDesc.StructureByteStride = 0;
+	hr = device->CreateBuffer(&bufferDesc, NULL, &m_SignatureCountsBuffer);
+	assert(hr == S_OK);
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+	uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.NumElements = SignatureCount;
+	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+	hr = device->CreateUnorderedAccessView(m_SignatureCountsBuffer, &uavDesc, &m_SignatureCountsUAV);
+	assert(hr == S_OK);
+
+	// a signature and a slot per texel
+	bufferDesc.ByteWidth = sizeof(UINT) * 2 * texelCount;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = sizeof(UINT) * 2;
+	hr = device->CreateBuffer(&bufferDesc, NULL, &m_TexelSignaturesBuffer);
+	assert(hr == S_OK);
+
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.Buffer.NumElements = texelCount;
+	uavDesc.Buffer.Flags = 0;
+	hr = device->CreateUnorderedAccessView(m_TexelSignaturesBuffer, &uavDesc, &m_TexelSignaturesUAV);
+	assert(hr == S_OK);
+
+	// a texel index per texel
+	bufferDesc.ByteWidth = sizeof(UINT) * texelCount;
+	bufferDesc.StructureByteStride = sizeof(UINT);
+	hr = device->CreateBuffer(&bufferDesc, NULL, &m_SortedTexelsBuffer);
+	assert(hr == S_OK);
+
+	hr = device->CreateUnorderedAccessView(m_SortedTexelsBuffer, &uavDesc, &m_SortedTexelsUAV);
+	assert(hr == S_OK);
+}
+
+void HeightmapFilter::ReleaseSortBuffers()
+{
+	if (m_SignatureCountsUAV) m_SignatureCountsUAV->Release();
+	if (m_SignatureCountsBuffer) m_SignatureCountsBuffer->Release();
+	if (m_TexelSignaturesUAV) m_TexelSignaturesUAV->Release();
+	if (m_TexelSignaturesBuffer) m_TexelSignaturesBuffer->Release();
+	if (m_SortedTexelsUAV) m_SortedTexelsUAV->Release();
+	if (m_SortedTexelsBuffer) m_SortedTexelsBuffer->Release();
+
+	m_SignatureCountsUAV = nullptr;
+	m_SignatureCountsBuffer = nullptr;
+	m_TexelSignaturesUAV = nullptr;
+	m_TexelSignaturesBuffer = nullptr;
+	m_SortedTexelsUAV = nullptr;
+	m_SortedTexelsBuffer = nullptr;
+	m_SortResolution = 0;
 }
 
 void HeightmapFilter::Run(ID3D11DeviceContext* deviceContext, Heightmap* heightmap, const BiomeGenerator* biomeGenerator)
 {
+	const unsigned int resolution = heightmap->GetResolution();
+
 	ID3D11UnorderedAccessView* uav = heightmap->GetUAV();
 	deviceContext->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
-	ID3D11ShaderResourceView* srvs[2] = { biomeGenerator->GetBiomeMapSRV(), biomeGenerator->GetGenerationSettingsSRV() };
-	deviceContext->CSSetShaderResources(0, 2, srvs);
+	// the heightmap's blend map must already be baked
+	const BiomeBlendMap* blendMap = heightmap->GetBlendMap();
+	ID3D11ShaderResourceView* srvs[4] = { biomeGenerator->GetBiomeMapSRV(), biomeGenerator->GetGenerationSettingsSRV(), biomeGenerator->GetLayerSourcesSRV(),
+		blendMap ? blendMap->GetSRV() : nullptr };
+	deviceContext->CSSetShaderResources(0, 4, srvs);
 
 	// update data in constant buffers
 	D3D11_MAPPED_SUBRESOURCE mappedResource;
@@ -48,24 +144,69 @@ void HeightmapFilter::Run(ID3D11DeviceContext* deviceContext, Heightmap* heightm
 	deviceContext->Map(m_WorldBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
 	WorldBufferType* dataPtr = reinterpret_cast<WorldBufferType*>(mappedResource.pData);
 	dataPtr->offset = heightmap->GetOffset();
+	dataPtr->resolution = resolution;
+	dataPtr->blendMapResolution = blendMap ? blendMap->GetResolution() : 0;
 	deviceContext->Unmap(m_WorldBuffer, 0);
 
 	ID3D11Buffer* cscbs[2] = { m_WorldBuffer, biomeGenerator->GetBiomeMappingBuffer() };
 	deviceContext->CSSetConstantBuffers(0, 2, cscbs);
 
-	deviceContext->CSSetShader(m_ComputeShader, nullptr, 0);
+	if (m_Sorted)
+	{
+		RunSorted(deviceContext, resolution);
+	}
+	else
+	{
+		deviceContext->CSSetShader(m_ComputeShader, nullptr, 0);
 
-	// assume thread groups consist of 16x16x1 threads
-	unsigned int groupCount = (heightmap->GetResolution() + 15) / 16; // (fast ceiling of integer division)
-	deviceContext->Dispatch(groupCount, groupCount, 1);
+		// assume thread groups consist of 16x16x1 threads
+		unsigned int groupCount = (resolution + 15) / 16; // (fast ceiling of integer division)
+		deviceContext->Dispatch(groupCount, groupCount, 1);
+	}
 
 	// clean up
 	deviceContext->CSSetShader(nullptr, nullptr, 0);
 
-	ID3D11UnorderedAccessView* nullUAV = nullptr;
-	deviceContext->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
-	ID3D11ShaderResourceView* nullSRVs[2] = { nullptr, nullptr };
-	deviceContext->CSSetShaderResources(0, 2, nullSRVs);
+	ID3D11UnorderedAccessView* nullUAVs[4] = { nullptr, nullptr, nullptr, nullptr };
+	deviceContext->CSSetUnorderedAccessViews(0, 4, nullUAVs, nullptr);
+	ID3D11ShaderResourceView* nullSRVs[4] = { nullptr, nullptr, nullptr, nullptr };
+	deviceContext->CSSetShaderResources(0, 4, nullSRVs);
 	ID3D11Buffer* nullCBs[3] = { nullptr, nullptr, nullptr };
 	deviceContext->CSSetConstantBuffers(0, 3, nullCBs);
 }
+
+void HeightmapFilter::RunSorted(ID3D11DeviceContext* deviceContext, unsigned int resolution)
+{
+	if (resolution != m_SortResolution)
+	{
+		ID3D11Device* device;
+		deviceContext->GetDevice(&device);
+		CreateSortBuffers(device, resolution);
+		device->Release();
+	}
+
+	const UINT zeros[4] = { 0, 0, 0, 0 };
+	deviceContext->ClearUnorderedAccessViewUint(m_SignatureCountsUAV, zeros);
+
+	// the heightmap stays bound to u0
+	ID3D11UnorderedAccessView* uavs[3] = { m_SignatureCountsUAV, m_TexelSignaturesUAV, m_SortedTexelsUAV };
+	deviceContext->CSSetUnorderedAccessViews(1, 3, uavs, nullptr);
+
+	// classify and sort texels by signature, then evaluate them in that order
+	// the sorting passes are cheap next to the noise, which is evaluated once per texel as before
+	unsigned int groupCount = (resolution + 15) / 16;
+	deviceContext->CSSetShader(m_ClassifyShader, nullptr, 0);
+	deviceContext->Dispatch(groupCount, groupCount, 1);
+
+	// a single group turns the counts into where each signature starts
+	deviceContext->CSSetShader(m_PrefixShader, nullptr, 0);
+	deviceContext->Dispatch(1, 1, 1);
+
+	// the last two passes have 256x1x1 threads per group, one per texel
+	unsigned int texelGroupCount = (resolution * resolution + 255) / 256;
+	deviceContext->CSSetShader(m_ScatterShader, nullptr, 0);
+	deviceContext->Dispatch(texelGroupCount, 1, 1);
+
+	deviceContext->CSSetShader(m_SortedShader, nullptr, 0);
+	deviceContext->Dispatch(texelGroupCount, 1, 1);
+}
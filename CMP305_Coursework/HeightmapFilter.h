@@ -16,16 +16,51 @@ class HeightmapFilter
 	struct WorldBufferType
 	{
 		XMFLOAT2 offset;
-		XMFLOAT2 padding;
+		UINT resolution;
+		UINT blendMapResolution;
 	};
 
 public:
-	HeightmapFilter(ID3D11Device* device, const wchar_t* cs);
+	// cs evaluates texels in place; classifyCS, prefixCS, scatterCS and sortedCS are the passes of sorted evaluation
+	HeightmapFilter(ID3D11Device* device, const wchar_t* cs, const wchar_t* classifyCS, const wchar_t* prefixCS, const wchar_t* scatterCS,
+		const wchar_t* sortedCS);
 	~HeightmapFilter();
 
 	void Run(ID3D11DeviceContext* deviceContext, Heightmap* heightmap, const BiomeGenerator* biomeGenerator);
 
+	// sorted evaluation groups the heightmap's texels by biome signature (the biome of an unblended texel, or a hash of
+	// the four biomes a blended texel blends, see terrainNoise.hlsli) before evaluating them, so neighbouring threads
+	// mostly evaluate the same layers with the same settings rather than diverging near biome borders; the heights are
+	// the same either way
+	inline void SetSorted(bool sorted) { m_Sorted = sorted; }
+	inline bool IsSorted() const { return m_Sorted; }
+
+private:
+	ID3D11ComputeShader* LoadComputeShader(ID3D11Device* device, const wchar_t* cs);
+	// (re)creates the buffers sorted evaluation needs for heightmaps of resolution x resolution texels
+	void CreateSortBuffers(ID3D11Device* device, unsigned int resolution);
+	void ReleaseSortBuffers();
+
+	void RunSorted(ID3D11DeviceContext* deviceContext, unsigned int resolution);
+
 protected:
 	ID3D11ComputeShader* m_ComputeShader = nullptr;
 	ID3D11Buffer* m_WorldBuffer = nullptr;
+
+	ID3D11ComputeShader* m_ClassifyShader = nullptr;
+	ID3D11ComputeShader* m_PrefixShader = nullptr;
+	ID3D11ComputeShader* m_ScatterShader = nullptr;
+	ID3D11ComputeShader* m_SortedShader = nullptr;
+
+	// must match SIGNATURE_COUNT in terrainNoise.hlsli
+	static const unsigned int SignatureCount = 4096;
+
+	bool m_Sorted = false;
+	unsigned int m_SortResolution = 0;
+	ID3D11Buffer* m_SignatureCountsBuffer = nullptr;
+	ID3D11UnorderedAccessView* m_SignatureCountsUAV = nullptr;
+	ID3D11Buffer* m_TexelSignaturesBuffer = nullptr;
+	ID3D11UnorderedAccessView* m_TexelSignaturesUAV = nullptr;
+	ID3D11Buffer* m_SortedTexelsBuffer = nullptr;
+	ID3D11UnorderedAccessView* m_SortedTexelsUAV = nullptr;
 };
@@ -2,9 +2,153 @@
 #include "System.h"
 #include "App1.h"
 #include <memory>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <shellapi.h>
+
+#include "BiomeGenerator.h"
+#include "BiomeSurvey.h"
+#include "HeightmapBaker.h"
+
+
+// report to the console that launched us, if there is one
+static void AttachParentConsole()
+{
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+	{
+		FILE* stream;
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+		freopen_s(&stream, "CONOUT$", "w", stderr);
+	}
+}
+
+// the command line split as the shell quoted it, without the program name, so paths may contain spaces
+static std::vector<std::string> GetCommandLineArgs()
+{
+	std::vector<std::string> args;
+
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (!argv) return args;
+
+	for (int i = 1; i < argc; i++)
+	{
+		// as UTF-8, which std::ifstream and fopen are given below
+		int length = WideCharToMultiByte(CP_UTF8, 0, argv[i], -1, nullptr, 0, nullptr, nullptr);
+		std::string arg(length > 0 ? length - 1 : 0, '\0');
+		if (length > 1)
+			WideCharToMultiByte(CP_UTF8, 0, argv[i], -1, &arg[0], length, nullptr, nullptr);
+		args.push_back(arg);
+	}
+	LocalFree(argv);
+	return args;
+}
+
+// parses the whole of arg as a number
+template<typename T>
+static bool ParseArg(const std::string& arg, T& value)
+{
+	std::istringstream stream(arg);
+	return (stream >> value) && stream.eof();
+}
+
+// Headless seed survey, run with:
+//	--survey <settings.json> <first seed> <seed count> <output.csv|output.json> [threads]
+// generates the biome map for every seed without creating a window or D3D device, and streams statistics to the output
+static int RunBiomeSurvey(const std::vector<std::string>& args)
+{
+	AttachParentConsole();
+
+	unsigned int firstSeed = 0;
+	int count = 0;
+	unsigned int threadCount = 0;
+	if (args.size() < 4 || args.size() > 5 || !ParseArg(args[1], firstSeed) || !ParseArg(args[2], count) || count <= 0
+		|| (args.size() == 5 && !ParseArg(args[4], threadCount)))
+	{
+		fprintf(stderr, "usage: --survey <settings.json> <first seed> <seed count> <output.csv|output.json> [threads]\n");
+		return 1;
+	}
+	const std::string& settingsPath = args[0];
+	const std::string& outputPath = args[3];
+
+	std::ifstream infile(settingsPath);
+	if (!infile)
+	{
+		fprintf(stderr, "could not open %s\n", settingsPath.c_str());
+		return 1;
+	}
+	nlohmann::json data;
+	try
+	{
+		infile >> data;
+	}
+	catch (const nlohmann::json::exception& e)
+	{
+		fprintf(stderr, "could not parse %s: %s\n", settingsPath.c_str(), e.what());
+		return 1;
+	}
+	infile.close();
+
+	// the same settings the app would load, without the GPU resources
+	BiomeGenerator generator(nullptr, 0);
+	if (data.contains("biomeGenerator")) generator.LoadFromJson(data["biomeGenerator"]);
+	generator.LoadPipelineFromJson(data.contains("biomePipeline") ? data["biomePipeline"] : nlohmann::json());
+	if (!generator.GetPipelineError().empty())
+	{
+		fprintf(stderr, "invalid biome pipeline: %s\n", generator.GetPipelineError().c_str());
+		return 1;
+	}
+
+	std::vector<std::string> biomeNames;
+	for (size_t i = 0; i < generator.GetBiomeCount(); i++)
+		biomeNames.push_back(generator.GetBiomeName(i));
+
+	std::ofstream outfile(outputPath);
+	if (!outfile)
+	{
+		fprintf(stderr, "could not open %s\n", outputPath.c_str());
+		return 1;
+	}
+	BiomeSurveyWriter writer(outfile, BiomeSurveyWriter::FormatFromPath(outputPath), biomeNames);
+
+	BiomeSurvey survey(generator.GetRules(), generator.GetPipeline());
+	int done = 0;
+	survey.Run(firstSeed, count, threadCount, [&](const BiomeSurvey::SeedStats& stats)
+	{
+		writer.Write(stats);
+		if (++done % 100 == 0)
+			printf("%d / %d seeds\n", done, count);
+	});
+	writer.Finish();
+
+	printf("surveyed %d seeds in %.2fs (%.1f seeds per second)\n", count, survey.GetLastSeconds(), survey.GetSeedsPerSecond());
+	return 0;
+}
+
+// Headless heightmap generation, run with:
+//	--bake <settings.json> <output directory> <min tile x> <min tile y> <max tile x> <max tile y> [threads] [resolution]
+// generates the tiles on the CPU and writes them to disk; tools/HeightmapBake.cpp is the same tool for other platforms
+static int RunHeightmapBake(const std::vector<std::string>& args)
+{
+	AttachParentConsole();
+	return HeightmapBaker::RunCommandLine(args);
+}
+
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline, int iCmdshow)
 {
+	std::vector<std::string> args = GetCommandLineArgs();
+	if (!args.empty())
+	{
+		const std::string mode = args[0];
+		args.erase(args.begin());
+		if (mode == "--survey") return RunBiomeSurvey(args);
+		if (mode == "--bake") return RunHeightmapBake(args);
+	}
+
 	App1* app = new App1();
 	std::unique_ptr<System> system = std::make_unique<System>(app, 2560, 1440, true, true);
 
@@ -12,4 +156,4 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline,
 	system->run();
 
 	return 0;
-}
\ No newline at end of file
+}
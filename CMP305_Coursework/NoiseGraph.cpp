@@ -0,0 +1,489 @@
+#include "NoiseGraph.h"
+
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+
+namespace
+{
+	// one entry per NOISE_NODE_TYPE, in the same order
+	// fractals share the layout of their first parameters, which simplex nodes share too
+	const NoiseNodeInfo NodeInfos[NOISE_NODE_COUNT] = {
+		// name, inputs, required inputs, parameters, defaults, commutative
+		{ "Constant", { nullptr, nullptr, nullptr }, 0, { "value" }, { 0.0f }, false },
+		{ "X", { nullptr, nullptr, nullptr }, 0, {}, {}, false },
+		{ "Y", { nullptr, nullptr, nullptr }, 0, {}, {}, false },
+		{ "Terrain", { nullptr, nullptr, nullptr }, 0, {}, {}, false },
+		{ "Simplex", { "warpX", "warpY", nullptr }, 0, { "frequency", "offsetX", "offsetY", "amplitude" }, { 1.0f, 0.0f, 0.0f, 1.0f }, false },
+
+		{ "Fbm", { "warpX", "warpY", nullptr }, 0,
+			{ "frequency", "offsetX", "offsetY", "amplitude", "octaves", "persistence", "lacunarity" },
+			{ 1.0f, 0.0f, 0.0f, 1.0f, 4.0f, 0.5f, 2.0f }, false },
+		{ "Ridged", { "warpX", "warpY", nullptr }, 0,
+			{ "frequency", "offsetX", "offsetY", "amplitude", "octaves", "persistence", "lacunarity", "power", "gain" },
+			{ 0.5f, 0.0f, 0.0f, 1.0f, 8.0f, 0.6f, 2.2f, 5.0f, 7.0f }, false },
+		{ "Mountains", { "warpX", "warpY", nullptr }, 0,
+			{ "frequency", "offsetX", "offsetY", "amplitude", "octaves", "persistence", "lacunarity", "blending", "detail" },
+			{ 0.5f, 0.0f, 0.0f, 1.0f, 8.0f, 0.5f, 2.1f, 0.15f, 0.1f }, false },
+
+		{ "Add", { "a", "b", nullptr }, 2, {}, {}, true },
+		{ "Subtract", { "a", "b", nullptr }, 2, {}, {}, false },
+		{ "Multiply", { "a", "b", nullptr }, 2, {}, {}, true },
+		{ "Min", { "a", "b", nullptr }, 2, {}, {}, false },
+		{ "Max", { "a", "b", nullptr }, 2, {}, {}, false },
+		{ "SmoothMax", { "a", "b", nullptr }, 2, { "smoothing" }, { 0.5f }, false },
+		{ "Lerp", { "a", "b", "t" }, 3, {}, {}, false },
+
+		{ "ScaleBias", { "input", nullptr, nullptr }, 1, { "scale", "bias" }, { 1.0f, 0.0f }, false },
+		{ "Abs", { "input", nullptr, nullptr }, 1, {}, {}, false },
+		{ "Clamp", { "input", nullptr, nullptr }, 1, { "min", "max" }, { 0.0f, 1.0f }, false },
+		{ "SmoothStep", { "input", nullptr, nullptr }, 1, { "edge0", "edge1" }, { 0.0f, 1.0f }, false },
+		{ "Pow", { "input", nullptr, nullptr }, 1, { "power" }, { 2.0f }, false },
+		{ "Terrace", { "input", nullptr, nullptr }, 1, { "steps", "sharpness" }, { 8.0f, 4.0f }, false }
+	};
+}
+
+
+const NoiseNodeInfo& NoiseGraph::GetInfo(NOISE_NODE_TYPE type)
+{
+	assert(type >= 0 && type < NOISE_NODE_COUNT && "Invalid noise node type");
+	return NodeInfos[type];
+}
+
+bool NoiseGraph::TypeFromName(const char* name, NOISE_NODE_TYPE& type)
+{
+	for (int i = 0; i < NOISE_NODE_COUNT; i++)
+	{
+		if (strcmp(NodeInfos[i].name, name) == 0)
+		{
+			type = static_cast<NOISE_NODE_TYPE>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+int NoiseGraph::FindNode(const std::string& name) const
+{
+	for (size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		if (!m_Nodes[i].name.empty() && m_Nodes[i].name == name)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+
+bool NoiseGraph::LoadFromJson(const nlohmann::json& data, std::string& error)
+{
+	NoiseGraph graph;
+
+	try
+	{
+		if (!data.contains("nodes") || !data["nodes"].is_array())
+		{
+			error = "Noise graph has no nodes array";
+			return false;
+		}
+
+		// declare every named node first, so inputs can refer to nodes further down
+		for (auto& desc : data["nodes"])
+		{
+			Node node;
+
+			std::string typeName = desc.value("type", "");
+			if (!TypeFromName(typeName.c_str(), node.type))
+			{
+				error = "Unknown noise node type '" + typeName + "'";
+				return false;
+			}
+
+			node.name = desc.value("name", "");
+			if (node.name.empty() || graph.FindNode(node.name) >= 0)
+			{
+				error = std::string(GetInfo(node.type).name) + " node needs a unique name";
+				return false;
+			}
+
+			const NoiseNodeInfo& info = GetInfo(node.type);
+			for (int i = 0; i < NOISE_NODE_MAX_PARAMS; i++)
+			{
+				if (!info.params[i]) continue;
+				node.params[i] = desc.contains(info.params[i]) ? desc[info.params[i]].get<float>() : info.defaults[i];
+			}
+
+			graph.m_Nodes.push_back(node);
+		}
+
+		// then connect them
+		const size_t namedNodes = graph.m_Nodes.size();
+		for (size_t n = 0; n < namedNodes; n++)
+		{
+			auto& desc = data["nodes"][n];
+			const NoiseNodeInfo& info = GetInfo(graph.m_Nodes[n].type);
+
+			for (int i = 0; i < NOISE_NODE_MAX_INPUTS; i++)
+			{
+				if (!info.inputs[i] || !desc.contains(info.inputs[i])) continue;
+
+				auto& input = desc[info.inputs[i]];
+				int index = -1;
+				if (input.is_number())
+				{
+					// numbers become constants of their own
+					Node constant;
+					constant.type = NOISE_NODE_CONSTANT;
+					constant.params[0] = input.get<float>();
+					index = static_cast<int>(graph.m_Nodes.size());
+					graph.m_Nodes.push_back(constant);
+				}
+				else
+				{
+					index = graph.FindNode(input.get<std::string>());
+					if (index < 0)
+					{
+						error = "Node '" + graph.m_Nodes[n].name + "' reads unknown node '" + input.get<std::string>() + "'";
+						return false;
+					}
+				}
+				graph.m_Nodes[n].inputs[i] = index;
+			}
+		}
+
+		if (!data.contains("output"))
+		{
+			error = "Noise graph has no output";
+			return false;
+		}
+		graph.m_Output = graph.FindNode(data["output"].get<std::string>());
+		if (graph.m_Output < 0)
+		{
+			error = "Noise graph output '" + data["output"].get<std::string>() + "' is not a node";
+			return false;
+		}
+	}
+	catch (const nlohmann::json::exception& e)
+	{
+		error = e.what();
+		return false;
+	}
+
+	if (!graph.Validate(error))
+		return false;
+
+	*this = graph;
+	return true;
+}
+
+nlohmann::json NoiseGraph::Serialize() const
+{
+	nlohmann::json serialized;
+	if (IsEmpty()) return serialized;
+
+	serialized["output"] = m_Nodes[m_Output].name;
+	serialized["nodes"] = nlohmann::json::array();
+
+	for (auto& node : m_Nodes)
+	{
+		// constants given inline are written inline again by the nodes reading them
+		if (node.name.empty()) continue;
+
+		const NoiseNodeInfo& info = GetInfo(node.type);
+
+		nlohmann::json desc;
+		desc["name"] = node.name;
+		desc["type"] = info.name;
+
+		for (int i = 0; i < NOISE_NODE_MAX_INPUTS; i++)
+		{
+			if (!info.inputs[i] || node.inputs[i] < 0) continue;
+
+			const Node& input = m_Nodes[node.inputs[i]];
+			if (input.name.empty())
+				desc[info.inputs[i]] = input.params[0];
+			else
+				desc[info.inputs[i]] = input.name;
+		}
+
+		for (int i = 0; i < NOISE_NODE_MAX_PARAMS; i++)
+		{
+			if (info.params[i])
+				desc[info.params[i]] = node.params[i];
+		}
+
+		serialized["nodes"].push_back(desc);
+	}
+
+	return serialized;
+}
+
+bool NoiseGraph::Validate(std::string& error) const
+{
+	for (auto& node : m_Nodes)
+	{
+		const NoiseNodeInfo& info = GetInfo(node.type);
+		for (int i = 0; i < info.requiredInputs; i++)
+		{
+			if (node.inputs[i] < 0)
+			{
+				error = std::string(info.name) + " node '" + node.name + "' has no " + info.inputs[i] + " input";
+				return false;
+			}
+		}
+	}
+
+	// depth first search from every node; a node reached again while still on the stack closes a cycle
+	enum { Unvisited, OnStack, Done };
+	std::vector<int> state(m_Nodes.size(), Unvisited);
+	std::vector<std::pair<int, int>> stack;
+
+	for (size_t root = 0; root < m_Nodes.size(); root++)
+	{
+		if (state[root] != Unvisited) continue;
+
+		stack.push_back({ static_cast<int>(root), 0 });
+		state[root] = OnStack;
+		while (!stack.empty())
+		{
+			const int node = stack.back().first;
+			const int input = stack.back().second++;
+			if (input == NOISE_NODE_MAX_INPUTS)
+			{
+				state[node] = Done;
+				stack.pop_back();
+				continue;
+			}
+
+			const int next = m_Nodes[node].inputs[input];
+			if (next < 0 || state[next] == Done) continue;
+			if (state[next] == OnStack)
+			{
+				error = "Node '" + m_Nodes[node].name + "' depends on itself";
+				return false;
+			}
+			state[next] = OnStack;
+			stack.push_back({ next, 0 });
+		}
+	}
+
+	return true;
+}
+
+
+// COMPILATION
+
+// the settings of a kernel evaluating a fractal as one of TerrainNoise's layers
+static TerrainNoiseSettings FractalSettings(const NoiseInstruction& instruction)
+{
+	const float* p = instruction.params;
+	const int octaves = static_cast<int>(p[4]);
+
+	TerrainNoiseSettings settings;
+	switch (instruction.type)
+	{
+	case NOISE_NODE_FBM:
+		settings.ContinentSettings.Elevation = p[3];
+		settings.ContinentSettings.Frequency = p[0];
+		settings.ContinentSettings.VerticalShift = 0.0f;
+		settings.ContinentSettings.Octaves = octaves;
+		settings.ContinentSettings.Offset = { p[1], p[2] };
+		settings.ContinentSettings.Persistence = p[5];
+		settings.ContinentSettings.Lacunarity = p[6];
+		break;
+
+	case NOISE_NODE_RIDGED:
+		settings.RidgeSettings.Elevation = p[3];
+		settings.RidgeSettings.Frequency = p[0];
+		settings.RidgeSettings.Octaves = octaves;
+		settings.RidgeSettings.Offset = { p[1], p[2] };
+		settings.RidgeSettings.Persistence = p[5];
+		settings.RidgeSettings.Lacunarity = p[6];
+		settings.RidgeSettings.Power = p[7];
+		settings.RidgeSettings.Gain = p[8];
+		break;
+
+	case NOISE_NODE_MOUNTAINS:
+		settings.MountainSettings.Elevation = p[3];
+		settings.MountainSettings.Frequency = p[0];
+		settings.MountainSettings.Octaves = octaves;
+		settings.MountainSettings.Offset = { p[1], p[2] };
+		settings.MountainSettings.Persistence = p[5];
+		settings.MountainSettings.Lacunarity = p[6];
+		settings.MountainSettings.Blending = p[7];
+		settings.MountainSettings.Detail = p[8];
+		break;
+
+	default:
+		assert(false && "Not a fractal");
+	}
+
+	return settings;
+}
+
+namespace
+{
+	// value numbering of a graph's nodes: each node becomes the instruction computing it, which is shared by every node
+	// computing the same thing
+	struct ProgramBuilder
+	{
+		const NoiseGraph& graph;
+		std::vector<NoiseInstruction>& instructions;
+
+		// instruction computing each node, or -1 before the node is reached
+		std::vector<int> values;
+		// instructions by their type, inputs and parameters
+		std::map<std::vector<uint32_t>, int> known;
+
+		int nodes = 0;
+		int shared = 0;
+
+		ProgramBuilder(const NoiseGraph& graph, std::vector<NoiseInstruction>& instructions)
+			: graph(graph), instructions(instructions), values(graph.GetNodes().size(), -1)
+		{}
+
+		// the instruction computing a node, emitted after those computing its inputs
+		int Emit(int n)
+		{
+			if (values[n] >= 0) return values[n];
+
+			const NoiseGraph::Node& node = graph.GetNodes()[n];
+			const NoiseNodeInfo& info = NoiseGraph::GetInfo(node.type);
+
+			NoiseInstruction instruction;
+			instruction.type = node.type;
+			for (int i = 0; i < NOISE_NODE_MAX_INPUTS; i++)
+				instruction.inputs[i] = node.inputs[i] >= 0 ? Emit(node.inputs[i]) : -1;
+			for (int i = 0; i < NOISE_NODE_MAX_PARAMS; i++)
+				instruction.params[i] = info.params[i] ? node.params[i] : 0.0f;
+
+			// simplex noise is a single octave of fbm
+			if (instruction.type == NOISE_NODE_SIMPLEX)
+			{
+				const NoiseNodeInfo& fbm = NoiseGraph::GetInfo(NOISE_NODE_FBM);
+				instruction.type = NOISE_NODE_FBM;
+				instruction.params[4] = 1.0f;
+				instruction.params[5] = fbm.defaults[5];
+				instruction.params[6] = fbm.defaults[6];
+			}
+			if (instruction.type == NOISE_NODE_FBM || instruction.type == NOISE_NODE_RIDGED || instruction.type == NOISE_NODE_MOUNTAINS)
+				instruction.params[4] = floorf(instruction.params[4]);
+
+			// a + b and b + a are the same instruction
+			if (info.commutative && instruction.inputs[1] < instruction.inputs[0])
+				std::swap(instruction.inputs[0], instruction.inputs[1]);
+
+			std::vector<uint32_t> key;
+			key.push_back(static_cast<uint32_t>(instruction.type));
+			for (int i = 0; i < NOISE_NODE_MAX_INPUTS; i++)
+				key.push_back(static_cast<uint32_t>(instruction.inputs[i]));
+			for (int i = 0; i < NOISE_NODE_MAX_PARAMS; i++)
+			{
+				uint32_t bits;
+				memcpy(&bits, &instruction.params[i], sizeof(bits));
+				key.push_back(bits);
+			}
+
+			nodes++;
+			auto found = known.find(key);
+			if (found != known.end())
+			{
+				shared++;
+				values[n] = found->second;
+				return found->second;
+			}
+
+			values[n] = static_cast<int>(instructions.size());
+			known[key] = values[n];
+			instructions.push_back(instruction);
+			return values[n];
+		}
+	};
+}
+
+void NoiseProgram::Compile(const NoiseGraph& graph, const TerrainNoiseSettings& terrain, float sampleSpacing)
+{
+	m_Instructions.clear();
+	m_Kernels.clear();
+	m_RegisterCount = 0;
+	m_OutputRegister = -1;
+	m_SampleSpacing = sampleSpacing;
+	m_NodeCount = 0;
+	m_SharedCount = 0;
+
+	if (graph.IsEmpty()) return;
+
+	// instructions in the order they run, reading each other's results by index
+	ProgramBuilder builder(graph, m_Instructions);
+	const int output = builder.Emit(graph.GetOutput());
+	m_NodeCount = builder.nodes;
+	m_SharedCount = builder.shared;
+
+	const int count = static_cast<int>(m_Instructions.size());
+	for (auto& instruction : m_Instructions)
+	{
+		switch (instruction.type)
+		{
+		case NOISE_NODE_TERRAIN:
+			instruction.kernel = static_cast<int>(m_Kernels.size());
+			m_Kernels.emplace_back(terrain, sampleSpacing);
+			break;
+		case NOISE_NODE_FBM:
+		case NOISE_NODE_RIDGED:
+		case NOISE_NODE_MOUNTAINS:
+			instruction.kernel = static_cast<int>(m_Kernels.size());
+			m_Kernels.emplace_back(FractalSettings(instruction), sampleSpacing);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// the last instruction reading each result; the output is read after them all
+	std::vector<int> lastUse(count, -1);
+	for (int i = 0; i < count; i++)
+	{
+		for (int input : m_Instructions[i].inputs)
+		{
+			if (input >= 0) lastUse[input] = i;
+		}
+	}
+	lastUse[output] = INT_MAX;
+
+	// allocate registers in order, reusing those whose value has been read for the last time
+	// an instruction may write the register of an input it reads last, as every input is read before the output is written
+	std::vector<int> registers(count, -1);
+	std::vector<int> available;
+	for (int i = 0; i < count; i++)
+	{
+		NoiseInstruction& instruction = m_Instructions[i];
+		for (int& input : instruction.inputs)
+		{
+			if (input < 0) continue;
+
+			const int value = input;
+			input = registers[value];
+			if (lastUse[value] == i)
+			{
+				// only free a register once, even if it is read by several inputs
+				lastUse[value] = -1;
+				available.push_back(input);
+			}
+		}
+
+		if (available.empty())
+		{
+			registers[i] = m_RegisterCount++;
+		}
+		else
+		{
+			registers[i] = available.back();
+			available.pop_back();
+		}
+		instruction.out = registers[i];
+	}
+
+	m_OutputRegister = registers[output];
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "NoiseSettings.h"
+#include "TerrainNoiseCPU.h"
+
+
+enum NOISE_NODE_TYPE : int
+{
+	// sources
+	NOISE_NODE_CONSTANT = 0,
+	NOISE_NODE_X,
+	NOISE_NODE_Y,
+	// the biome's own TerrainNoise, from its fixed layers
+	NOISE_NODE_TERRAIN,
+	NOISE_NODE_SIMPLEX,
+
+	// fractals
+	NOISE_NODE_FBM,
+	NOISE_NODE_RIDGED,
+	NOISE_NODE_MOUNTAINS,
+
+	// combiners
+	NOISE_NODE_ADD,
+	NOISE_NODE_SUBTRACT,
+	NOISE_NODE_MULTIPLY,
+	NOISE_NODE_MIN,
+	NOISE_NODE_MAX,
+	NOISE_NODE_SMOOTH_MAX,
+	NOISE_NODE_LERP,
+
+	// remaps
+	NOISE_NODE_SCALE_BIAS,
+	NOISE_NODE_ABS,
+	NOISE_NODE_CLAMP,
+	NOISE_NODE_SMOOTH_STEP,
+	NOISE_NODE_POW,
+	NOISE_NODE_TERRACE,
+
+	NOISE_NODE_COUNT
+};
+
+#define NOISE_NODE_MAX_INPUTS 3
+#define NOISE_NODE_MAX_PARAMS 9
+
+// Static description of each type of node, used to build nodes from data
+struct NoiseNodeInfo
+{
+	const char* name;
+	// names of the inputs, or nullptr for unused slots
+	const char* inputs[NOISE_NODE_MAX_INPUTS];
+	// the first requiredInputs inputs must be connected; the others (e.g. domain warps) default to 0
+	int requiredInputs;
+	// names of the parameters and their defaults, or nullptr for unused slots
+	const char* params[NOISE_NODE_MAX_PARAMS];
+	float defaults[NOISE_NODE_MAX_PARAMS];
+	// the first two inputs can be swapped without changing the result
+	bool commutative;
+};
+
+
+// A graph of noise nodes, as declared in a biome's settings JSON under "noiseGraph":
+//	{ "nodes": [ { "name": "warp", "type": "Fbm", "frequency": 4.0, "amplitude": 0.05 },
+//	             { "name": "hills", "type": "Ridged", "warpX": "warp", "warpY": "warp" },
+//	             { "name": "out", "type": "Terrace", "input": "hills", "steps": 6 } ],
+//	  "output": "out" }
+// Inputs name another node, or give a number for a constant; a node may be used by any number of others
+// Graphs are evaluated on the CPU (see NoiseProgram), in place of the biome's fixed layers; the terrain node brings those back in
+// The compute shaders still only evaluate the fixed layers, so graphs apply to baked heightmaps
+class NoiseGraph
+{
+public:
+	struct Node
+	{
+		NOISE_NODE_TYPE type = NOISE_NODE_CONSTANT;
+		// constants given inline have no name
+		std::string name;
+		// indices of the nodes connected to each input, or -1
+		int inputs[NOISE_NODE_MAX_INPUTS] = { -1, -1, -1 };
+		float params[NOISE_NODE_MAX_PARAMS] = {};
+	};
+
+	// replaces the graph only if the description is valid; otherwise error describes the problem
+	bool LoadFromJson(const nlohmann::json& data, std::string& error);
+	nlohmann::json Serialize() const;
+
+	// an empty graph leaves the biome to its fixed layers
+	inline bool IsEmpty() const { return m_Output < 0; }
+	inline void Clear() { m_Nodes.clear(); m_Output = -1; }
+
+	inline const std::vector<Node>& GetNodes() const { return m_Nodes; }
+	inline int GetOutput() const { return m_Output; }
+
+	static const NoiseNodeInfo& GetInfo(NOISE_NODE_TYPE type);
+	static bool TypeFromName(const char* name, NOISE_NODE_TYPE& type);
+
+private:
+	// checks every required input is connected and the graph has no cycles
+	bool Validate(std::string& error) const;
+
+	int FindNode(const std::string& name) const;
+
+private:
+	std::vector<Node> m_Nodes;
+	int m_Output = -1;
+};
+
+
+// One step of a compiled noise graph: a node applied to whole registers, each holding a value for every point of a batch
+struct NoiseInstruction
+{
+	// simplex nodes are compiled as single octave fbm
+	NOISE_NODE_TYPE type = NOISE_NODE_CONSTANT;
+	int out = -1;
+	// registers read by each input, or -1 for unconnected inputs
+	int inputs[NOISE_NODE_MAX_INPUTS] = { -1, -1, -1 };
+	float params[NOISE_NODE_MAX_PARAMS] = {};
+	// fractals and terrain: the kernel evaluating them (see NoiseProgram::GetKernels)
+	int kernel = -1;
+};
+
+// A noise graph compiled into a flat stream of instructions, run over batches of points by TerrainNoiseCPU::GraphNoise
+// Only nodes the output depends on are compiled, and nodes computing the same thing (the same type and parameters,
+// from the same inputs) are compiled once and shared; registers are reused as soon as their value is last read
+// Fractals are evaluated by TerrainNoiseKernel layer passes, so are band limited to the sample spacing as TerrainNoise is
+class NoiseProgram
+{
+public:
+	// terrain is the biome's settings, evaluated by terrain nodes
+	void Compile(const NoiseGraph& graph, const TerrainNoiseSettings& terrain, float sampleSpacing = 0.0f);
+
+	inline bool IsEmpty() const { return m_Instructions.empty(); }
+	inline const std::vector<NoiseInstruction>& GetInstructions() const { return m_Instructions; }
+	inline const std::vector<TerrainNoiseKernel>& GetKernels() const { return m_Kernels; }
+	inline int GetRegisterCount() const { return m_RegisterCount; }
+	inline int GetOutputRegister() const { return m_OutputRegister; }
+	inline float GetSampleSpacing() const { return m_SampleSpacing; }
+
+	// nodes of the graph that were compiled, and how many of them were shared with others rather than compiled again
+	inline int GetNodeCount() const { return m_NodeCount; }
+	inline int GetSharedCount() const { return m_SharedCount; }
+
+private:
+	std::vector<NoiseInstruction> m_Instructions;
+	std::vector<TerrainNoiseKernel> m_Kernels;
+	int m_RegisterCount = 0;
+	int m_OutputRegister = -1;
+	float m_SampleSpacing = 0.0f;
+
+	int m_NodeCount = 0;
+	int m_SharedCount = 0;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class Parallel
+{
+public:
+	// pure static class
+	Parallel() = delete;
+
+	// number of threads to use when 0 (automatic) is requested
+	static inline unsigned int ResolveThreadCount(unsigned int threadCount)
+	{
+		if (threadCount > 0) return threadCount;
+		unsigned int hw = std::thread::hardware_concurrency();
+		return hw > 0 ? hw : 1;
+	}
+
+	// number of workers that For and ForWorkers will use for a range of count items
+	static inline int WorkerCount(int count, unsigned int threadCount, int minRangeSize = 16)
+	{
+		if (count <= 0) return 0;
+
+		int threads = static_cast<int>(ResolveThreadCount(threadCount));
+		if (minRangeSize > 0 && count / minRangeSize < threads)
+			threads = count / minRangeSize;
+		return threads > 1 ? threads : 1;
+	}
+
+	// Splits [first, last) into contiguous ranges and calls func(begin, end) for each range on its own thread
+	// The calling thread processes the first range itself
+	// Ranges smaller than minRangeSize are not worth a thread, so small inputs run serially
+	template<typename Func>
+	static void For(int first, int last, unsigned int threadCount, Func func, int minRangeSize = 16)
+	{
+		ForWorkers(first, last, threadCount, [&func](int, int begin, int end) { func(begin, end); }, minRangeSize);
+	}
+
+	// As For, but func(worker, begin, end) is also given the index [0, WorkerCount) of the worker running the range
+	// so that each worker can use its own scratch memory
+	template<typename Func>
+	static void ForWorkers(int first, int last, unsigned int threadCount, Func func, int minRangeSize = 16)
+	{
+		int count = last - first;
+		int threads = WorkerCount(count, threadCount, minRangeSize);
+		if (threads == 0) return;
+
+		if (threads == 1)
+		{
+			func(0, first, last);
+			return;
+		}
+
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+
+		int rangeSize = count / threads;
+		int remainder = count % threads;
+
+		int begin = first + rangeSize + (remainder > 0 ? 1 : 0);
+		for (int t = 1; t < threads; t++)
+		{
+			int end = begin + rangeSize + (t < remainder ? 1 : 0);
+			workers.emplace_back(std::ref(func), t, begin, end);
+			begin = end;
+		}
+
+		func(0, first, first + rangeSize + (remainder > 0 ? 1 : 0));
+
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	// Calls func(worker, item) for every item in [first, last), where items are large and may vary in cost
+	// Each worker starts on its own contiguous share of the items; a worker that runs out steals the back half
+	// of the largest share that remains, so slow items don't leave the other threads idle at the end
+	template<typename Func>
+	static void ForEachStealing(int first, int last, unsigned int threadCount, Func func)
+	{
+		int count = last - first;
+		int threads = WorkerCount(count, threadCount, 1);
+		if (threads == 0) return;
+
+		if (threads == 1)
+		{
+			for (int item = first; item < last; item++)
+				func(0, item);
+			return;
+		}
+
+		struct Share
+		{
+			std::mutex mutex;
+			int begin = 0;
+			int end = 0;
+		};
+		std::vector<Share> shares(threads);
+
+		int rangeSize = count / threads;
+		int remainder = count % threads;
+		int begin = first;
+		for (int t = 0; t < threads; t++)
+		{
+			shares[t].begin = begin;
+			shares[t].end = begin = begin + rangeSize + (t < remainder ? 1 : 0);
+		}
+
+		ForWorkers(0, threads, threads, [&](int worker, int, int)
+		{
+			Share& own = shares[worker];
+			while (true)
+			{
+				int item = last;
+				{
+					std::lock_guard<std::mutex> lock(own.mutex);
+					if (own.begin < own.end) item = own.begin++;
+				}
+
+				if (item == last)
+				{
+					// out of work: find the share with the most left
+					int victim = -1;
+					int most = 0;
+					for (int t = 0; t < threads; t++)
+					{
+						std::lock_guard<std::mutex> lock(shares[t].mutex);
+						if (shares[t].end - shares[t].begin > most)
+						{
+							most = shares[t].end - shares[t].begin;
+							victim = t;
+						}
+					}
+					if (victim < 0) return;
+
+					int stolenBegin, stolenEnd;
+					{
+						std::lock_guard<std::mutex> lock(shares[victim].mutex);
+						stolenEnd = shares[victim].end;
+						stolenBegin = stolenEnd - (stolenEnd - shares[victim].begin + 1) / 2;
+						shares[victim].end = stolenBegin;
+					}
+					// someone else may have emptied it first
+					if (stolenBegin >= stolenEnd) continue;
+
+					item = stolenBegin;
+					std::lock_guard<std::mutex> lock(own.mutex);
+					own.begin = stolenBegin + 1;
+					own.end = stolenEnd;
+				}
+
+				func(worker, item);
+			}
+		}, 1);
+	}
+};
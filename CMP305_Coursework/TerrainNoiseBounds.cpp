@@ -0,0 +1,199 @@
+#include "TerrainNoiseBounds.h"
+
+#include <cmath>
+
+#include "TerrainNoiseCPU.h"
+
+
+typedef TerrainNoiseBounds::Interval Interval;
+
+const float TerrainNoiseBounds::NoiseRange = 1.0f;
+const float TerrainNoiseBounds::NoiseGradient = 8.0f;
+
+
+// D3D saturate, which takes NaN to 0
+static inline float Saturate(float x)
+{
+	x = x > 0.0f ? x : 0.0f;
+	return x < 1.0f ? x : 1.0f;
+}
+
+// smoothstep(0, edge, x)
+static inline float SmoothStep0(float edge, float x)
+{
+	float t = Saturate(x / edge);
+	return t * t * (3.0f - 2.0f * t);
+}
+
+
+// INTERVAL ARITHMETIC
+
+static inline Interval MakeInterval(float a, float b)
+{
+	Interval i;
+	i.min = a < b ? a : b;
+	i.max = a < b ? b : a;
+	return i;
+}
+
+static inline Interval Add(const Interval& a, const Interval& b)
+{
+	return { a.min + b.min, a.max + b.max };
+}
+
+static inline Interval Scale(const Interval& a, float s)
+{
+	return MakeInterval(a.min * s, a.max * s);
+}
+
+static inline Interval Multiply(const Interval& a, const Interval& b)
+{
+	Interval lo = MakeInterval(a.min * b.min, a.min * b.max);
+	Interval hi = MakeInterval(a.max * b.min, a.max * b.max);
+	return { lo.min < hi.min ? lo.min : hi.min, lo.max > hi.max ? lo.max : hi.max };
+}
+
+static inline Interval Abs(const Interval& a)
+{
+	if (a.min >= 0.0f) return a;
+	if (a.max <= 0.0f) return { -a.max, -a.min };
+	return { 0.0f, -a.min > a.max ? -a.min : a.max };
+}
+
+// image of a under a function that is monotonic (in either direction) over it
+template<typename Func>
+static inline Interval Monotonic(const Interval& a, Func func)
+{
+	return MakeInterval(func(a.min), func(a.max));
+}
+
+static inline float Magnitude(const Interval& a)
+{
+	return fabsf(a.min) > fabsf(a.max) ? fabsf(a.min) : fabsf(a.max);
+}
+
+
+Interval TerrainNoiseBounds::SNoise(float x, float y, float radius)
+{
+	// octaves that are fine enough to go through their whole range within the radius don't need sampling
+	float spread = NoiseGradient * radius;
+	if (spread >= 2.0f * NoiseRange)
+		return { -NoiseRange, NoiseRange };
+
+	float n = TerrainNoiseCPU::SNoise(x, y);
+	return { n - spread > -NoiseRange ? n - spread : -NoiseRange, n + spread < NoiseRange ? n + spread : NoiseRange };
+}
+
+Interval TerrainNoiseBounds::SimpleNoise(float x, float y, float radius, const SimpleNoiseSettings& settings, float sampleSpacing)
+{
+	Interval noiseSum;
+	float f = settings.Frequency;
+	float a = 1.0f;
+
+	for (int octave = 0; octave < settings.Octaves; octave++)
+	{
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		if (weight <= 0.0f && settings.Lacunarity >= 1.0f) break;
+
+		noiseSum = Add(noiseSum, Scale(SNoise(f * x + settings.Offset.x, f * y + settings.Offset.y, fabsf(f) * radius), a * weight));
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence;
+	}
+
+	noiseSum = Scale(noiseSum, settings.Elevation);
+	return { noiseSum.min + settings.VerticalShift, noiseSum.max + settings.VerticalShift };
+}
+
+Interval TerrainNoiseBounds::RidgeNoise(float x, float y, float radius, const RidgeNoiseSettings& settings, float sampleSpacing)
+{
+	Interval noiseSum;
+	float f = settings.Frequency;
+	float a = 1.0f;
+	Interval ridgeWeight{ 1.0f, 1.0f };
+
+	for (int octave = 0; octave < settings.Octaves; octave++)
+	{
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		if (weight <= 0.0f && settings.Lacunarity >= 1.0f) break;
+
+		Interval noise = Abs(SNoise(f * x + settings.Offset.x, f * y + settings.Offset.y, fabsf(f) * radius));
+		Interval noiseVal = Abs(Interval{ 1.0f - noise.max, 1.0f - noise.min });
+		noiseVal = Monotonic(noiseVal, [&](float n) { return powf(n, settings.Power); });
+		noiseVal = Multiply(noiseVal, ridgeWeight);
+		ridgeWeight = Monotonic(noiseVal, [&](float n) { return Saturate(n * settings.Gain); });
+
+		noiseSum = Add(noiseSum, Scale(noiseVal, a * weight));
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence;
+	}
+
+	return Scale(noiseSum, settings.Elevation);
+}
+
+Interval TerrainNoiseBounds::MountainNoise(float x, float y, float radius, const MountainNoiseSettings& settings, float sampleSpacing)
+{
+	Interval noiseSum;
+	float f = settings.Frequency;
+	Interval a{ 1.0f, 1.0f };
+
+	for (int octave = 0; octave < settings.Octaves; octave++)
+	{
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		if (weight <= 0.0f && settings.Lacunarity >= 1.0f) break;
+
+		Interval noiseVal1 = Abs(SNoise(f * x + settings.Offset.x, f * y + settings.Offset.y, fabsf(f) * radius));
+		// both of these only grow with noiseVal1
+		Interval noiseVal2 = Monotonic(noiseVal1, [&](float n) { return n * (1.0f - SmoothStep0(n, settings.Blending)); });
+		Interval persistence = Monotonic(noiseVal1, [&](float n) { return settings.Persistence * (1.0f - SmoothStep0(n, settings.Detail)); });
+
+		noiseSum = Add(noiseSum, Scale(Multiply(noiseVal2, a), weight));
+
+		f *= settings.Lacunarity;
+		a = Multiply(a, persistence);
+	}
+
+	return Scale(noiseSum, settings.Elevation);
+}
+
+Interval TerrainNoiseBounds::TerrainNoise(float minX, float minY, float maxX, float maxY, const TerrainNoiseSettings& settings, float sampleSpacing, float tolerance)
+{
+	// the rectangle is covered by the circle around its centre
+	float x = 0.5f * (minX + maxX);
+	float y = 0.5f * (minY + maxY);
+	float radius = 0.5f * sqrtf((maxX - minX) * (maxX - minX) + (maxY - minY) * (maxY - minY));
+
+	// create continent shape
+	Interval continentShape = SimpleNoise(x, y, radius, settings.ContinentSettings, sampleSpacing);
+
+	// create mountains
+	Interval mountainShape, ridgeShape;
+	if (settings.MountainSettings.Elevation > 0.0f)
+	{
+		mountainShape = MountainNoise(x, y, radius, settings.MountainSettings, sampleSpacing);
+	}
+	// create ridges
+	if (settings.RidgeSettings.Elevation > 0.0f)
+	{
+		ridgeShape = RidgeNoise(x, y, radius, settings.RidgeSettings, sampleSpacing);
+		ridgeShape = Multiply(ridgeShape, Monotonic(mountainShape, [&](float m) { return SmoothStep0(settings.RidgeSettings.RidgeThreshold, m); }));
+	}
+
+	// create ocean floor
+	// smooth max only grows with continentShape; the depth multiplier is linear either side of 0
+	continentShape = Monotonic(continentShape, [&](float c) { return TerrainNoiseCPU::SmoothMax(c, -settings.OceanFloorDepth, settings.OceanFloorSmoothing); });
+	auto deepen = [&](float c) { return c < 0 ? c * (1 + settings.OceanDepthMultiplier) : c; };
+	Interval deepened = MakeInterval(deepen(continentShape.min), deepen(continentShape.max));
+	if (continentShape.min < 0.0f && continentShape.max > 0.0f)
+	{
+		deepened.min = deepened.min < 0.0f ? deepened.min : 0.0f;
+		deepened.max = deepened.max > 0.0f ? deepened.max : 0.0f;
+	}
+
+	Interval height = Add(Add(deepened, mountainShape), ridgeShape);
+
+	// leave room for rounding, and for the vector and GPU implementations
+	tolerance *= (Magnitude(deepened) + Magnitude(mountainShape) + Magnitude(ridgeShape));
+	return { height.min - tolerance, height.max + tolerance };
+}
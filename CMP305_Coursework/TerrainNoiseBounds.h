@@ -0,0 +1,42 @@
+#pragma once
+
+#include "NoiseSettings.h"
+#include "TerrainNoiseCPU.h"
+
+
+// Conservative bounds on the terrain noise over a rectangle of the world, without generating it
+// Every layer is evaluated with interval arithmetic, at a cost of one noise sample per octave (or none, once octaves
+// are fine enough to take their full range over the rectangle) rather than one per point
+//
+// Each octave's noise is bounded by its value at the centre of the rectangle, plus the furthest it could have changed
+// by the edge given how steep simplex noise can be; the bounds also cover the differences between the CPU and GPU noise
+class TerrainNoiseBounds
+{
+public:
+	// pure static class
+	TerrainNoiseBounds() = delete;
+
+	struct Interval
+	{
+		float min = 0.0f;
+		float max = 0.0f;
+	};
+
+	// largest magnitude of SNoise (measured to be 0.9996)
+	static const float NoiseRange;
+	// largest rate of change of SNoise per unit distance (measured to be 7.4)
+	static const float NoiseGradient;
+
+	// bounds on SNoise within radius of (x, y)
+	static Interval SNoise(float x, float y, float radius);
+
+	// bounds on each layer within radius of (x, y)
+	static Interval SimpleNoise(float x, float y, float radius, const SimpleNoiseSettings& settings, float sampleSpacing = 0.0f);
+	static Interval RidgeNoise(float x, float y, float radius, const RidgeNoiseSettings& settings, float sampleSpacing = 0.0f);
+	static Interval MountainNoise(float x, float y, float radius, const MountainNoiseSettings& settings, float sampleSpacing = 0.0f);
+
+	// bounds on TerrainNoise over [minX, maxX] * [minY, maxY], band limited to the same sample spacing
+	// tolerance is how far the implementation bounded may be from the reference, per unit of noise
+	static Interval TerrainNoise(float minX, float minY, float maxX, float maxY, const TerrainNoiseSettings& settings, float sampleSpacing = 0.0f,
+		float tolerance = TerrainNoiseCPU::NoiseTolerance);
+};
@@ -0,0 +1,890 @@
+#include "TerrainNoiseCPU.h"
+
+#include <cmath>
+#include <vector>
+
+#include "CPUFeatures.h"
+#include "NoiseGraph.h"
+
+
+// 1 / 289
+#define NOISE_SIMPLEX_1_DIV_289 0.00346020761245674740484429065744f
+
+const float TerrainNoiseCPU::NoiseTolerance = 1e-4f;
+const float TerrainNoiseCPU::OctaveFadeStart = 0.25f;
+const float TerrainNoiseCPU::OctaveCutoff = 0.5f;
+
+
+// SCALAR REFERENCE
+
+static inline float Frac(float x) { return x - floorf(x); }
+
+static inline float Mod289(float x)
+{
+	return x - floorf(x * NOISE_SIMPLEX_1_DIV_289) * 289.0f;
+}
+
+static inline float Permute(float x)
+{
+	return Mod289(x * x * 34.0f + x);
+}
+
+// D3D saturate, which takes NaN to 0
+static inline float Saturate(float x)
+{
+	x = x > 0.0f ? x : 0.0f;
+	return x < 1.0f ? x : 1.0f;
+}
+
+// smoothstep(0, edge, x)
+static inline float SmoothStep0(float edge, float x)
+{
+	float t = Saturate(x / edge);
+	return t * t * (3.0f - 2.0f * t);
+}
+
+
+// where a point lies within its simplex cell
+struct SimplexPoint
+{
+	// the cell's lattice coordinates, before wrapping
+	float ix, iy;
+	// offsets from the cell's three corners
+	float x0, y0;
+	float x12x, x12y, x12z, x12w;
+	// whether the point's middle corner is (0, 1) rather than (1, 0)
+	bool xLessEqual;
+};
+
+static inline SimplexPoint Locate(float x, float y)
+{
+	const float Cx = 0.211324865405187f;	// (3.0-sqrt(3.0))/6.0
+	const float Cy = 0.366025403784439f;	// 0.5*(sqrt(3.0)-1.0)
+	const float Cz = -0.577350269189626f;	// -1.0 + 2.0 * C.x
+
+	SimplexPoint p;
+
+	// first corner
+	float s = x * Cy + y * Cy;
+	p.ix = floorf(x + s);
+	p.iy = floorf(y + s);
+	float t = p.ix * Cx + p.iy * Cx;
+	p.x0 = x - p.ix + t;
+	p.y0 = y - p.iy + t;
+
+	// other corners
+	p.xLessEqual = p.x0 <= p.y0;
+	float i1x = p.xLessEqual ? 0.0f : 1.0f;
+	float i1y = p.xLessEqual ? 1.0f : 0.0f;
+
+	p.x12x = p.x0 + Cx - i1x;
+	p.x12y = p.y0 + Cx - i1y;
+	p.x12z = p.x0 + Cz;
+	p.x12w = p.y0 + Cz;
+
+	return p;
+}
+
+// hash of the corner (dx, dy) of the cell with wrapped lattice coordinates (ix, iy)
+static inline float Hash(float ix, float iy, float dx, float dy)
+{
+	return Permute(Permute(iy + dy) + ix + dx);
+}
+
+// gradient of a corner with hash p, and the factor normalising it
+static inline void Gradient(float p, float& a, float& h, float& n)
+{
+	const float Cw = 0.024390243902439f;	// 1.0 / 41.0
+
+	// gradients: 41 points uniformly over a line, mapped onto a diamond
+	float gx = 2.0f * Frac(p * Cw) - 1.0f;
+	h = fabsf(gx) - 0.5f;
+	a = gx - floorf(gx + 0.5f);
+
+	// normalise gradients implicitly by scaling m
+	n = 1.79284291400159f - 0.85373472095314f * (a * a + h * h);
+}
+
+// sum of the contributions of a point's three corners, given their gradients
+static inline float Contributions(const SimplexPoint& p, float a0, float h0, float n0, float a1, float h1, float n1, float a2, float h2, float n2)
+{
+	float m0 = fmaxf(0.5f - (p.x0 * p.x0 + p.y0 * p.y0), 0.0f);
+	float m1 = fmaxf(0.5f - (p.x12x * p.x12x + p.x12y * p.x12y), 0.0f);
+	float m2 = fmaxf(0.5f - (p.x12z * p.x12z + p.x12w * p.x12w), 0.0f);
+	m0 = m0 * m0; m0 = m0 * m0;
+	m1 = m1 * m1; m1 = m1 * m1;
+	m2 = m2 * m2; m2 = m2 * m2;
+
+	m0 *= n0;
+	m1 *= n1;
+	m2 *= n2;
+
+	float g0 = a0 * p.x0 + h0 * p.y0;
+	float g1 = a1 * p.x12x + h1 * p.x12y;
+	float g2 = a2 * p.x12z + h2 * p.x12w;
+
+	return 130.0f * (m0 * g0 + m1 * g1 + m2 * g2);
+}
+
+float TerrainNoiseCPU::SNoise(float x, float y)
+{
+	SimplexPoint p = Locate(x, y);
+	float i1x = p.xLessEqual ? 0.0f : 1.0f;
+	float i1y = p.xLessEqual ? 1.0f : 0.0f;
+
+	// permutations
+	float ix = Mod289(p.ix);
+	float iy = Mod289(p.iy);
+
+	float a0, h0, n0, a1, h1, n1, a2, h2, n2;
+	Gradient(Hash(ix, iy, 0.0f, 0.0f), a0, h0, n0);
+	Gradient(Hash(ix, iy, i1x, i1y), a1, h1, n1);
+	Gradient(Hash(ix, iy, 1.0f, 1.0f), a2, h2, n2);
+
+	return Contributions(p, a0, h0, n0, a1, h1, n1, a2, h2, n2);
+}
+
+
+// GRID COHERENCE
+// neighbouring points of a grid mostly lie in the same simplex cells, whose corner gradients only depend on the cell,
+// so each octave keeps the gradients of the last cell it hashed for the points after it
+
+// a cell and the gradients at its corners (0, 0), (1, 0), (0, 1) and (1, 1)
+struct SimplexCell
+{
+	// lattice coordinates, before wrapping; NaN until a cell is hashed, so no point matches it
+	float ix = NAN;
+	float iy = NAN;
+	float a[4];
+	float h[4];
+	float n[4];
+
+	// false for octaves too fine for neighbouring points to share cells, which are hashed point by point
+	bool coherent = false;
+};
+
+static inline void HashCell(float cellX, float cellY, SimplexCell& cell)
+{
+	const float dx[4] = { 0.0f, 1.0f, 0.0f, 1.0f };
+	const float dy[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+	float ix = Mod289(cellX);
+	float iy = Mod289(cellY);
+	for (int corner = 0; corner < 4; corner++)
+		Gradient(Hash(ix, iy, dx[corner], dy[corner]), cell.a[corner], cell.h[corner], cell.n[corner]);
+
+	cell.ix = cellX;
+	cell.iy = cellY;
+}
+
+// SNoise, reusing the gradients of the last cell when the point lies in it
+static float SNoiseCoherent(float x, float y, SimplexCell* cell)
+{
+	if (!cell || !cell->coherent) return TerrainNoiseCPU::SNoise(x, y);
+
+	SimplexPoint p = Locate(x, y);
+	if (p.ix != cell->ix || p.iy != cell->iy)
+		HashCell(p.ix, p.iy, *cell);
+
+	const int c1 = p.xLessEqual ? 2 : 1;
+	return Contributions(p, cell->a[0], cell->h[0], cell->n[0], cell->a[c1], cell->h[c1], cell->n[c1], cell->a[3], cell->h[3], cell->n[3]);
+}
+
+// cells per batch of points (a point, or a vector of them) beyond which octaves aren't evaluated coherently
+// hashing a cell costs about as much as a batch hashed point by point, so cells must be shared by several batches to pay
+static const float MaxCellsPerBatch = 0.5f;
+
+// a cell for each octave of each layer of TerrainNoise, for points in rows gridSpacing apart evaluated width at a time
+// (layers may be evaluated one after the other, as TerrainNoiseKernel does, since each octave keeps its own cell)
+// a gridSpacing of 0 leaves every layer without cells, so every point is evaluated on its own
+struct GridCells
+{
+	std::vector<SimplexCell> cells;
+	SimplexCell* continent = nullptr;
+	SimplexCell* mountain = nullptr;
+	SimplexCell* ridge = nullptr;
+
+	GridCells(const TerrainNoiseSettings& settings, float gridSpacing, int width)
+	{
+		if (gridSpacing <= 0.0f) return;
+
+		int continentOctaves = settings.ContinentSettings.Octaves > 0 ? settings.ContinentSettings.Octaves : 0;
+		int mountainOctaves = settings.MountainSettings.Octaves > 0 ? settings.MountainSettings.Octaves : 0;
+		int ridgeOctaves = settings.RidgeSettings.Octaves > 0 ? settings.RidgeSettings.Octaves : 0;
+		cells.resize(continentOctaves + mountainOctaves + ridgeOctaves);
+
+		continent = cells.data();
+		mountain = continent + continentOctaves;
+		ridge = mountain + mountainOctaves;
+		SetCoherence(settings.ContinentSettings, gridSpacing, width, continent);
+		SetCoherence(settings.MountainSettings, gridSpacing, width, mountain);
+		SetCoherence(settings.RidgeSettings, gridSpacing, width, ridge);
+	}
+
+	template<typename Settings>
+	static void SetCoherence(const Settings& settings, float gridSpacing, int width, SimplexCell* layerCells)
+	{
+		// a row crosses about 1 + 2 * Cy = sqrt(3) cells per unit of noise space
+		float f = settings.Frequency;
+		for (int octave = 0; octave < settings.Octaves; octave++)
+		{
+			layerCells[octave].coherent = 1.7320508f * fabsf(f) * gridSpacing * static_cast<float>(width) <= MaxCellsPerBatch;
+			f *= settings.Lacunarity;
+		}
+	}
+};
+
+
+// BAND LIMITING
+
+float TerrainNoiseCPU::OctaveWeight(float frequency, float sampleSpacing)
+{
+	if (sampleSpacing <= 0.0f) return 1.0f;
+
+	// cycles per sample
+	float cycles = fabsf(frequency) * sampleSpacing;
+	if (cycles <= OctaveFadeStart) return 1.0f;
+	if (cycles >= OctaveCutoff) return 0.0f;
+
+	float t = (cycles - OctaveFadeStart) / (OctaveCutoff - OctaveFadeStart);
+	return 1.0f - t * t * (3.0f - 2.0f * t);
+}
+
+// octaves of a layer that are evaluated; octaves only get finer, so the first to be cut off ends the layer
+template<typename Settings>
+static int LayerOctaveCount(const Settings& settings, float sampleSpacing)
+{
+	float f = settings.Frequency;
+	for (int octave = 0; octave < settings.Octaves; octave++)
+	{
+		if (TerrainNoiseCPU::OctaveWeight(f, sampleSpacing) <= 0.0f && settings.Lacunarity >= 1.0f)
+			return octave;
+		f *= settings.Lacunarity;
+	}
+	return settings.Octaves > 0 ? settings.Octaves : 0;
+}
+
+int TerrainNoiseCPU::OctaveCount(const TerrainNoiseSettings& settings, float sampleSpacing)
+{
+	int count = LayerOctaveCount(settings.ContinentSettings, sampleSpacing);
+	if (settings.MountainSettings.Elevation > 0.0f)
+		count += LayerOctaveCount(settings.MountainSettings, sampleSpacing);
+	if (settings.RidgeSettings.Elevation > 0.0f)
+		count += LayerOctaveCount(settings.RidgeSettings, sampleSpacing);
+	return count;
+}
+
+
+// the layers of TerrainNoise; cells has one per octave of the layer for points of a grid (see GridCells), or is null
+
+// adds the octaves [firstOctave, lastOctave) of a simple noise layer to noiseSum, before elevation and vertical shift
+static float AddOctaves(float noiseSum, float x, float y, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave, float sampleSpacing,
+	SimplexCell* cells = nullptr)
+{
+	float f = settings.Frequency;
+	float a = 1.0f;
+
+	for (int octave = 0; octave < lastOctave; octave++)
+	{
+		// octaves too fine for the sample spacing fade out, and those past the cutoff are never evaluated
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		if (weight <= 0.0f && settings.Lacunarity >= 1.0f) break;
+
+		if (octave >= firstOctave)
+			noiseSum += SNoiseCoherent(f * x + settings.Offset.x, f * y + settings.Offset.y, cells ? cells + octave : nullptr) * (a * weight);
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence;
+	}
+
+	return noiseSum;
+}
+
+static float RidgeOctaves(float x, float y, const RidgeNoiseSettings& settings, float sampleSpacing, SimplexCell* cells = nullptr)
+{
+	float noiseSum = 0.0f;
+	float f = settings.Frequency;
+	float a = 1.0f;
+	float ridgeWeight = 1.0f;
+
+	for (int octave = 0; octave < settings.Octaves; octave++)
+	{
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		if (weight <= 0.0f && settings.Lacunarity >= 1.0f) break;
+
+		float noiseVal = 1.0f - fabsf(SNoiseCoherent(f * x + settings.Offset.x, f * y + settings.Offset.y, cells ? cells + octave : nullptr));
+		noiseVal = powf(fabsf(noiseVal), settings.Power);
+		noiseVal *= ridgeWeight;
+		ridgeWeight = Saturate(noiseVal * settings.Gain);
+
+		noiseSum += noiseVal * (a * weight);
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence;
+	}
+
+	return noiseSum * settings.Elevation;
+}
+
+static float MountainOctaves(float x, float y, const MountainNoiseSettings& settings, float sampleSpacing, SimplexCell* cells = nullptr)
+{
+	float noiseSum = 0.0f;
+	float f = settings.Frequency;
+	float a = 1.0f;
+
+	for (int octave = 0; octave < settings.Octaves; octave++)
+	{
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		if (weight <= 0.0f && settings.Lacunarity >= 1.0f) break;
+
+		float noiseVal1 = fabsf(SNoiseCoherent(f * x + settings.Offset.x, f * y + settings.Offset.y, cells ? cells + octave : nullptr));
+		float noiseVal2 = noiseVal1 * (1.0f - SmoothStep0(noiseVal1, settings.Blending));
+
+		noiseSum += noiseVal2 * (a * weight);
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence * (1.0f - SmoothStep0(noiseVal1, settings.Detail));
+	}
+
+	return noiseSum * settings.Elevation;
+}
+
+float TerrainNoiseCPU::SimpleNoise(float x, float y, const SimpleNoiseSettings& settings, float sampleSpacing)
+{
+	return AddOctaves(0.0f, x, y, settings, 0, settings.Octaves, sampleSpacing) * settings.Elevation + settings.VerticalShift;
+}
+
+float TerrainNoiseCPU::ContinentOctaves(float x, float y, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave, float sampleSpacing)
+{
+	return AddOctaves(0.0f, x, y, settings, firstOctave, lastOctave, sampleSpacing);
+}
+
+float TerrainNoiseCPU::RidgeNoise(float x, float y, const RidgeNoiseSettings& settings, float sampleSpacing)
+{
+	return RidgeOctaves(x, y, settings, sampleSpacing);
+}
+
+float TerrainNoiseCPU::MountainNoise(float x, float y, const MountainNoiseSettings& settings, float sampleSpacing)
+{
+	return MountainOctaves(x, y, settings, sampleSpacing);
+}
+
+// TerrainNoise, with the first baseOctaves octaves of the continent layer already summed in continentBase
+static float TerrainNoiseFrom(float x, float y, const TerrainNoiseSettings& settings, float sampleSpacing, float continentBase, int baseOctaves,
+	GridCells* grid = nullptr)
+{
+	// create continent shape
+	const SimpleNoiseSettings& continentSettings = settings.ContinentSettings;
+	float continentShape = AddOctaves(continentBase, x, y, continentSettings, baseOctaves, continentSettings.Octaves, sampleSpacing,
+		grid ? grid->continent : nullptr) * continentSettings.Elevation + continentSettings.VerticalShift;
+
+	// create mountains
+	float mountainShape = 0.0f, ridgeShape = 0.0f;
+	if (settings.MountainSettings.Elevation > 0.0f)
+	{
+		mountainShape = MountainOctaves(x, y, settings.MountainSettings, sampleSpacing, grid ? grid->mountain : nullptr);
+	}
+	// create ridges
+	if (settings.RidgeSettings.Elevation > 0.0f)
+	{
+		ridgeShape = RidgeOctaves(x, y, settings.RidgeSettings, sampleSpacing, grid ? grid->ridge : nullptr);
+		ridgeShape *= SmoothStep0(settings.RidgeSettings.RidgeThreshold, mountainShape);
+	}
+
+	// create ocean floor
+	continentShape = TerrainNoiseCPU::SmoothMax(continentShape, -settings.OceanFloorDepth, settings.OceanFloorSmoothing);
+	if (continentShape < 0)
+		continentShape *= 1 + settings.OceanDepthMultiplier;
+
+	return continentShape + mountainShape + ridgeShape;
+}
+
+float TerrainNoiseCPU::TerrainNoise(float x, float y, const TerrainNoiseSettings& settings, float sampleSpacing)
+{
+	return TerrainNoiseFrom(x, y, settings, sampleSpacing, 0.0f, 0);
+}
+
+float TerrainNoiseCPU::SmoothMax(float a, float b, float k)
+{
+	// k = min(0, -k), where a k of 0 must become -0 so the division sends h to 0 when b > a and to 1 when a > b, giving max(a, b)
+	// D3D min and max return the other operand when one is NaN, as fminf and fmaxf do
+	k = k > 0.0f ? -k : -0.0f;
+	float h = fmaxf(0.0f, fminf(1.0f, (b - a + k) / (2.0f * k)));
+	return a * h + b * (1.0f - h) - k * h * (1.0f - h);
+}
+
+
+// BATCHES
+
+void TerrainNoiseCPU::TerrainNoise(const float* x, const float* y, int count, const TerrainNoiseSettings& settings, float* heights, float sampleSpacing,
+	const float* continentBase, int baseOctaves)
+{
+	TerrainNoiseGrid(x, y, count, 0.0f, settings, heights, sampleSpacing, continentBase, baseOctaves);
+}
+
+void TerrainNoiseCPU::TerrainNoiseGrid(const float* x, const float* y, int count, float gridSpacing, const TerrainNoiseSettings& settings, float* heights,
+	float sampleSpacing, const float* continentBase, int baseOctaves)
+{
+	if (CPUFeatures::HasAVX512())
+		TerrainNoiseAVX512(x, y, count, settings, heights, sampleSpacing, continentBase, baseOctaves, gridSpacing);
+	else if (CPUFeatures::HasAVX2())
+		TerrainNoiseAVX2(x, y, count, settings, heights, sampleSpacing, continentBase, baseOctaves, gridSpacing);
+	else
+		TerrainNoiseScalar(x, y, count, settings, heights, sampleSpacing, continentBase, baseOctaves, gridSpacing);
+}
+
+void TerrainNoiseCPU::TerrainNoiseScalar(const float* x, const float* y, int count, const TerrainNoiseSettings& settings, float* heights, float sampleSpacing,
+	const float* continentBase, int baseOctaves, float gridSpacing)
+{
+	if (!continentBase) baseOctaves = 0;
+
+	GridCells grid(settings, gridSpacing, 1);
+	for (int i = 0; i < count; i++)
+		heights[i] = TerrainNoiseFrom(x[i], y[i], settings, sampleSpacing, continentBase ? continentBase[i] : 0.0f, baseOctaves, &grid);
+}
+
+
+// NOISE GRAPHS
+
+// an instruction of a noise program at a point, given the registers holding its inputs there
+static float GraphInstruction(const NoiseProgram& program, const NoiseInstruction& instruction, float x, float y, const float* registers)
+{
+	// unconnected inputs are 0
+	const float a = instruction.inputs[0] >= 0 ? registers[instruction.inputs[0]] : 0.0f;
+	const float b = instruction.inputs[1] >= 0 ? registers[instruction.inputs[1]] : 0.0f;
+	const float c = instruction.inputs[2] >= 0 ? registers[instruction.inputs[2]] : 0.0f;
+	const float* p = instruction.params;
+
+	// fractals are warped by their first two inputs
+	const float wx = instruction.inputs[0] >= 0 ? x + a : x;
+	const float wy = instruction.inputs[1] >= 0 ? y + b : y;
+
+	switch (instruction.type)
+	{
+	case NOISE_NODE_CONSTANT:		return p[0];
+	case NOISE_NODE_X:				return x;
+	case NOISE_NODE_Y:				return y;
+	case NOISE_NODE_TERRAIN:
+	{
+		const TerrainNoiseKernel& kernel = program.GetKernels()[instruction.kernel];
+		return TerrainNoiseCPU::TerrainNoise(x, y, kernel.GetSettings(), kernel.GetSampleSpacing());
+	}
+
+	case NOISE_NODE_FBM:
+	{
+		const TerrainNoiseKernel& kernel = program.GetKernels()[instruction.kernel];
+		return TerrainNoiseCPU::SimpleNoise(wx, wy, kernel.GetSettings().ContinentSettings, kernel.GetSampleSpacing());
+	}
+	case NOISE_NODE_RIDGED:
+	{
+		const TerrainNoiseKernel& kernel = program.GetKernels()[instruction.kernel];
+		return RidgeOctaves(wx, wy, kernel.GetSettings().RidgeSettings, kernel.GetSampleSpacing());
+	}
+	case NOISE_NODE_MOUNTAINS:
+	{
+		const TerrainNoiseKernel& kernel = program.GetKernels()[instruction.kernel];
+		return MountainOctaves(wx, wy, kernel.GetSettings().MountainSettings, kernel.GetSampleSpacing());
+	}
+
+	// min and max return their second operand when either is NaN, as the vector instructions do
+	case NOISE_NODE_ADD:			return a + b;
+	case NOISE_NODE_SUBTRACT:		return a - b;
+	case NOISE_NODE_MULTIPLY:		return a * b;
+	case NOISE_NODE_MIN:			return a < b ? a : b;
+	case NOISE_NODE_MAX:			return a > b ? a : b;
+	case NOISE_NODE_SMOOTH_MAX:		return TerrainNoiseCPU::SmoothMax(a, b, p[0]);
+	case NOISE_NODE_LERP:			return a + c * (b - a);
+
+	case NOISE_NODE_SCALE_BIAS:		return a * p[0] + p[1];
+	case NOISE_NODE_ABS:			return fabsf(a);
+	case NOISE_NODE_CLAMP:
+	{
+		float v = a > p[0] ? a : p[0];
+		return v < p[1] ? v : p[1];
+	}
+	case NOISE_NODE_SMOOTH_STEP:
+	{
+		float t = Saturate((a - p[0]) / (p[1] - p[0]));
+		return t * t * (3.0f - 2.0f * t);
+	}
+	case NOISE_NODE_POW:			return powf(a > 0.0f ? a : 0.0f, p[0]);
+	case NOISE_NODE_TERRACE:
+	{
+		// flat steps, rising more sharply towards the next the higher the sharpness
+		float t = a * p[0];
+		float step = floorf(t);
+		return (step + powf(t - step, p[1])) / p[0];
+	}
+
+	default:
+		return 0.0f;
+	}
+}
+
+void TerrainNoiseCPU::GraphNoise(const NoiseProgram& program, const float* x, const float* y, int count, float* heights)
+{
+	if (CPUFeatures::HasAVX512())
+		GraphNoiseAVX512(program, x, y, count, heights);
+	else if (CPUFeatures::HasAVX2())
+		GraphNoiseAVX2(program, x, y, count, heights);
+	else
+		GraphNoiseScalar(program, x, y, count, heights);
+}
+
+void TerrainNoiseCPU::GraphNoiseScalar(const NoiseProgram& program, const float* x, const float* y, int count, float* heights)
+{
+	if (program.IsEmpty())
+	{
+		for (int i = 0; i < count; i++)
+			heights[i] = 0.0f;
+		return;
+	}
+
+	std::vector<float> registers(program.GetRegisterCount());
+	for (int i = 0; i < count; i++)
+	{
+		for (const NoiseInstruction& instruction : program.GetInstructions())
+			registers[instruction.out] = GraphInstruction(program, instruction, x[i], y[i], registers.data());
+		heights[i] = registers[program.GetOutputRegister()];
+	}
+}
+
+
+// points the vector kernels evaluate a layer (or an instruction) at a time; a chunk's values stay in the L1 cache between passes
+static const int KernelChunk = 256;
+
+
+#if CPU_X86
+namespace NoiseAVX2
+{
+#define SIMD_TARGET CPU_TARGET_AVX2
+
+	typedef __m256 F;
+	typedef __m256 M;
+	static const int Width = 8;
+
+	SIMD_TARGET static inline F Set(float v) { return _mm256_set1_ps(v); }
+	SIMD_TARGET static inline F Zero() { return _mm256_setzero_ps(); }
+	SIMD_TARGET static inline F Load(const float* p) { return _mm256_loadu_ps(p); }
+	SIMD_TARGET static inline void Store(float* p, F v) { _mm256_storeu_ps(p, v); }
+
+	SIMD_TARGET static inline F Add(F a, F b) { return _mm256_add_ps(a, b); }
+	SIMD_TARGET static inline F Sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	SIMD_TARGET static inline F Mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	SIMD_TARGET static inline F MulAdd(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+	SIMD_TARGET static inline F Div(F a, F b) { return _mm256_div_ps(a, b); }
+	SIMD_TARGET static inline F Min(F a, F b) { return _mm256_min_ps(a, b); }
+	SIMD_TARGET static inline F Max(F a, F b) { return _mm256_max_ps(a, b); }
+	SIMD_TARGET static inline F Abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	SIMD_TARGET static inline F Floor(F a) { return _mm256_floor_ps(a); }
+
+	SIMD_TARGET static inline M LessEqual(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	SIMD_TARGET static inline M Less(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	SIMD_TARGET static inline M Greater(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	SIMD_TARGET static inline M Equal(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	SIMD_TARGET static inline M And(M a, M b) { return _mm256_and_ps(a, b); }
+	SIMD_TARGET static inline bool All(M m) { return _mm256_movemask_ps(m) == 0xff; }
+	SIMD_TARGET static inline F Select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+
+	// x = mantissa * 2^exponent, with the mantissa in [0.5, 1); x must be positive
+	SIMD_TARGET static inline F Frexp(F x, F& exponent)
+	{
+		__m256i bits = _mm256_castps_si256(x);
+		__m256i e = _mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff));
+		exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(e, _mm256_set1_epi32(126)));
+		return _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x807fffff)), _mm256_set1_epi32(0x3f000000)));
+	}
+
+	// 2^n for whole numbers n in [-126, 127]
+	SIMD_TARGET static inline F Ldexp2(F n)
+	{
+		return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23));
+	}
+
+#include "TerrainNoiseSIMD.inl"
+
+#undef SIMD_TARGET
+}
+
+namespace NoiseAVX512
+{
+#define SIMD_TARGET CPU_TARGET_AVX512
+
+	typedef __m512 F;
+	typedef __mmask16 M;
+	static const int Width = 16;
+
+	SIMD_TARGET static inline F Set(float v) { return _mm512_set1_ps(v); }
+	SIMD_TARGET static inline F Zero() { return _mm512_setzero_ps(); }
+	SIMD_TARGET static inline F Load(const float* p) { return _mm512_loadu_ps(p); }
+	SIMD_TARGET static inline void Store(float* p, F v) { _mm512_storeu_ps(p, v); }
+
+	SIMD_TARGET static inline F Add(F a, F b) { return _mm512_add_ps(a, b); }
+	SIMD_TARGET static inline F Sub(F a, F b) { return _mm512_sub_ps(a, b); }
+	SIMD_TARGET static inline F Mul(F a, F b) { return _mm512_mul_ps(a, b); }
+	SIMD_TARGET static inline F MulAdd(F a, F b, F c) { return _mm512_fmadd_ps(a, b, c); }
+	SIMD_TARGET static inline F Div(F a, F b) { return _mm512_div_ps(a, b); }
+	SIMD_TARGET static inline F Min(F a, F b) { return _mm512_min_ps(a, b); }
+	SIMD_TARGET static inline F Max(F a, F b) { return _mm512_max_ps(a, b); }
+	SIMD_TARGET static inline F Abs(F a) { return _mm512_abs_ps(a); }
+	SIMD_TARGET static inline F Floor(F a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+	SIMD_TARGET static inline M LessEqual(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+	SIMD_TARGET static inline M Less(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+	SIMD_TARGET static inline M Greater(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+	SIMD_TARGET static inline M Equal(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+	SIMD_TARGET static inline M And(M a, M b) { return _mm512_kand(a, b); }
+	SIMD_TARGET static inline bool All(M m) { return m == 0xffff; }
+	SIMD_TARGET static inline F Select(M m, F a, F b) { return _mm512_mask_blend_ps(m, b, a); }
+
+	SIMD_TARGET static inline F Frexp(F x, F& exponent)
+	{
+		__m512i bits = _mm512_castps_si512(x);
+		__m512i e = _mm512_and_si512(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(0xff));
+		exponent = _mm512_cvtepi32_ps(_mm512_sub_epi32(e, _mm512_set1_epi32(126)));
+		return _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x807fffff)), _mm512_set1_epi32(0x3f000000)));
+	}
+
+	SIMD_TARGET static inline F Ldexp2(F n)
+	{
+		return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23));
+	}
+
+#include "TerrainNoiseSIMD.inl"
+
+#undef SIMD_TARGET
+}
+#endif
+
+void TerrainNoiseCPU::GraphNoiseAVX2(const NoiseProgram& program, const float* x, const float* y, int count, float* heights)
+{
+#if CPU_X86
+	NoiseAVX2::GraphNoiseBatch(program, x, y, count, heights);
+#else
+	GraphNoiseScalar(program, x, y, count, heights);
+#endif
+}
+
+void TerrainNoiseCPU::GraphNoiseAVX512(const NoiseProgram& program, const float* x, const float* y, int count, float* heights)
+{
+#if CPU_X86
+	NoiseAVX512::GraphNoiseBatch(program, x, y, count, heights);
+#else
+	GraphNoiseScalar(program, x, y, count, heights);
+#endif
+}
+
+
+void TerrainNoiseCPU::TerrainNoiseAVX2(const float* x, const float* y, int count, const TerrainNoiseSettings& settings, float* heights, float sampleSpacing,
+	const float* continentBase, int baseOctaves, float gridSpacing)
+{
+	TerrainNoiseKernel(settings, sampleSpacing).TerrainNoiseAVX2(x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+}
+
+void TerrainNoiseCPU::TerrainNoiseAVX512(const float* x, const float* y, int count, const TerrainNoiseSettings& settings, float* heights, float sampleSpacing,
+	const float* continentBase, int baseOctaves, float gridSpacing)
+{
+	TerrainNoiseKernel(settings, sampleSpacing).TerrainNoiseAVX512(x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+}
+
+
+// KERNELS
+
+// octave tables of a layer; amplitudes are left out of the mountains' table, as they depend on the noise
+template<typename Settings>
+static void BuildLayer(const Settings& settings, float sampleSpacing, bool amplitudes, TerrainNoiseKernel::Layer& layer)
+{
+	layer.octaves = LayerOctaveCount(settings, sampleSpacing);
+	layer.frequencies.resize(layer.octaves);
+	layer.amplitudes.resize(layer.octaves);
+
+	float f = settings.Frequency;
+	float a = 1.0f;
+	for (int octave = 0; octave < layer.octaves; octave++)
+	{
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		layer.frequencies[octave] = f;
+		layer.amplitudes[octave] = amplitudes ? a * weight : weight;
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence;
+	}
+}
+
+TerrainNoiseKernel::TerrainNoiseKernel(const TerrainNoiseSettings& settings, float sampleSpacing)
+	: m_Settings(settings)
+	, m_SampleSpacing(sampleSpacing)
+{
+	m_Layers = 0;
+	if (settings.MountainSettings.Elevation > 0.0f)
+	{
+		m_Layers |= Mountains;
+		if (settings.RidgeSettings.Elevation > 0.0f)
+			m_Layers |= Ridges;
+	}
+
+	BuildLayer(settings.ContinentSettings, sampleSpacing, true, m_Continent);
+	BuildLayer(settings.MountainSettings, sampleSpacing, false, m_Mountains);
+	BuildLayer(settings.RidgeSettings, sampleSpacing, true, m_Ridges);
+
+	m_SharedOctaves.assign(m_Ridges.octaves, -1);
+	m_SharedOctaveCount = 0;
+	const bool sameOffset = settings.MountainSettings.Offset.x == settings.RidgeSettings.Offset.x
+		&& settings.MountainSettings.Offset.y == settings.RidgeSettings.Offset.y;
+	if ((m_Layers & Ridges) && sameOffset)
+	{
+		const int ridgeOctaves = m_Ridges.octaves < MaxSharedOctaves ? m_Ridges.octaves : MaxSharedOctaves;
+		const int mountainOctaves = m_Mountains.octaves < MaxSharedOctaves ? m_Mountains.octaves : MaxSharedOctaves;
+		for (int ridge = 0; ridge < ridgeOctaves; ridge++)
+		{
+			for (int mountain = 0; mountain < mountainOctaves && m_SharedOctaves[ridge] < 0; mountain++)
+			{
+				if (m_Ridges.frequencies[ridge] == m_Mountains.frequencies[mountain])
+				{
+					m_SharedOctaves[ridge] = mountain;
+					m_SharedOctaveCount++;
+				}
+			}
+		}
+	}
+
+#if CPU_X86
+	NoiseAVX2::SelectKernels(*this, m_AVX2);
+	NoiseAVX512::SelectKernels(*this, m_AVX512);
+#endif
+}
+
+void TerrainNoiseKernel::TerrainNoise(const float* x, const float* y, int count, float* heights, const float* continentBase, int baseOctaves,
+	float gridSpacing) const
+{
+	if (CPUFeatures::HasAVX512())
+		TerrainNoiseAVX512(x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+	else if (CPUFeatures::HasAVX2())
+		TerrainNoiseAVX2(x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+	else
+		TerrainNoiseScalar(x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+}
+
+void TerrainNoiseKernel::TerrainNoiseScalar(const float* x, const float* y, int count, float* heights, const float* continentBase, int baseOctaves,
+	float gridSpacing) const
+{
+	TerrainNoiseCPU::TerrainNoiseScalar(x, y, count, m_Settings, heights, m_SampleSpacing, continentBase, baseOctaves, gridSpacing);
+}
+
+void TerrainNoiseKernel::TerrainNoiseAVX2(const float* x, const float* y, int count, float* heights, const float* continentBase, int baseOctaves,
+	float gridSpacing) const
+{
+#if CPU_X86
+	Evaluate(m_AVX2, x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+#else
+	TerrainNoiseScalar(x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+#endif
+}
+
+void TerrainNoiseKernel::TerrainNoiseAVX512(const float* x, const float* y, int count, float* heights, const float* continentBase, int baseOctaves,
+	float gridSpacing) const
+{
+#if CPU_X86
+	Evaluate(m_AVX512, x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+#else
+	TerrainNoiseScalar(x, y, count, heights, continentBase, baseOctaves, gridSpacing);
+#endif
+}
+
+void TerrainNoiseKernel::Evaluate(const Kernels& kernels, const float* x, const float* y, int count, float* heights, const float* continentBase,
+	int baseOctaves, float gridSpacing) const
+{
+	if (!continentBase) baseOctaves = 0;
+
+	GridCells grid(m_Settings, gridSpacing, kernels.width);
+
+	float mountains[KernelChunk], ridges[KernelChunk];
+	// the last chunk goes through whole vectors of padding
+	float padX[KernelChunk], padY[KernelChunk], padHeights[KernelChunk];
+
+	for (int start = 0; start < count; start += KernelChunk)
+	{
+		const int chunk = count - start < KernelChunk ? count - start : KernelChunk;
+		const int vectors = (chunk + kernels.width - 1) / kernels.width * kernels.width;
+
+		const float* cx = x + start;
+		const float* cy = y + start;
+		float* ch = heights + start;
+		if (vectors != chunk)
+		{
+			for (int i = 0; i < vectors; i++)
+			{
+				padX[i] = i < chunk ? cx[i] : 0.0f;
+				padY[i] = i < chunk ? cy[i] : 0.0f;
+			}
+			cx = padX;
+			cy = padY;
+			ch = padHeights;
+		}
+
+		// the continent pass adds to the octaves already summed
+		for (int i = 0; i < vectors; i++)
+			ch[i] = continentBase && i < chunk ? continentBase[start + i] : 0.0f;
+
+		kernels.continent(*this, cx, cy, vectors, ch, baseOctaves, grid.continent);
+		if (kernels.mountainsAndRidges)
+		{
+			kernels.mountainsAndRidges(*this, cx, cy, vectors, mountains, ridges, grid.mountain, grid.ridge);
+		}
+		else
+		{
+			if (m_Layers & Mountains)
+				kernels.mountains(*this, cx, cy, vectors, mountains, 0, grid.mountain);
+			if (m_Layers & Ridges)
+				kernels.ridges(*this, cx, cy, vectors, ridges, 0, grid.ridge);
+		}
+		kernels.combine(*this, ch, mountains, ridges, vectors);
+
+		if (ch == padHeights)
+		{
+			for (int i = 0; i < chunk; i++)
+				heights[start + i] = padHeights[i];
+		}
+	}
+}
+
+
+static void ContinentOctavesScalar(const float* x, const float* y, int count, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave,
+	float* sums, float sampleSpacing)
+{
+	for (int i = 0; i < count; i++)
+		sums[i] = TerrainNoiseCPU::ContinentOctaves(x[i], y[i], settings, firstOctave, lastOctave, sampleSpacing);
+}
+
+CPU_TARGET_AVX2
+static void ContinentOctavesAVX2(const float* x, const float* y, int count, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave,
+	float* sums, float sampleSpacing)
+{
+#if CPU_X86
+	NoiseAVX2::ContinentOctavesBatch(x, y, count, settings, firstOctave, lastOctave, sums, sampleSpacing);
+#else
+	ContinentOctavesScalar(x, y, count, settings, firstOctave, lastOctave, sums, sampleSpacing);
+#endif
+}
+
+CPU_TARGET_AVX512
+static void ContinentOctavesAVX512(const float* x, const float* y, int count, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave,
+	float* sums, float sampleSpacing)
+{
+#if CPU_X86
+	NoiseAVX512::ContinentOctavesBatch(x, y, count, settings, firstOctave, lastOctave, sums, sampleSpacing);
+#else
+	ContinentOctavesScalar(x, y, count, settings, firstOctave, lastOctave, sums, sampleSpacing);
+#endif
+}
+
+void TerrainNoiseCPU::ContinentOctaves(const float* x, const float* y, int count, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave,
+	float* sums, float sampleSpacing)
+{
+	if (CPUFeatures::HasAVX512())
+		ContinentOctavesAVX512(x, y, count, settings, firstOctave, lastOctave, sums, sampleSpacing);
+	else if (CPUFeatures::HasAVX2())
+		ContinentOctavesAVX2(x, y, count, settings, firstOctave, lastOctave, sums, sampleSpacing);
+	else
+		ContinentOctavesScalar(x, y, count, settings, firstOctave, lastOctave, sums, sampleSpacing);
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vector>
+
+#include "NoiseSettings.h"
+
+
+class NoiseProgram;
+
+// CPU port of the terrain noise in terrainNoise_cs.hlsl, working directly on the same settings structs
+// so heightmaps can be generated without a D3D device
+//
+// The scalar functions are the reference: they follow noiseSimplex.hlsli, noiseFunctions.hlsli and math.hlsli
+// operation for operation in 32-bit floats, including D3D's handling of NaN in saturate, min and max
+// The batch functions evaluate many points at once with 8-wide AVX2 or 16-wide AVX-512 kernels where available
+//
+// Tolerance:
+// the vector kernels compute pow with their own exp2/log2, and may fuse multiply-adds, so they differ from the scalar
+// reference by at most NoiseTolerance per unit of noise (i.e. per unit of elevation summed over octaves);
+// the GPU differs from the scalar reference for the same reasons, as fxc also fuses multiply-adds and pow is
+// evaluated with the hardware's approximate exp2/log2, and agreement with it is expected to the same tolerance
+class TerrainNoiseCPU
+{
+public:
+	// pure static class
+	TerrainNoiseCPU() = delete;
+
+	// largest difference between implementations, relative to the summed elevation of the noise
+	static const float NoiseTolerance;
+
+	// BAND LIMITING
+	// every function below takes the spacing between the points it will be sampled at (in world units)
+	// an octave of frequency f has features about 1 / f apart, so octaves with more than OctaveCutoff cycles per sample
+	// can't be represented at that spacing and only add aliasing; they are skipped, and octaves from OctaveFadeStart
+	// cycles per sample fade out towards the cutoff, so heights change smoothly as the spacing changes
+	// a spacing of 0 evaluates every octave, exactly as the GPU does
+	static const float OctaveFadeStart;
+	static const float OctaveCutoff;
+
+	// weight of an octave of the given frequency; 1 below the fade, 0 beyond the cutoff
+	static float OctaveWeight(float frequency, float sampleSpacing);
+	// number of octaves TerrainNoise evaluates, across all of its layers
+	static int OctaveCount(const TerrainNoiseSettings& settings, float sampleSpacing);
+
+	// SCALAR REFERENCE
+
+	// 2D simplex noise in [-1, 1]
+	static float SNoise(float x, float y);
+
+	static float SimpleNoise(float x, float y, const SimpleNoiseSettings& settings, float sampleSpacing = 0.0f);
+	static float RidgeNoise(float x, float y, const RidgeNoiseSettings& settings, float sampleSpacing = 0.0f);
+	static float MountainNoise(float x, float y, const MountainNoiseSettings& settings, float sampleSpacing = 0.0f);
+	static float TerrainNoise(float x, float y, const TerrainNoiseSettings& settings, float sampleSpacing = 0.0f);
+
+	static float SmoothMax(float a, float b, float k);
+
+	// sum of the continent octaves [firstOctave, lastOctave) at a point, before elevation and vertical shift
+	// the first octaves can be evaluated this way elsewhere (e.g. on a coarse lattice, see ContinentLattice) and passed
+	// to the batch functions as continentBase
+	static float ContinentOctaves(float x, float y, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave, float sampleSpacing = 0.0f);
+
+
+	// BATCHES
+	// heights[i] = TerrainNoise(x[i], y[i], settings, sampleSpacing) for count points
+	// if continentBase is given, continentBase[i] stands in for the first baseOctaves octaves of the continent layer,
+	// as returned by ContinentOctaves(x[i], y[i], settings.ContinentSettings, 0, baseOctaves, sampleSpacing)
+
+	static void TerrainNoise(const float* x, const float* y, int count, const TerrainNoiseSettings& settings, float* heights, float sampleSpacing = 0.0f,
+		const float* continentBase = nullptr, int baseOctaves = 0);
+
+	// the same for points in rows of a grid, gridSpacing apart along the rows (e.g. a heightmap's pixels, or a biome's share of them, in row order)
+	// neighbouring points mostly lie in the same simplex cells, so the gradients at a cell's corners are hashed once for all of them;
+	// the heights are bit-identical to TerrainNoise's, and any points are allowed, though scattered points gain nothing
+	static void TerrainNoiseGrid(const float* x, const float* y, int count, float gridSpacing, const TerrainNoiseSettings& settings, float* heights,
+		float sampleSpacing = 0.0f, const float* continentBase = nullptr, int baseOctaves = 0);
+
+	// sums[i] = ContinentOctaves(x[i], y[i], settings, firstOctave, lastOctave, sampleSpacing) for count points
+	static void ContinentOctaves(const float* x, const float* y, int count, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave,
+		float* sums, float sampleSpacing = 0.0f);
+
+	// implementations, selected between by TerrainNoiseGrid above; a gridSpacing of 0 evaluates each point on its own
+	static void TerrainNoiseScalar(const float* x, const float* y, int count, const TerrainNoiseSettings& settings, float* heights, float sampleSpacing = 0.0f,
+		const float* continentBase = nullptr, int baseOctaves = 0, float gridSpacing = 0.0f);
+	static void TerrainNoiseAVX2(const float* x, const float* y, int count, const TerrainNoiseSettings& settings, float* heights, float sampleSpacing = 0.0f,
+		const float* continentBase = nullptr, int baseOctaves = 0, float gridSpacing = 0.0f);
+	static void TerrainNoiseAVX512(const float* x, const float* y, int count, const TerrainNoiseSettings& settings, float* heights, float sampleSpacing = 0.0f,
+		const float* continentBase = nullptr, int baseOctaves = 0, float gridSpacing = 0.0f);
+
+
+	// NOISE GRAPHS
+	// heights[i] = the output of a compiled noise graph (see NoiseGraph) at (x[i], y[i]) for count points
+	// the vector implementations run each instruction over a chunk of points at a time
+
+	static void GraphNoise(const NoiseProgram& program, const float* x, const float* y, int count, float* heights);
+
+	// implementations, selected between by GraphNoise
+	static void GraphNoiseScalar(const NoiseProgram& program, const float* x, const float* y, int count, float* heights);
+	static void GraphNoiseAVX2(const NoiseProgram& program, const float* x, const float* y, int count, float* heights);
+	static void GraphNoiseAVX512(const NoiseProgram& program, const float* x, const float* y, int count, float* heights);
+};
+
+
+struct SimplexCell;
+
+// The batch TerrainNoise for one set of settings (e.g. a biome's), prepared once when the settings change rather than for every batch
+// Each layer's octaves are fixed when the kernel is made: how many are evaluated after band limiting, and their frequencies and
+// amplitudes, in tables; the vector kernels are picked from ones compiled for each octave count, with the octave loops unrolled,
+// and for each set of enabled layers, so no branches on the settings are left in the inner loops
+// Ridge octaves that land on the same lattice points as mountain octaves reuse their noise, in a pass evaluating both layers
+// The batch functions of TerrainNoiseCPU make a kernel for each call
+class TerrainNoiseKernel
+{
+public:
+	// layers with more octaves than this are evaluated by a kernel that loops over them
+	static const int MaxUnrolledOctaves = 10;
+
+	// ridge octaves sampling the same lattice points as one of the first MaxSharedOctaves mountain octaves (the same frequency
+	// and offset) take that octave's noise rather than evaluating their own
+	static const int MaxSharedOctaves = MaxUnrolledOctaves;
+
+	// enabled layers
+	static const int Mountains = 1;
+	// ridges are scaled by the mountains, so vanish without them
+	static const int Ridges = 2;
+
+	struct Layer
+	{
+		// octaves evaluated, after band limiting
+		int octaves = 0;
+		std::vector<float> frequencies;
+		// amplitude times band limiting weight; for mountains only the weight, as their amplitude depends on the noise
+		std::vector<float> amplitudes;
+	};
+
+	TerrainNoiseKernel(const TerrainNoiseSettings& settings, float sampleSpacing = 0.0f);
+
+	// TerrainNoiseCPU::TerrainNoiseGrid, with this kernel's settings and sample spacing; a gridSpacing of 0 evaluates each point on its own
+	void TerrainNoise(const float* x, const float* y, int count, float* heights, const float* continentBase = nullptr, int baseOctaves = 0,
+		float gridSpacing = 0.0f) const;
+
+	// implementations, selected between by TerrainNoise
+	void TerrainNoiseScalar(const float* x, const float* y, int count, float* heights, const float* continentBase = nullptr, int baseOctaves = 0,
+		float gridSpacing = 0.0f) const;
+	void TerrainNoiseAVX2(const float* x, const float* y, int count, float* heights, const float* continentBase = nullptr, int baseOctaves = 0,
+		float gridSpacing = 0.0f) const;
+	void TerrainNoiseAVX512(const float* x, const float* y, int count, float* heights, const float* continentBase = nullptr, int baseOctaves = 0,
+		float gridSpacing = 0.0f) const;
+
+	inline const TerrainNoiseSettings& GetSettings() const { return m_Settings; }
+	inline float GetSampleSpacing() const { return m_SampleSpacing; }
+	inline int GetLayers() const { return m_Layers; }
+	inline const Layer& GetContinent() const { return m_Continent; }
+	inline const Layer& GetMountains() const { return m_Mountains; }
+	inline const Layer& GetRidges() const { return m_Ridges; }
+	// for each ridge octave, the mountain octave it shares noise with, or -1
+	inline const std::vector<int>& GetSharedOctaves() const { return m_SharedOctaves; }
+	inline int GetSharedOctaveCount() const { return m_SharedOctaveCount; }
+
+	// a layer's octaves [firstOctave, layer octaves) at count points, a whole number of vectors; out holds the sums to add
+	// the continent to, and receives the layer's noise
+	typedef void (*LayerKernel)(const TerrainNoiseKernel& kernel, const float* x, const float* y, int count, float* out, int firstOctave,
+		SimplexCell* cells);
+	// the mountain and ridge layers in one pass, whole, so shared octaves are evaluated once
+	typedef void (*FusedKernel)(const TerrainNoiseKernel& kernel, const float* x, const float* y, int count, float* mountains, float* ridges,
+		SimplexCell* mountainCells, SimplexCell* ridgeCells);
+	// heights hold the continent octaves, and receive the terrain
+	typedef void (*CombineKernel)(const TerrainNoiseKernel& kernel, float* heights, const float* mountains, const float* ridges, int count);
+
+	// the kernels picked for the settings, for an instruction set
+	struct Kernels
+	{
+		int width = 1;
+		LayerKernel continent = nullptr;
+		LayerKernel mountains = nullptr;
+		LayerKernel ridges = nullptr;
+		// only for kernels sharing octaves; the others evaluate mountains and ridges apart
+		FusedKernel mountainsAndRidges = nullptr;
+		CombineKernel combine = nullptr;
+	};
+
+private:
+	void Evaluate(const Kernels& kernels, const float* x, const float* y, int count, float* heights, const float* continentBase, int baseOctaves,
+		float gridSpacing) const;
+
+private:
+	TerrainNoiseSettings m_Settings;
+	float m_SampleSpacing = 0.0f;
+
+	int m_Layers = 0;
+	Layer m_Continent;
+	Layer m_Mountains;
+	Layer m_Ridges;
+	std::vector<int> m_SharedOctaves;
+	int m_SharedOctaveCount = 0;
+
+	Kernels m_AVX2;
+	Kernels m_AVX512;
+};
@@ -0,0 +1,443 @@
+#include "TerrainNoiseFixed.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "CPUFeatures.h"
+#include "TerrainNoiseCPU.h"
+
+
+const float TerrainNoiseFixed::MaxCoordinate = 16383.0f;
+const float TerrainNoiseFixed::MaxFrequency = 32767.0f;
+const float TerrainNoiseFixed::MaxRidgePower = 64.0f;
+const float TerrainNoiseFixed::FloatTolerance = 4e-3f;
+
+
+// OPERATIONS
+// each namespace defines the operations TerrainNoiseFixed.inl is written against, then includes it
+
+namespace NoiseFixedScalar
+{
+#define SIMD_TARGET
+
+	typedef int32_t I;
+	typedef bool M;
+	static const int Width = 1;
+
+	static inline I Set(int32_t v) { return v; }
+
+	// wrapping, as the vector instructions do
+	static inline I Add(I a, I b) { return static_cast<I>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+	static inline I Sub(I a, I b) { return static_cast<I>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+	static inline I MulLo(I a, I b) { return static_cast<I>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+	static inline I Min(I a, I b) { return a < b ? a : b; }
+	static inline I Max(I a, I b) { return a > b ? a : b; }
+	static inline I Abs(I a) { return a < 0 ? Sub(0, a) : a; }
+
+	static inline M Less(I a, I b) { return a < b; }
+	static inline M Greater(I a, I b) { return a > b; }
+	static inline I Select(M m, I a, I b) { return m ? a : b; }
+
+	template<int S> static inline I MulShift(I a, I b) { return static_cast<I>(static_cast<int64_t>(a) * b >> S); }
+	template<int S> static inline I ShiftLeft(I a) { return static_cast<I>(static_cast<uint32_t>(a) << S); }
+	template<int S> static inline I ShiftRight(I a) { return a >> S; }
+	static inline I ShiftLeftBy(I a, I count) { return static_cast<I>(static_cast<uint32_t>(a) << count); }
+	static inline I ShiftRightBy(I a, I count) { return a >> (count < 31 ? count : 31); }
+
+	static inline void SplitMulAdd(I a, int32_t b, I s, int32_t t, int64_t c, int bits, I& whole, I& fraction)
+	{
+		int64_t u = static_cast<int64_t>(a) * b + static_cast<int64_t>(s) * t + c;
+		whole = static_cast<I>(static_cast<I>(u >> 32) >> (bits - 32));
+		fraction = static_cast<I>(static_cast<uint64_t>(u) >> (bits - TerrainNoiseFixed::NoiseBits)) & 0xffffff;
+	}
+
+	static inline I Log2Floor(I a)
+	{
+		float f = static_cast<float>(a);
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return static_cast<I>(bits >> 23) - 127;
+	}
+
+	static inline I FromWorld(const float* p)
+	{
+		// NaN becomes -MaxCoordinate, as the vector max does
+		float v = *p > -TerrainNoiseFixed::MaxCoordinate ? *p : -TerrainNoiseFixed::MaxCoordinate;
+		v = v < TerrainNoiseFixed::MaxCoordinate ? v : TerrainNoiseFixed::MaxCoordinate;
+		return static_cast<I>(v * 65536.0f);
+	}
+
+	static inline void StoreHeights(float* p, I h) { *p = static_cast<float>(h) * (1.0f / 65536.0f); }
+
+	static inline I Ratio(I a, I b)
+	{
+		float r = static_cast<float>(a) / static_cast<float>(b);
+		r = r > 0.0f ? r : 0.0f;
+		r = r < 1.0f ? r : 1.0f;
+		return static_cast<I>(r * 16777216.0f);
+	}
+
+#include "TerrainNoiseFixed.inl"
+
+#undef SIMD_TARGET
+}
+
+#if CPU_X86
+namespace NoiseFixedAVX2
+{
+#define SIMD_TARGET CPU_TARGET_AVX2
+
+	typedef __m256i I;
+	typedef __m256i M;
+	static const int Width = 8;
+
+	SIMD_TARGET static inline I Set(int32_t v) { return _mm256_set1_epi32(v); }
+
+	SIMD_TARGET static inline I Add(I a, I b) { return _mm256_add_epi32(a, b); }
+	SIMD_TARGET static inline I Sub(I a, I b) { return _mm256_sub_epi32(a, b); }
+	SIMD_TARGET static inline I MulLo(I a, I b) { return _mm256_mullo_epi32(a, b); }
+	SIMD_TARGET static inline I Min(I a, I b) { return _mm256_min_epi32(a, b); }
+	SIMD_TARGET static inline I Max(I a, I b) { return _mm256_max_epi32(a, b); }
+	SIMD_TARGET static inline I Abs(I a) { return _mm256_abs_epi32(a); }
+
+	SIMD_TARGET static inline M Less(I a, I b) { return _mm256_cmpgt_epi32(b, a); }
+	SIMD_TARGET static inline M Greater(I a, I b) { return _mm256_cmpgt_epi32(a, b); }
+	SIMD_TARGET static inline I Select(M m, I a, I b) { return _mm256_blendv_epi8(b, a, m); }
+
+	// products of the even and odd lanes, shifted into the low and high halves of each 64-bit lane
+	template<int S> SIMD_TARGET static inline I MulShift(I a, I b)
+	{
+		__m256i even = _mm256_srli_epi64(_mm256_mul_epi32(a, b), S);
+		__m256i odd = _mm256_slli_epi64(_mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)), 32 - S);
+		return _mm256_blend_epi32(even, odd, 0xaa);
+	}
+	template<int S> SIMD_TARGET static inline I ShiftLeft(I a) { return _mm256_slli_epi32(a, S); }
+	template<int S> SIMD_TARGET static inline I ShiftRight(I a) { return _mm256_srai_epi32(a, S); }
+	SIMD_TARGET static inline I ShiftLeftBy(I a, I count) { return _mm256_sllv_epi32(a, count); }
+	SIMD_TARGET static inline I ShiftRightBy(I a, I count) { return _mm256_srav_epi32(a, count); }
+
+	SIMD_TARGET static inline void SplitMulAdd(I a, int32_t b, I s, int32_t t, int64_t c, int bits, I& whole, I& fraction)
+	{
+		const __m256i B = _mm256_set1_epi32(b);
+		const __m256i T = _mm256_set1_epi32(t);
+		const __m256i C = _mm256_set1_epi64x(c);
+		__m256i even = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epi32(a, B), _mm256_mul_epi32(s, T)), C);
+		__m256i odd = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epi32(_mm256_srli_epi64(a, 32), B), _mm256_mul_epi32(_mm256_srli_epi64(s, 32), T)), C);
+
+		// the high halves, shifted down past the rest of the fraction
+		whole = _mm256_sra_epi32(_mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa), _mm_cvtsi32_si128(bits - 32));
+
+		const __m128i down = _mm_cvtsi32_si128(bits - TerrainNoiseFixed::NoiseBits);
+		fraction = _mm256_blend_epi32(_mm256_srl_epi64(even, down), _mm256_slli_epi64(_mm256_srl_epi64(odd, down), 32), 0xaa);
+		fraction = _mm256_and_si256(fraction, _mm256_set1_epi32(0xffffff));
+	}
+
+	SIMD_TARGET static inline I Log2Floor(I a)
+	{
+		return _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(a)), 23), _mm256_set1_epi32(127));
+	}
+
+	SIMD_TARGET static inline I FromWorld(const float* p)
+	{
+		__m256 v = _mm256_max_ps(_mm256_loadu_ps(p), _mm256_set1_ps(-TerrainNoiseFixed::MaxCoordinate));
+		v = _mm256_min_ps(v, _mm256_set1_ps(TerrainNoiseFixed::MaxCoordinate));
+		return _mm256_cvttps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(65536.0f)));
+	}
+
+	SIMD_TARGET static inline void StoreHeights(float* p, I h)
+	{
+		_mm256_storeu_ps(p, _mm256_mul_ps(_mm256_cvtepi32_ps(h), _mm256_set1_ps(1.0f / 65536.0f)));
+	}
+
+	SIMD_TARGET static inline I Ratio(I a, I b)
+	{
+		__m256 r = _mm256_div_ps(_mm256_cvtepi32_ps(a), _mm256_cvtepi32_ps(b));
+		r = _mm256_min_ps(_mm256_max_ps(r, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+		return _mm256_cvttps_epi32(_mm256_mul_ps(r, _mm256_set1_ps(16777216.0f)));
+	}
+
+#include "TerrainNoiseFixed.inl"
+
+#undef SIMD_TARGET
+}
+
+namespace NoiseFixedAVX512
+{
+#define SIMD_TARGET CPU_TARGET_AVX512
+
+	typedef __m512i I;
+	typedef __mmask16 M;
+	static const int Width = 16;
+
+	SIMD_TARGET static inline I Set(int32_t v) { return _mm512_set1_epi32(v); }
+
+	SIMD_TARGET static inline I Add(I a, I b) { return _mm512_add_epi32(a, b); }
+	SIMD_TARGET static inline I Sub(I a, I b) { return _mm512_sub_epi32(a, b); }
+	SIMD_TARGET static inline I MulLo(I a, I b) { return _mm512_mullo_epi32(a, b); }
+	SIMD_TARGET static inline I Min(I a, I b) { return _mm512_min_epi32(a, b); }
+	SIMD_TARGET static inline I Max(I a, I b) { return _mm512_max_epi32(a, b); }
+	SIMD_TARGET static inline I Abs(I a) { return _mm512_abs_epi32(a); }
+
+	SIMD_TARGET static inline M Less(I a, I b) { return _mm512_cmplt_epi32_mask(a, b); }
+	SIMD_TARGET static inline M Greater(I a, I b) { return _mm512_cmpgt_epi32_mask(a, b); }
+	SIMD_TARGET static inline I Select(M m, I a, I b) { return _mm512_mask_blend_epi32(m, b, a); }
+
+	template<int S> SIMD_TARGET static inline I MulShift(I a, I b)
+	{
+		__m512i even = _mm512_srli_epi64(_mm512_mul_epi32(a, b), S);
+		__m512i odd = _mm512_slli_epi64(_mm512_mul_epi32(_mm512_srli_epi64(a, 32), _mm512_srli_epi64(b, 32)), 32 - S);
+		return _mm512_mask_blend_epi32(0xaaaa, even, odd);
+	}
+	template<int S> SIMD_TARGET static inline I ShiftLeft(I a) { return _mm512_slli_epi32(a, S); }
+	template<int S> SIMD_TARGET static inline I ShiftRight(I a) { return _mm512_srai_epi32(a, S); }
+	SIMD_TARGET static inline I ShiftLeftBy(I a, I count) { return _mm512_sllv_epi32(a, count); }
+	SIMD_TARGET static inline I ShiftRightBy(I a, I count) { return _mm512_srav_epi32(a, count); }
+
+	SIMD_TARGET static inline void SplitMulAdd(I a, int32_t b, I s, int32_t t, int64_t c, int bits, I& whole, I& fraction)
+	{
+		const __m512i B = _mm512_set1_epi32(b);
+		const __m512i T = _mm512_set1_epi32(t);
+		const __m512i C = _mm512_set1_epi64(c);
+		__m512i even = _mm512_add_epi64(_mm512_add_epi64(_mm512_mul_epi32(a, B), _mm512_mul_epi32(s, T)), C);
+		__m512i odd = _mm512_add_epi64(_mm512_add_epi64(_mm512_mul_epi32(_mm512_srli_epi64(a, 32), B), _mm512_mul_epi32(_mm512_srli_epi64(s, 32), T)), C);
+
+		whole = _mm512_sra_epi32(_mm512_mask_blend_epi32(0xaaaa, _mm512_srli_epi64(even, 32), odd), _mm_cvtsi32_si128(bits - 32));
+
+		const __m128i down = _mm_cvtsi32_si128(bits - TerrainNoiseFixed::NoiseBits);
+		fraction = _mm512_mask_blend_epi32(0xaaaa, _mm512_srl_epi64(even, down), _mm512_slli_epi64(_mm512_srl_epi64(odd, down), 32));
+		fraction = _mm512_and_si512(fraction, _mm512_set1_epi32(0xffffff));
+	}
+
+	SIMD_TARGET static inline I Log2Floor(I a)
+	{
+		return _mm512_sub_epi32(_mm512_srli_epi32(_mm512_castps_si512(_mm512_cvtepi32_ps(a)), 23), _mm512_set1_epi32(127));
+	}
+
+	SIMD_TARGET static inline I FromWorld(const float* p)
+	{
+		__m512 v = _mm512_max_ps(_mm512_loadu_ps(p), _mm512_set1_ps(-TerrainNoiseFixed::MaxCoordinate));
+		v = _mm512_min_ps(v, _mm512_set1_ps(TerrainNoiseFixed::MaxCoordinate));
+		return _mm512_cvttps_epi32(_mm512_mul_ps(v, _mm512_set1_ps(65536.0f)));
+	}
+
+	SIMD_TARGET static inline void StoreHeights(float* p, I h)
+	{
+		_mm512_storeu_ps(p, _mm512_mul_ps(_mm512_cvtepi32_ps(h), _mm512_set1_ps(1.0f / 65536.0f)));
+	}
+
+	SIMD_TARGET static inline I Ratio(I a, I b)
+	{
+		__m512 r = _mm512_div_ps(_mm512_cvtepi32_ps(a), _mm512_cvtepi32_ps(b));
+		r = _mm512_min_ps(_mm512_max_ps(r, _mm512_setzero_ps()), _mm512_set1_ps(1.0f));
+		return _mm512_cvttps_epi32(_mm512_mul_ps(r, _mm512_set1_ps(16777216.0f)));
+	}
+
+#include "TerrainNoiseFixed.inl"
+
+#undef SIMD_TARGET
+}
+#endif
+
+
+// SETTINGS
+// converted with single float multiplies by powers of 2 and truncation, so they're the same everywhere too
+
+static int32_t ToFixed(float v, int bits)
+{
+	// NaN becomes 0
+	v = v * static_cast<float>(1 << bits);
+	if (!(v > -2147483520.0f)) return v < 0.0f ? -2147483520 : 0;
+	return v < 2147483520.0f ? static_cast<int32_t>(v) : 2147483520;
+}
+
+// (sqrt(3) - 1) / 2, with 31 fractional bits
+static const int64_t SkewFactor = 786033569;
+
+// v times the skew factor, rounded down, for any v below 2^62
+static int64_t SkewTerm(int64_t v)
+{
+	int64_t high = v >> 31;
+	int64_t low = v - high * (static_cast<int64_t>(1) << 31);
+	return high * SkewFactor + (low * SkewFactor >> 31);
+}
+
+// an octave's frequency keeps 30 significant bits, but at least HeightBits fractional bits
+static void SetFrequency(float f, TerrainNoiseFixed::Octave& octave)
+{
+	f = f < TerrainNoiseFixed::MaxFrequency ? f : TerrainNoiseFixed::MaxFrequency;
+	f = f > -TerrainNoiseFixed::MaxFrequency ? f : -TerrainNoiseFixed::MaxFrequency;
+
+	int bits = 30;
+	while (bits > TerrainNoiseFixed::HeightBits && fabsf(f) * static_cast<float>(1 << bits) >= 2147483520.0f)
+		bits--;
+	octave.frequency = ToFixed(f, bits);
+	octave.skewedFrequency = static_cast<int32_t>(SkewTerm(octave.frequency));
+	octave.fractionBits = TerrainNoiseFixed::HeightBits + bits;
+}
+
+// the offset is skewed exactly, in the octave's fixed point
+static void SetOffset(const XMFLOAT2& offset, TerrainNoiseFixed::Octave& octave)
+{
+	const double scale = static_cast<double>(static_cast<int64_t>(1) << octave.fractionBits);
+	const double limit = static_cast<double>(TerrainNoiseFixed::MaxCoordinate) * scale;
+	double ox = static_cast<double>(offset.x) * scale;
+	double oy = static_cast<double>(offset.y) * scale;
+	ox = ox > -limit ? (ox < limit ? ox : limit) : -limit;
+	oy = oy > -limit ? (oy < limit ? oy : limit) : -limit;
+
+	int64_t s = SkewTerm(static_cast<int64_t>(ox) + static_cast<int64_t>(oy));
+	octave.offsetX = static_cast<int64_t>(ox) + s;
+	octave.offsetY = static_cast<int64_t>(oy) + s;
+}
+
+// band limiting weight of an octave (see TerrainNoiseCPU::OctaveWeight), with the smoothstep in fixed point
+static int32_t OctaveWeight(float frequency, float sampleSpacing)
+{
+	if (sampleSpacing <= 0.0f) return NoiseFixedScalar::One;
+
+	float cycles = fabsf(frequency) * sampleSpacing;
+	if (cycles <= TerrainNoiseCPU::OctaveFadeStart) return NoiseFixedScalar::One;
+	if (cycles >= TerrainNoiseCPU::OctaveCutoff) return 0;
+
+	int32_t t = ToFixed((cycles - TerrainNoiseCPU::OctaveFadeStart) / (TerrainNoiseCPU::OctaveCutoff - TerrainNoiseCPU::OctaveFadeStart),
+		TerrainNoiseFixed::NoiseBits);
+	return NoiseFixedScalar::One - NoiseFixedScalar::SmoothStep(t);
+}
+
+// octaves of a layer, as TerrainNoiseKernel's tables; amplitudes are left out of the mountains'
+template<typename Settings>
+static void BuildLayer(const Settings& settings, float sampleSpacing, bool amplitudes, std::vector<TerrainNoiseFixed::Octave>& octaves)
+{
+	octaves.clear();
+
+	float f = settings.Frequency;
+	float a = 1.0f;
+	for (int octave = 0; octave < settings.Octaves; octave++)
+	{
+		// octaves only get finer, so the first to be cut off ends the layer
+		int32_t weight = OctaveWeight(f, sampleSpacing);
+		if (weight <= 0 && settings.Lacunarity >= 1.0f) break;
+
+		TerrainNoiseFixed::Octave o;
+		SetFrequency(f, o);
+		SetOffset(settings.Offset, o);
+		o.amplitude = amplitudes ? NoiseFixedScalar::MulShift<24>(ToFixed(a, TerrainNoiseFixed::NoiseBits), weight) : weight;
+		octaves.push_back(o);
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence;
+	}
+}
+
+TerrainNoiseFixed::TerrainNoiseFixed(const TerrainNoiseSettings& settings, float sampleSpacing)
+	: m_Settings(settings)
+	, m_SampleSpacing(sampleSpacing)
+{
+	Parameters& p = m_Parameters;
+
+	p.mountainsEnabled = settings.MountainSettings.Elevation > 0.0f;
+	p.ridgesEnabled = p.mountainsEnabled && settings.RidgeSettings.Elevation > 0.0f;
+
+	BuildLayer(settings.ContinentSettings, sampleSpacing, true, p.continent);
+	if (p.mountainsEnabled)
+		BuildLayer(settings.MountainSettings, sampleSpacing, false, p.mountains);
+	if (p.ridgesEnabled)
+		BuildLayer(settings.RidgeSettings, sampleSpacing, true, p.ridges);
+
+	p.continentElevation = ToFixed(settings.ContinentSettings.Elevation, HeightBits);
+	p.continentShift = ToFixed(settings.ContinentSettings.VerticalShift, HeightBits);
+
+	p.mountainElevation = ToFixed(settings.MountainSettings.Elevation, HeightBits);
+	p.mountainPersistence = ToFixed(settings.MountainSettings.Persistence, NoiseBits);
+	p.blending = ToFixed(settings.MountainSettings.Blending, NoiseBits);
+	p.detail = ToFixed(settings.MountainSettings.Detail, NoiseBits);
+
+	p.ridgeElevation = ToFixed(settings.RidgeSettings.Elevation, HeightBits);
+	float power = settings.RidgeSettings.Power < MaxRidgePower ? settings.RidgeSettings.Power : MaxRidgePower;
+	p.ridgePower = ToFixed(power, HeightBits);
+	p.ridgePower = p.ridgePower > 1 ? p.ridgePower : 1;
+	p.ridgeGain = ToFixed(settings.RidgeSettings.Gain, HeightBits);
+	p.ridgeThreshold = ToFixed(settings.RidgeSettings.RidgeThreshold, HeightBits);
+	// power * log2 must stay above -2^31 (in NoiseBits), and nothing below -25 matters
+	int64_t minLog = -(static_cast<int64_t>(25) << (NoiseBits + HeightBits)) / p.ridgePower;
+	p.ridgeMinLog = static_cast<int32_t>(minLog > -(static_cast<int64_t>(32) << NoiseBits) ? minLog : -(static_cast<int64_t>(32) << NoiseBits));
+
+	// SmoothMax(continent, -depth, smoothing) takes a smoothing of k > 0 as -k, and anything else as -0
+	p.oceanFloor = -ToFixed(settings.OceanFloorDepth, HeightBits);
+	p.oceanSmoothing = settings.OceanFloorSmoothing > 0.0f ? ToFixed(settings.OceanFloorSmoothing, HeightBits) : 0;
+	p.oceanDepthScale = ToFixed(1 + settings.OceanDepthMultiplier, HeightBits);
+}
+
+float TerrainNoiseFixed::SNoise(float x, float y)
+{
+	int32_t px = NoiseFixedScalar::FromWorld(&x);
+	int32_t py = NoiseFixedScalar::FromWorld(&y);
+
+	// an octave of frequency 1 at no offset
+	Octave octave;
+	SetFrequency(1.0f, octave);
+	return static_cast<float>(NoiseFixedScalar::SNoise(px, py, px + py, octave)) * (1.0f / 16777216.0f);
+}
+
+// saturate(a / b), to NoiseBits; NaN becomes 0
+static int32_t BlendRatio(int64_t a, int64_t b)
+{
+	float r = static_cast<float>(a) / static_cast<float>(b);
+	r = r > 0.0f ? (r < 1.0f ? r : 1.0f) : 0.0f;
+	return static_cast<int32_t>(r * 16777216.0f);
+}
+
+float TerrainNoiseFixed::BiomeBlend(float biomeUV, float blending)
+{
+	const int64_t one = 1 << NoiseBits;
+	const int64_t uv = ToFixed(biomeUV, NoiseBits);
+	const int64_t b = ToFixed(blending, NoiseBits);
+
+	int64_t blend = 0;
+	if (uv <= one / 2)
+		blend += NoiseFixedScalar::SmoothStep(BlendRatio(2 * uv + b, 2 * b)) - one;
+	if (uv >= one / 2)
+		blend += NoiseFixedScalar::SmoothStep(BlendRatio((uv * (one + b) >> NoiseBits) - one, 2 * b));
+	return static_cast<float>(blend) * (1.0f / 16777216.0f);
+}
+
+float TerrainNoiseFixed::Lerp(float a, float b, float t)
+{
+	const int64_t fa = ToFixed(a, HeightBits);
+	const int64_t fb = ToFixed(b, HeightBits);
+	const int64_t ft = ToFixed(t, NoiseBits);
+	return static_cast<float>(fa + ((fb - fa) * ft >> NoiseBits)) * (1.0f / 65536.0f);
+}
+
+void TerrainNoiseFixed::TerrainNoise(const float* x, const float* y, int count, float* heights) const
+{
+	if (CPUFeatures::HasAVX512())
+		TerrainNoiseAVX512(x, y, count, heights);
+	else if (CPUFeatures::HasAVX2())
+		TerrainNoiseAVX2(x, y, count, heights);
+	else
+		TerrainNoiseScalar(x, y, count, heights);
+}
+
+void TerrainNoiseFixed::TerrainNoiseScalar(const float* x, const float* y, int count, float* heights) const
+{
+	NoiseFixedScalar::TerrainNoiseBatch(m_Parameters, x, y, count, heights);
+}
+
+void TerrainNoiseFixed::TerrainNoiseAVX2(const float* x, const float* y, int count, float* heights) const
+{
+#if CPU_X86
+	NoiseFixedAVX2::TerrainNoiseBatch(m_Parameters, x, y, count, heights);
+#else
+	TerrainNoiseScalar(x, y, count, heights);
+#endif
+}
+
+void TerrainNoiseFixed::TerrainNoiseAVX512(const float* x, const float* y, int count, float* heights) const
+{
+#if CPU_X86
+	NoiseFixedAVX512::TerrainNoiseBatch(m_Parameters, x, y, count, heights);
+#else
+	TerrainNoiseScalar(x, y, count, heights);
+#endif
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "NoiseSettings.h"
+
+
+// TerrainNoise in fixed point, for heights that must be identical wherever they're generated (e.g. tiles baked on different
+// machines meeting at a seam)
+// Float noise depends on the compiler: whether multiply-adds are fused, and which pairs, changes the last bits, and the
+// vector kernels compute pow differently again; here the simplex lattice, hashing, gradients and fractal sums are all
+// integer arithmetic, written once (TerrainNoiseFixed.inl) and compiled for scalar, AVX2 and AVX-512 code, which all
+// produce the same bits
+// The only float operations are single IEEE operations, exact or correctly rounded: converting coordinates in and heights
+// out, and the divisions of smoothstep and smooth max
+//
+// The heights follow TerrainNoiseCPU::TerrainNoise closely but aren't equal to it: coordinates are quantised to
+// 1 / 65536 of a world unit, and noise and weights to 24 bits; see FloatTolerance
+// World coordinates must lie within +-MaxCoordinate, and frequencies within +-MaxFrequency; ridge powers are clamped to
+// (0, MaxRidgePower]
+class TerrainNoiseFixed
+{
+public:
+	// fractional bits of heights and elevations (and world coordinates), and of noise, amplitudes and weights
+	static const int HeightBits = 16;
+	static const int NoiseBits = 24;
+
+	static const float MaxCoordinate;
+	static const float MaxFrequency;
+	static const float MaxRidgePower;
+
+	// largest difference from TerrainNoiseCPU's heights per unit of noise, as TerrainNoiseCPU::NoiseTolerance
+	static const float FloatTolerance;
+
+	// an octave of a layer, ready to evaluate
+	struct Octave
+	{
+		// frequency, and frequency times the skew factor (sqrt(3) - 1) / 2, with fractionBits - HeightBits fractional bits
+		// so they keep 30 significant bits
+		int32_t frequency = 0;
+		int32_t skewedFrequency = 0;
+		int fractionBits = 32;
+		// offset, skewed onto the simplex lattice, with fractionBits fractional bits
+		int64_t offsetX = 0;
+		int64_t offsetY = 0;
+		// amplitude times band limiting weight; for mountains only the weight, as their amplitude depends on the noise
+		int32_t amplitude = 0;
+	};
+
+	// the settings in fixed point: elevations, shifts and depths in HeightBits, and the rest in NoiseBits
+	// (except ridge power and gain, which scale noise so are in HeightBits)
+	struct Parameters
+	{
+		// octaves evaluated, after band limiting
+		std::vector<Octave> continent;
+		std::vector<Octave> mountains;
+		std::vector<Octave> ridges;
+
+		// ridges are scaled by the mountains, so vanish without them
+		bool mountainsEnabled = false;
+		bool ridgesEnabled = false;
+
+		int32_t continentElevation = 0;
+		int32_t continentShift = 0;
+
+		int32_t mountainElevation = 0;
+		int32_t mountainPersistence = 0;
+		int32_t blending = 0;
+		int32_t detail = 0;
+
+		int32_t ridgeElevation = 0;
+		int32_t ridgePower = 0;
+		int32_t ridgeGain = 0;
+		int32_t ridgeThreshold = 0;
+		// lowest log2 the ridges' pow can be raised to the power from without overflowing
+		int32_t ridgeMinLog = 0;
+
+		int32_t oceanFloor = 0;
+		int32_t oceanSmoothing = 0;
+		// 1 + the ocean depth multiplier
+		int32_t oceanDepthScale = 0;
+	};
+
+	TerrainNoiseFixed(const TerrainNoiseSettings& settings, float sampleSpacing = 0.0f);
+
+	// 2D simplex noise in [-1, 1], at a point of noise space
+	static float SNoise(float x, float y);
+
+	// blending between biomes, so that blended heights are the same everywhere too
+	// GetBiomeBlend in biomeHelper.hlsli for one axis, to NoiseBits
+	static float BiomeBlend(float biomeUV, float blending);
+	// a + t * (b - a), for heights and blends as returned above
+	static float Lerp(float a, float b, float t);
+
+	// heights[i] = this TerrainNoise at (x[i], y[i]) for count points; every implementation returns the same heights
+	void TerrainNoise(const float* x, const float* y, int count, float* heights) const;
+
+	// implementations, selected between by TerrainNoise
+	void TerrainNoiseScalar(const float* x, const float* y, int count, float* heights) const;
+	void TerrainNoiseAVX2(const float* x, const float* y, int count, float* heights) const;
+	void TerrainNoiseAVX512(const float* x, const float* y, int count, float* heights) const;
+
+	inline const TerrainNoiseSettings& GetSettings() const { return m_Settings; }
+	inline float GetSampleSpacing() const { return m_SampleSpacing; }
+	inline const Parameters& GetParameters() const { return m_Parameters; }
+
+private:
+	TerrainNoiseSettings m_Settings;
+	float m_SampleSpacing = 0.0f;
+
+	Parameters m_Parameters;
+};
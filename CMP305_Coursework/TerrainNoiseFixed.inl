@@ -0,0 +1,308 @@
+// Fixed point terrain noise, written once against a small set of integer operations and compiled for each instruction set
+// Included by TerrainNoiseFixed.cpp inside a namespace that defines:
+//	I, M					32-bit integer vector and comparison mask types, Width lanes wide
+//	Set, Add, Sub, MulLo, Min, Max, Abs, Less, Greater, Select(mask, ifTrue, ifFalse)
+//	MulShift<S>(a, b)		the low 32 bits of the 64-bit product a * b shifted right by S (S <= 32)
+//	ShiftLeft<S>, ShiftRight<S>, ShiftLeftBy, ShiftRightBy		shifts, by a constant or by each lane's count; right shifts are arithmetic
+//	SplitMulAdd(a, b, s, t, c, bits, whole, fraction)	the 64-bit a * b + s * t + c, with bits fractional bits, split into its
+//							whole part and its top NoiseBits fractional bits
+//	Log2Floor				floor(log2(a)) for 0 < a <= 2^24
+//	FromWorld, StoreHeights	world coordinates in, clamped and truncated to HeightBits, and heights out
+//	Ratio					saturate(a / b) in NoiseBits, as a correctly rounded float division; NaN (0 / 0) gives 0
+// and SIMD_TARGET, the attribute every function needs to use the instruction set
+//
+// Every operation gives the same bits in every namespace, so the noise does too
+// The steps follow TerrainNoiseCPU's scalar reference (and so noiseSimplex.hlsli) with the constants rounded to fixed point
+
+
+static const int32_t One = 1 << TerrainNoiseFixed::NoiseBits;
+
+// D3D saturate, in NoiseBits
+SIMD_TARGET static inline I Saturate(I x)
+{
+	return Min(Max(x, Set(0)), Set(One));
+}
+
+// smoothstep of t in [0, 1]
+SIMD_TARGET static inline I SmoothStep(I t)
+{
+	return MulShift<24>(MulShift<24>(t, t), Sub(Set(3 * One), Add(t, t)));
+}
+
+
+// SIMPLEX NOISE
+// simplex cells are found from the point skewed onto the lattice: f * (x, y) + offset + (f * (x + y) + offsetX + offsetY) * (sqrt(3) - 1) / 2
+// each octave has its frequency times (sqrt(3) - 1) / 2 and its skewed offset ready, so a point is skewed exactly in one 64-bit
+// multiply-add per axis, which leaves the cell as the whole part and the offset within the cell as the fraction, however large
+// the coordinates
+
+// x * 289, and x * 34 + 1
+SIMD_TARGET static inline I Times289(I x)
+{
+	return Add(Add(ShiftLeft<8>(x), ShiftLeft<5>(x)), x);
+}
+
+SIMD_TARGET static inline I Times34Plus1(I x)
+{
+	return Add(Add(ShiftLeft<5>(x), ShiftLeft<1>(x)), Set(1));
+}
+
+// x mod 289 for any x
+SIMD_TARGET static inline I Mod289Wide(I x)
+{
+	// 65536 = 222 (mod 289), and the bias is a multiple of 289 that keeps the sum positive
+	I high = ShiftRight<16>(x);
+	x = Add(Add(MulLo(high, Set(222)), Sub(x, ShiftLeft<16>(high))), Set(7340600));
+	return Sub(x, Times289(MulShift<32>(x, Set(14861479))));
+}
+
+// x mod 289 for 0 <= x < 2^24
+SIMD_TARGET static inline I Mod289(I x)
+{
+	return Sub(x, Times289(MulShift<32>(x, Set(14861479))));
+}
+
+// (34 * x * x + x) mod 289
+SIMD_TARGET static inline I Permute(I x)
+{
+	return Mod289(MulLo(x, Times34Plus1(x)));
+}
+
+// gradient of a corner with hash p, and the factor normalising it
+SIMD_TARGET static inline void Gradient(I p, I& a, I& h, I& n)
+{
+	// 41 points uniformly over a line: gx = g / 41 for odd g in [-41, 39]
+	I g = Sub(Add(p, p), Set(41));
+	I q = MulShift<32>(p, Set(104755300));
+	g = Sub(g, Add(Add(ShiftLeft<6>(q), ShiftLeft<4>(q)), Add(q, q)));
+
+	// mapped onto a diamond, as numerators over 82: h = |gx| - 0.5 and a = gx - floor(gx + 0.5)
+	I hn = Sub(Add(Abs(g), Abs(g)), Set(41));
+	I an = Add(g, g);
+	an = Select(Greater(g, Set(20)), Sub(an, Set(82)), Select(Less(g, Set(-20)), Add(an, Set(82)), an));
+
+	a = MulLo(an, Set(204600));
+	h = MulLo(hn, Set(204600));
+	// 1.79284291400159 - 0.85373472095314 * (a * a + h * h)
+	n = Sub(Set(30078913), MulShift<16>(Add(MulLo(an, an), MulLo(hn, hn)), Set(139603101)));
+}
+
+// a corner's contribution, given the point's offset from it, in 30 fractional bits so they're summed before scaling
+SIMD_TARGET static inline I Contribution(I x, I y, I p)
+{
+	I a, h, n;
+	Gradient(p, a, h, n);
+
+	// m^4 in 30 fractional bits
+	I m = Max(Sub(Set(One / 2), Add(MulShift<24>(x, x), MulShift<24>(y, y))), Set(0));
+	m = MulShift<18>(m, m);
+	m = MulShift<30>(m, m);
+	m = MulShift<24>(m, n);
+
+	I g = Add(MulShift<24>(a, x), MulShift<24>(h, y));
+	return MulShift<24>(m, g);
+}
+
+// simplex noise of an octave at points (x, y) in HeightBits, with xy = x + y; in NoiseBits
+SIMD_TARGET static inline I SNoise(I x, I y, I xy, const TerrainNoiseFixed::Octave& octave)
+{
+	const I Cx = Set(3545443);		// (3.0-sqrt(3.0))/6.0
+	const I Cz = Set(-9686330);		// -1.0 + 2.0 * C.x
+
+	I ix, iy, u, v;
+	SplitMulAdd(x, octave.frequency, xy, octave.skewedFrequency, octave.offsetX, octave.fractionBits, ix, u);
+	SplitMulAdd(y, octave.frequency, xy, octave.skewedFrequency, octave.offsetY, octave.fractionBits, iy, v);
+
+	// first corner: unskewing the offset within the cell gives the offset from it
+	I t = MulShift<31>(Add(u, v), Set(453816693));
+	I x0 = Sub(u, t);
+	I y0 = Sub(v, t);
+
+	// other corners
+	M xGreater = Greater(u, v);
+	I i1x = Select(xGreater, Set(1), Set(0));
+	I i1y = Select(xGreater, Set(0), Set(1));
+
+	I x1 = Sub(Add(x0, Cx), ShiftLeft<24>(i1x));
+	I y1 = Sub(Add(y0, Cx), ShiftLeft<24>(i1y));
+	I x2 = Add(x0, Cz);
+	I y2 = Add(y0, Cz);
+
+	// permutations
+	ix = Mod289Wide(ix);
+	iy = Mod289Wide(iy);
+	// the middle corner's row is one of the others'
+	I row0 = Permute(iy);
+	I row1 = Permute(Add(iy, Set(1)));
+	I p0 = Permute(Add(row0, ix));
+	I p1 = Permute(Add(Add(Select(xGreater, row0, row1), ix), i1x));
+	I p2 = Permute(Add(Add(row1, ix), Set(1)));
+
+	I sum = Add(Add(Contribution(x0, y0, p0), Contribution(x1, y1, p1)), Contribution(x2, y2, p2));
+	return ShiftRight<6>(MulLo(sum, Set(130)));
+}
+
+
+// pow(x, p) for x in [0, 1] in NoiseBits and p > 0 in HeightBits; minLog keeps p * log2(x) from overflowing
+// log2 and exp2 use the same polynomials as the float kernels' Log2 and Exp2, in 30 fractional bits
+SIMD_TARGET static inline I Pow(I x, I p, I minLog)
+{
+	x = Min(x, Set(One));
+	M positive = Greater(x, Set(0));
+	x = Max(x, Set(1));
+
+	// x = m * 2^e with m in [1, 2), then centred on 1
+	I e = Log2Floor(x);
+	I m = ShiftLeftBy(x, Sub(Set(30), e));
+	M large = Greater(m, Set(1518500250));
+	m = Select(large, ShiftRight<1>(m), m);
+	e = Select(large, Add(e, Set(1)), e);
+	m = Sub(m, Set(1 << 30));
+
+	I z = MulShift<30>(m, m);
+	I y = Set(75566553);
+	y = Add(MulShift<30>(y, m), Set(-123637187));
+	y = Add(MulShift<30>(y, m), Set(125380819));
+	y = Add(MulShift<30>(y, m), Set(-133360247));
+	y = Add(MulShift<30>(y, m), Set(153000938));
+	y = Add(MulShift<30>(y, m), Set(-178971906));
+	y = Add(MulShift<30>(y, m), Set(214756040));
+	y = Add(MulShift<30>(y, m), Set(-268435392));
+	y = Add(MulShift<30>(y, m), Set(357913918));
+	y = MulShift<30>(MulShift<30>(y, m), z);
+	y = Sub(y, ShiftRight<1>(z));
+
+	// log2(x) in NoiseBits, from the natural log of the mantissa
+	I l = Add(ShiftLeft<24>(Sub(e, Set(24))), ShiftRight<6>(MulShift<30>(Add(m, y), Set(1549082005))));
+	l = MulShift<16>(Max(l, minLog), p);
+
+	// 2^l = 2^f * 2^n, with f in [-0.5, 0.5) in 30 fractional bits; 2^-25 is below NoiseBits' precision
+	l = Max(l, Set(-25 * One));
+	I n = ShiftRight<24>(Add(l, Set(One / 2)));
+	I f = ShiftLeft<6>(Sub(l, ShiftLeft<24>(n)));
+
+	I q = Set(164855);
+	q = Add(MulShift<30>(q, f), Set(1438693));
+	q = Add(MulShift<30>(q, f), Set(10327718));
+	q = Add(MulShift<30>(q, f), Set(59596241));
+	q = Add(MulShift<30>(q, f), Set(257941218));
+	q = Add(MulShift<30>(q, f), Set(744261142));
+	q = Add(MulShift<30>(q, f), Set(1 << 30));
+
+	return Select(positive, ShiftRightBy(q, Sub(Set(6), n)), Set(0));
+}
+
+
+// TERRAIN NOISE
+// the layers of TerrainNoise at points in HeightBits, as TerrainNoiseFrom in TerrainNoiseCPU.cpp
+
+SIMD_TARGET static inline I ContinentShape(const TerrainNoiseFixed::Parameters& parameters, I x, I y, I xy)
+{
+	I sum = Set(0);
+	for (const TerrainNoiseFixed::Octave& octave : parameters.continent)
+		sum = Add(sum, MulShift<24>(SNoise(x, y, xy, octave), Set(octave.amplitude)));
+
+	return Add(MulShift<24>(sum, Set(parameters.continentElevation)), Set(parameters.continentShift));
+}
+
+SIMD_TARGET static inline I MountainShape(const TerrainNoiseFixed::Parameters& parameters, I x, I y, I xy)
+{
+	I sum = Set(0);
+	I a = Set(One);
+
+	for (const TerrainNoiseFixed::Octave& octave : parameters.mountains)
+	{
+		I noiseVal1 = Abs(SNoise(x, y, xy, octave));
+		I noiseVal2 = MulShift<24>(noiseVal1, Sub(Set(One), SmoothStep(Ratio(Set(parameters.blending), noiseVal1))));
+
+		sum = Add(sum, MulShift<24>(noiseVal2, MulShift<24>(a, Set(octave.amplitude))));
+
+		a = MulShift<24>(a, MulShift<24>(Set(parameters.mountainPersistence), Sub(Set(One), SmoothStep(Ratio(Set(parameters.detail), noiseVal1)))));
+	}
+
+	return MulShift<24>(sum, Set(parameters.mountainElevation));
+}
+
+SIMD_TARGET static inline I RidgeShape(const TerrainNoiseFixed::Parameters& parameters, I x, I y, I xy)
+{
+	I sum = Set(0);
+	I ridgeWeight = Set(One);
+
+	for (const TerrainNoiseFixed::Octave& octave : parameters.ridges)
+	{
+		I noiseVal = Sub(Set(One), Abs(SNoise(x, y, xy, octave)));
+		noiseVal = Pow(Abs(noiseVal), Set(parameters.ridgePower), Set(parameters.ridgeMinLog));
+		noiseVal = MulShift<24>(noiseVal, ridgeWeight);
+		ridgeWeight = Saturate(MulShift<16>(noiseVal, Set(parameters.ridgeGain)));
+
+		sum = Add(sum, MulShift<24>(noiseVal, Set(octave.amplitude)));
+	}
+
+	return MulShift<24>(sum, Set(parameters.ridgeElevation));
+}
+
+// TerrainNoiseCPU::SmoothMax(a, b, -k) for k >= 0
+SIMD_TARGET static inline I SmoothMax(I a, I b, I k)
+{
+	I h = Ratio(Add(Sub(a, b), k), Add(k, k));
+	I g = Sub(Set(One), h);
+	return Add(Add(MulShift<24>(a, h), MulShift<24>(b, g)), MulShift<24>(k, MulShift<24>(h, g)));
+}
+
+// heights in HeightBits
+SIMD_TARGET static inline I TerrainHeight(const TerrainNoiseFixed::Parameters& parameters, I x, I y, I xy)
+{
+	// create continent shape
+	I continentShape = ContinentShape(parameters, x, y, xy);
+
+	// create mountains and ridges
+	I mountainShape = Set(0), ridgeShape = Set(0);
+	if (parameters.mountainsEnabled)
+		mountainShape = MountainShape(parameters, x, y, xy);
+	if (parameters.ridgesEnabled)
+	{
+		ridgeShape = RidgeShape(parameters, x, y, xy);
+		ridgeShape = MulShift<24>(ridgeShape, SmoothStep(Ratio(mountainShape, Set(parameters.ridgeThreshold))));
+	}
+
+	// create ocean floor
+	continentShape = SmoothMax(continentShape, Set(parameters.oceanFloor), Set(parameters.oceanSmoothing));
+	continentShape = Select(Less(continentShape, Set(0)), MulShift<16>(continentShape, Set(parameters.oceanDepthScale)), continentShape);
+
+	return Add(Add(continentShape, mountainShape), ridgeShape);
+}
+
+SIMD_TARGET static void TerrainNoiseBatch(const TerrainNoiseFixed::Parameters& parameters, const float* x, const float* y, int count, float* heights)
+{
+	// the last points go through a whole vector of padding
+	float padX[Width], padY[Width], padHeights[Width];
+
+	for (int start = 0; start < count; start += Width)
+	{
+		const float* vx = x + start;
+		const float* vy = y + start;
+		float* vh = heights + start;
+		const int points = count - start < Width ? count - start : Width;
+		if (points < Width)
+		{
+			for (int i = 0; i < Width; i++)
+			{
+				padX[i] = i < points ? vx[i] : 0.0f;
+				padY[i] = i < points ? vy[i] : 0.0f;
+			}
+			vx = padX;
+			vy = padY;
+			vh = padHeights;
+		}
+
+		I px = FromWorld(vx);
+		I py = FromWorld(vy);
+		StoreHeights(vh, TerrainHeight(parameters, px, py, Add(px, py)));
+
+		if (vh == padHeights)
+		{
+			for (int i = 0; i < points; i++)
+				heights[start + i] = padHeights[i];
+		}
+	}
+}
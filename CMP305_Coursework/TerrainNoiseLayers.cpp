@@ -0,0 +1,82 @@
+#include "TerrainNoiseLayers.h"
+
+
+bool TerrainNoiseLayers::SameLayer(const SimpleNoiseSettings& a, const SimpleNoiseSettings& b)
+{
+	return a.Frequency == b.Frequency && a.Octaves == b.Octaves && a.Offset.x == b.Offset.x && a.Offset.y == b.Offset.y
+		&& a.Persistence == b.Persistence && a.Lacunarity == b.Lacunarity;
+}
+
+bool TerrainNoiseLayers::SameLayer(const MountainNoiseSettings& a, const MountainNoiseSettings& b)
+{
+	return a.Frequency == b.Frequency && a.Octaves == b.Octaves && a.Persistence == b.Persistence
+		&& a.Lacunarity == b.Lacunarity && a.Offset.x == b.Offset.x && a.Offset.y == b.Offset.y && a.Blending == b.Blending
+		&& a.Detail == b.Detail;
+}
+
+bool TerrainNoiseLayers::SameLayer(const RidgeNoiseSettings& a, const RidgeNoiseSettings& b)
+{
+	return a.Frequency == b.Frequency && a.Octaves == b.Octaves && a.Persistence == b.Persistence
+		&& a.Lacunarity == b.Lacunarity && a.Offset.x == b.Offset.x && a.Offset.y == b.Offset.y && a.Power == b.Power
+		&& a.Gain == b.Gain;
+}
+
+void TerrainNoiseLayers::FindSources(const TerrainNoiseSettings* settings, int count, Sources* sources)
+{
+	for (int biome = 0; biome < count; biome++)
+	{
+		const TerrainNoiseSettings& s = settings[biome];
+		Sources& layers = sources[biome];
+
+		// as terrainNoise.hlsli decides which layers to evaluate; NaN elevations are off
+		const bool mountains = s.MountainSettings.Elevation > 0.0f;
+		const bool ridges = mountains && s.RidgeSettings.Elevation > 0.0f;
+
+		layers.continent = biome;
+		layers.mountains = mountains ? biome : -1;
+		layers.ridges = ridges ? biome : -1;
+		layers.padding = 0;
+
+		// every earlier biome is its own source, or points at one that is
+		for (int other = 0; other < biome; other++)
+		{
+			const TerrainNoiseSettings& o = settings[other];
+			if (layers.continent == biome && sources[other].continent == other && SameLayer(s.ContinentSettings, o.ContinentSettings))
+				layers.continent = other;
+			if (layers.mountains == biome && sources[other].mountains == other && SameLayer(s.MountainSettings, o.MountainSettings))
+				layers.mountains = other;
+			if (layers.ridges == biome && sources[other].ridges == other && SameLayer(s.RidgeSettings, o.RidgeSettings))
+				layers.ridges = other;
+		}
+	}
+}
+
+void TerrainNoiseLayers::CountEvaluations(const TerrainNoiseSettings* settings, const Sources* sources, const int* biomes, int count,
+	Evaluations& evaluations)
+{
+	int evaluated[3 * 4];
+	int distinct = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const int biome = biomes[i];
+		if (i == 0 || biome != biomes[0])
+		{
+			const TerrainNoiseSettings& s = settings[biome];
+			evaluations.unshared += 1 + (s.MountainSettings.Elevation > 0.0f) + (s.RidgeSettings.Elevation > 0.0f);
+		}
+
+		// each distinct source of each layer is evaluated once
+		const int layers[3] = { sources[biome].continent, sources[biome].mountains, sources[biome].ridges };
+		for (int layer = 0; layer < 3; layer++)
+		{
+			if (layers[layer] < 0) continue;
+
+			const int key = (layer << 16) | layers[layer];
+			bool repeated = false;
+			for (int j = 0; j < distinct; j++)
+				repeated |= evaluated[j] == key;
+			if (!repeated) evaluated[distinct++] = key;
+		}
+	}
+	evaluations.shared += distinct;
+}
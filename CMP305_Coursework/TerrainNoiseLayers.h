@@ -0,0 +1,47 @@
+#pragma once
+
+#include "NoiseSettings.h"
+
+
+// Finds the layers of TerrainNoise that biomes have in common, so that where biomes blend each distinct layer is
+// evaluated once and shared, rather than once for every biome (presets often give biomes the same continent at a
+// different elevation, or no mountains)
+//
+// What's shared is a layer's octave sum, which depends on every setting but the elevation (and the continent's vertical
+// shift, and the ridges' threshold); each biome scales the sum by its own elevation when the layers are combined
+// Mountains with no elevation are off, and so are ridges without mountains, as they are scaled by the mountains
+class TerrainNoiseLayers
+{
+public:
+	// pure static class
+	TerrainNoiseLayers() = delete;
+
+	// for each layer of a biome, the first biome evaluating the same layer (which may be itself), or -1 if the layer is off
+	// must match the layer sources buffer in terrainNoise.hlsli
+	struct Sources
+	{
+		int continent = 0;
+		int mountains = -1;
+		int ridges = -1;
+		int padding = 0;
+	};
+
+	// layer evaluations over some pixels, as terrainNoise_cs.hlsl evaluated them before sharing and as it does now
+	struct Evaluations
+	{
+		long long unshared = 0;
+		long long shared = 0;
+	};
+
+	static bool SameLayer(const SimpleNoiseSettings& a, const SimpleNoiseSettings& b);
+	static bool SameLayer(const MountainNoiseSettings& a, const MountainNoiseSettings& b);
+	static bool SameLayer(const RidgeNoiseSettings& a, const RidgeNoiseSettings& b);
+
+	// sources[i] for settings[i], for count biomes
+	static void FindSources(const TerrainNoiseSettings* settings, int count, Sources* sources);
+
+	// adds the layer evaluations at a pixel blending biomes[0, count) (at most 4, ordered as terrainNoise_cs.hlsl loads them)
+	// unshared counts every layer with elevation of each biome other than repeats of the first, as each was evaluated in full
+	static void CountEvaluations(const TerrainNoiseSettings* settings, const Sources* sources, const int* biomes, int count,
+		Evaluations& evaluations);
+};
@@ -0,0 +1,752 @@
+// Vector terrain noise, written once against a small set of operations and compiled for each instruction set
+// Included by TerrainNoiseCPU.cpp inside a namespace that defines:
+//	F, M					float vector and comparison mask types, Width lanes wide
+//	Set, Zero, Load, Store
+//	Add, Sub, Mul, MulAdd, Div, Min, Max, Abs, Floor	(MulAdd is fused; Min and Max return their second operand when either is NaN)
+//	LessEqual, Less, Greater, Equal, And, All, Select(mask, ifTrue, ifFalse)
+//	Frexp, Ldexp2			exponent manipulation for Exp2 and Log2
+// and SIMD_TARGET, the attribute every function needs to use the instruction set
+//
+// Every function mirrors its scalar reference in TerrainNoiseCPU.cpp; see there for the HLSL it comes from
+// SimplexCell and GridCells are shared with the scalar reference
+// TerrainNoise itself is evaluated by TerrainNoiseKernel, one layer at a time over a chunk of points, with the passes under KERNELS
+// and noise graphs an instruction at a time over a chunk of points, under NOISE GRAPHS
+
+
+SIMD_TARGET static inline F Frac(F x) { return Sub(x, Floor(x)); }
+
+SIMD_TARGET static inline F Mod289(F x)
+{
+	return Sub(x, Mul(Floor(Mul(x, Set(NOISE_SIMPLEX_1_DIV_289))), Set(289.0f)));
+}
+
+SIMD_TARGET static inline F Permute(F x)
+{
+	return Mod289(Add(Mul(Mul(x, x), Set(34.0f)), x));
+}
+
+// D3D saturate, which takes NaN to 0
+SIMD_TARGET static inline F Saturate(F x)
+{
+	return Min(Max(x, Zero()), Set(1.0f));
+}
+
+// smoothstep(0, edge, x)
+SIMD_TARGET static inline F SmoothStep0(F edge, F x)
+{
+	F t = Saturate(Div(x, edge));
+	return Mul(Mul(t, t), Sub(Set(3.0f), Mul(Set(2.0f), t)));
+}
+
+// 2^x, for x <= 126
+SIMD_TARGET static inline F Exp2(F x)
+{
+	x = Max(x, Set(-126.0f));
+	F n = Floor(Add(x, Set(0.5f)));
+	F f = Sub(x, n);
+
+	F p = Set(1.535336188319500e-4f);
+	p = Add(Mul(p, f), Set(1.339887440266574e-3f));
+	p = Add(Mul(p, f), Set(9.618437357674640e-3f));
+	p = Add(Mul(p, f), Set(5.550332471162809e-2f));
+	p = Add(Mul(p, f), Set(2.402264791363012e-1f));
+	p = Add(Mul(p, f), Set(6.931472028550421e-1f));
+	p = Add(Mul(p, f), Set(1.0f));
+
+	return Mul(p, Ldexp2(n));
+}
+
+// log2(x), for x > 0
+SIMD_TARGET static inline F Log2(F x)
+{
+	F e;
+	F m = Frexp(x, e);
+
+	// centre the mantissa on 1
+	M small = Less(m, Set(0.707106781186547524f));
+	e = Select(small, Sub(e, Set(1.0f)), e);
+	m = Sub(Select(small, Add(m, m), m), Set(1.0f));
+
+	F z = Mul(m, m);
+	F y = Set(7.0376836292e-2f);
+	y = Add(Mul(y, m), Set(-1.1514610310e-1f));
+	y = Add(Mul(y, m), Set(1.1676998740e-1f));
+	y = Add(Mul(y, m), Set(-1.2420140846e-1f));
+	y = Add(Mul(y, m), Set(1.4249322787e-1f));
+	y = Add(Mul(y, m), Set(-1.6668057665e-1f));
+	y = Add(Mul(y, m), Set(2.0000714765e-1f));
+	y = Add(Mul(y, m), Set(-2.4999993993e-1f));
+	y = Add(Mul(y, m), Set(3.3333331174e-1f));
+	y = Mul(Mul(y, m), z);
+	y = Sub(y, Mul(Set(0.5f), z));
+
+	// natural log of the mantissa, converted to base 2
+	return Add(Mul(Add(m, y), Set(1.44269504088896341f)), e);
+}
+
+// pow(x, p) for x >= 0
+SIMD_TARGET static inline F Pow(F x, float p)
+{
+	return Select(Greater(x, Zero()), Exp2(Mul(Set(p), Log2(x))), Set(powf(0.0f, p)));
+}
+
+
+// SNoise is split up as the scalar reference is, so the grid evaluator can share every step of it
+// multiply-adds are fused explicitly: compilers that fuse them on their own (as GCC does) may pick different pairs depending
+// on what the code is inlined into, and the grid evaluator must match SNoise bit for bit
+
+struct SimplexPoint
+{
+	F ix, iy;
+	F x0, y0;
+	F x12x, x12y, x12z, x12w;
+	M xLessEqual;
+};
+
+SIMD_TARGET static inline void Locate(F x, F y, SimplexPoint& p)
+{
+	const F Cx = Set(0.211324865405187f);
+	const F Cy = Set(0.366025403784439f);
+	const F Cz = Set(-0.577350269189626f);
+
+	// first corner
+	F s = MulAdd(x, Cy, Mul(y, Cy));
+	p.ix = Floor(Add(x, s));
+	p.iy = Floor(Add(y, s));
+	F t = MulAdd(p.ix, Cx, Mul(p.iy, Cx));
+	p.x0 = Add(Sub(x, p.ix), t);
+	p.y0 = Add(Sub(y, p.iy), t);
+
+	// other corners
+	p.xLessEqual = LessEqual(p.x0, p.y0);
+	F i1x = Select(p.xLessEqual, Zero(), Set(1.0f));
+	F i1y = Select(p.xLessEqual, Set(1.0f), Zero());
+
+	p.x12x = Sub(Add(p.x0, Cx), i1x);
+	p.x12y = Sub(Add(p.y0, Cx), i1y);
+	p.x12z = Add(p.x0, Cz);
+	p.x12w = Add(p.y0, Cz);
+}
+
+SIMD_TARGET static inline F Hash(F ix, F iy, F dx, F dy)
+{
+	return Permute(Add(Add(Permute(Add(iy, dy)), ix), dx));
+}
+
+SIMD_TARGET static inline void Gradient(F p, F& a, F& h, F& n)
+{
+	const F Cw = Set(0.024390243902439f);
+
+	F gx = Sub(Mul(Set(2.0f), Frac(Mul(p, Cw))), Set(1.0f));
+	h = Sub(Abs(gx), Set(0.5f));
+	a = Sub(gx, Floor(Add(gx, Set(0.5f))));
+
+	n = MulAdd(Set(-0.85373472095314f), MulAdd(a, a, Mul(h, h)), Set(1.79284291400159f));
+}
+
+SIMD_TARGET static inline F Contributions(const SimplexPoint& p, F a0, F h0, F n0, F a1, F h1, F n1, F a2, F h2, F n2)
+{
+	F m0 = Max(Sub(Set(0.5f), MulAdd(p.x0, p.x0, Mul(p.y0, p.y0))), Zero());
+	F m1 = Max(Sub(Set(0.5f), MulAdd(p.x12x, p.x12x, Mul(p.x12y, p.x12y))), Zero());
+	F m2 = Max(Sub(Set(0.5f), MulAdd(p.x12z, p.x12z, Mul(p.x12w, p.x12w))), Zero());
+	m0 = Mul(m0, m0); m0 = Mul(m0, m0);
+	m1 = Mul(m1, m1); m1 = Mul(m1, m1);
+	m2 = Mul(m2, m2); m2 = Mul(m2, m2);
+
+	m0 = Mul(m0, n0);
+	m1 = Mul(m1, n1);
+	m2 = Mul(m2, n2);
+
+	F g0 = MulAdd(a0, p.x0, Mul(h0, p.y0));
+	F g1 = MulAdd(a1, p.x12x, Mul(h1, p.x12y));
+	F g2 = MulAdd(a2, p.x12z, Mul(h2, p.x12w));
+
+	return Mul(Set(130.0f), MulAdd(m2, g2, MulAdd(m1, g1, Mul(m0, g0))));
+}
+
+SIMD_TARGET static inline F SNoise(F x, F y)
+{
+	SimplexPoint p;
+	Locate(x, y, p);
+	F i1x = Select(p.xLessEqual, Zero(), Set(1.0f));
+	F i1y = Select(p.xLessEqual, Set(1.0f), Zero());
+
+	// permutations
+	F ix = Mod289(p.ix);
+	F iy = Mod289(p.iy);
+
+	F a0, h0, n0, a1, h1, n1, a2, h2, n2;
+	Gradient(Hash(ix, iy, Zero(), Zero()), a0, h0, n0);
+	Gradient(Hash(ix, iy, i1x, i1y), a1, h1, n1);
+	Gradient(Hash(ix, iy, Set(1.0f), Set(1.0f)), a2, h2, n2);
+
+	return Contributions(p, a0, h0, n0, a1, h1, n1, a2, h2, n2);
+}
+
+
+// GRID COHERENCE
+
+// offsets of a cell's corners (0, 0), (1, 0), (0, 1) and (1, 1), repeated across the lanes
+static const float CornerX[16] = { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1 };
+static const float CornerY[16] = { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1 };
+
+// HashCell, with the four corners in the first lanes
+SIMD_TARGET static inline void HashCorners(float cellX, float cellY, SimplexCell& cell)
+{
+	F a, h, n;
+	Gradient(Hash(Mod289(Set(cellX)), Mod289(Set(cellY)), Load(CornerX), Load(CornerY)), a, h, n);
+
+	float la[Width], lh[Width], ln[Width];
+	Store(la, a);
+	Store(lh, h);
+	Store(ln, n);
+	for (int corner = 0; corner < 4; corner++)
+	{
+		cell.a[corner] = la[corner];
+		cell.h[corner] = lh[corner];
+		cell.n[corner] = ln[corner];
+	}
+
+	cell.ix = cellX;
+	cell.iy = cellY;
+}
+
+// SNoise, hashing each cell once for all the lanes in it, and keeping the last cell for the next vector
+SIMD_TARGET static inline F SNoiseCoherent(F x, F y, SimplexCell* cell)
+{
+	if (!cell || !cell->coherent) return SNoise(x, y);
+
+	SimplexPoint p;
+	Locate(x, y, p);
+
+	// the gradients at the corners of each lane's cell
+	F a[4], h[4], n[4];
+
+	// most vectors lie entirely in the last cell
+	if (All(And(Equal(p.ix, Set(cell->ix)), Equal(p.iy, Set(cell->iy)))))
+	{
+		for (int corner = 0; corner < 4; corner++)
+		{
+			a[corner] = Set(cell->a[corner]);
+			h[corner] = Set(cell->h[corner]);
+			n[corner] = Set(cell->n[corner]);
+		}
+	}
+	else
+	{
+		float ix[Width], iy[Width];
+		Store(ix, p.ix);
+		Store(iy, p.iy);
+
+		for (int lane = 0; lane < Width; )
+		{
+			if (ix[lane] != cell->ix || iy[lane] != cell->iy)
+			{
+				// NaN is in no cell
+				if (ix[lane] != ix[lane] || iy[lane] != iy[lane]) return SNoise(x, y);
+				HashCorners(ix[lane], iy[lane], *cell);
+			}
+
+			// the first cell fills every lane; the lanes of later cells are overwritten
+			M inCell = And(Equal(p.ix, Set(cell->ix)), Equal(p.iy, Set(cell->iy)));
+			for (int corner = 0; corner < 4; corner++)
+			{
+				a[corner] = lane == 0 ? Set(cell->a[corner]) : Select(inCell, Set(cell->a[corner]), a[corner]);
+				h[corner] = lane == 0 ? Set(cell->h[corner]) : Select(inCell, Set(cell->h[corner]), h[corner]);
+				n[corner] = lane == 0 ? Set(cell->n[corner]) : Select(inCell, Set(cell->n[corner]), n[corner]);
+			}
+
+			lane++;
+			while (lane < Width && ix[lane] == cell->ix && iy[lane] == cell->iy) lane++;
+		}
+	}
+
+	// the middle corner is (0, 1) or (1, 0)
+	F a1 = Select(p.xLessEqual, a[2], a[1]);
+	F h1 = Select(p.xLessEqual, h[2], h[1]);
+	F n1 = Select(p.xLessEqual, n[2], n[1]);
+
+	return Contributions(p, a[0], h[0], n[0], a1, h1, n1, a[3], h[3], n[3]);
+}
+
+
+// adds the octaves [firstOctave, lastOctave) of a simple noise layer to noiseSum, before elevation and vertical shift
+SIMD_TARGET static inline F AddOctaves(F noiseSum, F x, F y, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave, float sampleSpacing)
+{
+	float f = settings.Frequency;
+	float a = 1.0f;
+
+	for (int octave = 0; octave < lastOctave; octave++)
+	{
+		float weight = TerrainNoiseCPU::OctaveWeight(f, sampleSpacing);
+		if (weight <= 0.0f && settings.Lacunarity >= 1.0f) break;
+
+		if (octave >= firstOctave)
+		{
+			F px = Add(Mul(Set(f), x), Set(settings.Offset.x));
+			F py = Add(Mul(Set(f), y), Set(settings.Offset.y));
+			noiseSum = Add(noiseSum, Mul(SNoise(px, py), Set(a * weight)));
+		}
+
+		f *= settings.Lacunarity;
+		a *= settings.Persistence;
+	}
+
+	return noiseSum;
+}
+
+SIMD_TARGET static inline F SmoothMax(F a, F b, float k)
+{
+	k = k > 0.0f ? -k : -0.0f;
+	F h = Max(Min(Div(Add(Sub(b, a), Set(k)), Set(2.0f * k)), Set(1.0f)), Zero());
+	F oneMinusH = Sub(Set(1.0f), h);
+	return Sub(Add(Mul(a, h), Mul(b, oneMinusH)), Mul(Mul(Set(k), h), oneMinusH));
+}
+
+
+// KERNELS
+// the passes of TerrainNoiseKernel over a chunk of points, a whole number of vectors
+// layer passes are compiled for every octave count up to MaxUnrolledOctaves, so their octave loops unroll; counts beyond
+// that are taken from the kernel's layer at run time
+
+template<int Octaves>
+SIMD_TARGET static inline int KernelOctaves(const TerrainNoiseKernel::Layer& layer)
+{
+	return Octaves <= TerrainNoiseKernel::MaxUnrolledOctaves ? Octaves : layer.octaves;
+}
+
+template<int Octaves>
+SIMD_TARGET static void ContinentKernel(const TerrainNoiseKernel& kernel, const float* x, const float* y, int count, float* out, int firstOctave,
+	SimplexCell* cells)
+{
+	const TerrainNoiseKernel::Layer& layer = kernel.GetContinent();
+	const int octaves = KernelOctaves<Octaves>(layer);
+	const float* frequencies = layer.frequencies.data();
+	const float* amplitudes = layer.amplitudes.data();
+	const F offsetX = Set(kernel.GetSettings().ContinentSettings.Offset.x);
+	const F offsetY = Set(kernel.GetSettings().ContinentSettings.Offset.y);
+
+	for (int i = 0; i < count; i += Width)
+	{
+		F vx = Load(x + i);
+		F vy = Load(y + i);
+		F noiseSum = Load(out + i);
+		for (int octave = firstOctave; octave < octaves; octave++)
+		{
+			F px = Add(Mul(Set(frequencies[octave]), vx), offsetX);
+			F py = Add(Mul(Set(frequencies[octave]), vy), offsetY);
+			noiseSum = Add(noiseSum, Mul(SNoiseCoherent(px, py, cells ? cells + octave : nullptr), Set(amplitudes[octave])));
+		}
+		Store(out + i, noiseSum);
+	}
+}
+
+// an octave of the mountains, from its noise; weight is its band limiting weight
+SIMD_TARGET static inline void MountainOctave(F noise, const MountainNoiseSettings& settings, float weight, F& noiseSum, F& a)
+{
+	F noiseVal1 = Abs(noise);
+	F noiseVal2 = Mul(noiseVal1, Sub(Set(1.0f), SmoothStep0(noiseVal1, Set(settings.Blending))));
+
+	noiseSum = Add(noiseSum, Mul(noiseVal2, weight < 1.0f ? Mul(a, Set(weight)) : a));
+	a = Mul(a, Mul(Set(settings.Persistence), Sub(Set(1.0f), SmoothStep0(noiseVal1, Set(settings.Detail)))));
+}
+
+// an octave of the ridges, from its noise
+SIMD_TARGET static inline void RidgeOctave(F noise, const RidgeNoiseSettings& settings, float amplitude, F& noiseSum, F& ridgeWeight)
+{
+	F noiseVal = Sub(Set(1.0f), Abs(noise));
+	noiseVal = Pow(Abs(noiseVal), settings.Power);
+	noiseVal = Mul(noiseVal, ridgeWeight);
+	ridgeWeight = Saturate(Mul(noiseVal, Set(settings.Gain)));
+
+	noiseSum = Add(noiseSum, Mul(noiseVal, Set(amplitude)));
+}
+
+template<int Octaves>
+SIMD_TARGET static void MountainKernel(const TerrainNoiseKernel& kernel, const float* x, const float* y, int count, float* out, int firstOctave,
+	SimplexCell* cells)
+{
+	const MountainNoiseSettings& settings = kernel.GetSettings().MountainSettings;
+	const TerrainNoiseKernel::Layer& layer = kernel.GetMountains();
+	const int octaves = KernelOctaves<Octaves>(layer);
+	const float* frequencies = layer.frequencies.data();
+	const float* weights = layer.amplitudes.data();
+	const F offsetX = Set(settings.Offset.x);
+	const F offsetY = Set(settings.Offset.y);
+
+	for (int i = 0; i < count; i += Width)
+	{
+		F vx = Load(x + i);
+		F vy = Load(y + i);
+		F noiseSum = Zero();
+		// the amplitude depends on the noise, so differs between lanes
+		F a = Set(1.0f);
+		for (int octave = firstOctave; octave < octaves; octave++)
+		{
+			F px = Add(Mul(Set(frequencies[octave]), vx), offsetX);
+			F py = Add(Mul(Set(frequencies[octave]), vy), offsetY);
+			MountainOctave(SNoiseCoherent(px, py, cells ? cells + octave : nullptr), settings, weights[octave], noiseSum, a);
+		}
+		Store(out + i, Mul(noiseSum, Set(settings.Elevation)));
+	}
+}
+
+template<int Octaves>
+SIMD_TARGET static void RidgeKernel(const TerrainNoiseKernel& kernel, const float* x, const float* y, int count, float* out, int firstOctave,
+	SimplexCell* cells)
+{
+	const RidgeNoiseSettings& settings = kernel.GetSettings().RidgeSettings;
+	const TerrainNoiseKernel::Layer& layer = kernel.GetRidges();
+	const int octaves = KernelOctaves<Octaves>(layer);
+	const float* frequencies = layer.frequencies.data();
+	const float* amplitudes = layer.amplitudes.data();
+	const F offsetX = Set(settings.Offset.x);
+	const F offsetY = Set(settings.Offset.y);
+
+	for (int i = 0; i < count; i += Width)
+	{
+		F vx = Load(x + i);
+		F vy = Load(y + i);
+		F noiseSum = Zero();
+		F ridgeWeight = Set(1.0f);
+		for (int octave = firstOctave; octave < octaves; octave++)
+		{
+			F px = Add(Mul(Set(frequencies[octave]), vx), offsetX);
+			F py = Add(Mul(Set(frequencies[octave]), vy), offsetY);
+			RidgeOctave(SNoiseCoherent(px, py, cells ? cells + octave : nullptr), settings, amplitudes[octave], noiseSum, ridgeWeight);
+		}
+		Store(out + i, Mul(noiseSum, Set(settings.Elevation)));
+	}
+}
+
+// the mountain and ridge passes together, for kernels whose ridges share octaves with the mountains; Octaves is the ridges' count
+// the mountains' noise is kept for the octaves that can be shared, and taken by the ridge octaves sharing them in place of their own
+template<int Octaves>
+SIMD_TARGET static void MountainRidgeKernel(const TerrainNoiseKernel& kernel, const float* x, const float* y, int count, float* mountains,
+	float* ridges, SimplexCell* mountainCells, SimplexCell* ridgeCells)
+{
+	const MountainNoiseSettings& mountainSettings = kernel.GetSettings().MountainSettings;
+	const RidgeNoiseSettings& ridgeSettings = kernel.GetSettings().RidgeSettings;
+	const TerrainNoiseKernel::Layer& mountainLayer = kernel.GetMountains();
+	const TerrainNoiseKernel::Layer& ridgeLayer = kernel.GetRidges();
+	const int ridgeOctaves = KernelOctaves<Octaves>(ridgeLayer);
+	const int* shared = kernel.GetSharedOctaves().data();
+	// shared octaves have the same offset
+	const F offsetX = Set(mountainSettings.Offset.x);
+	const F offsetY = Set(mountainSettings.Offset.y);
+
+	for (int i = 0; i < count; i += Width)
+	{
+		F vx = Load(x + i);
+		F vy = Load(y + i);
+		F octaveNoise[TerrainNoiseKernel::MaxSharedOctaves];
+
+		F noiseSum = Zero();
+		F a = Set(1.0f);
+		for (int octave = 0; octave < mountainLayer.octaves; octave++)
+		{
+			F px = Add(Mul(Set(mountainLayer.frequencies[octave]), vx), offsetX);
+			F py = Add(Mul(Set(mountainLayer.frequencies[octave]), vy), offsetY);
+			F noise = SNoiseCoherent(px, py, mountainCells ? mountainCells + octave : nullptr);
+			if (octave < TerrainNoiseKernel::MaxSharedOctaves)
+				octaveNoise[octave] = noise;
+
+			MountainOctave(noise, mountainSettings, mountainLayer.amplitudes[octave], noiseSum, a);
+		}
+		Store(mountains + i, Mul(noiseSum, Set(mountainSettings.Elevation)));
+
+		noiseSum = Zero();
+		F ridgeWeight = Set(1.0f);
+		for (int octave = 0; octave < ridgeOctaves; octave++)
+		{
+			F noise;
+			if (shared[octave] >= 0)
+			{
+				noise = octaveNoise[shared[octave]];
+			}
+			else
+			{
+				F px = Add(Mul(Set(ridgeLayer.frequencies[octave]), vx), offsetX);
+				F py = Add(Mul(Set(ridgeLayer.frequencies[octave]), vy), offsetY);
+				noise = SNoiseCoherent(px, py, ridgeCells ? ridgeCells + octave : nullptr);
+			}
+
+			RidgeOctave(noise, ridgeSettings, ridgeLayer.amplitudes[octave], noiseSum, ridgeWeight);
+		}
+		Store(ridges + i, Mul(noiseSum, Set(ridgeSettings.Elevation)));
+	}
+}
+
+// Layers is the kernel's set of enabled layers; the others add nothing
+template<int Layers>
+SIMD_TARGET static void CombineKernel(const TerrainNoiseKernel& kernel, float* heights, const float* mountains, const float* ridges, int count)
+{
+	const TerrainNoiseSettings& settings = kernel.GetSettings();
+
+	for (int i = 0; i < count; i += Width)
+	{
+		F continentShape = Add(Mul(Load(heights + i), Set(settings.ContinentSettings.Elevation)), Set(settings.ContinentSettings.VerticalShift));
+
+		F mountainShape = (Layers & TerrainNoiseKernel::Mountains) ? Load(mountains + i) : Zero();
+		F ridgeShape = (Layers & TerrainNoiseKernel::Ridges) ?
+			Mul(Load(ridges + i), SmoothStep0(Set(settings.RidgeSettings.RidgeThreshold), mountainShape)) : Zero();
+
+		continentShape = SmoothMax(continentShape, Set(-settings.OceanFloorDepth), settings.OceanFloorSmoothing);
+		continentShape = Select(Less(continentShape, Zero()), Mul(continentShape, Set(1.0f + settings.OceanDepthMultiplier)), continentShape);
+
+		Store(heights + i, Add(Add(continentShape, mountainShape), ridgeShape));
+	}
+}
+
+static const TerrainNoiseKernel::LayerKernel ContinentKernels[TerrainNoiseKernel::MaxUnrolledOctaves + 2] =
+{
+	ContinentKernel<0>, ContinentKernel<1>, ContinentKernel<2>, ContinentKernel<3>, ContinentKernel<4>, ContinentKernel<5>,
+	ContinentKernel<6>, ContinentKernel<7>, ContinentKernel<8>, ContinentKernel<9>, ContinentKernel<10>, ContinentKernel<11>
+};
+static const TerrainNoiseKernel::LayerKernel MountainKernels[TerrainNoiseKernel::MaxUnrolledOctaves + 2] =
+{
+	MountainKernel<0>, MountainKernel<1>, MountainKernel<2>, MountainKernel<3>, MountainKernel<4>, MountainKernel<5>,
+	MountainKernel<6>, MountainKernel<7>, MountainKernel<8>, MountainKernel<9>, MountainKernel<10>, MountainKernel<11>
+};
+static const TerrainNoiseKernel::LayerKernel RidgeKernels[TerrainNoiseKernel::MaxUnrolledOctaves + 2] =
+{
+	RidgeKernel<0>, RidgeKernel<1>, RidgeKernel<2>, RidgeKernel<3>, RidgeKernel<4>, RidgeKernel<5>,
+	RidgeKernel<6>, RidgeKernel<7>, RidgeKernel<8>, RidgeKernel<9>, RidgeKernel<10>, RidgeKernel<11>
+};
+static const TerrainNoiseKernel::FusedKernel MountainRidgeKernels[TerrainNoiseKernel::MaxUnrolledOctaves + 2] =
+{
+	MountainRidgeKernel<0>, MountainRidgeKernel<1>, MountainRidgeKernel<2>, MountainRidgeKernel<3>, MountainRidgeKernel<4>, MountainRidgeKernel<5>,
+	MountainRidgeKernel<6>, MountainRidgeKernel<7>, MountainRidgeKernel<8>, MountainRidgeKernel<9>, MountainRidgeKernel<10>, MountainRidgeKernel<11>
+};
+static const TerrainNoiseKernel::CombineKernel CombineKernels[4] =
+{
+	CombineKernel<0>, CombineKernel<1>, CombineKernel<2>, CombineKernel<3>
+};
+
+static inline int KernelIndex(int octaves)
+{
+	return octaves <= TerrainNoiseKernel::MaxUnrolledOctaves ? octaves : TerrainNoiseKernel::MaxUnrolledOctaves + 1;
+}
+
+// the passes for a kernel's layers and octave counts
+static void SelectKernels(const TerrainNoiseKernel& kernel, TerrainNoiseKernel::Kernels& kernels)
+{
+	kernels.width = Width;
+	kernels.continent = ContinentKernels[KernelIndex(kernel.GetContinent().octaves)];
+	kernels.mountains = MountainKernels[KernelIndex(kernel.GetMountains().octaves)];
+	kernels.ridges = RidgeKernels[KernelIndex(kernel.GetRidges().octaves)];
+	kernels.mountainsAndRidges = kernel.GetSharedOctaveCount() > 0 ? MountainRidgeKernels[KernelIndex(kernel.GetRidges().octaves)] : nullptr;
+	kernels.combine = CombineKernels[kernel.GetLayers()];
+}
+
+
+// NOISE GRAPHS
+
+// TerrainNoise of a kernel at count points, a whole number of vectors; mountains and ridges are working space
+SIMD_TARGET static void TerrainChunk(const TerrainNoiseKernel& kernel, const float* x, const float* y, int count, float* out, float* mountains,
+	float* ridges)
+{
+	TerrainNoiseKernel::Kernels kernels;
+	SelectKernels(kernel, kernels);
+
+	for (int i = 0; i < count; i += Width)
+		Store(out + i, Zero());
+	kernels.continent(kernel, x, y, count, out, 0, nullptr);
+	if (kernels.mountainsAndRidges)
+	{
+		kernels.mountainsAndRidges(kernel, x, y, count, mountains, ridges, nullptr, nullptr);
+	}
+	else
+	{
+		if (kernel.GetLayers() & TerrainNoiseKernel::Mountains)
+			kernels.mountains(kernel, x, y, count, mountains, 0, nullptr);
+		if (kernel.GetLayers() & TerrainNoiseKernel::Ridges)
+			kernels.ridges(kernel, x, y, count, ridges, 0, nullptr);
+	}
+	kernels.combine(kernel, out, mountains, ridges, count);
+}
+
+// runs every instruction of a program over count points, a whole number of vectors
+// registers holds KernelChunk values for each register of the program, and warpX and warpY are working space of KernelChunk values
+SIMD_TARGET static void GraphChunk(const NoiseProgram& program, const float* x, const float* y, int count, float* registers, float* warpX, float* warpY)
+{
+	for (const NoiseInstruction& instruction : program.GetInstructions())
+	{
+		float* out = registers + instruction.out * KernelChunk;
+		const float* a = instruction.inputs[0] >= 0 ? registers + instruction.inputs[0] * KernelChunk : nullptr;
+		const float* b = instruction.inputs[1] >= 0 ? registers + instruction.inputs[1] * KernelChunk : nullptr;
+		const float* c = instruction.inputs[2] >= 0 ? registers + instruction.inputs[2] * KernelChunk : nullptr;
+		const float* p = instruction.params;
+		const TerrainNoiseKernel* kernel = instruction.kernel >= 0 ? &program.GetKernels()[instruction.kernel] : nullptr;
+
+		// fractals are warped by their first two inputs, which are read before out (which may be the same register) is written
+		const float* px = x;
+		const float* py = y;
+		if (instruction.type == NOISE_NODE_FBM || instruction.type == NOISE_NODE_RIDGED || instruction.type == NOISE_NODE_MOUNTAINS)
+		{
+			if (a)
+			{
+				for (int i = 0; i < count; i += Width)
+					Store(warpX + i, Add(Load(x + i), Load(a + i)));
+				px = warpX;
+			}
+			if (b)
+			{
+				for (int i = 0; i < count; i += Width)
+					Store(warpY + i, Add(Load(y + i), Load(b + i)));
+				py = warpY;
+			}
+		}
+
+		switch (instruction.type)
+		{
+		case NOISE_NODE_CONSTANT:
+			for (int i = 0; i < count; i += Width) Store(out + i, Set(p[0]));
+			break;
+		case NOISE_NODE_X:
+			for (int i = 0; i < count; i += Width) Store(out + i, Load(x + i));
+			break;
+		case NOISE_NODE_Y:
+			for (int i = 0; i < count; i += Width) Store(out + i, Load(y + i));
+			break;
+		case NOISE_NODE_TERRAIN:
+			TerrainChunk(*kernel, x, y, count, out, warpX, warpY);
+			break;
+
+		case NOISE_NODE_FBM:
+		{
+			const SimpleNoiseSettings& settings = kernel->GetSettings().ContinentSettings;
+			for (int i = 0; i < count; i += Width) Store(out + i, Zero());
+			ContinentKernels[KernelIndex(kernel->GetContinent().octaves)](*kernel, px, py, count, out, 0, nullptr);
+			for (int i = 0; i < count; i += Width)
+				Store(out + i, Add(Mul(Load(out + i), Set(settings.Elevation)), Set(settings.VerticalShift)));
+			break;
+		}
+		case NOISE_NODE_RIDGED:
+			RidgeKernels[KernelIndex(kernel->GetRidges().octaves)](*kernel, px, py, count, out, 0, nullptr);
+			break;
+		case NOISE_NODE_MOUNTAINS:
+			MountainKernels[KernelIndex(kernel->GetMountains().octaves)](*kernel, px, py, count, out, 0, nullptr);
+			break;
+
+		case NOISE_NODE_ADD:
+			for (int i = 0; i < count; i += Width) Store(out + i, Add(Load(a + i), Load(b + i)));
+			break;
+		case NOISE_NODE_SUBTRACT:
+			for (int i = 0; i < count; i += Width) Store(out + i, Sub(Load(a + i), Load(b + i)));
+			break;
+		case NOISE_NODE_MULTIPLY:
+			for (int i = 0; i < count; i += Width) Store(out + i, Mul(Load(a + i), Load(b + i)));
+			break;
+		case NOISE_NODE_MIN:
+			for (int i = 0; i < count; i += Width) Store(out + i, Min(Load(a + i), Load(b + i)));
+			break;
+		case NOISE_NODE_MAX:
+			for (int i = 0; i < count; i += Width) Store(out + i, Max(Load(a + i), Load(b + i)));
+			break;
+		case NOISE_NODE_SMOOTH_MAX:
+			for (int i = 0; i < count; i += Width) Store(out + i, SmoothMax(Load(a + i), Load(b + i), p[0]));
+			break;
+		case NOISE_NODE_LERP:
+			for (int i = 0; i < count; i += Width)
+			{
+				F va = Load(a + i);
+				Store(out + i, Add(va, Mul(Load(c + i), Sub(Load(b + i), va))));
+			}
+			break;
+
+		case NOISE_NODE_SCALE_BIAS:
+			for (int i = 0; i < count; i += Width) Store(out + i, Add(Mul(Load(a + i), Set(p[0])), Set(p[1])));
+			break;
+		case NOISE_NODE_ABS:
+			for (int i = 0; i < count; i += Width) Store(out + i, Abs(Load(a + i)));
+			break;
+		case NOISE_NODE_CLAMP:
+			for (int i = 0; i < count; i += Width) Store(out + i, Min(Max(Load(a + i), Set(p[0])), Set(p[1])));
+			break;
+		case NOISE_NODE_SMOOTH_STEP:
+			for (int i = 0; i < count; i += Width)
+			{
+				F t = Saturate(Div(Sub(Load(a + i), Set(p[0])), Set(p[1] - p[0])));
+				Store(out + i, Mul(Mul(t, t), Sub(Set(3.0f), Mul(Set(2.0f), t))));
+			}
+			break;
+		case NOISE_NODE_POW:
+			for (int i = 0; i < count; i += Width) Store(out + i, Pow(Max(Load(a + i), Zero()), p[0]));
+			break;
+		case NOISE_NODE_TERRACE:
+			for (int i = 0; i < count; i += Width)
+			{
+				F t = Mul(Load(a + i), Set(p[0]));
+				F step = Floor(t);
+				Store(out + i, Div(Add(step, Pow(Sub(t, step), p[1])), Set(p[0])));
+			}
+			break;
+
+		default:
+			for (int i = 0; i < count; i += Width) Store(out + i, Zero());
+			break;
+		}
+	}
+}
+
+SIMD_TARGET static void GraphNoiseBatch(const NoiseProgram& program, const float* x, const float* y, int count, float* heights)
+{
+	if (program.IsEmpty())
+	{
+		for (int i = 0; i < count; i++)
+			heights[i] = 0.0f;
+		return;
+	}
+
+	std::vector<float> registers(program.GetRegisterCount() * KernelChunk);
+	float warpX[KernelChunk], warpY[KernelChunk];
+	// the last chunk goes through whole vectors of padding
+	float padX[KernelChunk], padY[KernelChunk];
+
+	const float* output = registers.data() + program.GetOutputRegister() * KernelChunk;
+	for (int start = 0; start < count; start += KernelChunk)
+	{
+		const int chunk = count - start < KernelChunk ? count - start : KernelChunk;
+		const int vectors = (chunk + Width - 1) / Width * Width;
+
+		const float* cx = x + start;
+		const float* cy = y + start;
+		if (vectors != chunk)
+		{
+			for (int i = 0; i < vectors; i++)
+			{
+				padX[i] = i < chunk ? cx[i] : 0.0f;
+				padY[i] = i < chunk ? cy[i] : 0.0f;
+			}
+			cx = padX;
+			cy = padY;
+		}
+
+		GraphChunk(program, cx, cy, vectors, registers.data(), warpX, warpY);
+		for (int i = 0; i < chunk; i++)
+			heights[start + i] = output[i];
+	}
+}
+
+
+SIMD_TARGET static void ContinentOctavesBatch(const float* x, const float* y, int count, const SimpleNoiseSettings& settings, int firstOctave, int lastOctave,
+	float* sums, float sampleSpacing)
+{
+	int i = 0;
+	for (; i + Width <= count; i += Width)
+		Store(sums + i, AddOctaves(Zero(), Load(x + i), Load(y + i), settings, firstOctave, lastOctave, sampleSpacing));
+
+	if (i < count)
+	{
+		float px[Width] = {}, py[Width] = {}, ps[Width];
+		for (int j = 0; i + j < count; j++)
+		{
+			px[j] = x[i + j];
+			py[j] = y[i + j];
+		}
+		Store(ps, AddOctaves(Zero(), Load(px), Load(py), settings, firstOctave, lastOctave, sampleSpacing));
+		for (int j = 0; i + j < count; j++)
+			sums[i + j] = ps[j];
+	}
+}
@@ -1,4 +1,6 @@
 
+#include "math.hlsli"
+
 #define MAX_BIOMES 32
 
 struct BiomeMappingBuffer
@@ -7,6 +9,9 @@ struct BiomeMappingBuffer
     uint resolution;
     float blending;
     float padding;
+    // cell of the world that the biome map texture begins at
+    int2 origin;
+    float2 padding1;
 };
 
 struct BiomeTan
@@ -40,9 +45,10 @@ float2 GetBiomeMapUV(float2 pos, BiomeMappingBuffer mappingBuffer)
     return pos * mappingBuffer.pxPerTile / mappingBuffer.resolution;
 }
 
+// returns texel of the biome map texture that contains pos
 uint2 GetBiomeMapLocation(float2 pos, BiomeMappingBuffer mappingBuffer)
 {
-    return (mappingBuffer.resolution - 1) * GetBiomeMapUV(pos, mappingBuffer);
+    return int2(floor((mappingBuffer.resolution - 1) * GetBiomeMapUV(pos, mappingBuffer))) - mappingBuffer.origin;
 }
 
 // retuns uv within the biome
@@ -65,6 +71,60 @@ float2 GetBiomeBlend(float2 pos, BiomeMappingBuffer mappingBuffer)
 }
 
 
+// the biomes blended at a position, and the signed blend weights between them (as GetBiomeBlend)
+// biomes are the biome at the position, then its neighbours along x, along y, and along both; where the position isn't
+// blended along an axis its neighbours along that axis are the biome itself
+struct BiomeBlendSample
+{
+    uint4 biomes;
+    float2 blend;
+};
+
+BiomeBlendSample GetBiomeBlendSample(Texture2D<uint> biomeMap, float2 pos, BiomeMappingBuffer mappingBuffer)
+{
+    uint2 biomeMapUV = GetBiomeMapLocation(pos, mappingBuffer);
+    
+    BiomeBlendSample blendSample;
+    blendSample.blend = GetBiomeBlend(pos, mappingBuffer);
+    uint2 d = sign(blendSample.blend);
+    blendSample.biomes.x = biomeMap.Load(uint3(biomeMapUV + uint2(0,   0),   0));
+    blendSample.biomes.y = biomeMap.Load(uint3(biomeMapUV + uint2(d.x, 0),   0));
+    blendSample.biomes.z = biomeMap.Load(uint3(biomeMapUV + uint2(0,   d.y), 0));
+    blendSample.biomes.w = biomeMap.Load(uint3(biomeMapUV + uint2(d.x, d.y), 0));
+    return blendSample;
+}
+
+// a texel of a blend map baked on the CPU (see BiomeBlendMap): GetBiomeBlendSample at the texel's position, with the
+// blend weights rounded to 16 bits (away from zero, so they are only 0 where GetBiomeBlend is)
+BiomeBlendSample LoadBiomeBlendSample(Texture2D<uint2> blendMap, uint2 texel)
+{
+    uint2 packed = blendMap.Load(uint3(texel, 0));
+    
+    BiomeBlendSample blendSample;
+    blendSample.biomes = (packed.xxxx >> uint4(0, 8, 16, 24)) & 0xFF;
+    // sign extend the 16-bit weights
+    blendSample.blend = float2(asint(packed.yy << uint2(16, 0)) >> 16) / 32767.0f;
+    return blendSample;
+}
+
+// derivative of GetBiomeBlend with respect to pos; each component of the blend only varies along its own axis
+float2 GetBiomeBlendGradient(float2 pos, BiomeMappingBuffer mappingBuffer)
+{
+    float2 biomeUV = GetBiomeUV(pos, mappingBuffer);
+    // d(biomeUV)/d(pos), away from the jumps in frac at the edges of a biome
+    float uvScale = float(mappingBuffer.resolution - 1) * mappingBuffer.pxPerTile / mappingBuffer.resolution;
+    
+    float2 t1 = saturate(biomeUV / mappingBuffer.blending + 0.5f);
+    float2 t2 = saturate((biomeUV * (1 + mappingBuffer.blending) - 1.0f) / (2.0f * mappingBuffer.blending));
+    
+    float2 gradient = float2(0.0f, 0.0f);
+    
+    gradient += step(biomeUV, 0.5f) * smoothstepSlope(t1) / mappingBuffer.blending;
+    gradient += step(0.5f, biomeUV) * smoothstepSlope(t2) * (1 + mappingBuffer.blending) / (2.0f * mappingBuffer.blending);
+    
+    return gradient * uvScale;
+}
+
 // interpolate tan
 BiomeTan BlendTans(BiomeTan a, BiomeTan b, float t)
 {
@@ -95,16 +155,11 @@ BiomeTan BlendTans(BiomeTan a, BiomeTan b, float t)
     return blended;
 }
 
-BiomeTan BlendTans(Texture2D biomeMap, StructuredBuffer<BiomeTan> biomeTans, uint2 biomeMapUV, float2 weights)
+BiomeTan BlendTans(StructuredBuffer<BiomeTan> biomeTans, BiomeBlendSample blendSample)
 {
-    int b1 = asint(biomeMap.Load(uint3(biomeMapUV + uint2(0,               0),               0)).r);
-    int b2 = asint(biomeMap.Load(uint3(biomeMapUV + uint2(sign(weights.x), 0),               0)).r);
-    int b3 = asint(biomeMap.Load(uint3(biomeMapUV + uint2(0,               sign(weights.y)), 0)).r);
-    int b4 = asint(biomeMap.Load(uint3(biomeMapUV + uint2(sign(weights.x), sign(weights.y)), 0)).r);
-    
     return BlendTans(
-        BlendTans(biomeTans[b1], biomeTans[b3], abs(weights.y)),
-        BlendTans(biomeTans[b2], biomeTans[b4], abs(weights.y)),
-        abs(weights.x)
+        BlendTans(biomeTans[blendSample.biomes.x], biomeTans[blendSample.biomes.z], abs(blendSample.blend.y)),
+        BlendTans(biomeTans[blendSample.biomes.y], biomeTans[blendSample.biomes.w], abs(blendSample.blend.y)),
+        abs(blendSample.blend.x)
     );
 }
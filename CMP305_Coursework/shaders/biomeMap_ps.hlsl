@@ -1,6 +1,6 @@
 #include "biomeHelper.hlsli"
 
-Texture2D gBiomeMap : register(t0);
+Texture2D<uint> gBiomeMap : register(t0);
 SamplerState gSampler : register(s0);
 
 cbuffer BiomeColourBuffer : register(b0)
@@ -33,8 +33,11 @@ float4 main(InputType input) : SV_TARGET
     float2 worldMinPos = worldPos - viewSize * 0.5f;
     float2 worldMaxPos = worldPos + viewSize * 0.5f;
     
-    float2 worldMin = GetBiomeMapUV(worldMinPos, mappingBuffer);
-    float2 worldMax = GetBiomeMapUV(worldMaxPos, mappingBuffer);
+    // the texture may only be a window onto the biome map, so find the view bounds in texture uv space
+    float2 dims;
+    gBiomeMap.GetDimensions(dims.x, dims.y);
+    float2 worldMin = ((mappingBuffer.resolution - 1) * GetBiomeMapUV(worldMinPos, mappingBuffer) - mappingBuffer.origin) / dims;
+    float2 worldMax = ((mappingBuffer.resolution - 1) * GetBiomeMapUV(worldMaxPos, mappingBuffer) - mappingBuffer.origin) / dims;
     
     bool2 outerBounds = uv >= worldMin &&
                         uv <= worldMax;
@@ -42,7 +45,8 @@ float4 main(InputType input) : SV_TARGET
                         uv <= worldMax - borderThickness;
     bool border = outerBounds.x && outerBounds.y && !(innerBounds.x && innerBounds.y);
     
-    int biome = asint(gBiomeMap.Sample(gSampler, uv).r);
+    // integer textures cannot be filtered, so load the nearest texel
+    int biome = gBiomeMap.Load(int3(min(uv * dims, dims - 1.0f), 0));
     float3 colour = border ? borderColour : biomeColours[biome].rgb;
     
     return float4(colour, 1.0f);
@@ -1,3 +1,6 @@
+#ifndef MATH_FUNC
+#define MATH_FUNC
+
 // Smooth minimum of two values, controlled by smoothing factor k
 // When k = 0, this behaves identically to min(a, b)
 float smoothMin(float a, float b, float k)
@@ -18,6 +21,60 @@ float smoothMax(float a, float b, float k)
 }
 
 
+// VALUES WITH GRADIENTS
+// A float3 holds a value in x and its gradient (d/dx, d/dy) in yz
+
+// product rule
+float3 mulGrad(float3 a, float3 b)
+{
+    return float3(a.x * b.x, a.yz * b.x + a.x * b.yz);
+}
+
+float3 saturateGrad(float3 v)
+{
+    return float3(saturate(v.x), v.x > 0.0f && v.x < 1.0f ? v.yz : float2(0.0f, 0.0f));
+}
+
+// slope of smoothstep with respect to its saturated parameter t (zero when clamped)
+float smoothstepSlope(float t)
+{
+    return 6.0f * t * (1.0f - t);
+}
+float2 smoothstepSlope(float2 t)
+{
+    return 6.0f * t * (1.0f - t);
+}
+
+// smoothstep(e0, e1, x) for a varying x
+float3 smoothstepGrad(float e0, float e1, float3 x)
+{
+    float t = saturate((x.x - e0) / (e1 - e0));
+    float slope = e1 != e0 ? smoothstepSlope(t) / (e1 - e0) : 0.0f;
+    return float3(t * t * (3.0f - 2.0f * t), slope * x.yz);
+}
+
+// smoothstep(0, edge, x) for a constant x and a varying edge
+float3 smoothstepEdgeGrad(float3 edge, float x)
+{
+    float t = saturate(x / edge.x);
+    // dt/d(edge) = -x / edge^2 = -t / edge
+    float slope = edge.x > 0.0f ? -smoothstepSlope(t) * t / edge.x : 0.0f;
+    return float3(t * t * (3.0f - 2.0f * t), slope * edge.yz);
+}
+
+// smoothMax of a varying a and a constant b
+float3 smoothMaxGrad(float3 a, float b, float k)
+{
+    k = min(0, -k);
+    float h = max(0, min(1, (b - a.x + k) / (2 * k)));
+    float value = a.x * h + b * (1 - h) - k * h * (1 - h);
+    
+    // dh/da = -1 / 2k within the smoothing region
+    float dh = h > 0.0f && h < 1.0f ? -0.5f / k : 0.0f;
+    float slope = h + (a.x - b - k * (1 - 2 * h)) * dh;
+    return float3(value, slope * a.yz);
+}
+
 // taken from: https://gist.github.com/DomNomNom/46bb1ce47f68d255fd5d
 
 // adapted from intersectCube in https://github.com/evanw/webgl-path-tracing/blob/master/webgl-path-tracing.js
@@ -57,3 +114,4 @@ float4 remap01(float4 v)
 {
     return saturate(0.5f * (1.0f + v));
 }
+#endif
\ No newline at end of file
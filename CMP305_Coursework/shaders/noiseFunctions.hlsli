@@ -147,4 +147,187 @@ float TerrainNoise(float2 pos, TerrainNoiseSettings terrainSettings)
         continentShape *= 1 + terrainSettings.oceanDepthMultiplier;
     
     return continentShape + mountainShape + ridgeShape;
+}
+
+// NOISE FUNCTIONS WITH GRADIENTS
+// Each returns float3(noise, d/dx, d/dy) with respect to pos; the noise is the same as the functions above
+
+float3 SimpleNoiseGrad(float2 pos, SimpleNoiseSettings settings)
+{
+    float3 noiseSum = 0.0f;
+    float f = settings.frequency;
+    float a = 1.0f;
+    
+    for (int octave = 0; octave < settings.octaves; octave++)
+    {
+        float3 noiseVal = snoiseGrad(f * pos + settings.offset);
+        noiseVal.yz *= f;
+        
+        noiseSum += noiseVal * a;
+        
+        f *= settings.lacunarity;
+        a *= settings.persistence;
+    }
+    
+    noiseSum *= settings.elevation;
+    noiseSum.x += settings.verticalShift;
+    return noiseSum;
+}
+
+
+// an octave of the ridges, from its noise (with the gradient scaled by its frequency)
+void RidgeOctaveGrad(float3 noise, RidgeNoiseSettings settings, float a, inout float3 noiseSum, inout float3 ridgeWeight)
+{
+    // 1 - abs(noise)
+    float3 noiseVal = float3(1.0f, 0.0f, 0.0f) - sign(noise.x) * noise;
+    // the slope of abs(v)^power is power * abs(v)^power / v
+    float powered = pow(abs(noiseVal.x), settings.power);
+    noiseVal.yz *= noiseVal.x != 0.0f ? settings.power * powered / noiseVal.x : 0.0f;
+    noiseVal.x = powered;
+    
+    noiseVal = mulGrad(noiseVal, ridgeWeight);
+    ridgeWeight = saturateGrad(noiseVal * settings.gain);
+    
+    noiseSum += noiseVal * a;
+}
+
+float3 RidgeNoiseGrad(float2 pos, RidgeNoiseSettings settings)
+{
+    float3 noiseSum = 0.0f;
+    float f = settings.frequency;
+    float a = 1.0f;
+    float3 ridgeWeight = float3(1.0f, 0.0f, 0.0f);
+    
+    for (int octave = 0; octave < settings.octaves; octave++)
+    {
+        float3 noise = snoiseGrad(f * pos + settings.offset);
+        noise.yz *= f;
+        
+        RidgeOctaveGrad(noise, settings, a, noiseSum, ridgeWeight);
+        
+        f *= settings.lacunarity;
+        a *= settings.persistence;
+    }
+    
+    return noiseSum * settings.elevation;
+}
+
+
+// an octave of the mountains, from its noise; a is the octave's amplitude, which depends on the octaves before it
+void MountainOctaveGrad(float3 noise, MountainNoiseSettings settings, inout float3 noiseSum, inout float3 a)
+{
+    float3 noiseVal1 = sign(noise.x) * noise;
+    float3 blend = smoothstepEdgeGrad(noiseVal1, settings.blending);
+    float3 noiseVal2 = mulGrad(noiseVal1, float3(1.0f - blend.x, -blend.yz));
+    
+    noiseSum += mulGrad(noiseVal2, a);
+    
+    float3 detail = smoothstepEdgeGrad(noiseVal1, settings.detail);
+    a = mulGrad(a, settings.persistence * float3(1.0f - detail.x, -detail.yz));
+}
+
+float3 MountainNoiseGrad(float2 pos, MountainNoiseSettings settings)
+{
+    float3 noiseSum = 0.0f;
+    float f = settings.frequency;
+    // each octave's amplitude depends on the octaves before it, so it has a gradient too
+    float3 a = float3(1.0f, 0.0f, 0.0f);
+    
+    for (int octave = 0; octave < settings.octaves; octave++)
+    {
+        float3 noise = snoiseGrad(f * pos + settings.offset);
+        noise.yz *= f;
+        
+        MountainOctaveGrad(noise, settings, noiseSum, a);
+        
+        f *= settings.lacunarity;
+    }
+    
+    return noiseSum * settings.elevation;
+}
+
+
+// MountainNoiseGrad and RidgeNoiseGrad together
+// when the layers have the same frequency, lacunarity and offset their octaves sample the same points, so each octave's noise
+// is evaluated once for both; otherwise they are evaluated apart
+void MountainRidgeNoiseGrad(float2 pos, MountainNoiseSettings mountainSettings, RidgeNoiseSettings ridgeSettings,
+    out float3 mountainShape, out float3 ridgeShape)
+{
+    if (mountainSettings.frequency != ridgeSettings.frequency || mountainSettings.lacunarity != ridgeSettings.lacunarity
+        || any(mountainSettings.offset != ridgeSettings.offset))
+    {
+        mountainShape = MountainNoiseGrad(pos, mountainSettings);
+        ridgeShape = RidgeNoiseGrad(pos, ridgeSettings);
+        return;
+    }
+    
+    float3 mountainSum = 0.0f, ridgeSum = 0.0f;
+    float3 mountainAmplitude = float3(1.0f, 0.0f, 0.0f);
+    float ridgeAmplitude = 1.0f;
+    float3 ridgeWeight = float3(1.0f, 0.0f, 0.0f);
+    float f = mountainSettings.frequency;
+    
+    int octaves = max(mountainSettings.octaves, ridgeSettings.octaves);
+    for (int octave = 0; octave < octaves; octave++)
+    {
+        float3 noise = snoiseGrad(f * pos + mountainSettings.offset);
+        noise.yz *= f;
+        
+        if (octave < mountainSettings.octaves)
+            MountainOctaveGrad(noise, mountainSettings, mountainSum, mountainAmplitude);
+        if (octave < ridgeSettings.octaves)
+        {
+            RidgeOctaveGrad(noise, ridgeSettings, ridgeAmplitude, ridgeSum, ridgeWeight);
+            ridgeAmplitude *= ridgeSettings.persistence;
+        }
+        
+        f *= mountainSettings.lacunarity;
+    }
+    
+    mountainShape = mountainSum * mountainSettings.elevation;
+    ridgeShape = ridgeSum * ridgeSettings.elevation;
+}
+
+// combines the layers of TerrainNoiseGrad, each evaluated on its own (so layers can be shared between biomes)
+// ridges are scaled by the mountains, so are left out (as 0) without them
+float3 CombineTerrainGrad(float3 continentShape, float3 mountainShape, float3 ridgeShape, TerrainNoiseSettings terrainSettings)
+{
+    ridgeShape = mulGrad(ridgeShape, smoothstepGrad(0, terrainSettings.ridgeSettings.ridgeThreshold, mountainShape));
+    
+    // create ocean floor
+    continentShape = smoothMaxGrad(continentShape, -terrainSettings.oceanFloorDepth, terrainSettings.oceanFloorSmoothing);
+    if (continentShape.x < 0)
+        continentShape *= 1 + terrainSettings.oceanDepthMultiplier;
+    
+    return continentShape + mountainShape + ridgeShape;
+}
+
+// the same, from the layers' octave sums evaluated with an elevation of 1 (and no vertical shift), so that biomes whose
+// layers differ only in elevation can share them
+float3 CombineTerrainSumsGrad(float3 continentSum, float3 mountainSum, float3 ridgeSum, TerrainNoiseSettings terrainSettings)
+{
+    float3 continentShape = continentSum * terrainSettings.continentSettings.elevation;
+    continentShape.x += terrainSettings.continentSettings.verticalShift;
+    
+    return CombineTerrainGrad(continentShape, mountainSum * terrainSettings.mountainSettings.elevation,
+        ridgeSum * terrainSettings.ridgeSettings.elevation, terrainSettings);
+}
+
+float3 TerrainNoiseGrad(float2 pos, TerrainNoiseSettings terrainSettings)
+{
+    // create continent shape
+    float3 continentShape = SimpleNoiseGrad(pos, terrainSettings.continentSettings);
+    
+    // create mountains
+    float3 mountainShape = 0, ridgeShape = 0;
+    if (terrainSettings.mountainSettings.elevation > 0.0f)
+    {
+        // create ridges, sharing octaves with the mountains where they line up
+        if (terrainSettings.ridgeSettings.elevation > 0.0f)
+            MountainRidgeNoiseGrad(pos, terrainSettings.mountainSettings, terrainSettings.ridgeSettings, mountainShape, ridgeShape);
+        else
+            mountainShape = MountainNoiseGrad(pos, terrainSettings.mountainSettings);
+    }
+    
+    return CombineTerrainGrad(continentShape, mountainShape, ridgeShape, terrainSettings);
 }
\ No newline at end of file
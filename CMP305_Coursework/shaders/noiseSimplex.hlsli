@@ -201,6 +201,74 @@ float snoise(float2 v)
     return 130.0 * dot(m, g);
 }
 
+// 2D noise with its analytic gradient, as float3(noise, d/dx, d/dy)
+// (not part of the original port; the noise value is computed exactly as snoise does)
+float3 snoiseGrad(float2 v)
+{
+    const float4 C = float4(
+		0.211324865405187, // (3.0-sqrt(3.0))/6.0
+		0.366025403784439, // 0.5*(sqrt(3.0)-1.0)
+	 -0.577350269189626, // -1.0 + 2.0 * C.x
+		0.024390243902439 // 1.0 / 41.0
+	);
+	
+// First corner
+    float2 i = floor(v + dot(v, C.yy));
+    float2 x0 = v - i + dot(i, C.xx);
+	
+// Other corners
+    int xLessEqual = step(x0.x, x0.y); // x <= y ?
+    int2 i1 =
+		int2(1, 0) * (1 - xLessEqual) // x > y
+		+ int2(0, 1) * xLessEqual // x <= y
+    ;
+    float4 x12 = x0.xyxy + C.xxzz;
+    x12.xy -= i1;
+	
+// Permutations
+    i = mod289(i); // Avoid truncation effects in permutation
+    float3 p = permute(
+		permute(
+				i.y + float3(0.0, i1.y, 1.0)
+		) + i.x + float3(0.0, i1.x, 1.0)
+	);
+	
+    float3 m = max(
+		0.5 - float3(
+			dot(x0, x0),
+			dot(x12.xy, x12.xy),
+			dot(x12.zw, x12.zw)
+		),
+		0.0
+	);
+    float3 m2 = m * m;
+    float3 m4 = m2 * m2;
+	
+// Gradients: 41 points uniformly over a line, mapped onto a diamond.
+    float3 x = 2.0 * frac(p * C.www) - 1.0;
+    float3 h = abs(x) - 0.5;
+    float3 ox = floor(x + 0.5);
+    float3 a0 = x - ox;
+
+// Normalise gradients implicitly by scaling m
+    float3 norm = 1.79284291400159 - 0.85373472095314 * (a0 * a0 + h * h);
+
+// Compute final noise value at P
+    float3 g;
+    g.x = a0.x * x0.x + h.x * x0.y;
+    g.yz = a0.yz * x12.xz + h.yz * x12.yw;
+	
+// Each corner contributes norm * m^4 * dot(gradient, offset), and every offset moves one to one with v;
+// d(m^4)/d(offset) = 4m^3 * -2 * offset (zero where m is clamped, as m is then 0)
+    float3 w = m4 * norm;
+    float3 dm = -8.0 * m2 * m * norm * g;
+    float2 grad =
+		w.x * float2(a0.x, h.x) + w.y * float2(a0.y, h.y) + w.z * float2(a0.z, h.z) +
+		dm.x * x0 + dm.y * x12.xy + dm.z * x12.zw;
+	
+    return 130.0 * float3(dot(w, g), grad);
+}
+
 // ----------------------------------- 3D -------------------------------------
 
 float snoise(float3 v)
@@ -0,0 +1,21 @@
+#include "terrainNoise.hlsli"
+
+// how many texels have each signature
+RWByteAddressBuffer gSignatureCounts : register(u1);
+// for each texel, its signature and its place among the texels with that signature
+RWStructuredBuffer<uint2> gTexelSignatures : register(u2);
+
+
+// first pass of sorted evaluation: counts the texels with each biome signature
+[numthreads(16, 16, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    if (dispatchThreadID.x >= resolution || dispatchThreadID.y >= resolution)
+        return;
+    
+    uint signature = BiomeSignature(GetTexelBlendSample(dispatchThreadID.xy));
+    
+    uint slot;
+    gSignatureCounts.InterlockedAdd(signature * 4, 1, slot);
+    gTexelSignatures[dispatchThreadID.y * resolution + dispatchThreadID.x] = uint2(signature, slot);
+}
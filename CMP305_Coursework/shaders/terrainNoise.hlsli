@@ -0,0 +1,158 @@
+#include "noiseFunctions.hlsli"
+#include "biomeHelper.hlsli"
+
+RWTexture2D<float4> gHeightmap : register(u0);
+
+Texture2D<uint> gBiomeMap : register(t0);
+StructuredBuffer<TerrainNoiseSettings> gGenerationSettingsBuffer : register(t1);
+// for each biome, the biome whose settings its continent, mountain and ridge layers are evaluated with (-1 when off);
+// biomes with equal layers, other than their elevations, share a source (see TerrainNoiseLayers)
+StructuredBuffer<int4> gLayerSourcesBuffer : register(t2);
+// biomes and blend weights over the tile, baked on the CPU (see BiomeBlendMap)
+Texture2D<uint2> gBiomeBlendMap : register(t3);
+
+SamplerState gBiomeMapSampler : register(s0);
+
+cbuffer WorldBuffer : register(b0)
+{
+    float2 offset;
+    uint resolution;
+    // resolution of gBiomeBlendMap, which is only read when it equals the heightmap's
+    uint blendMapResolution;
+}
+cbuffer BiomeMappingBuffer : register(b1)
+{
+    BiomeMappingBuffer mappingBuffer;
+}
+
+
+// the position in the world of a texel of the heightmap
+float2 GetTexelPosition(uint2 texel)
+{
+    return float2(texel) / float(resolution - 1) + offset;
+}
+
+// true when every texel of the block from firstTexel to lastTexel lies in the unblended middle of one biome map cell,
+// as most blocks away from biome borders do; biome is then that cell's biome
+// the cell and blend are monotonic along each axis within a cell, so the corners of the block stand for every texel in it
+bool IsSingleBiomeBlock(uint2 firstTexel, uint2 lastTexel, out uint biome)
+{
+    float2 first = GetTexelPosition(firstTexel);
+    float2 last = GetTexelPosition(lastTexel);
+    
+    uint2 cell = GetBiomeMapLocation(first, mappingBuffer);
+    biome = gBiomeMap.Load(uint3(cell, 0));
+    
+    return all(cell == GetBiomeMapLocation(last, mappingBuffer))
+        && all(GetBiomeBlend(first, mappingBuffer) == 0.0f) && all(GetBiomeBlend(last, mappingBuffer) == 0.0f);
+}
+
+// the biomes and blend weights at a texel of the heightmap; the biomes are read from the tile's blend map when it lines
+// up with the heightmap texel for texel, otherwise found from the biome map
+// the blend weights are always found again at full precision, so heights don't depend on the blend map
+BiomeBlendSample GetTexelBlendSample(uint2 texel)
+{
+    float2 pos = GetTexelPosition(texel);
+    if (blendMapResolution != resolution)
+        return GetBiomeBlendSample(gBiomeMap, pos, mappingBuffer);
+    
+    BiomeBlendSample blendSample = LoadBiomeBlendSample(gBiomeBlendMap, texel);
+    blendSample.blend = GetBiomeBlend(pos, mappingBuffer);
+    return blendSample;
+}
+
+// height at pos, blending as blendSample, and its gradient with respect to pos
+float3 TerrainAt(float2 pos, BiomeBlendSample blendSample)
+{
+    float2 biomeBlending = blendSample.blend;
+    
+    float3 terrain = 0.0f;
+    if (length(biomeBlending) == 0.0f)
+    {
+        terrain = TerrainNoiseGrad(pos, gGenerationSettingsBuffer[blendSample.biomes.x]);
+    }
+    else
+    {
+        // each distinct layer is evaluated once with an elevation of 1, and shared by every biome it belongs to
+        int biomes[4] = { blendSample.biomes.x, blendSample.biomes.y, blendSample.biomes.z, blendSample.biomes.w };
+        int4 sources[4];
+        float3 continents[4], mountains[4], ridges[4], h[4];
+        [unroll]
+        for (int i = 0; i < 4; i++)
+        {
+            sources[i] = gLayerSourcesBuffer[biomes[i]];
+            
+            // the first biome with the same source for each layer
+            int3 first = i;
+            [unroll]
+            for (int j = i - 1; j >= 0; j--)
+                first = sources[j].xyz == sources[i].xyz ? j : first;
+            
+            continents[i] = 0.0f;
+            mountains[i] = 0.0f;
+            ridges[i] = 0.0f;
+            [unroll]
+            for (int k = 0; k < i; k++)
+            {
+                continents[i] = first.x == k ? continents[k] : continents[i];
+                mountains[i] = first.y == k ? mountains[k] : mountains[i];
+                ridges[i] = first.z == k ? ridges[k] : ridges[i];
+            }
+            
+            if (first.x == i)
+            {
+                SimpleNoiseSettings continentSettings = gGenerationSettingsBuffer[sources[i].x].continentSettings;
+                continentSettings.elevation = 1.0f;
+                continentSettings.verticalShift = 0.0f;
+                continents[i] = SimpleNoiseGrad(pos, continentSettings);
+            }
+            
+            MountainNoiseSettings mountainSettings = gGenerationSettingsBuffer[max(sources[i].y, 0)].mountainSettings;
+            RidgeNoiseSettings ridgeSettings = gGenerationSettingsBuffer[max(sources[i].z, 0)].ridgeSettings;
+            mountainSettings.elevation = 1.0f;
+            ridgeSettings.elevation = 1.0f;
+            bool evaluateMountains = first.y == i && sources[i].y >= 0;
+            bool evaluateRidges = first.z == i && sources[i].z >= 0;
+            // mountains and ridges evaluated together share the octaves that line up
+            if (evaluateMountains && evaluateRidges)
+                MountainRidgeNoiseGrad(pos, mountainSettings, ridgeSettings, mountains[i], ridges[i]);
+            else if (evaluateMountains)
+                mountains[i] = MountainNoiseGrad(pos, mountainSettings);
+            else if (evaluateRidges)
+                ridges[i] = RidgeNoiseGrad(pos, ridgeSettings);
+            
+            h[i] = CombineTerrainSumsGrad(continents[i], mountains[i], ridges[i], gGenerationSettingsBuffer[biomes[i]]);
+        }
+        float3 h1 = h[0], h2 = h[1], h3 = h[2], h4 = h[3];
+        
+        float2 weights = abs(biomeBlending);
+        float2 weightSlopes = sign(biomeBlending) * GetBiomeBlendGradient(pos, mappingBuffer);
+        
+        float3 h13 = lerp(h1, h3, weights.y);
+        float3 h24 = lerp(h2, h4, weights.y);
+        terrain = lerp(h13, h24, weights.x);
+        
+        // the blend weights vary with pos too
+        terrain.y += (h24.x - h13.x) * weightSlopes.x;
+        terrain.z += lerp(h3.x - h1.x, h4.x - h2.x, weights.x) * weightSlopes.y;
+    }
+    
+    return terrain;
+}
+
+// must be a multiple of the prefix pass's 1024 threads (see terrainPrefix_cs.hlsl)
+#define SIGNATURE_COUNT 4096
+
+// texels with the same signature take the same path through TerrainAt: the biome at the texel when it isn't blended,
+// or MAX_BIOMES + a hash of the four biomes it blends, in order, when it is
+// blended signatures that share a hash are grouped together, which costs coherence but never changes a height
+uint BiomeSignature(BiomeBlendSample blendSample)
+{
+    if (length(blendSample.blend) == 0.0f)
+        return blendSample.biomes.x;
+    
+    // biomes are below MAX_BIOMES (32), so 5 bits each
+    uint4 biomes = blendSample.biomes;
+    uint packed = biomes.x | (biomes.y << 5) | (biomes.z << 10) | (biomes.w << 15);
+    return MAX_BIOMES + ((packed * 2654435761u) >> 12) % (SIGNATURE_COUNT - MAX_BIOMES);
+}
@@ -0,0 +1,22 @@
+#include "terrainNoise.hlsli"
+
+RWStructuredBuffer<uint> gSortedTexels : register(u3);
+
+
+// final pass of sorted evaluation: as terrainNoise_cs.hlsl, but threads take texels in signature order,
+// so the threads of a wave take the same path through TerrainAt everywhere but at the boundaries between signatures
+[numthreads(256, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    if (dispatchThreadID.x >= resolution * resolution)
+        return;
+    
+    uint index = gSortedTexels[dispatchThreadID.x];
+    uint2 texel = uint2(index % resolution, index / resolution);
+    
+    float3 terrain = TerrainAt(GetTexelPosition(texel), GetTexelBlendSample(texel));
+    
+    float4 v = gHeightmap[texel];
+    v.rgb = terrain;
+    gHeightmap[texel] = v;
+}
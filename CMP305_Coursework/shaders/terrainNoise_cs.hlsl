@@ -1,26 +1,8 @@
-#include "noiseFunctions.hlsli"
-#include "biomeHelper.hlsli"
-
-RWTexture2D<float4> gHeightmap : register(u0);
-
-Texture2D<int> gBiomeMap : register(t0);
-StructuredBuffer<TerrainNoiseSettings> gGenerationSettingsBuffer : register(t1);
-
-SamplerState gBiomeMapSampler : register(s0);
-
-cbuffer WorldBuffer : register(b0)
-{
-    float2 offset;
-    float2 padding0;
-}
-cbuffer BiomeMappingBuffer : register(b1)
-{
-    BiomeMappingBuffer mappingBuffer;
-}
+#include "terrainNoise.hlsli"
 
 
 [numthreads(16, 16, 1)]
-void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+void main(uint3 dispatchThreadID : SV_DispatchThreadID, uint3 groupID : SV_GroupID)
 {
     uint2 heightmapDims;
     gHeightmap.GetDimensions(heightmapDims.x, heightmapDims.y);
@@ -31,36 +13,20 @@ void main(uint3 dispatchThreadID : SV_DispatchThreadID)
     float2 uv = float2(dispatchThreadID.xy) / float2(heightmapDims - float2(1, 1));
     float2 pos = uv + offset;
     
-    uint2 biomeMapUV = GetBiomeMapLocation(pos, mappingBuffer);
-    float2 biomeBlending = GetBiomeBlend(pos, mappingBuffer);
-   
+    // the whole group takes the same branch: groups away from biome borders evaluate a single biome, with no blending
+    uint2 firstTexel = groupID.xy * 16;
+    uint2 lastTexel = min(firstTexel + 15, heightmapDims - 1);
+    uint biome;
     
-    float terrainHeight = 0.0f;
-    if (length(biomeBlending) == 0.0f)
-    {
-        int biome = asint(gBiomeMap.Load(uint3(biomeMapUV, 0)).r);
-        terrainHeight = TerrainNoise(pos, gGenerationSettingsBuffer[biome]);
-    }
+    // height, and its gradient with respect to pos
+    float3 terrain;
+    if (IsSingleBiomeBlock(firstTexel, lastTexel, biome))
+        terrain = TerrainNoiseGrad(pos, gGenerationSettingsBuffer[biome]);
     else
-    {
-        int b1 = asint(gBiomeMap.Load(uint3(biomeMapUV + uint2(0, 0), 0)).r);
-        int b2 = asint(gBiomeMap.Load(uint3(biomeMapUV + uint2(sign(biomeBlending.x), 0), 0)).r);
-        int b3 = asint(gBiomeMap.Load(uint3(biomeMapUV + uint2(0, sign(biomeBlending.y)), 0)).r);
-        int b4 = asint(gBiomeMap.Load(uint3(biomeMapUV + uint2(sign(biomeBlending.x), sign(biomeBlending.y)), 0)).r);
-        
-        float h1 = TerrainNoise(pos, gGenerationSettingsBuffer[b1]);
-        float h2 = b2 == b1 ? h1 : TerrainNoise(pos, gGenerationSettingsBuffer[b2]);
-        float h3 = b3 == b1 ? h1 : TerrainNoise(pos, gGenerationSettingsBuffer[b3]);
-        float h4 = b4 == b1 ? h1 : TerrainNoise(pos, gGenerationSettingsBuffer[b4]);
-        
-        terrainHeight = lerp(
-            lerp(h1, h3, abs(biomeBlending.y)),
-            lerp(h2, h4, abs(biomeBlending.y)),
-            abs(biomeBlending.x)
-        );
-    }
+        terrain = TerrainAt(pos, GetTexelBlendSample(dispatchThreadID.xy));
     
+    // height in r; the gradient in g and b lets the terrain shader light it without sampling neighbouring texels
     float4 v = gHeightmap[dispatchThreadID.xy];
-    v.r = terrainHeight;
+    v.rgb = terrain;
     gHeightmap[dispatchThreadID.xy] = v;
-}
\ No newline at end of file
+}
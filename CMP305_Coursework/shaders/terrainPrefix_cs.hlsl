@@ -0,0 +1,47 @@
+#include "terrainNoise.hlsli"
+
+// how many texels have each signature; replaced by where the texels with each signature start in sorted order
+RWByteAddressBuffer gSignatureCounts : register(u1);
+
+#define PREFIX_THREADS 1024
+#define COUNTS_PER_THREAD (SIGNATURE_COUNT / PREFIX_THREADS)
+
+groupshared uint gsTotals[PREFIX_THREADS];
+
+
+// second pass of sorted evaluation: an exclusive prefix sum over the signature counts, by a single group
+[numthreads(PREFIX_THREADS, 1, 1)]
+void main(uint3 groupThreadID : SV_GroupThreadID)
+{
+    uint thread = groupThreadID.x;
+    uint first = thread * COUNTS_PER_THREAD;
+    
+    // each thread sums a run of counts
+    uint counts[COUNTS_PER_THREAD];
+    uint total = 0;
+    [unroll]
+    for (uint i = 0; i < COUNTS_PER_THREAD; i++)
+    {
+        counts[i] = gSignatureCounts.Load((first + i) * 4);
+        total += counts[i];
+    }
+    gsTotals[thread] = total;
+    GroupMemoryBarrierWithGroupSync();
+    
+    // then the runs' totals are scanned across the group
+    for (uint stride = 1; stride < PREFIX_THREADS; stride *= 2)
+    {
+        uint previous = thread >= stride ? gsTotals[thread - stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gsTotals[thread] += previous;
+        GroupMemoryBarrierWithGroupSync();
+    }
+    
+    uint start = gsTotals[thread] - total;
+    [unroll]
+    for (uint j = 0; j < COUNTS_PER_THREAD; j++)
+    {
+        gSignatureCounts.Store((first + j) * 4, start);
+        start += counts[j];
+    }
+}
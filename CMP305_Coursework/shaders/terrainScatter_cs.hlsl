@@ -0,0 +1,20 @@
+#include "terrainNoise.hlsli"
+
+// where the texels with each signature start, after the prefix pass
+RWByteAddressBuffer gSignatureCounts : register(u1);
+RWStructuredBuffer<uint2> gTexelSignatures : register(u2);
+// texel indices, grouped by signature
+RWStructuredBuffer<uint> gSortedTexels : register(u3);
+
+
+// third pass of sorted evaluation: places each texel after all texels with lower signatures
+[numthreads(256, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint index = dispatchThreadID.x;
+    if (index >= resolution * resolution)
+        return;
+    
+    uint2 signature = gTexelSignatures[index];
+    gSortedTexels[gSignatureCounts.Load(signature.x * 4) + signature.y] = index;
+}
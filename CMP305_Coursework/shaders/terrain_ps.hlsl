@@ -5,7 +5,8 @@
 #include "noiseSimplex.hlsli"
 
 Texture2D heightmap : register(t0);
-Texture2D biomeMap : register(t1);
+// biomes and blend weights over this tile, baked on the CPU (see BiomeBlendMap)
+Texture2D<uint2> biomeBlendMap : register(t1);
 StructuredBuffer<BiomeTan> biomeTans : register(t2);
 
 SamplerState heightmapSampler : register(s0);
@@ -37,36 +38,14 @@ struct InputType
 
 float3 calculateNormal(float2 pos)
 {
-    const float gWorldCellSpace = 1 / 100.0f;
-	
-    const float gTexelCellSpaceU = 1.0f / 1024.0f;
-    const float gTexelCellSpaceV = 1.0f / 1024.0f;
-	
-	// calculate normal from displacement map
-    float2 leftTex = pos - float2(gTexelCellSpaceU, 0.0f);
-    float2 rightTex = pos + float2(gTexelCellSpaceU, 0.0f);
-    float2 topTex = pos - float2(0.0f, gTexelCellSpaceV);
-    float2 bottomTex = pos + float2(0.0f, gTexelCellSpaceV);
-	
-    float thisY = heightmap.SampleLevel(heightmapSampler, pos, 0).r;
-    float leftY = heightmap.SampleLevel(heightmapSampler, leftTex, 0).r;
-    float rightY = heightmap.SampleLevel(heightmapSampler, rightTex, 0).r;
-    float topY = heightmap.SampleLevel(heightmapSampler, topTex, 0).r;
-    float bottomY = heightmap.SampleLevel(heightmapSampler, bottomTex, 0).r;
-	
-    // slightly better estimation of normals at the heightmap edge
-    if (leftTex.x < 0.0f)
-        leftY = 2.0f * thisY - rightY;
-    if (rightTex.x > 1.0f)
-        rightY = 2.0f * thisY - leftY;
-    if (bottomTex.y > 1.0f)
-        bottomY = 2.0f * thisY - topY;
-    if (topTex.y < 0.0f)
-        topY = 2.0f * thisY - bottomY;
+    // the heightmap holds the gradient of the height with respect to pos in g and b
+    // it is exact at the edges of the heightmap, so neighbouring tiles' normals agree along their seams
+    float2 gradient = heightmap.SampleLevel(heightmapSampler, pos, 0).gb;
+    
+    // steepness thresholds in the biome tans are tuned to slopes measured over a texel (1 / 1024) against a world cell of 1 / 100
+    const float gSlopeScale = (1.0f / 1024.0f) / (1.0f / 100.0f);
     
-    float3 tangent = normalize(float3(2.0f * gWorldCellSpace, rightY - leftY, 0.0f));
-    float3 bitangent = normalize(float3(0.0f, bottomY - topY, -2.0f * gWorldCellSpace));
-    return normalize(cross(tangent, bitangent));
+    return normalize(float3(-gSlopeScale * gradient.x, 1.0f, -gSlopeScale * gradient.y));
 }
 
 // Calculate lighting intensity based on direction and normal. Combine with light colour.
@@ -84,12 +63,14 @@ float4 main(InputType input) : SV_TARGET
     // lighting:
     float4 lightColour = ambientColour + calculateDiffuse(-normalize(lightDirection), normal, diffuseColour);
     
-    // biome:
-    uint2 biomeMapUV = GetBiomeMapLocation(worldOffset + input.tex, mappingBuffer);
-    float2 biomeBlend = GetBiomeBlend(worldOffset + input.tex, mappingBuffer);
+    // biome, from the nearest texel of the blend map:
+    uint2 blendMapDims;
+    biomeBlendMap.GetDimensions(blendMapDims.x, blendMapDims.y);
+    uint2 blendMapTexel = uint2(input.tex * float2(blendMapDims - 1) + 0.5f);
+    BiomeBlendSample blendSample = LoadBiomeBlendSample(biomeBlendMap, min(blendMapTexel, blendMapDims - 1));
     
     // blend biome tans
-    BiomeTan biomeTan = BlendTans(biomeMap, biomeTans, biomeMapUV, biomeBlend);
+    BiomeTan biomeTan = BlendTans(biomeTans, blendSample);
     
     // steepness:
     // global up is always (0, 1, 0), so dot(normal, worldNormal) simplifies to normal.y
@@ -11,7 +11,7 @@ Texture2D normalMapA : register(t2);
 Texture2D normalMapB : register(t3);
 SamplerState normalMapSampler : register(s0);
 
-Texture2D biomeMap : register(t4);
+Texture2D<uint> biomeMap : register(t4);
 StructuredBuffer<BiomeTan> biomeTans : register(t5);
 
 
@@ -135,12 +135,12 @@ float4 main(InputType input) : SV_TARGET
         
         // water colour depends on biome
         // biome:
+        // the water covers every tile at once, so it finds the blending itself rather than reading the tiles' blend maps
         float2 pos = intersectionPoint.xz / 100.0f;
-        uint2 biomeMapUV = GetBiomeMapLocation(pos, mappingBuffer);
-        float2 biomeBlend = GetBiomeBlend(pos, mappingBuffer);
+        BiomeBlendSample blendSample = GetBiomeBlendSample(biomeMap, pos, mappingBuffer);
     
         // blend biome tans
-        BiomeTan biomeTan = BlendTans(biomeMap, biomeTans, biomeMapUV, biomeBlend);
+        BiomeTan biomeTan = BlendTans(biomeTans, blendSample);
         
         float4 waterColour = float4(lerp(biomeTan.shallowWaterColour, biomeTan.deepWaterColour, tDepth), 1.0f);
         
@@ -0,0 +1,19 @@
+// HeightmapBake.cpp
+// Command line heightmap tile generator, for machines without a GPU (e.g. Linux build servers)
+// The Windows build offers the same tool through CMP305_Coursework.exe --bake
+//
+// Builds with any C++14 compiler; NoiseSettings needs the DirectXMath headers (header only) on the include path:
+//	g++ -std=c++14 -O2 -pthread -I.. -I../../include -I<DirectXMath>/Inc HeightmapBake.cpp ../HeightmapBaker.cpp
+//		../BiomeBlending.cpp ../BiomeCatalog.cpp ../BiomePipeline.cpp ../BiomeStages.cpp ../BiomeKernels.cpp ../BiomeMapBuffer.cpp ../BiomeSettingsJson.cpp
+//		../BiomeLayerStack.cpp ../ContinentLattice.cpp ../NoiseGraph.cpp ../NoiseSettings.cpp ../SerializationHelper.cpp ../TerrainNoiseBounds.cpp
+//		../TerrainNoiseCPU.cpp ../TerrainNoiseFixed.cpp ../TerrainNoiseLayers.cpp ../../include/imGUI/imgui.cpp ../../include/imGUI/imgui_draw.cpp -o HeightmapBake
+//
+// usage: HeightmapBake <settings.json> <output directory> <min tile x> <min tile y> <max tile x> <max tile y> [threads] [resolution]
+//	[--band-limit] [--continent-error <height>] [--fixed-point]
+#include "HeightmapBaker.h"
+
+
+int main(int argc, char** argv)
+{
+	return HeightmapBaker::RunCommandLine(std::vector<std::string>(argv + 1, argv + argc));
+}